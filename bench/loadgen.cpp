@@ -0,0 +1,488 @@
+/**
+ * Closed loop HTTP/1.1 load generator for measuring a running server.
+ *
+ *     dinoscale_load [--host <ip>] [--port <port>] [--path <target>]
+ *                    [--connections <n>] [--threads <n>] [--pipeline <n>]
+ *                    [--duration <seconds>] [--warmup <seconds>]
+ *                    [--no-keepalive] [--json]
+ *
+ * Every connection keeps `--pipeline` requests in flight and sends the next
+ * one as soon as a response arrived. Without keep-alive every request opens
+ * a connection of its own, which measures connection setup as well.
+ * Latency is taken from queuing a request to receiving the last byte of its
+ * response, responses of the warmup period are not counted.
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int         port = 6969;
+    std::string path = "/";
+    unsigned    connections = 64;
+    unsigned    threads = 2;
+    unsigned    pipeline = 1;
+    double      duration = 10;  // seconds measured
+    double      warmup = 1;     // seconds before measuring
+    bool        keepAlive = true;
+    bool        json = false;
+};
+
+/* per thread results, merged once the threads are done */
+struct Stats {
+    std::vector<std::uint32_t> latencies;  // nanoseconds, clamped
+    std::uint64_t              responses = 0;
+    std::uint64_t              failedStatus = 0;  // 4xx and 5xx responses
+    std::uint64_t              socketErrors = 0;
+    std::uint64_t              bytes = 0;
+};
+
+struct Client {
+    int                           fd = -1;
+    bool                          connecting = false;
+    std::string                   output;
+    std::size_t                   sent = 0;
+    std::string                   input;
+    std::deque<Clock::time_point> inFlight;  // queue time of each request
+};
+
+class Worker {
+   private:
+    const Options&      options;
+    const sockaddr_in&  address;
+    std::string         request;
+    Clock::time_point   measureFrom;
+    Clock::time_point   stopAt;
+    int                 epollFd;
+    std::vector<Client> clients;
+    Stats               stats;
+
+    bool open(Client& client) {
+        client = Client();
+        client.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                           0);
+        if (client.fd < 0) {
+            return false;
+        }
+        int enable = 1;
+        setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &enable,
+                   sizeof(enable));
+        if (connect(client.fd, reinterpret_cast<const sockaddr*>(&address),
+                    sizeof(address)) != 0 &&
+            errno != EINPROGRESS) {
+            ::close(client.fd);
+            client.fd = -1;
+            return false;
+        }
+        client.connecting = true;
+
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.ptr = &client;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &event);
+
+        issue(client, options.keepAlive ? options.pipeline : 1);
+        return true;
+    }
+
+    void close(Client& client) {
+        if (client.fd >= 0) {
+            ::close(client.fd);  // also leaves the epoll set
+        }
+        client.fd = -1;
+    }
+
+    /* drops a broken connection and starts over with a new one */
+    void reopen(Client& client) {
+        close(client);
+        if (Clock::now() < stopAt) {
+            open(client);
+        }
+    }
+
+    void issue(Client& client, unsigned count) {
+        Clock::time_point now = Clock::now();
+        for (unsigned i = 0; i < count; i++) {
+            client.output.append(request);
+            client.inFlight.push_back(now);
+        }
+    }
+
+    /* waits for the socket to become writable only while output is left */
+    void watch(Client& client, bool writable) {
+        epoll_event event{};
+        event.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.ptr = &client;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &event);
+    }
+
+    bool flush(Client& client) {
+        while (client.sent < client.output.size()) {
+            ssize_t written =
+                send(client.fd, client.output.data() + client.sent,
+                     client.output.size() - client.sent, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    return false;
+                }
+                watch(client, true);
+                return true;
+            }
+            client.sent += written;
+        }
+        client.output.clear();
+        client.sent = 0;
+        watch(client, false);
+        return true;
+    }
+
+    /* length of the complete response at the front of `input`, 0 if the
+     * response is still incomplete, -1 if it cannot be parsed; `closing` is
+     * set when the server closes the connection after it */
+    static long responseLength(std::string_view input, int& status,
+                               bool& closing) {
+        std::size_t headEnd = input.find("\r\n\r\n");
+        if (headEnd == std::string_view::npos) {
+            return 0;
+        }
+        std::string_view head = input.substr(0, headEnd + 2);
+        if (head.size() < 12 || head.substr(0, 5) != "HTTP/") {
+            return -1;
+        }
+        std::from_chars(head.data() + 9, head.data() + 12, status);
+
+        std::size_t contentLength = 0;
+        std::size_t line = head.find("\r\n") + 2;
+        while (line < head.size()) {
+            std::size_t      next = head.find("\r\n", line);
+            std::string_view field = head.substr(line, next - line);
+            line = next + 2;
+            if (field.size() > 15 &&
+                strncasecmp(field.data(), "Content-Length:", 15) == 0) {
+                std::size_t value = field.find_first_not_of(' ', 15);
+                std::from_chars(field.data() + value,
+                                field.data() + field.size(), contentLength);
+            } else if (field.size() >= 17 &&
+                       strncasecmp(field.data(), "Connection: close", 17) ==
+                           0) {
+                closing = true;
+            }
+        }
+
+        std::size_t total = headEnd + 4 + contentLength;
+        return input.size() >= total ? static_cast<long>(total) : 0;
+    }
+
+    void record(Client& client, int status) {
+        Clock::time_point now = Clock::now();
+        Clock::time_point queued = client.inFlight.front();
+        client.inFlight.pop_front();
+        if (queued < measureFrom) {
+            return;
+        }
+
+        auto nanoseconds =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - queued)
+                .count();
+        stats.latencies.push_back(static_cast<std::uint32_t>(
+            std::min<long long>(nanoseconds, UINT32_MAX)));
+        stats.responses++;
+        if (status >= 400) {
+            stats.failedStatus++;
+        }
+    }
+
+    void readResponses(Client& client) {
+        char buffer[65536];
+        bool closed = false;
+        while (true) {
+            ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (received > 0) {
+                client.input.append(buffer, received);
+                stats.bytes += received;
+                continue;
+            }
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            closed = received == 0 ||
+                     (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+
+        std::size_t consumed = 0;
+        while (!client.inFlight.empty()) {
+            int  status = 0;
+            bool closing = false;
+            long length =
+                responseLength(std::string_view(client.input).substr(consumed),
+                               status, closing);
+            if (length <= 0) {
+                if (length < 0) {
+                    closed = true;
+                }
+                break;
+            }
+            consumed += length;
+            record(client, status);
+
+            if (!options.keepAlive || closing) {
+                // requests pipelined behind this response are lost
+                reopen(client);
+                return;
+            }
+            if (Clock::now() < stopAt) {
+                issue(client, 1);
+            }
+        }
+        client.input.erase(0, consumed);
+
+        if (closed) {
+            stats.socketErrors++;
+            reopen(client);
+            return;
+        }
+        if (!client.output.empty() && !flush(client)) {
+            stats.socketErrors++;
+            reopen(client);
+        }
+    }
+
+    void handle(Client& client, std::uint32_t events) {
+        if (client.connecting && (events & (EPOLLOUT | EPOLLERR))) {
+            int       error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(client.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0) {
+                stats.socketErrors++;
+                reopen(client);
+                return;
+            }
+            client.connecting = false;
+        }
+        if (events & EPOLLOUT) {
+            if (!flush(client)) {
+                stats.socketErrors++;
+                reopen(client);
+                return;
+            }
+        }
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            readResponses(client);
+        }
+    }
+
+   public:
+    Worker(const Options& options, const sockaddr_in& address,
+           unsigned connectionCount, Clock::time_point measureFrom,
+           Clock::time_point stopAt)
+        : options(options),
+          address(address),
+          measureFrom(measureFrom),
+          stopAt(stopAt),
+          epollFd(epoll_create1(EPOLL_CLOEXEC)),
+          clients(connectionCount) {
+        request = "GET " + options.path + " HTTP/1.1\r\nHost: " + options.host +
+                  (options.keepAlive ? "\r\n\r\n"
+                                     : "\r\nConnection: close\r\n\r\n");
+    }
+
+    ~Worker() { ::close(epollFd); }
+
+    void Run() {
+        for (Client& client : clients) {
+            if (!open(client)) {
+                stats.socketErrors++;
+            }
+        }
+
+        epoll_event events[256];
+        while (Clock::now() < stopAt) {
+            int count = epoll_wait(epollFd, events, 256, 100);
+            for (int i = 0; i < count; i++) {
+                handle(*static_cast<Client*>(events[i].data.ptr),
+                       events[i].events);
+            }
+        }
+        for (Client& client : clients) {
+            close(client);
+        }
+    }
+
+    Stats& Result() { return stats; }
+};
+
+double percentile(const std::vector<std::uint32_t>& sorted, double rank) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(rank * (sorted.size() - 1));
+    return sorted[index] / 1000.0;
+}
+
+void report(const Options& options, Stats& total) {
+    std::vector<std::uint32_t>& latencies = total.latencies;
+    std::sort(latencies.begin(), latencies.end());
+
+    double mean = 0;
+    for (std::uint32_t latency : latencies) {
+        mean += latency;
+    }
+    mean = latencies.empty() ? 0 : mean / latencies.size() / 1000.0;
+    double max = latencies.empty() ? 0 : latencies.back() / 1000.0;
+    double rate = total.responses / options.duration;
+
+    if (options.json) {
+        std::printf(
+            "{\"connections\": %u, \"threads\": %u, \"pipeline\": %u, "
+            "\"keep_alive\": %s, \"duration_s\": %.3f, \"requests\": %llu, "
+            "\"requests_per_sec\": %.1f, \"bytes_per_sec\": %.1f, "
+            "\"error_responses\": %llu, \"socket_errors\": %llu, "
+            "\"latency_us\": {\"mean\": %.2f, \"p50\": %.2f, \"p99\": %.2f, "
+            "\"p999\": %.2f, \"max\": %.2f}}\n",
+            options.connections, options.threads, options.pipeline,
+            options.keepAlive ? "true" : "false", options.duration,
+            static_cast<unsigned long long>(total.responses), rate,
+            total.bytes / options.duration,
+            static_cast<unsigned long long>(total.failedStatus),
+            static_cast<unsigned long long>(total.socketErrors), mean,
+            percentile(latencies, 0.5), percentile(latencies, 0.99),
+            percentile(latencies, 0.999), max);
+        return;
+    }
+
+    std::printf("%u connections, %u threads, pipeline %u, %s, %.1f s\n",
+                options.connections, options.threads, options.pipeline,
+                options.keepAlive ? "keep-alive" : "close", options.duration);
+    std::printf("  requests/sec  %12.1f\n", rate);
+    std::printf("  requests      %12llu\n",
+                static_cast<unsigned long long>(total.responses));
+    std::printf("  4xx/5xx       %12llu\n",
+                static_cast<unsigned long long>(total.failedStatus));
+    std::printf("  socket errors %12llu\n",
+                static_cast<unsigned long long>(total.socketErrors));
+    std::printf("  latency us    mean %.1f  p50 %.1f  p99 %.1f  p999 %.1f  "
+                "max %.1f\n",
+                mean, percentile(latencies, 0.5), percentile(latencies, 0.99),
+                percentile(latencies, 0.999), max);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view argument = argv[i];
+        bool             hasValue = i + 1 < argc;
+        if (argument == "--json") {
+            options.json = true;
+        } else if (argument == "--no-keepalive") {
+            options.keepAlive = false;
+        } else if (argument == "--host" && hasValue) {
+            options.host = argv[++i];
+        } else if (argument == "--port" && hasValue) {
+            options.port = std::atoi(argv[++i]);
+        } else if (argument == "--path" && hasValue) {
+            options.path = argv[++i];
+        } else if (argument == "--connections" && hasValue) {
+            options.connections = std::atoi(argv[++i]);
+        } else if (argument == "--threads" && hasValue) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (argument == "--pipeline" && hasValue) {
+            options.pipeline = std::atoi(argv[++i]);
+        } else if (argument == "--duration" && hasValue) {
+            options.duration = std::atof(argv[++i]);
+        } else if (argument == "--warmup" && hasValue) {
+            options.warmup = std::atof(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    options.threads = std::clamp(options.threads, 1u,
+                                 std::max(options.connections, 1u));
+    return options.connections > 0 && options.pipeline > 0 &&
+           options.duration > 0 && options.warmup >= 0;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s [--host <ip>] [--port <port>] "
+                     "[--path <target>] [--connections <n>] [--threads <n>] "
+                     "[--pipeline <n>] [--duration <seconds>] "
+                     "[--warmup <seconds>] [--no-keepalive] [--json]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+        std::fprintf(stderr, "invalid host address %s\n",
+                     options.host.c_str());
+        return 2;
+    }
+
+    Clock::time_point measureFrom =
+        Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>(options.warmup));
+    Clock::time_point stopAt =
+        measureFrom + std::chrono::duration_cast<Clock::duration>(
+                          std::chrono::duration<double>(options.duration));
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned i = 0; i < options.threads; i++) {
+        unsigned share = options.connections / options.threads +
+                         (i < options.connections % options.threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(options, address, share,
+                                                   measureFrom, stopAt));
+    }
+
+    std::vector<std::thread> threads;
+    for (std::unique_ptr<Worker>& worker : workers) {
+        threads.emplace_back(&Worker::Run, worker.get());
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Stats total;
+    for (std::unique_ptr<Worker>& worker : workers) {
+        Stats& stats = worker->Result();
+        total.latencies.insert(total.latencies.end(), stats.latencies.begin(),
+                               stats.latencies.end());
+        total.responses += stats.responses;
+        total.failedStatus += stats.failedStatus;
+        total.socketErrors += stats.socketErrors;
+        total.bytes += stats.bytes;
+    }
+
+    report(options, total);
+    return total.responses > 0 ? 0 : 1;
+}
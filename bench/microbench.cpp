@@ -0,0 +1,281 @@
+/**
+ * Microbenchmarks of the hot paths of a request: parsing, route lookup,
+ * response serialization and logging.
+ *
+ *     dinoscale_bench [--json] [--filter <text>] [--min-time <seconds>]
+ *
+ * Every benchmark is calibrated until one run takes at least `--min-time`,
+ * then measured three times; the median is reported. `--json` prints the
+ * results as one JSON document for regression tracking.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/HTTPRequest.hpp"
+#include "core/HTTPResponse.hpp"
+#include "core/Router.hpp"
+#include "logger/Logger.hpp"
+#include "metrics/Metrics.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string   name;
+    std::uint64_t iterations;
+    double        nsPerOp;
+};
+
+struct Options {
+    bool             json = false;
+    std::string_view filter;
+    double           minTime = 0.2;  // seconds per measured run
+};
+
+/* keeps the compiler from discarding a computed value */
+template <typename T>
+void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/* `body(n)` performs n operations */
+using Body = std::function<void(std::uint64_t)>;
+
+double timeRun(const Body& body, std::uint64_t iterations) {
+    Clock::time_point start = Clock::now();
+    body(iterations);
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+Result measure(std::string_view name, const Body& body,
+               const Options& options) {
+    std::uint64_t iterations = 1;
+    double        seconds = timeRun(body, iterations);
+    while (seconds < options.minTime) {
+        double scale = seconds > 0 ? options.minTime / seconds * 1.2 : 100;
+        iterations = std::max<std::uint64_t>(
+            iterations + 1, iterations * std::min(scale, 100.0));
+        seconds = timeRun(body, iterations);
+    }
+
+    double runs[3];
+    for (double& run : runs) {
+        run = timeRun(body, iterations);
+    }
+    std::sort(std::begin(runs), std::end(runs));
+    return {std::string(name), iterations, runs[1] * 1e9 / iterations};
+}
+
+/* collects what `WriteResponse` queues instead of sending it */
+struct CountingOutput {
+    std::size_t bytes = 0;
+
+    void Write(std::string_view data) { bytes += data.size(); }
+    void Write(const char* data) { Write(std::string_view(data)); }
+    void Write(std::string&& data) { bytes += data.size(); }
+    void WriteShared(std::string_view data, std::shared_ptr<const void>) {
+        bytes += data.size();
+    }
+};
+
+constexpr std::string_view smallRequest =
+    "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+constexpr std::string_view browserRequest =
+    "GET /static/css/site.css?v=42 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+    "(KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: style\r\n"
+    "Referer: https://www.example.com/\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Cookie: session=5f2b8c1e9a7d4e3f; theme=dark\r\n\r\n";
+
+Body parseBenchmark(std::string_view raw) {
+    return [raw](std::uint64_t iterations) {
+        DinoScale::HTTPRequestParser parser;
+        DinoScale::HTTPRequest       request;
+        for (std::uint64_t i = 0; i < iterations; i++) {
+            parser.Reset();
+            keep(parser.Parse(raw, request));
+        }
+    };
+}
+
+/* fills `request` with a GET of `target`, its views point into `storage` */
+void makeRequest(std::string& storage, std::string_view target,
+                 DinoScale::HTTPRequest& request) {
+    storage = "GET ";
+    storage.append(target);
+    storage.append(" HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+    DinoScale::HTTPRequestParser parser;
+    parser.Parse(storage, request);
+}
+
+/* a router shaped like a small REST API with a few static files */
+std::shared_ptr<DinoScale::Router> makeRouter() {
+    auto router = std::make_shared<DinoScale::Router>();
+    const char* resources[] = {"users",  "posts",    "comments", "albums",
+                               "photos", "todos",    "orders",   "products",
+                               "carts",  "invoices", "reviews",  "tags"};
+    for (const char* resource : resources) {
+        std::string base = std::string("/api/v1/") + resource;
+        router->Add(DinoScale::HTTPMethod::GET, base, {});
+        router->Add(DinoScale::HTTPMethod::POST, base, {});
+        router->Add(DinoScale::HTTPMethod::GET, base + "/:id", {});
+        router->Add(DinoScale::HTTPMethod::PUT, base + "/:id", {});
+        router->Add(DinoScale::HTTPMethod::GET, base + "/:id/history", {});
+    }
+    router->Add(DinoScale::HTTPMethod::GET, "/", {});
+    router->Add(DinoScale::HTTPMethod::GET, "/about", {});
+    router->Add(DinoScale::HTTPMethod::GET, "/static/*file", {});
+    router->Freeze();
+    return router;
+}
+
+Body routeBenchmark(std::shared_ptr<DinoScale::Router> router,
+                    std::string_view                  target) {
+    auto storage = std::make_shared<std::string>();
+    auto request = std::make_shared<DinoScale::HTTPRequest>();
+    makeRequest(*storage, target, *request);
+    return [router, storage, request](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; i++) {
+            keep(router->Match(*request));
+        }
+    };
+}
+
+Body responseBenchmark(std::size_t bodySize) {
+    return [bodySize](std::uint64_t iterations) {
+        DinoScale::HTTPResponse response;
+        CountingOutput          output;
+        std::string             content(bodySize, 'x');
+        for (std::uint64_t i = 0; i < iterations; i++) {
+            response.Clear();
+            response.SetHeader("Content-Type", "application/json");
+            response.SetHeader("Cache-Control", "no-store");
+            response.Send(content);
+            DinoScale::WriteResponse(output, response,
+                                     "Connection: keep-alive\r\n\r\n", false);
+        }
+        keep(output.bytes);
+    };
+}
+
+Body logBenchmark() {
+    return [](std::uint64_t iterations) {
+        std::shared_ptr<Logger> logger = Logger::GetInstance();
+        for (std::uint64_t i = 0; i < iterations; i++) {
+            logger->Info("{} {} answered in {} us", "GET", "/index.html", i);
+        }
+    };
+}
+
+Body metricsBenchmark() {
+    return [](std::uint64_t iterations) {
+        DinoScale::MetricsShard shard(64);
+        for (std::uint64_t i = 0; i < iterations; i++) {
+            shard.RecordRequest(i % 64, HTTPStatusCode::OK,
+                                std::chrono::microseconds(i % 5000));
+        }
+        keep(shard);
+    };
+}
+
+void print(const std::vector<Result>& results, bool json) {
+    if (!json) {
+        for (const Result& result : results) {
+            std::printf("%-28s %12.1f ns/op %14.0f op/s\n",
+                        result.name.c_str(), result.nsPerOp,
+                        1e9 / result.nsPerOp);
+        }
+        return;
+    }
+
+    std::printf("{\"benchmarks\": [");
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const Result& result = results[i];
+        std::printf("%s\n  {\"name\": \"%s\", \"iterations\": %llu, "
+                    "\"ns_per_op\": %.3f, \"ops_per_sec\": %.1f}",
+                    i == 0 ? "" : ",", result.name.c_str(),
+                    static_cast<unsigned long long>(result.iterations),
+                    result.nsPerOp, 1e9 / result.nsPerOp);
+    }
+    std::printf("\n]}\n");
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view argument = argv[i];
+        if (argument == "--json") {
+            options.json = true;
+        } else if (argument == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (argument == "--min-time" && i + 1 < argc) {
+            options.minTime = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--json] [--filter <text>] "
+                         "[--min-time <seconds>]\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    return options.minTime > 0;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    // log lines go nowhere, so the benchmark measures the logging thread
+    std::shared_ptr<Logger> logger = Logger::GetInstance();
+    logger->SetPreferences(LogLevel::Info, LogOutput::File, "/dev/null");
+
+    std::shared_ptr<DinoScale::Router> router = makeRouter();
+
+    std::vector<std::pair<std::string_view, Body>> benchmarks = {
+        {"parse/small", parseBenchmark(smallRequest)},
+        {"parse/browser", parseBenchmark(browserRequest)},
+        {"route/static", routeBenchmark(router, "/api/v1/reviews")},
+        {"route/capture", routeBenchmark(router, "/api/v1/orders/1234")},
+        {"route/wildcard", routeBenchmark(router, "/static/js/app.js")},
+        {"route/miss", routeBenchmark(router, "/api/v2/users")},
+        {"response/small", responseBenchmark(64)},
+        {"response/16k", responseBenchmark(16384)},
+        {"log/sync", logBenchmark()},
+        {"log/async", logBenchmark()},
+        {"metrics/record", metricsBenchmark()},
+    };
+
+    std::vector<Result> results;
+    for (const auto& [name, body] : benchmarks) {
+        if (name.find(options.filter) == std::string_view::npos) {
+            continue;
+        }
+        if (name == "log/async") {
+            logger->EnableAsync(1 << 20, LogOverflow::Block);
+        }
+        results.push_back(measure(name, body, options));
+    }
+
+    print(results, options.json);
+    return 0;
+}
@@ -1,10 +1,23 @@
+#include "ExampleAssets.hpp"
 #include "server.hpp"
 int main() {
     DinoScale::DinoScale ds = DinoScale::DinoScale();
-    ds.createRoute("GET", "/", "index.html");
-    ds.createRoute("GET", "/hello", "hello.html");
-    ds.createRoute("GET", "/night", "night.html");
+    // the pages are compiled in, the server runs from any directory
+    const DinoScale::EmbeddedBundle& pages = ExampleAssets::bundle;
+    ds.createRoute(DinoScale::HTTPMethod::GET, "/", *pages.Find("index.html"));
+    ds.createRoute(DinoScale::HTTPMethod::GET, "/hello",
+                   *pages.Find("hello.html"));
+    ds.createRoute(DinoScale::HTTPMethod::GET, "/night",
+                   *pages.Find("night.html"));
+    ds.MountAssets("/pages", pages);
+    ds.createRoute(DinoScale::HTTPMethod::GET, "/greet/:name",
+                   [](const DinoScale::HTTPRequest& request,
+                      DinoScale::HTTPResponse&      response) {
+                       response.Send("Hello, " +
+                                     std::string(request.Param("name")) +
+                                     "!\n");
+                   });
 
     ds.startListening();
     return 0;
-}
\ No newline at end of file
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
 namespace DinoScale {
 enum class HTTPMethod {
     GET,
@@ -12,4 +16,44 @@ enum class HTTPMethod {
     TRACE,
     PATCH
 };
+
+/** Number of `HTTPMethod` values, for tables indexed by method. */
+inline constexpr std::size_t HTTPMethodCount =
+    static_cast<std::size_t>(HTTPMethod::PATCH) + 1;
+
+namespace detail {
+inline constexpr std::pair<std::string_view, HTTPMethod> methodNames[] = {
+    {"GET",     HTTPMethod::GET    },
+    {"HEAD",    HTTPMethod::HEAD   },
+    {"POST",    HTTPMethod::POST   },
+    {"PUT",     HTTPMethod::PUT    },
+    {"DELETE",  HTTPMethod::DELETE },
+    {"CONNECT", HTTPMethod::CONNECT},
+    {"OPTIONS", HTTPMethod::OPTION },
+    {"TRACE",   HTTPMethod::TRACE  },
+    {"PATCH",   HTTPMethod::PATCH  },
+};
+}  // namespace detail
+
+/**
+ * @brief Maps the method token of a request line onto its `HTTPMethod`.
+ *
+ * @param token: Method as it appears on the wire, e.g. `GET`.
+ * @param method: Receives the matching method when the token is known.
+ * @return false if the token does not name a supported method.
+ */
+inline bool ParseHTTPMethod(std::string_view token, HTTPMethod& method) {
+    for (const auto& [name, value] : detail::methodNames) {
+        if (name == token) {
+            method = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Method token as sent on the wire, e.g. `OPTIONS` for `OPTION`. */
+constexpr std::string_view HTTPMethodName(HTTPMethod method) {
+    return detail::methodNames[static_cast<std::size_t>(method)].first;
+}
 }  // namespace DinoScale
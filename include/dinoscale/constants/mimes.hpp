@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string_view>
+#include <utility>
+
+#include "../utils/Strings.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Picks the `Content-Type` of a static file from its extension. Unknown
+ * extensions are served as `application/octet-stream`.
+ */
+inline std::string_view MimeTypeForPath(std::string_view path) {
+    static constexpr std::pair<std::string_view, std::string_view> mimeTypes[] =
+        {
+            {"html",  "text/html; charset=utf-8"      },
+            {"htm",   "text/html; charset=utf-8"      },
+            {"css",   "text/css; charset=utf-8"       },
+            {"js",    "text/javascript; charset=utf-8"},
+            {"mjs",   "text/javascript; charset=utf-8"},
+            {"json",  "application/json"              },
+            {"txt",   "text/plain; charset=utf-8"     },
+            {"csv",   "text/csv; charset=utf-8"       },
+            {"xml",   "application/xml"               },
+            {"svg",   "image/svg+xml"                 },
+            {"png",   "image/png"                     },
+            {"jpg",   "image/jpeg"                    },
+            {"jpeg",  "image/jpeg"                    },
+            {"gif",   "image/gif"                     },
+            {"webp",  "image/webp"                    },
+            {"avif",  "image/avif"                    },
+            {"ico",   "image/x-icon"                  },
+            {"woff",  "font/woff"                     },
+            {"woff2", "font/woff2"                    },
+            {"ttf",   "font/ttf"                      },
+            {"wasm",  "application/wasm"              },
+            {"pdf",   "application/pdf"               },
+            {"zip",   "application/zip"               },
+            {"mp4",   "video/mp4"                     },
+            {"webm",  "video/webm"                    },
+            {"mp3",   "audio/mpeg"                    },
+    };
+
+    std::size_t dot = path.rfind('.');
+    std::size_t slash = path.rfind('/');
+    if (dot != std::string_view::npos &&
+        (slash == std::string_view::npos || dot > slash)) {
+        std::string_view extension = path.substr(dot + 1);
+        for (const auto& [name, type] : mimeTypes) {
+            if (EqualsIgnoreCase(name, extension)) {
+                return type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+}  // namespace DinoScale
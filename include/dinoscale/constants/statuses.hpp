@@ -1,3 +1,10 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
 /**
  * @brief Will store the HTTP status messages as the key and the
  * status code as the value. For further reference, visit the mozilla
@@ -70,4 +77,220 @@ enum class HTTPStatusCode {
     Loop_Detected = 508,
     Not_Extended = 510,
     Network_Authentication_Required = 511
-};
\ No newline at end of file
+};
+
+/**
+ * @brief Reason phrase sent after the status code in the status line.
+ */
+constexpr std::string_view HTTPStatusReason(HTTPStatusCode status) {
+    switch (status) {
+        case HTTPStatusCode::Continue:
+            return "Continue";
+        case HTTPStatusCode::Switching_Protocols:
+            return "Switching Protocols";
+        case HTTPStatusCode::Processing:
+            return "Processing";
+        case HTTPStatusCode::Early_Hints:
+            return "Early Hints";
+        case HTTPStatusCode::OK:
+            return "OK";
+        case HTTPStatusCode::Created:
+            return "Created";
+        case HTTPStatusCode::Accepted:
+            return "Accepted";
+        case HTTPStatusCode::Non_Authoritative_Information:
+            return "Non-Authoritative Information";
+        case HTTPStatusCode::No_Content:
+            return "No Content";
+        case HTTPStatusCode::Reset_Content:
+            return "Reset Content";
+        case HTTPStatusCode::Partial_Content:
+            return "Partial Content";
+        case HTTPStatusCode::Multi_Status:
+            return "Multi-Status";
+        case HTTPStatusCode::Already_Reported:
+            return "Already Reported";
+        case HTTPStatusCode::IM_Used:
+            return "IM Used";
+        case HTTPStatusCode::Multiple_Choices:
+            return "Multiple Choices";
+        case HTTPStatusCode::Moved_Permanently:
+            return "Moved Permanently";
+        case HTTPStatusCode::Found:
+            return "Found";
+        case HTTPStatusCode::See_Other:
+            return "See Other";
+        case HTTPStatusCode::Not_Modified:
+            return "Not Modified";
+        case HTTPStatusCode::Temporary_Redirect:
+            return "Temporary Redirect";
+        case HTTPStatusCode::Permanent_Redirect:
+            return "Permanent Redirect";
+        case HTTPStatusCode::Bad_Request:
+            return "Bad Request";
+        case HTTPStatusCode::Unauthorized:
+            return "Unauthorized";
+        case HTTPStatusCode::Payment_Required:
+            return "Payment Required";
+        case HTTPStatusCode::Forbidden:
+            return "Forbidden";
+        case HTTPStatusCode::Not_Found:
+            return "Not Found";
+        case HTTPStatusCode::Method_Not_Allowed:
+            return "Method Not Allowed";
+        case HTTPStatusCode::Not_Acceptable:
+            return "Not Acceptable";
+        case HTTPStatusCode::Proxy_Authentication_Required:
+            return "Proxy Authentication Required";
+        case HTTPStatusCode::Request_Timeout:
+            return "Request Timeout";
+        case HTTPStatusCode::Conflict:
+            return "Conflict";
+        case HTTPStatusCode::Gone:
+            return "Gone";
+        case HTTPStatusCode::Length_Required:
+            return "Length Required";
+        case HTTPStatusCode::Precondition_Failed:
+            return "Precondition Failed";
+        case HTTPStatusCode::Payload_Too_Large:
+            return "Payload Too Large";
+        case HTTPStatusCode::URI_Too_Long:
+            return "URI Too Long";
+        case HTTPStatusCode::Unsupported_Media_Type:
+            return "Unsupported Media Type";
+        case HTTPStatusCode::Range_Not_Satisfiable:
+            return "Range Not Satisfiable";
+        case HTTPStatusCode::Expectation_Failed:
+            return "Expectation Failed";
+        case HTTPStatusCode::Im_A_Teapot:
+            return "I'm a teapot";
+        case HTTPStatusCode::Misdirected_Request:
+            return "Misdirected Request";
+        case HTTPStatusCode::Unprocessable_Content:
+            return "Unprocessable Content";
+        case HTTPStatusCode::Locked:
+            return "Locked";
+        case HTTPStatusCode::Failed_Dependency:
+            return "Failed Dependency";
+        case HTTPStatusCode::Too_Early_Experimental:
+            return "Too Early";
+        case HTTPStatusCode::Upgrade_Required:
+            return "Upgrade Required";
+        case HTTPStatusCode::Precondition_Required:
+            return "Precondition Required";
+        case HTTPStatusCode::Too_Many_Requests:
+            return "Too Many Requests";
+        case HTTPStatusCode::Request_Header_Fields_Too_Large:
+            return "Request Header Fields Too Large";
+        case HTTPStatusCode::Unavailable_For_Legal_Reasons:
+            return "Unavailable For Legal Reasons";
+        case HTTPStatusCode::Internal_Server_Error:
+            return "Internal Server Error";
+        case HTTPStatusCode::Not_Implemented:
+            return "Not Implemented";
+        case HTTPStatusCode::Bad_Gateway:
+            return "Bad Gateway";
+        case HTTPStatusCode::Service_Unavailable:
+            return "Service Unavailable";
+        case HTTPStatusCode::Gateway_Timeout:
+            return "Gateway Timeout";
+        case HTTPStatusCode::HTTP_Version_Not_Supported:
+            return "HTTP Version Not Supported";
+        case HTTPStatusCode::Variant_Also_Negotiates:
+            return "Variant Also Negotiates";
+        case HTTPStatusCode::Insufficient_Storage:
+            return "Insufficient Storage";
+        case HTTPStatusCode::Loop_Detected:
+            return "Loop Detected";
+        case HTTPStatusCode::Not_Extended:
+            return "Not Extended";
+        case HTTPStatusCode::Network_Authentication_Required:
+            return "Network Authentication Required";
+    }
+    return "Unknown";
+}
+
+/**
+ * @brief Whether a response with `status` carries content. Those of 1xx, 204
+ * and 304 never do and are sent without Content-Length, RFC 9110 section
+ * 8.6.
+ */
+constexpr bool HTTPStatusHasContent(HTTPStatusCode status) {
+    int code = static_cast<int>(status);
+    return code >= 200 && code != 204 && code != 304;
+}
+
+namespace HTTPStatusLines {
+constexpr int first = 100;
+constexpr int last = 599;
+
+constexpr bool isKnown(int code) {
+    return HTTPStatusReason(static_cast<HTTPStatusCode>(code)) != "Unknown";
+}
+
+/* "HTTP/1.1 " + three digits + ' ' + reason + CRLF */
+constexpr std::size_t lineLength(int code) {
+    return 13 + HTTPStatusReason(static_cast<HTTPStatusCode>(code)).size() + 2;
+}
+
+constexpr std::size_t totalLength = [] {
+    std::size_t total = 0;
+    for (int code = first; code <= last; code++) {
+        if (isKnown(code)) {
+            total += lineLength(code);
+        }
+    }
+    return total;
+}();
+
+/* every status line back to back, located through `offset` and `length`
+ * indexed by `code - first` */
+struct Table {
+    std::array<char, totalLength>               text{};
+    std::array<std::uint16_t, last - first + 1> offset{};
+    std::array<std::uint8_t, last - first + 1>  length{};
+};
+
+constexpr Table table = [] {
+    Table       result;
+    std::size_t position = 0;
+    for (int code = first; code <= last; code++) {
+        if (!isKnown(code)) {
+            continue;
+        }
+        result.offset[code - first] = position;
+        result.length[code - first] = lineLength(code);
+
+        for (char c : std::string_view("HTTP/1.1 ")) {
+            result.text[position++] = c;
+        }
+        result.text[position++] = '0' + code / 100;
+        result.text[position++] = '0' + code / 10 % 10;
+        result.text[position++] = '0' + code % 10;
+        result.text[position++] = ' ';
+        for (char c : HTTPStatusReason(static_cast<HTTPStatusCode>(code))) {
+            result.text[position++] = c;
+        }
+        result.text[position++] = '\r';
+        result.text[position++] = '\n';
+    }
+    return result;
+}();
+}  // namespace HTTPStatusLines
+
+/**
+ * @brief Complete status line of `status`, e.g. `HTTP/1.1 404 Not Found` with
+ * its CRLF, generated at compile time. Codes outside the enum get the status
+ * line of 500.
+ */
+constexpr std::string_view HTTPStatusLine(HTTPStatusCode status) {
+    int code = static_cast<int>(status);
+    if (code < HTTPStatusLines::first || code > HTTPStatusLines::last ||
+        HTTPStatusLines::table.length[code - HTTPStatusLines::first] == 0) {
+        code = static_cast<int>(HTTPStatusCode::Internal_Server_Error);
+    }
+    const HTTPStatusLines::Table& table = HTTPStatusLines::table;
+    std::size_t                   index = code - HTTPStatusLines::first;
+    return std::string_view(table.text.data() + table.offset[index],
+                            table.length[index]);
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <limits>
+#include <string_view>
+
+#include "../utils/HTTPDate.hpp"
+#include "../utils/SmallVector.hpp"
+#include "../utils/Strings.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Checks whether the `If-None-Match` list `value` names `etag`, using
+ * the weak comparison the header calls for: `W/` prefixes are ignored and
+ * `*` matches any current representation.
+ */
+constexpr bool ETagListMatches(std::string_view value, std::string_view etag) {
+    if (etag.substr(0, 2) == "W/") {
+        etag.remove_prefix(2);
+    }
+    while (true) {
+        while (!value.empty() && (value.front() == ' ' ||
+                                  value.front() == '\t' ||
+                                  value.front() == ',')) {
+            value.remove_prefix(1);
+        }
+        if (value.empty()) {
+            return false;
+        }
+        if (value.front() == '*') {
+            return true;
+        }
+        if (value.substr(0, 2) == "W/") {
+            value.remove_prefix(2);
+        }
+        if (value.empty() || value.front() != '"') {
+            return false;  // not an entity tag, the list is malformed
+        }
+        std::size_t closing = value.find('"', 1);
+        if (closing == std::string_view::npos) {
+            return false;
+        }
+        if (value.substr(0, closing + 1) == etag) {
+            return true;
+        }
+        value.remove_prefix(closing + 1);
+    }
+}
+
+/**
+ * @brief Evaluates `If-None-Match` and `If-Modified-Since` of a GET or HEAD
+ * request against the current validators of the selected representation.
+ * `If-Modified-Since` is only consulted when `If-None-Match` is absent.
+ *
+ * @return true if the client's copy is current and a 304 answers it.
+ */
+inline bool IsNotModified(std::string_view ifNoneMatch,
+                          std::string_view ifModifiedSince,
+                          std::string_view etag, std::time_t modified) {
+    if (!ifNoneMatch.empty()) {
+        return ETagListMatches(ifNoneMatch, etag);
+    }
+    std::time_t since;
+    return !ifModifiedSince.empty() &&
+           ParseHTTPDate(ifModifiedSince, since) && modified <= since;
+}
+
+/**
+ * @brief Evaluates `If-Range`: the range applies only when the validator in
+ * `value` still identifies the representation. Entity tags are compared
+ * strongly, dates must equal the modification time exactly.
+ */
+inline bool IfRangeMatches(std::string_view value, std::string_view etag,
+                           std::time_t modified) {
+    value = TrimWhitespace(value);
+    if (value.empty()) {
+        return true;
+    }
+    if (value.front() == '"' || value.substr(0, 2) == "W/") {
+        return value == etag && etag.substr(0, 2) != "W/";
+    }
+    std::time_t date;
+    return ParseHTTPDate(value, date) && date == modified;
+}
+
+/** @brief Bytes `[offset, offset + length)` of a representation. */
+struct ByteRange {
+    std::size_t offset;
+    std::size_t length;
+};
+
+enum class RangeStatus {
+    Ignored,        // no usable `Range`, the full representation is sent
+    Satisfiable,    // at least one range overlaps the representation
+    Unsatisfiable,  // valid ranges which all lie beyond its end
+};
+
+using ByteRanges = SmallVector<ByteRange, 4>;
+
+/**
+ * @brief Parses a `Range: bytes=...` header for a representation of `size`
+ * bytes into `ranges`, in the order requested, clipped to the
+ * representation and without the ranges lying beyond its end. `ranges` is
+ * left empty unless they are `Satisfiable`.
+ *
+ * A header in another unit or with invalid syntax is ignored, as permitted.
+ * Requests for more than `maxRanges` ranges, or whose ranges add up to more
+ * than the representation itself, are ignored too, so overlapping ranges
+ * cannot multiply the bytes sent for one file.
+ */
+inline RangeStatus ParseByteRanges(std::string_view value, std::size_t size,
+                                   std::size_t maxRanges, ByteRanges& ranges) {
+    ranges.clear();
+    value = TrimWhitespace(value);
+    if (value.size() < 6 || !EqualsIgnoreCase(value.substr(0, 6), "bytes=")) {
+        return RangeStatus::Ignored;
+    }
+    value.remove_prefix(6);
+
+    auto number = [](std::string_view digits, std::size_t& result) {
+        if (digits.empty()) {
+            return false;
+        }
+        result = 0;
+        for (char c : digits) {
+            if (c < '0' || c > '9' ||
+                result > (std::numeric_limits<std::size_t>::max() - 9) / 10) {
+                return false;
+            }
+            result = result * 10 + (c - '0');
+        }
+        return true;
+    };
+
+    // nothing of a header that is ignored is kept
+    auto ignore = [&ranges] {
+        ranges.clear();
+        return RangeStatus::Ignored;
+    };
+
+    std::size_t requested = 0;
+    std::size_t total = 0;
+    while (!value.empty()) {
+        std::size_t      comma = value.find(',');
+        std::string_view element = TrimWhitespace(value.substr(0, comma));
+        value.remove_prefix(comma == std::string_view::npos ? value.size()
+                                                            : comma + 1);
+        if (element.empty()) {
+            continue;  // lists may contain empty elements
+        }
+        if (++requested > maxRanges) {
+            return ignore();
+        }
+
+        std::size_t dash = element.find('-');
+        if (dash == std::string_view::npos) {
+            return ignore();
+        }
+        std::string_view firstText = element.substr(0, dash);
+        std::string_view lastText = element.substr(dash + 1);
+
+        ByteRange range;
+        if (firstText.empty()) {
+            // suffix range, the final bytes of the representation
+            std::size_t suffix;
+            if (!number(lastText, suffix)) {
+                return ignore();
+            }
+            if (suffix == 0 || size == 0) {
+                continue;
+            }
+            range.length = suffix < size ? suffix : size;
+            range.offset = size - range.length;
+        } else {
+            std::size_t first;
+            std::size_t last = size;
+            if (!number(firstText, first) ||
+                (!lastText.empty() &&
+                 (!number(lastText, last) || last < first))) {
+                return ignore();
+            }
+            if (first >= size) {
+                continue;
+            }
+            if (last >= size) {
+                last = size - 1;
+            }
+            range.offset = first;
+            range.length = last - first + 1;
+        }
+
+        total += range.length;
+        if (total > size) {
+            return ignore();
+        }
+        ranges.push_back(range);
+    }
+
+    if (requested == 0) {
+        return RangeStatus::Ignored;
+    }
+    return ranges.empty() ? RangeStatus::Unsatisfiable
+                          : RangeStatus::Satisfiable;
+}
+}  // namespace DinoScale
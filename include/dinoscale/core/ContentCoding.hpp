@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#ifdef DINOSCALE_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#include "../utils/Strings.hpp"
+
+namespace DinoScale {
+/** Content codings static files can be sent with. */
+enum class ContentCoding { Identity, Gzip, Brotli };
+
+/** Token of `coding` in `Accept-Encoding` and `Content-Encoding`. */
+constexpr std::string_view ContentCodingName(ContentCoding coding) {
+    switch (coding) {
+        case ContentCoding::Gzip:
+            return "gzip";
+        case ContentCoding::Brotli:
+            return "br";
+        default:
+            return "identity";
+    }
+}
+
+/** Extension of a precompressed sibling file, e.g. `app.js.gz`. */
+constexpr std::string_view ContentCodingSuffix(ContentCoding coding) {
+    switch (coding) {
+        case ContentCoding::Gzip:
+            return ".gz";
+        case ContentCoding::Brotli:
+            return ".br";
+        default:
+            return "";
+    }
+}
+
+/**
+ * @brief Checks whether the `Accept-Encoding` list `value` accepts `coding`,
+ * named explicitly or through `*`, with a non-zero quality. An explicit
+ * entry takes precedence over `*`.
+ */
+constexpr bool AcceptsCoding(std::string_view value, ContentCoding coding) {
+    std::string_view name = ContentCodingName(coding);
+    int              explicitly = -1;  // unknown, refused, accepted
+    int              wildcard = -1;
+    while (!value.empty()) {
+        std::size_t      comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        value = comma == std::string_view::npos ? std::string_view()
+                                                : value.substr(comma + 1);
+
+        std::size_t      semicolon = item.find(';');
+        std::string_view token = TrimWhitespace(item.substr(0, semicolon));
+        bool             accepted = true;
+        if (semicolon != std::string_view::npos) {
+            // q=0 in any spelling, such as 0.000, refuses the coding
+            std::string_view quality =
+                TrimWhitespace(item.substr(semicolon + 1));
+            if (quality.size() >= 3 && ToLowerASCII(quality[0]) == 'q' &&
+                quality[1] == '=' && quality[2] == '0') {
+                accepted = quality.find_first_not_of("0.", 2) !=
+                           std::string_view::npos;
+            }
+        }
+
+        if (EqualsIgnoreCase(token, name) ||
+            (coding == ContentCoding::Gzip &&
+             EqualsIgnoreCase(token, "x-gzip"))) {
+            explicitly = accepted;
+        } else if (token == "*") {
+            wildcard = accepted;
+        }
+    }
+    return explicitly >= 0 ? explicitly == 1 : wildcard == 1;
+}
+
+/**
+ * @brief Whether files of `contentType` shrink noticeably when compressed:
+ * text, JSON, XML, SVG and WebAssembly. Images, fonts, archives and media
+ * are compressed already.
+ */
+constexpr bool IsCompressible(std::string_view contentType) {
+    return contentType.substr(0, 5) == "text/" ||
+           contentType.substr(0, 16) == "application/json" ||
+           contentType.substr(0, 15) == "application/xml" ||
+           contentType.substr(0, 13) == "image/svg+xml" ||
+           contentType.substr(0, 16) == "application/wasm";
+}
+
+/**
+ * @brief Compresses `data` into the gzip format at the highest level, which
+ * is affordable as every static file is compressed once.
+ * @return false if zlib is unavailable or failed, `out` is undefined then.
+ */
+inline bool GzipCompress(std::string_view data, std::string& out) {
+#ifdef DINOSCALE_WITH_ZLIB
+    z_stream stream{};
+    // 16 added to the window bits selects the gzip wrapper
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out.resize(deflateBound(&stream, data.size()));
+    stream.next_in =
+        reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = out.size();
+    int status = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return status == Z_STREAM_END;
+#else
+    (void)data;
+    (void)out;
+    return false;
+#endif
+}
+}  // namespace DinoScale
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string_view>
+
+namespace DinoScale {
+/**
+ * @brief 64-bit FNV-1a of `key` finished with the murmur3 mixer, seeded so
+ * that the perfect hash of an `EmbeddedBundle` can derive independent slots.
+ */
+constexpr std::uint64_t EmbeddedHash(std::string_view key,
+                                     std::uint64_t    seed = 0) {
+    std::uint64_t hash = 14695981039346656037ull ^ seed;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/* slot of a key hashing to `hash` under the displacement of its bucket */
+constexpr std::uint64_t EmbeddedSlot(std::uint64_t hash,
+                                     std::uint32_t displacement) {
+    hash ^= (displacement + 1) * 0x9e3779b97f4a7c15ull;
+    hash ^= hash >> 29;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * @brief A file compiled into the binary by `dinoscale_embed`, with its
+ * response header serialized at build time like a `CachedFile`'s.
+ */
+struct EmbeddedAsset {
+    std::string_view path;  // relative to the embedded directory
+    std::string_view body;
+
+    /** `HTTP/1.1 200 OK` followed by Content-Type, Content-Length, ETag,
+     * Last-Modified and Accept-Ranges, each line terminated by CRLF. */
+    std::string_view header;
+    std::size_t      fieldsOffset;
+
+    std::string_view contentType;
+    std::string_view etag;  // derived from the content, stable across builds
+    std::string_view lastModified;
+    std::time_t      modified;
+
+    constexpr std::string_view Fields() const {
+        return header.substr(fieldsOffset);
+    }
+};
+
+/**
+ * @brief The assets of one embedded directory, generated into a header by
+ * the `dinoscale_embed_assets` CMake function and mounted with
+ * `DinoScale::MountAssets`.
+ *
+ * Paths are found through a perfect hash computed at build time with hash
+ * and displace: the hash of a path picks a bucket, whose displacement moves
+ * the keys of that bucket to free slots of the table.
+ * A lookup hashes the path once and compares it against the one asset in
+ * its slot, and works in constant expressions as well.
+ */
+class EmbeddedBundle {
+   private:
+    const EmbeddedAsset* assets = nullptr;
+    std::size_t          count = 0;
+    const std::uint32_t* displacements = nullptr;  // one per bucket
+    std::size_t          bucketCount = 0;
+    const std::int32_t*  slots = nullptr;  // asset index, -1 if free
+    std::size_t          slotCount = 0;
+
+   public:
+    /** An empty bundle. */
+    constexpr EmbeddedBundle() = default;
+
+    template <std::size_t Assets, std::size_t Buckets, std::size_t Slots>
+    constexpr EmbeddedBundle(const EmbeddedAsset (&assets)[Assets],
+                             const std::uint32_t (&displacements)[Buckets],
+                             const std::int32_t (&slots)[Slots])
+        : assets(assets),
+          count(Assets),
+          displacements(displacements),
+          bucketCount(Buckets),
+          slots(slots),
+          slotCount(Slots) {}
+
+    /** The asset at `path`, e.g. `css/site.css`, nullptr if there is none. */
+    constexpr const EmbeddedAsset* Find(std::string_view path) const {
+        if (count == 0) {
+            return nullptr;
+        }
+        std::uint64_t hash = EmbeddedHash(path);
+        std::uint64_t slot =
+            EmbeddedSlot(hash, displacements[hash % bucketCount]) % slotCount;
+        std::int32_t index = slots[slot];
+        if (index < 0 || assets[index].path != path) {
+            return nullptr;
+        }
+        return &assets[index];
+    }
+
+    constexpr std::size_t Size() const { return count; }
+
+    constexpr const EmbeddedAsset* begin() const { return assets; }
+    constexpr const EmbeddedAsset* end() const { return assets + count; }
+};
+}  // namespace DinoScale
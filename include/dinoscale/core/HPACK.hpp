@@ -0,0 +1,544 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace DinoScale {
+namespace detail {
+/* bit lengths of the canonical Huffman code of RFC 7541 appendix B, by
+ * symbol, 256 being end of string; the codes follow from the lengths */
+inline constexpr std::uint8_t huffmanLengths[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28, 28, 28,
+    28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28, 6, 10, 10, 12,
+    13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6, 5, 5, 5, 6, 6, 6, 6, 6, 6, 6,
+    7, 8, 15, 6, 12, 10, 13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6, 15, 5, 6, 5, 6, 5,
+    6, 6, 6, 5, 7, 7, 6, 6, 6, 5, 6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11,
+    14, 13, 28, 20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24,
+    23, 24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24, 22,
+    21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23, 21, 21, 22,
+    21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23, 26, 26, 20, 19, 22,
+    23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25, 19, 21, 26, 27, 27, 26, 27,
+    24, 21, 21, 26, 26, 28, 27, 27, 27, 20, 24, 20, 21, 22, 21, 21, 23, 22,
+    22, 25, 25, 24, 24, 26, 23, 26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27,
+    27, 27, 27, 27, 26, 30,
+};
+
+struct HuffmanCode {
+    std::array<std::uint32_t, 257> codes{};  // by symbol
+
+    /* codes of length `l` run from firstCode[l] to firstCode[l] +
+     * counts[l] - 1 and stand for symbols[offsets[l]] onwards */
+    std::array<std::uint32_t, 31>  firstCode{};
+    std::array<std::uint16_t, 31>  counts{};
+    std::array<std::uint16_t, 31>  offsets{};
+    std::array<std::uint16_t, 257> symbols{};
+};
+
+inline constexpr HuffmanCode huffmanCode = [] {
+    HuffmanCode huffman;
+    for (std::uint8_t length : huffmanLengths) {
+        huffman.counts[length]++;
+    }
+    std::uint32_t code = 0;
+    std::uint16_t offset = 0;
+    for (std::size_t length = 1; length < 31; length++) {
+        code = (code + huffman.counts[length - 1]) << 1;
+        huffman.firstCode[length] = code;
+        huffman.offsets[length] = offset;
+        offset += huffman.counts[length];
+    }
+    std::array<std::uint32_t, 31> next = huffman.firstCode;
+    for (std::size_t length = 1; length < 31; length++) {
+        for (std::uint16_t symbol = 0; symbol < 257; symbol++) {
+            if (huffmanLengths[symbol] == length) {
+                huffman.symbols[huffman.offsets[length] +
+                                (next[length] - huffman.firstCode[length])] =
+                    symbol;
+                huffman.codes[symbol] = next[length]++;
+            }
+        }
+    }
+    return huffman;
+}();
+
+/* the static table of RFC 7541 appendix A, index 1 first */
+inline constexpr std::pair<std::string_view, std::string_view>
+    hpackStaticTable[] = {
+        {":authority",                  ""             },
+        {":method",                     "GET"          },
+        {":method",                     "POST"         },
+        {":path",                       "/"            },
+        {":path",                       "/index.html"  },
+        {":scheme",                     "http"         },
+        {":scheme",                     "https"        },
+        {":status",                     "200"          },
+        {":status",                     "204"          },
+        {":status",                     "206"          },
+        {":status",                     "304"          },
+        {":status",                     "400"          },
+        {":status",                     "404"          },
+        {":status",                     "500"          },
+        {"accept-charset",              ""             },
+        {"accept-encoding",             "gzip, deflate"},
+        {"accept-language",             ""             },
+        {"accept-ranges",               ""             },
+        {"accept",                      ""             },
+        {"access-control-allow-origin", ""             },
+        {"age",                         ""             },
+        {"allow",                       ""             },
+        {"authorization",               ""             },
+        {"cache-control",               ""             },
+        {"content-disposition",         ""             },
+        {"content-encoding",            ""             },
+        {"content-language",            ""             },
+        {"content-length",              ""             },
+        {"content-location",            ""             },
+        {"content-range",               ""             },
+        {"content-type",                ""             },
+        {"cookie",                      ""             },
+        {"date",                        ""             },
+        {"etag",                        ""             },
+        {"expect",                      ""             },
+        {"expires",                     ""             },
+        {"from",                        ""             },
+        {"host",                        ""             },
+        {"if-match",                    ""             },
+        {"if-modified-since",           ""             },
+        {"if-none-match",               ""             },
+        {"if-range",                    ""             },
+        {"if-unmodified-since",         ""             },
+        {"last-modified",               ""             },
+        {"link",                        ""             },
+        {"location",                    ""             },
+        {"max-forwards",                ""             },
+        {"proxy-authenticate",          ""             },
+        {"proxy-authorization",         ""             },
+        {"range",                       ""             },
+        {"referer",                     ""             },
+        {"refresh",                     ""             },
+        {"retry-after",                 ""             },
+        {"server",                      ""             },
+        {"set-cookie",                  ""             },
+        {"strict-transport-security",   ""             },
+        {"transfer-encoding",           ""             },
+        {"user-agent",                  ""             },
+        {"vary",                        ""             },
+        {"via",                         ""             },
+        {"www-authenticate",            ""             },
+};
+
+inline constexpr std::size_t hpackStaticCount =
+    sizeof(hpackStaticTable) / sizeof(hpackStaticTable[0]);
+}  // namespace detail
+
+/**
+ * @brief Decodes the Huffman coded string `data` of a header block, appending
+ * the text to `out`.
+ * @return false if the padding is longer than 7 bits, is not a prefix of the
+ * end of string code, or the end of string code appears in the string.
+ */
+inline bool HuffmanDecode(std::string_view data, std::string& out) {
+    const detail::HuffmanCode& huffman = detail::huffmanCode;
+    std::uint32_t              code = 0;
+    std::size_t                length = 0;
+    for (char byte : data) {
+        unsigned char value = static_cast<unsigned char>(byte);
+        for (int bit = 7; bit >= 0; bit--) {
+            code = (code << 1) | ((value >> bit) & 1);
+            if (++length > 30) {
+                return false;
+            }
+            std::uint32_t index = code - huffman.firstCode[length];
+            if (code >= huffman.firstCode[length] &&
+                index < huffman.counts[length]) {
+                std::uint16_t symbol =
+                    huffman.symbols[huffman.offsets[length] + index];
+                if (symbol == 256) {
+                    return false;
+                }
+                out.push_back(static_cast<char>(symbol));
+                code = 0;
+                length = 0;
+            }
+        }
+    }
+    // the padding is the most significant bits of the end of string code
+    return length <= 7 && code == (1u << length) - 1;
+}
+
+/** Bytes `data` takes Huffman coded. */
+inline std::size_t HuffmanLength(std::string_view data) {
+    std::size_t bits = 0;
+    for (char byte : data) {
+        bits += detail::huffmanLengths[static_cast<unsigned char>(byte)];
+    }
+    return (bits + 7) / 8;
+}
+
+/** Appends `data` Huffman coded to `out`, padded with ones. */
+inline void HuffmanEncode(std::string_view data, std::string& out) {
+    std::uint64_t pending = 0;
+    std::size_t   bits = 0;
+    for (char byte : data) {
+        unsigned char symbol = static_cast<unsigned char>(byte);
+        std::size_t   length = detail::huffmanLengths[symbol];
+        pending = (pending << length) | detail::huffmanCode.codes[symbol];
+        bits += length;
+        while (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>(pending >> bits));
+        }
+    }
+    if (bits > 0) {
+        out.push_back(
+            static_cast<char>((pending << (8 - bits)) | (0xff >> bits)));
+    }
+}
+
+/**
+ * @brief The dynamic table of one direction of an HPACK context: the fields
+ * most recently inserted, newest first, evicted oldest first once their size
+ * exceeds the capacity.
+ */
+class HPACKTable {
+   public:
+    struct Entry {
+        std::string name;
+        std::string value;
+
+        /* RFC 7541 section 4.1, with the overhead of 32 per entry */
+        std::size_t Size() const { return name.size() + value.size() + 32; }
+    };
+
+   private:
+    std::deque<Entry> entries;
+    std::size_t       size = 0;
+    std::size_t       capacity = 4096;
+
+    void evict(std::size_t limit) {
+        while (size > limit) {
+            size -= entries.back().Size();
+            entries.pop_back();
+        }
+    }
+
+   public:
+    /** Inserts `entry`, evicting older ones. An entry larger than the whole
+     * table empties it and is not inserted. */
+    void Insert(Entry&& entry) {
+        std::size_t entrySize = entry.Size();
+        if (entrySize > capacity) {
+            evict(0);
+            return;
+        }
+        evict(capacity - entrySize);
+        size += entrySize;
+        entries.push_front(std::move(entry));
+    }
+
+    void SetCapacity(std::size_t bytes) {
+        capacity = bytes;
+        evict(capacity);
+    }
+
+    std::size_t Capacity() const { return capacity; }
+
+    std::size_t Count() const { return entries.size(); }
+
+    /** Entry `index`, 0 being the newest. */
+    const Entry& At(std::size_t index) const { return entries[index]; }
+};
+
+/**
+ * @brief Decoder of the header blocks one peer sends over an HTTP/2
+ * connection. The dynamic table lives as long as the connection, so every
+ * block must be decoded in the order it arrived, including those of
+ * streams which are refused.
+ */
+class HPACKDecoder {
+   private:
+    HPACKTable  table;
+    std::size_t maxCapacity = 4096;  // announced in our SETTINGS
+    std::string nameBuffer;          // Huffman decoded strings
+    std::string valueBuffer;
+
+    /* decodes an integer whose first byte keeps `prefix` bits for it */
+    static bool decodeInteger(const unsigned char*& position,
+                              const unsigned char* end, int prefix,
+                              std::size_t& value) {
+        if (position == end) {
+            return false;
+        }
+        std::size_t mask = (1u << prefix) - 1;
+        value = *position++ & mask;
+        if (value < mask) {
+            return true;
+        }
+        for (int shift = 0; position < end; shift += 7) {
+            if (shift > 28) {
+                return false;  // beyond anything a field could need
+            }
+            unsigned char byte = *position++;
+            value += static_cast<std::size_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* decodes a string literal, `out` views either the block or `buffer` */
+    static bool decodeString(const unsigned char*& position,
+                             const unsigned char* end, std::string& buffer,
+                             std::string_view& out) {
+        if (position == end) {
+            return false;
+        }
+        bool        huffman = *position & 0x80;
+        std::size_t length;
+        if (!decodeInteger(position, end, 7, length) ||
+            length > static_cast<std::size_t>(end - position)) {
+            return false;
+        }
+        std::string_view raw(reinterpret_cast<const char*>(position), length);
+        position += length;
+        if (!huffman) {
+            out = raw;
+            return true;
+        }
+        buffer.clear();
+        if (!HuffmanDecode(raw, buffer)) {
+            return false;
+        }
+        out = buffer;
+        return true;
+    }
+
+    /* the field at `index` of the static and dynamic tables combined */
+    bool lookup(std::size_t index, std::string_view& name,
+                std::string_view& value) const {
+        if (index == 0) {
+            return false;
+        }
+        if (index <= detail::hpackStaticCount) {
+            name = detail::hpackStaticTable[index - 1].first;
+            value = detail::hpackStaticTable[index - 1].second;
+            return true;
+        }
+        index -= detail::hpackStaticCount + 1;
+        if (index >= table.Count()) {
+            return false;
+        }
+        name = table.At(index).name;
+        value = table.At(index).value;
+        return true;
+    }
+
+   public:
+    /**
+     * @brief Decodes the complete header block `block`, calling
+     * `sink(name, value)` for every field in order. The views are only
+     * valid during the call.
+     * @return false on a decoding error, which breaks the connection's
+     * compression context.
+     */
+    template <typename Sink>
+    bool Decode(std::string_view block, Sink&& sink) {
+        auto position = reinterpret_cast<const unsigned char*>(block.data());
+        auto end = position + block.size();
+        bool fieldSeen = false;
+
+        while (position < end) {
+            unsigned char    first = *position;
+            std::size_t      index;
+            std::string_view name;
+            std::string_view value;
+
+            if (first & 0x80) {
+                // indexed field
+                if (!decodeInteger(position, end, 7, index) ||
+                    !lookup(index, name, value)) {
+                    return false;
+                }
+                sink(name, value);
+                fieldSeen = true;
+                continue;
+            }
+
+            if ((first & 0xe0) == 0x20) {
+                // dynamic table size update, only ahead of the fields
+                if (fieldSeen || !decodeInteger(position, end, 5, index) ||
+                    index > maxCapacity) {
+                    return false;
+                }
+                table.SetCapacity(index);
+                continue;
+            }
+
+            // literal field, indexed into the table with prefix 6, or not
+            // indexed (prefix 4, never indexed being the same to us)
+            bool indexed = (first & 0xc0) == 0x40;
+            if (!decodeInteger(position, end, indexed ? 6 : 4, index)) {
+                return false;
+            }
+            if (index == 0) {
+                if (!decodeString(position, end, nameBuffer, name)) {
+                    return false;
+                }
+            } else if (!lookup(index, name, value)) {
+                return false;
+            }
+            if (!decodeString(position, end, valueBuffer, value)) {
+                return false;
+            }
+            fieldSeen = true;
+
+            if (!indexed) {
+                sink(name, value);
+                continue;
+            }
+            // copied first, `name` may refer to an entry about to be evicted
+            HPACKTable::Entry entry{std::string(name), std::string(value)};
+            sink(std::string_view(entry.name), std::string_view(entry.value));
+            table.Insert(std::move(entry));
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Encoder of the header blocks sent over an HTTP/2 connection.
+ *
+ * Fields found in the static or dynamic table are sent as a single index.
+ * Others are sent as literals, Huffman coded whenever that is shorter, and
+ * inserted into the dynamic table if the caller expects them to repeat, such
+ * as `content-type`, so that later responses refer to them by index.
+ */
+class HPACKEncoder {
+   public:
+    enum class Indexing {
+        Incremental,  // insert into the dynamic table
+        None,         // e.g. values changing with every response
+        Never         // sensitive, intermediaries must not index it either
+    };
+
+   private:
+    static constexpr std::size_t maxCapacity = 4096;
+
+    HPACKTable  table;
+    bool        resized = false;  // a size update is due
+    std::size_t smallestCapacity = maxCapacity;  // since the last block
+
+    static void encodeInteger(std::string& out, unsigned char flags,
+                              int prefix, std::size_t value) {
+        std::size_t mask = (1u << prefix) - 1;
+        if (value < mask) {
+            out.push_back(static_cast<char>(flags | value));
+            return;
+        }
+        out.push_back(static_cast<char>(flags | mask));
+        value -= mask;
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static void encodeString(std::string& out, std::string_view data) {
+        std::size_t huffmanLength = HuffmanLength(data);
+        if (huffmanLength < data.size()) {
+            encodeInteger(out, 0x80, 7, huffmanLength);
+            HuffmanEncode(data, out);
+        } else {
+            encodeInteger(out, 0, 7, data.size());
+            out.append(data);
+        }
+    }
+
+   public:
+    /**
+     * @brief Applies the `SETTINGS_HEADER_TABLE_SIZE` of the peer. The table
+     * never grows beyond 4096 bytes, and the change is announced at the
+     * start of the next block.
+     */
+    void SetPeerCapacity(std::size_t bytes) {
+        std::size_t capacity = bytes < maxCapacity ? bytes : maxCapacity;
+        if (capacity == table.Capacity()) {
+            return;
+        }
+        if (capacity < smallestCapacity) {
+            smallestCapacity = capacity;
+        }
+        table.SetCapacity(capacity);
+        resized = true;
+    }
+
+    /** Starts a header block in `out`. */
+    void Begin(std::string& out) {
+        if (!resized) {
+            return;
+        }
+        // a shrink in between must be announced too, it evicted entries
+        if (smallestCapacity < table.Capacity()) {
+            encodeInteger(out, 0x20, 5, smallestCapacity);
+        }
+        encodeInteger(out, 0x20, 5, table.Capacity());
+        resized = false;
+        smallestCapacity = table.Capacity();
+    }
+
+    /** Appends the field `name: value`, `name` in lower case, to `out`. */
+    void Encode(std::string& out, std::string_view name,
+                std::string_view value, Indexing indexing) {
+        std::size_t nameIndex = 0;
+        for (std::size_t i = 0; i < detail::hpackStaticCount; i++) {
+            if (detail::hpackStaticTable[i].first != name) {
+                continue;
+            }
+            if (detail::hpackStaticTable[i].second == value) {
+                encodeInteger(out, 0x80, 7, i + 1);
+                return;
+            }
+            if (nameIndex == 0) {
+                nameIndex = i + 1;
+            }
+        }
+        if (indexing != Indexing::Never) {
+            for (std::size_t i = 0; i < table.Count(); i++) {
+                const HPACKTable::Entry& entry = table.At(i);
+                if (entry.name == name && entry.value == value) {
+                    encodeInteger(out, 0x80, 7,
+                                  detail::hpackStaticCount + 1 + i);
+                    return;
+                }
+            }
+        }
+
+        switch (indexing) {
+            case Indexing::Incremental:
+                encodeInteger(out, 0x40, 6, nameIndex);
+                break;
+            case Indexing::None:
+                encodeInteger(out, 0x00, 4, nameIndex);
+                break;
+            case Indexing::Never:
+                encodeInteger(out, 0x10, 4, nameIndex);
+                break;
+        }
+        if (nameIndex == 0) {
+            encodeString(out, name);
+        }
+        encodeString(out, value);
+        if (indexing == Indexing::Incremental) {
+            table.Insert({std::string(name), std::string(value)});
+        }
+    }
+};
+}  // namespace DinoScale
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+
+#include "../constants/methods.hpp"
+#include "../simd/Scan.hpp"
+#include "../utils/SmallVector.hpp"
+#include "../utils/Strings.hpp"
+
+namespace DinoScale {
+/**
+ * @brief A single `Name: value` pair. Both views point into the connection's
+ * read buffer and stay valid until the request is consumed.
+ */
+struct HTTPHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * @brief A path segment captured by a `:name` or `*name` route pattern. The
+ * name points into the router, the value into the read buffer.
+ */
+struct RouteParam {
+    std::string_view name;
+    std::string_view value;
+};
+
+class RequestBody;
+class HandlerIO;
+
+/**
+ * @brief Parsed request head. Nothing is copied out of the read buffer, every
+ * field is a view into it, and up to 32 headers are stored inline so that a
+ * typical request never touches the heap.
+ */
+class HTTPRequest {
+    friend class HTTPRequestParser;
+    friend class HTTP2Session;
+    friend class Router;
+    friend class DinoScale;
+
+   private:
+    HTTPMethod       method = HTTPMethod::GET;
+    std::string_view methodName;
+    std::string_view target;  // path and query as sent by the client
+    std::string_view path;
+    std::string_view query;  // without the leading '?'
+    int              versionMinor = 1;
+    std::size_t      headLength = 0;
+
+    SmallVector<HTTPHeader, 32> headers;
+    SmallVector<RouteParam, 8>  params;  // filled in by the router
+
+    const RequestBody* body = nullptr;  // set before the handler runs
+    HandlerIO*         io = nullptr;    // set for coroutine handlers
+
+   public:
+    HTTPRequest() = default;
+
+    HTTPRequest(const HTTPRequest&) = delete;
+    HTTPRequest& operator=(const HTTPRequest&) = delete;
+
+    HTTPMethod       Method() const { return method; }
+    std::string_view MethodName() const { return methodName; }
+    std::string_view Target() const { return target; }
+    std::string_view Path() const { return path; }
+    std::string_view Query() const { return query; }
+
+    /** `1` for HTTP/1.1, `0` for HTTP/1.0. */
+    int VersionMinor() const { return versionMinor; }
+
+    /** Bytes from the start of the request line up to and including the
+     * blank line, i.e. where the body starts. */
+    std::size_t HeadLength() const { return headLength; }
+
+    const SmallVector<HTTPHeader, 32>& Headers() const { return headers; }
+    const SmallVector<RouteParam, 8>&  Params() const { return params; }
+
+    /**
+     * @brief Value captured by the route parameter called `name`, e.g. `42`
+     * for `id` when `/users/:id` matched `/users/42`.
+     * @return Empty view if the route has no such parameter.
+     */
+    std::string_view Param(std::string_view name) const {
+        for (const RouteParam& param : params) {
+            if (param.name == name) {
+                return param.value;
+            }
+        }
+        return {};
+    }
+
+    /** Payload of the request, complete by the time a handler runs.
+     * Coroutine handlers read it with `IO().ReadBody()` instead. */
+    const RequestBody& Body() const { return *body; }
+
+    /** Body, timer and output operations of a coroutine handler, see
+     * `HandlerIO`. Only valid inside a coroutine handler. */
+    HandlerIO& IO() const { return *io; }
+
+    /**
+     * @brief Value of the first header called `name`, compared case
+     * insensitively.
+     * @return Empty view if the header is absent.
+     */
+    std::string_view Header(std::string_view name) const {
+        for (const HTTPHeader& header : headers) {
+            if (EqualsIgnoreCase(header.name, name)) {
+                return header.value;
+            }
+        }
+        return {};
+    }
+
+    bool HasHeader(std::string_view name) const {
+        for (const HTTPHeader& header : headers) {
+            if (EqualsIgnoreCase(header.name, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Whether the client wants the connection to stay open: the
+     * default for HTTP/1.1 unless it sent `Connection: close`, opt-in through
+     * `Connection: keep-alive` for HTTP/1.0.
+     */
+    bool KeepAlive() const {
+        std::string_view connection = Header("Connection");
+        return versionMinor >= 1 ? !HasToken(connection, "close")
+                                 : HasToken(connection, "keep-alive");
+    }
+
+    /**
+     * @brief Reads the `Content-Length` header, 0 when it is absent. Several
+     * fields, or a list of values in one, are accepted as long as all values
+     * are the same, RFC 9112 section 6.3.
+     * @return false if a value is not a plain decimal number, or the values
+     * differ.
+     */
+    bool ContentLength(std::size_t& length) const {
+        length = 0;
+        bool seen = false;
+        for (const HTTPHeader& header : headers) {
+            if (!EqualsIgnoreCase(header.name, "Content-Length")) {
+                continue;
+            }
+            std::string_view values = header.value;
+            while (true) {
+                std::size_t      comma = values.find(',');
+                std::string_view value =
+                    TrimWhitespace(values.substr(0, comma));
+                std::size_t parsed = 0;
+                auto        result = std::from_chars(
+                    value.data(), value.data() + value.size(), parsed);
+                if (value.empty() || result.ec != std::errc() ||
+                    result.ptr != value.data() + value.size() ||
+                    (seen && parsed != length)) {
+                    return false;
+                }
+                length = parsed;
+                seen = true;
+                if (comma == std::string_view::npos) {
+                    break;
+                }
+                values.remove_prefix(comma + 1);
+            }
+        }
+        return true;
+    }
+};
+
+enum class ParseStatus {
+    Complete,          // the head was parsed into the request
+    Incomplete,        // the blank line ending the head has not arrived yet
+    Malformed,         // syntax error, answer with 400
+    UnsupportedMethod  // unknown method token, answer with 501
+};
+
+/**
+ * @brief Resumable parser for request heads.
+ *
+ * Bytes can arrive over any number of reads. Each call only searches the bytes
+ * appended since the previous one for the end of the head, and once it is
+ * found the head is parsed in a single pass into views over the buffer. As the
+ * buffer may be reallocated between reads, the parser keeps offsets instead of
+ * pointers, and it must be `Reset` whenever the front of the buffer is
+ * consumed.
+ */
+class HTTPRequestParser {
+   private:
+    std::size_t scanned = 0;  // prefix known not to contain the end of head
+    std::size_t headEnd = 0;  // end of the head once found, 0 before that
+
+    /* RFC 9110 tchar: characters allowed in method and header names */
+    static constexpr std::array<bool, 256> tokenChars = [] {
+        std::array<bool, 256> table{};
+        for (int c = '0'; c <= '9'; c++) table[c] = true;
+        for (int c = 'a'; c <= 'z'; c++) table[c] = true;
+        for (int c = 'A'; c <= 'Z'; c++) table[c] = true;
+        for (char c : std::string_view("!#$%&'*+-.^_`|~")) {
+            table[static_cast<unsigned char>(c)] = true;
+        }
+        return table;
+    }();
+
+    static bool isTokenChar(char c) {
+        return tokenChars[static_cast<unsigned char>(c)];
+    }
+
+    /* consumes CRLF or a bare LF at `position` */
+    static bool skipLineBreak(const char*& position, const char* end) {
+        if (position < end && *position == '\n') {
+            position++;
+            return true;
+        }
+        if (end - position >= 2 && position[0] == '\r' && position[1] == '\n') {
+            position += 2;
+            return true;
+        }
+        return false;
+    }
+
+    static ParseStatus parseHead(const char* begin, const char* end,
+                                 HTTPRequest& request) {
+        const char* position = begin;
+
+        // a client may send empty lines ahead of the request line
+        while (position < end && (*position == '\r' || *position == '\n')) {
+            position++;
+        }
+
+        const char* methodEnd = Scan::FindTokenEnd(position, end);
+        if (methodEnd == position || methodEnd == end || *methodEnd != ' ') {
+            return ParseStatus::Malformed;
+        }
+        request.methodName = std::string_view(position, methodEnd - position);
+        position = methodEnd + 1;
+
+        const char* targetEnd = Scan::FindTokenEnd(position, end);
+        if (targetEnd == position || targetEnd == end || *targetEnd != ' ') {
+            return ParseStatus::Malformed;
+        }
+        request.target = std::string_view(position, targetEnd - position);
+        std::size_t queryStart = request.target.find('?');
+        request.path = request.target.substr(0, queryStart);
+        request.query = queryStart == std::string_view::npos
+                            ? std::string_view()
+                            : request.target.substr(queryStart + 1);
+        position = targetEnd + 1;
+
+        std::string_view version(position,
+                                 std::min<std::ptrdiff_t>(8, end - position));
+        if (version.size() != 8 || version.substr(0, 7) != "HTTP/1." ||
+            (version[7] != '0' && version[7] != '1')) {
+            return ParseStatus::Malformed;
+        }
+        request.versionMinor = version[7] - '0';
+        position += 8;
+        if (!skipLineBreak(position, end)) {
+            return ParseStatus::Malformed;
+        }
+
+        while (!skipLineBreak(position, end)) {
+            const char* nameEnd = position;
+            while (nameEnd < end && isTokenChar(*nameEnd)) {
+                nameEnd++;
+            }
+            // obsolete line folding starts with whitespace and is rejected
+            if (nameEnd == position || nameEnd == end || *nameEnd != ':') {
+                return ParseStatus::Malformed;
+            }
+
+            const char* valueStart = nameEnd + 1;
+            while (valueStart < end &&
+                   (*valueStart == ' ' || *valueStart == '\t')) {
+                valueStart++;
+            }
+            const char* valueEnd = Scan::FindLineEnd(valueStart, end);
+            const char* lineEnd = valueEnd;
+            if (!skipLineBreak(lineEnd, end)) {
+                return ParseStatus::Malformed;
+            }
+
+            request.headers.push_back(
+                {std::string_view(position, nameEnd - position),
+                 TrimWhitespace(
+                     std::string_view(valueStart, valueEnd - valueStart))});
+            position = lineEnd;
+        }
+
+        if (!ParseHTTPMethod(request.methodName, request.method)) {
+            return ParseStatus::UnsupportedMethod;
+        }
+        return ParseStatus::Complete;
+    }
+
+   public:
+    /**
+     * @brief Tries to parse the request at the front of `buffer`.
+     *
+     * @param buffer: Everything received so far, starting with the request.
+     * @param request: Filled in when the status is `Complete`, its views point
+     * into `buffer`.
+     */
+    ParseStatus Parse(std::string_view buffer, HTTPRequest& request) {
+        if (headEnd == 0) {
+            headEnd = Scan::FindHeadEnd(buffer.data(), buffer.size(), scanned);
+            if (headEnd == 0) {
+                scanned = buffer.size();
+                return ParseStatus::Incomplete;
+            }
+        }
+
+        request.headers.clear();
+        request.headLength = headEnd;
+        return parseHead(buffer.data(), buffer.data() + headEnd, request);
+    }
+
+    /** Forgets all progress, called when the buffer front is consumed. */
+    void Reset() {
+        scanned = 0;
+        headEnd = 0;
+    }
+};
+}  // namespace DinoScale
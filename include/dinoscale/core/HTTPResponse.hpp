@@ -0,0 +1,145 @@
+#pragma once
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "../constants/statuses.hpp"
+#include "../utils/HTTPDate.hpp"
+#include "../utils/Strings.hpp"
+#include "ResponseBody.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Response filled in by a route handler.
+ *
+ * The status line comes from the table generated at compile time, header
+ * fields set by the handler are kept in one buffer whose capacity survives
+ * `Clear`, and the body is a list of segments. The server adds `Date`,
+ * `Content-Length` and `Connection` itself when the response is written.
+ */
+class HTTPResponse {
+   private:
+    HTTPStatusCode status = HTTPStatusCode::OK;
+    std::string    fields;  // "Name: value\r\n" lines set by the handler
+    ResponseBody   body;
+    bool           hasContentType = false;
+
+   public:
+    HTTPResponse() = default;
+
+    HTTPStatusCode Status() const { return status; }
+    void           SetStatus(HTTPStatusCode code) { status = code; }
+
+    /** `HTTP/1.1 <code> <reason>` of the current status, CRLF included. */
+    std::string_view StatusLine() const { return HTTPStatusLine(status); }
+
+    /**
+     * @brief Adds a header field. Fields are sent in the order they were
+     * set, setting a name twice sends it twice.
+     */
+    void SetHeader(std::string_view name, std::string_view value) {
+        if (EqualsIgnoreCase(name, "Content-Type")) {
+            hasContentType = true;
+        }
+        fields.append(name);
+        fields.append(": ");
+        fields.append(value);
+        fields.append("\r\n");
+    }
+
+    /** Header fields set so far, each terminated by CRLF. */
+    std::string_view Fields() const { return fields; }
+
+    bool HasContentType() const { return hasContentType; }
+
+    /** Replaces the body with a copy of `content`. */
+    void Send(std::string_view content) {
+        body.Clear();
+        body.Append(content);
+    }
+
+    void Send(const char* content) { Send(std::string_view(content)); }
+
+    /** Replaces the body with `content`, taking over its bytes. */
+    void Send(std::string&& content) {
+        body.Clear();
+        body.Append(std::move(content));
+    }
+
+    /** Replaces the body with memory that outlives the server, such as a
+     * string literal, without copying it. */
+    void SendStatic(std::string_view content) {
+        body.Clear();
+        body.AppendStatic(content);
+    }
+
+    /** Appends a copy of `content` to the body. */
+    void Write(std::string_view content) { body.Append(content); }
+
+    ResponseBody&       Body() { return body; }
+    const ResponseBody& Body() const { return body; }
+
+    /** Resets to an empty 200 response, keeping allocated buffers. */
+    void Clear() {
+        status = HTTPStatusCode::OK;
+        fields.clear();
+        body.Clear();
+        hasContentType = false;
+    }
+};
+
+/**
+ * @brief Queues `response` on `output` without assembling it into one buffer:
+ * the head piece by piece, then the body segments. Owned segments up to
+ * 16 KiB are copied so that `response` keeps their buffers, larger ones and
+ * shared ones are moved out of it. `Output` provides the `Write` and
+ * `WriteShared` members of `Connection`. A status without content is sent
+ * with neither Content-Length nor body, whatever the handler put in it, as
+ * the client would read those bytes as the next response.
+ *
+ * @param connectionHeader: `Connection` header line which ends the head,
+ * blank line included.
+ * @param headOnly: Leaves out the body to answer a `HEAD` request.
+ */
+template <typename Output>
+void WriteResponse(Output& output, HTTPResponse& response,
+                   std::string_view connectionHeader, bool headOnly) {
+    constexpr std::size_t copyLimit = 16 * 1024;
+    ResponseBody&         body = response.Body();
+    bool                  hasContent = HTTPStatusHasContent(response.Status());
+
+    output.Write(response.StatusLine());
+    output.Write(response.Fields());
+    if (hasContent && !response.HasContentType() && !body.Empty()) {
+        output.Write("Content-Type: text/plain; charset=utf-8\r\n");
+    }
+
+    if (hasContent) {
+        char  length[48] = "Content-Length: ";
+        char* end = std::to_chars(length + 16, length + sizeof(length) - 2,
+                                  body.Size())
+                        .ptr;
+        *end++ = '\r';
+        *end++ = '\n';
+        output.Write(std::string_view(length, end - length));
+    }
+    output.Write(CachedDateHeader());
+    output.Write(connectionHeader);
+
+    if (hasContent && !headOnly) {
+        for (ResponseBody::Segment& segment : body.Segments()) {
+            if (segment.IsOwned() && segment.owned.size() <= copyLimit) {
+                // copied, so the response keeps its buffer for the next body
+                output.Write(std::string_view(segment.owned));
+            } else if (segment.IsOwned()) {
+                output.Write(std::move(segment.owned));
+            } else {
+                output.WriteShared(segment.view, std::move(segment.owner));
+            }
+        }
+    }
+    body.Clear();
+}
+}  // namespace DinoScale
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <coroutine>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "../utils/HTTPDate.hpp"
+#include "HTTPResponse.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Asynchronous operations of a coroutine handler on the connection of
+ * its request, reached through `HTTPRequest::IO`.
+ *
+ * Awaiting one suspends the handler without blocking the reactor thread,
+ * which goes on serving other connections and resumes the handler on the
+ * same thread once the body bytes arrived, the time passed or the output was
+ * handed to the kernel. Handlers therefore need no locking, but must not
+ * block either.
+ *
+ * ```cpp
+ * Task<HTTPResponse> upload(HTTPRequest& request) {
+ *     std::size_t total = 0;
+ *     while (true) {
+ *         std::string_view chunk = co_await request.IO().ReadBody();
+ *         if (chunk.empty()) break;
+ *         total += chunk.size();
+ *     }
+ *     HTTPResponse response;
+ *     response.Send(std::to_string(total));
+ *     co_return response;
+ * }
+ * ```
+ */
+class HandlerIO {
+    friend class DinoScale;
+
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    /** What a suspended handler waits for. */
+    enum class Wait {
+        None,   // running, or not suspended through this interface
+        Body,   // more of the request body
+        Timer,  // a point in time
+        Drain   // the queued output to be sent
+    };
+
+   private:
+    /* response state, set by the server before the handler starts */
+    std::string_view connectionHeader;
+    bool             chunked = true;    // the client understands chunks
+    bool             headOnly = false;  // bytes of a HEAD are left out
+    bool             streaming = false;
+    HTTPStatusCode   streamStatus = HTTPStatusCode::OK;
+
+    /* queues one chunk of a streamed body */
+    void writeChunk(std::string_view data) {
+        if (headOnly || data.empty()) {
+            return;
+        }
+        if (chunked) {
+            char  size[24];
+            char* end = std::to_chars(size, size + 20, data.size(), 16).ptr;
+            *end++ = '\r';
+            *end++ = '\n';
+            queue(std::string_view(size, end - size));
+        }
+        queue(data);
+        if (chunked) {
+            queue("\r\n");
+        }
+    }
+
+   protected:
+    /** Suspends the handler at `waiter` until `wait` is satisfied. */
+    virtual void suspendOn(Wait wait, std::coroutine_handle<> waiter,
+                           Clock::time_point wakeAt) = 0;
+
+    /** Body bytes received since the last `dropBodyChunk`. */
+    virtual std::string_view bodyChunk() const = 0;
+    virtual void             dropBodyChunk() = 0;
+    virtual bool             bodyComplete() const = 0;
+
+    /** Queues output for the client, copying `data`. */
+    virtual void queue(std::string_view data) = 0;
+
+    /** Gets ready for the handler of the next request. */
+    void beginExchange(std::string_view keepAliveHeader, bool chunkedBody,
+                       bool head) {
+        connectionHeader = keepAliveHeader;
+        chunked = chunkedBody;
+        headOnly = head;
+        streaming = false;
+        streamStatus = HTTPStatusCode::OK;
+    }
+
+    /**
+     * @brief Queues what remains of a streamed response: the body of
+     * `response` as the last chunk, then the end of the body.
+     */
+    void endStream(HTTPResponse& response) {
+        for (ResponseBody::Segment& segment : response.Body().Segments()) {
+            writeChunk(segment.IsOwned() ? std::string_view(segment.owned)
+                                         : segment.view);
+        }
+        response.Body().Clear();
+        if (chunked && !headOnly) {
+            queue("0\r\n\r\n");
+        }
+    }
+
+    ~HandlerIO() = default;
+
+   public:
+    /** Resumes with the next run of body bytes, empty once all of it was
+     * read. The bytes stay valid until the next `ReadBody`. */
+    struct BodyAwaiter {
+        HandlerIO& io;
+
+        bool await_ready() const {
+            io.dropBodyChunk();
+            return io.bodyComplete();
+        }
+
+        void await_suspend(std::coroutine_handle<> waiter) const {
+            io.suspendOn(Wait::Body, waiter, {});
+        }
+
+        std::string_view await_resume() const { return io.bodyChunk(); }
+    };
+
+    /** Resumes once `duration` has passed. */
+    struct SleepAwaiter {
+        HandlerIO&      io;
+        Clock::duration duration;
+
+        bool await_ready() const { return duration <= Clock::duration::zero(); }
+
+        void await_suspend(std::coroutine_handle<> waiter) const {
+            io.suspendOn(Wait::Timer, waiter, Clock::now() + duration);
+        }
+
+        void await_resume() const {}
+    };
+
+    /** Resumes once everything queued was handed to the kernel. */
+    struct DrainAwaiter {
+        HandlerIO& io;
+
+        bool await_ready() const { return io.headOnly; }
+
+        void await_suspend(std::coroutine_handle<> waiter) const {
+            io.suspendOn(Wait::Drain, waiter, {});
+        }
+
+        void await_resume() const {}
+    };
+
+    /**
+     * @brief Reads the request body as it arrives. Only the bytes of the
+     * current chunk are held in memory, however large the body is. A handler
+     * returning before the end of the body closes the connection after the
+     * response.
+     */
+    BodyAwaiter ReadBody() { return BodyAwaiter{*this}; }
+
+    /** Suspends the handler for `duration`. */
+    SleepAwaiter Sleep(Clock::duration duration) {
+        return SleepAwaiter{*this, duration};
+    }
+
+    /**
+     * @brief Sends the status and header fields of `head` right away and
+     * streams the body with `Write`, as `Transfer-Encoding: chunked` or, for
+     * HTTP/1.0 clients, until the connection closes. The body of `head` is
+     * ignored, the response returned by the handler ends the stream.
+     */
+    void BeginResponse(const HTTPResponse& head) {
+        if (streaming) {
+            return;
+        }
+        streaming = true;
+        streamStatus = head.Status();
+        queue(head.StatusLine());
+        queue(head.Fields());
+        if (!head.HasContentType()) {
+            queue("Content-Type: text/plain; charset=utf-8\r\n");
+        }
+        if (chunked) {
+            queue("Transfer-Encoding: chunked\r\n");
+        }
+        queue(CachedDateHeader());
+        queue(chunked ? connectionHeader : "Connection: close\r\n\r\n");
+    }
+
+    /**
+     * @brief Queues `data` as the next piece of a streamed body, starting a
+     * `200 OK` stream unless `BeginResponse` did. Awaiting the result waits
+     * until the client took everything queued, which bounds the memory of
+     * a response produced faster than it is read.
+     */
+    DrainAwaiter Write(std::string_view data) {
+        if (!streaming) {
+            BeginResponse(HTTPResponse());
+        }
+        writeChunk(data);
+        return DrainAwaiter{*this};
+    }
+
+    /** Whether the response is being streamed. */
+    bool IsStreaming() const { return streaming; }
+};
+}  // namespace DinoScale
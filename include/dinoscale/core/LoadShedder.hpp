@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace DinoScale {
+/**
+ * @brief Decides which requests queued for the handler pool still run, the
+ * CoDel way: it tells a burst, which the queue absorbs and which drains on
+ * its own, from a standing queue, which only adds latency. While the queue
+ * was empty at some point during the last `interval`, requests may wait up
+ * to `interval`. Once it stayed non-empty for longer, requests which waited
+ * more than `target` are answered with a 503 instead of being run. Refusing
+ * them is cheap, so the queue drains and the requests which are admitted
+ * wait about `target` at most.
+ *
+ * Safe to use from any thread.
+ */
+class LoadShedder {
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::duration target;
+    Clock::duration interval;
+
+    /* last time a request found the queue empty, since the clock epoch */
+    std::atomic<Clock::rep> lastEmpty;
+
+   public:
+    /** A zero `target` disables shedding. */
+    LoadShedder(Clock::duration target, Clock::duration interval)
+        : target(target),
+          interval(interval),
+          lastEmpty(Clock::now().time_since_epoch().count()) {}
+
+    /** Records that a request found the queue empty at `now`. */
+    void MarkEmpty(Clock::time_point now) {
+        lastEmpty.store(now.time_since_epoch().count(),
+                        std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Decides whether a request queued at `queuedAt` still runs when
+     * it is taken from the queue at `now`.
+     * @return false if it is to be shed.
+     */
+    bool Admit(Clock::time_point queuedAt, Clock::time_point now) const {
+        if (target.count() == 0) {
+            return true;
+        }
+        Clock::time_point empty(
+            Clock::duration(lastEmpty.load(std::memory_order_relaxed)));
+        bool standing = now - empty >= interval;
+        return now - queuedAt <= (standing ? target : interval);
+    }
+};
+}  // namespace DinoScale
@@ -0,0 +1,524 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "../utils/Strings.hpp"
+#include "HTTPRequest.hpp"
+
+namespace DinoScale {
+enum class BodyStatus {
+    Incomplete,     // more bytes are needed
+    Complete,       // the whole body was received
+    Malformed,      // invalid framing, answer with 400
+    TooLarge,       // exceeds the configured maximum, answer with 413
+    FieldsTooLarge, // trailer section beyond its limit, answer with 431
+    NotImplemented, // transfer coding besides chunked, answer with 501
+    StorageFailed   // the spool file could not be written, answer with 500
+};
+
+/**
+ * @brief Bounds applied to every request body.
+ */
+struct BodyLimits {
+    /** Bodies up to this size stay in memory, larger ones are spooled. */
+    std::size_t memoryLimit = 64 * 1024;
+
+    /** Largest accepted body, 0 accepts bodies of any size. */
+    std::size_t maxSize = 64 * 1024 * 1024;
+
+    /** Directory receiving the anonymous spool files. */
+    std::string spoolDirectory = "/tmp";
+
+    /** Largest chunk extension of a chunked body, and largest trailer
+     * section, in bytes. Defaults to the largest request head. */
+    std::size_t maxFieldSize = 30720;
+};
+
+/**
+ * @brief Incremental decoder for `Transfer-Encoding: chunked`. Input may be
+ * split at any byte, the decoder keeps its position inside the framing
+ * between calls and hands decoded payload to a sink as soon as it arrives.
+ * Chunk extensions and trailer fields are skipped, as long as they stay
+ * within the limit given with `SetFieldLimit`.
+ */
+class ChunkedDecoder {
+   private:
+    enum class State {
+        Size,         // hex digits of the chunk size
+        Extension,    // ";name=value" after the size
+        SizeLF,       // '\n' ending the size line
+        Data,         // chunk payload
+        DataCR,       // '\r' after the payload
+        DataLF,       // '\n' after the payload
+        TrailerStart, // start of a trailer line or the final empty line
+        Trailer,      // inside a trailer line
+        FinalLF,      // '\n' of the final empty line
+        Done
+    };
+
+    State         state = State::Size;
+    std::uint64_t chunkRemaining = 0;
+    int           sizeDigits = 0;
+    std::size_t   fieldBytes = 0;  // of the current extension or the trailer
+    std::size_t   fieldLimit = BodyLimits().maxFieldSize;
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    /* state following a complete size line */
+    State afterSizeLine() {
+        sizeDigits = 0;
+        fieldBytes = 0;
+        return chunkRemaining == 0 ? State::TrailerStart : State::Data;
+    }
+
+   public:
+    /**
+     * @brief Decodes as much of `input` as possible.
+     *
+     * @param consumed: Receives how many bytes of `input` were used, bytes of
+     * the next pipelined request are never consumed.
+     * @param sink: Called with every run of decoded payload, returns false to
+     * abort decoding.
+     */
+    template <typename Sink>
+    BodyStatus Decode(std::string_view input, std::size_t& consumed,
+                      Sink&& sink) {
+        std::size_t position = 0;
+
+        while (position < input.size() && state != State::Done) {
+            char c = input[position];
+
+            switch (state) {
+                case State::Size: {
+                    int digit = hexValue(c);
+                    if (digit >= 0) {
+                        // 15 hex digits keep the size far from overflowing
+                        if (++sizeDigits > 15) {
+                            return BodyStatus::TooLarge;
+                        }
+                        chunkRemaining = chunkRemaining * 16 + digit;
+                    } else if (sizeDigits == 0) {
+                        return BodyStatus::Malformed;
+                    } else if (c == ';' || c == ' ' || c == '\t') {
+                        state = State::Extension;
+                        fieldBytes = 0;
+                    } else if (c == '\r') {
+                        state = State::SizeLF;
+                    } else if (c == '\n') {
+                        state = afterSizeLine();
+                    } else {
+                        return BodyStatus::Malformed;
+                    }
+                    position++;
+                    break;
+                }
+                case State::Extension:
+                    if (c == '\r') {
+                        state = State::SizeLF;
+                    } else if (c == '\n') {
+                        state = afterSizeLine();
+                    } else if (++fieldBytes > fieldLimit) {
+                        return BodyStatus::Malformed;
+                    }
+                    position++;
+                    break;
+                case State::SizeLF:
+                    if (c != '\n') {
+                        return BodyStatus::Malformed;
+                    }
+                    state = afterSizeLine();
+                    position++;
+                    break;
+                case State::Data: {
+                    std::size_t available = input.size() - position;
+                    std::size_t length =
+                        chunkRemaining < available ? chunkRemaining : available;
+                    if (!sink(input.substr(position, length))) {
+                        consumed = position;
+                        return BodyStatus::TooLarge;
+                    }
+                    chunkRemaining -= length;
+                    position += length;
+                    if (chunkRemaining == 0) {
+                        state = State::DataCR;
+                    }
+                    break;
+                }
+                case State::DataCR:
+                    if (c == '\r') {
+                        state = State::DataLF;
+                    } else if (c == '\n') {
+                        state = State::Size;
+                    } else {
+                        return BodyStatus::Malformed;
+                    }
+                    position++;
+                    break;
+                case State::DataLF:
+                    if (c != '\n') {
+                        return BodyStatus::Malformed;
+                    }
+                    state = State::Size;
+                    position++;
+                    break;
+                case State::TrailerStart:
+                    if (c == '\r') {
+                        state = State::FinalLF;
+                    } else if (c == '\n') {
+                        state = State::Done;
+                    } else {
+                        state = State::Trailer;
+                        continue;  // counted as part of the line
+                    }
+                    position++;
+                    break;
+                case State::Trailer:
+                    // the limit covers all trailer lines together
+                    if (++fieldBytes > fieldLimit) {
+                        return BodyStatus::FieldsTooLarge;
+                    }
+                    if (c == '\n') {
+                        state = State::TrailerStart;
+                    }
+                    position++;
+                    break;
+                case State::FinalLF:
+                    if (c != '\n') {
+                        return BodyStatus::Malformed;
+                    }
+                    state = State::Done;
+                    position++;
+                    break;
+                case State::Done:
+                    break;
+            }
+        }
+
+        consumed = position;
+        return state == State::Done ? BodyStatus::Complete
+                                    : BodyStatus::Incomplete;
+    }
+
+    /** Bounds the bytes of one chunk extension and of the trailer section,
+     * both are rejected beyond it. */
+    void SetFieldLimit(std::size_t limit) { fieldLimit = limit; }
+
+    void Reset() {
+        state = State::Size;
+        chunkRemaining = 0;
+        sizeDigits = 0;
+        fieldBytes = 0;
+    }
+};
+
+/**
+ * @brief Body of the request currently being received on a connection.
+ *
+ * The body is fed straight from the connection input as bytes arrive, so the
+ * input buffer never holds more than one read worth of payload. Small bodies
+ * are kept in memory; once a body grows beyond `BodyLimits::memoryLimit` it is
+ * moved to an anonymous temporary file and every further byte is appended
+ * there, which keeps the memory used per upload bounded no matter how large
+ * it is. Both `Content-Length` and chunked framing are supported, as well
+ * as bodies whose end is signalled by the protocol carrying them.
+ */
+class RequestBody {
+   private:
+    enum class Framing {
+        Inactive,       // no request in progress
+        ContentLength,  // exactly `remaining` more bytes
+        Chunked,        // decoded by `decoder`
+        Delimited       // everything fed until `Finish`
+    };
+
+    Framing        framing = Framing::Inactive;
+    std::size_t    remaining = 0;
+    std::size_t    size = 0;
+    std::string    memory;     // payload while it is below the memory limit
+    int            spoolFd = -1;  // temporary file once it is not
+    bool           writeFailed = false;
+    bool           complete = false;
+    bool           streaming = false;  // `memory` holds the unread chunk
+    BodyLimits     limits;
+    ChunkedDecoder decoder;
+
+    /* moves the in-memory payload into a fresh temporary file */
+    bool spool() {
+#ifdef O_TMPFILE
+        spoolFd = open(limits.spoolDirectory.c_str(),
+                       O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+#endif
+        if (spoolFd < 0) {
+            // file systems without O_TMPFILE support
+            std::string path = limits.spoolDirectory + "/dinoscale-XXXXXX";
+            spoolFd = mkstemp(path.data());
+            if (spoolFd < 0) {
+                return false;
+            }
+            unlink(path.c_str());
+        }
+
+        bool written = writeAll(memory);
+        memory.clear();
+        memory.shrink_to_fit();
+        return written;
+    }
+
+    bool writeAll(std::string_view data) {
+        while (!data.empty()) {
+            ssize_t bytesWritten = write(spoolFd, data.data(), data.size());
+            if (bytesWritten < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data.remove_prefix(bytesWritten);
+        }
+        return true;
+    }
+
+    /* stores decoded payload, false once the body became too large */
+    bool append(std::string_view data) {
+        if (limits.maxSize != 0 && size + data.size() > limits.maxSize) {
+            return false;
+        }
+        size += data.size();
+
+        if (streaming) {
+            memory.append(data);
+            return true;
+        }
+        if (spoolFd < 0 && memory.size() + data.size() <= limits.memoryLimit) {
+            memory.append(data);
+            return true;
+        }
+        if (spoolFd < 0 && !spool()) {
+            writeFailed = true;
+        }
+        if (!writeFailed && !writeAll(data)) {
+            writeFailed = true;
+        }
+        return true;
+    }
+
+   public:
+    RequestBody() = default;
+
+    RequestBody(const RequestBody&) = delete;
+    RequestBody& operator=(const RequestBody&) = delete;
+
+    /**
+     * @brief Prepares for the body of `request` based on its framing headers,
+     * following RFC 9112 section 6.3. Requests carrying both framings, whose
+     * `Content-Length` values differ, or whose final transfer coding is not
+     * chunked are rejected as a smuggling attempt.
+     */
+    BodyStatus Begin(const HTTPRequest& request, const BodyLimits& bodyLimits) {
+        Reset();
+        limits = bodyLimits;
+
+        // the codings of all Transfer-Encoding fields, in order
+        bool     encoded = false;
+        unsigned codings = 0;
+        unsigned chunked = 0;
+        bool     chunkedLast = false;
+        for (const HTTPHeader& header : request.Headers()) {
+            if (!EqualsIgnoreCase(header.name, "Transfer-Encoding")) {
+                continue;
+            }
+            encoded = true;
+            std::string_view values = header.value;
+            while (!values.empty()) {
+                std::size_t      comma = values.find(',');
+                std::string_view coding =
+                    TrimWhitespace(values.substr(0, comma));
+                if (!coding.empty()) {
+                    chunkedLast = EqualsIgnoreCase(coding, "chunked");
+                    chunked += chunkedLast;
+                    codings++;
+                }
+                if (comma == std::string_view::npos) {
+                    break;
+                }
+                values.remove_prefix(comma + 1);
+            }
+        }
+        if (encoded) {
+            if (request.HasHeader("Content-Length") || !chunkedLast ||
+                chunked > 1) {
+                return BodyStatus::Malformed;
+            }
+            // chunked is the only coding we decode
+            if (codings > 1) {
+                return BodyStatus::NotImplemented;
+            }
+            framing = Framing::Chunked;
+            decoder.SetFieldLimit(limits.maxFieldSize);
+            return BodyStatus::Incomplete;
+        }
+
+        if (!request.ContentLength(remaining)) {
+            return BodyStatus::Malformed;
+        }
+        if (limits.maxSize != 0 && remaining > limits.maxSize) {
+            return BodyStatus::TooLarge;
+        }
+        framing = Framing::ContentLength;
+        complete = remaining == 0;
+        return complete ? BodyStatus::Complete : BodyStatus::Incomplete;
+    }
+
+    /**
+     * @brief Prepares for a body delimited by the protocol instead of header
+     * fields, e.g. the DATA frames of an HTTP/2 stream up to `END_STREAM`.
+     * Everything fed belongs to it until `Finish`.
+     */
+    void BeginDelimited(const BodyLimits& bodyLimits) {
+        Reset();
+        limits = bodyLimits;
+        framing = Framing::Delimited;
+    }
+
+    /** Completes a body started with `BeginDelimited`. */
+    void Finish() { complete = true; }
+
+    /**
+     * @brief Takes body bytes from the front of `input`.
+     * @param consumed: Receives the number of bytes taken, the rest belongs
+     * to the next request.
+     */
+    BodyStatus Feed(std::string_view input, std::size_t& consumed) {
+        consumed = 0;
+        BodyStatus status;
+
+        if (framing == Framing::ContentLength) {
+            consumed = remaining < input.size() ? remaining : input.size();
+            append(input.substr(0, consumed));
+            remaining -= consumed;
+            status = remaining == 0 ? BodyStatus::Complete
+                                    : BodyStatus::Incomplete;
+        } else if (framing == Framing::Delimited) {
+            consumed = input.size();
+            if (!append(input)) {
+                return BodyStatus::TooLarge;
+            }
+            status = BodyStatus::Incomplete;
+        } else if (framing == Framing::Chunked) {
+            status = decoder.Decode(
+                input, consumed,
+                [this](std::string_view data) { return append(data); });
+        } else {
+            return BodyStatus::Complete;
+        }
+
+        if (writeFailed) {
+            // the payload is incomplete, the handler must not see it
+            return BodyStatus::StorageFailed;
+        }
+        complete = status == BodyStatus::Complete;
+        return status;
+    }
+
+    /** Whether a request body is currently being received. */
+    bool IsActive() const { return framing != Framing::Inactive; }
+
+    /** Whether the last byte of the body was received. */
+    bool IsComplete() const { return complete; }
+
+    /**
+     * @brief Hands the payload to a reader chunk by chunk instead of storing
+     * it: `Feed` appends to the current chunk, which the reader takes with
+     * `Chunk` and releases with `DropChunk` before more is fed.
+     */
+    void Stream() { streaming = true; }
+
+    std::string_view Chunk() const { return memory; }
+
+    void DropChunk() { memory.clear(); }
+
+    /** Number of payload bytes received so far. */
+    std::size_t Size() const { return size; }
+
+    /** Whether the payload lives in a temporary file instead of memory. */
+    bool IsSpooled() const { return spoolFd >= 0; }
+
+    /** Descriptor of the spool file, -1 while the body is in memory. */
+    int SpoolFd() const { return spoolFd; }
+
+    /**
+     * @brief Copies up to `length` payload bytes starting at `offset`,
+     * wherever the body is stored.
+     * @return Number of bytes copied.
+     */
+    std::size_t Read(std::size_t offset, char* destination,
+                     std::size_t length) const {
+        if (offset >= size) {
+            return 0;
+        }
+        if (length > size - offset) {
+            length = size - offset;
+        }
+        if (!IsSpooled()) {
+            memory.copy(destination, length, offset);
+            return length;
+        }
+
+        std::size_t copied = 0;
+        while (copied < length) {
+            ssize_t bytesRead = pread(spoolFd, destination + copied,
+                                      length - copied, offset + copied);
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytesRead <= 0) {
+                break;
+            }
+            copied += bytesRead;
+        }
+        return copied;
+    }
+
+    /** The whole payload, only meaningful while it is not spooled. */
+    std::string_view InMemory() const { return memory; }
+
+    /** Releases the payload and gets ready for the next request. */
+    void Reset() {
+        framing = Framing::Inactive;
+        remaining = 0;
+        size = 0;
+        memory.clear();
+        writeFailed = false;
+        complete = false;
+        streaming = false;
+        decoder.Reset();
+        if (spoolFd >= 0) {
+            close(spoolFd);
+            spoolFd = -1;
+        }
+    }
+
+    /** Resets and frees the in-memory payload buffer as well. */
+    void Release() {
+        Reset();
+        std::string().swap(memory);
+    }
+
+    ~RequestBody() { Reset(); }
+};
+}  // namespace DinoScale
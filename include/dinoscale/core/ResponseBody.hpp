@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace DinoScale {
+/**
+ * @brief Body of a response as a list of segments, each either bytes owned by
+ * the body or a view of memory owned elsewhere. Segments are handed to the
+ * connection as they are and leave in one scatter-gather write together with
+ * the header, so a body is never concatenated or copied into an output
+ * buffer.
+ *
+ * `Clear` keeps the segment slots and the capacity of their owned strings,
+ * so a response object reused across requests stops allocating once it has
+ * served bodies of the usual shape.
+ */
+class ResponseBody {
+   public:
+    struct Segment {
+        std::string owned;  // used when `view` is empty
+
+        /** Bytes outside the body, kept alive by `owner` (null for memory
+         * which outlives the server, e.g. string literals). */
+        std::string_view            view;
+        std::shared_ptr<const void> owner;
+
+        bool IsOwned() const { return view.data() == nullptr; }
+
+        std::string_view Bytes() const {
+            return IsOwned() ? std::string_view(owned) : view;
+        }
+    };
+
+   private:
+    /* appends below this size are copied into the previous owned segment
+     * rather than starting a segment of their own */
+    static constexpr std::size_t coalesceLimit = 1024;
+
+    /* owned strings larger than this are freed rather than kept by `Clear` */
+    static constexpr std::size_t retainLimit = 64 * 1024;
+
+    std::vector<Segment> segments;   // slots past `used` are cleared
+    std::size_t          used = 0;   // segments of the current body
+    std::size_t          size = 0;
+
+    Segment& nextSegment() {
+        if (used == segments.size()) {
+            segments.emplace_back();
+        }
+        return segments[used++];
+    }
+
+    Segment* lastSegment() {
+        return used == 0 ? nullptr : &segments[used - 1];
+    }
+
+   public:
+    /** Appends a copy of `data`. */
+    void Append(std::string_view data) {
+        if (data.empty()) {
+            return;
+        }
+        size += data.size();
+        Segment* last = lastSegment();
+        if (last != nullptr && last->IsOwned() && data.size() < coalesceLimit) {
+            last->owned.append(data);
+            return;
+        }
+        nextSegment().owned.assign(data);
+    }
+
+    /** Appends `data` without copying its bytes. */
+    void Append(std::string&& data) {
+        if (data.empty()) {
+            return;
+        }
+        size += data.size();
+        nextSegment().owned = std::move(data);
+    }
+
+    /** Appends `data` by reference, it must outlive the server. */
+    void AppendStatic(std::string_view data) { AppendShared(data, nullptr); }
+
+    /** Appends `data` by reference, `owner` keeps it alive until it is sent. */
+    void AppendShared(std::string_view            data,
+                      std::shared_ptr<const void> owner) {
+        if (data.empty()) {
+            return;
+        }
+        size += data.size();
+        Segment& segment = nextSegment();
+        segment.view = data;
+        segment.owner = std::move(owner);
+    }
+
+    std::size_t Size() const { return size; }
+    bool        Empty() const { return size == 0; }
+
+    /** Segments in order, the connection may move them out. */
+    std::span<Segment> Segments() {
+        return std::span<Segment>(segments.data(), used);
+    }
+
+    void Clear() {
+        for (std::size_t i = 0; i < used; i++) {
+            Segment& segment = segments[i];
+            if (segment.owned.capacity() > retainLimit) {
+                std::string().swap(segment.owned);
+            } else {
+                segment.owned.clear();
+            }
+            segment.view = {};
+            segment.owner.reset();
+        }
+        used = 0;
+        size = 0;
+    }
+};
+}  // namespace DinoScale
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "HTTPResponse.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Opts a handler route into the `ResponseCache`, see
+ * `DinoScale::createRoute`.
+ */
+struct ResponseCachePolicy {
+    /** How long a response is served from the cache, 0 disables caching. */
+    std::chrono::milliseconds ttl{0};
+
+    /** Request headers whose values select different responses, e.g.
+     * `Accept-Language`. Method and target are always part of the key. */
+    std::vector<std::string> varyHeaders;
+};
+
+/**
+ * @brief A handler response serialized once for every request it answers:
+ * the head up to the Content-Length line, if its status has content, and the
+ * body. The Date and Connection headers are added per request.
+ */
+struct CachedResponse {
+    HTTPStatusCode status = HTTPStatusCode::OK;
+    std::string    head;
+    std::string    body;
+
+    /** Serializes `response`, leaving its body empty. */
+    static std::shared_ptr<CachedResponse> From(HTTPResponse& response) {
+        auto cached = std::make_shared<CachedResponse>();
+        cached->status = response.Status();
+        cached->head.append(response.StatusLine());
+        cached->head.append(response.Fields());
+        if (!HTTPStatusHasContent(cached->status)) {
+            response.Body().Clear();  // dropped, as by `WriteResponse`
+            return cached;
+        }
+
+        cached->body.reserve(response.Body().Size());
+        for (const ResponseBody::Segment& segment :
+             response.Body().Segments()) {
+            cached->body.append(segment.IsOwned()
+                                    ? std::string_view(segment.owned)
+                                    : segment.view);
+        }
+        response.Body().Clear();
+
+        if (!response.HasContentType() && !cached->body.empty()) {
+            cached->head.append("Content-Type: text/plain; charset=utf-8\r\n");
+        }
+        char  length[24];
+        char* end =
+            std::to_chars(length, length + sizeof(length), cached->body.size())
+                .ptr;
+        cached->head.append("Content-Length: ");
+        cached->head.append(length, end - length);
+        cached->head.append("\r\n");
+        return cached;
+    }
+
+    std::size_t Footprint() const { return head.size() + body.size(); }
+};
+
+/**
+ * @brief Shared cache of serialized handler responses with a time to live.
+ *
+ * Keys are spread over shards with a lock each, so reactors looking up
+ * different keys rarely contend. Each shard evicts its least recently used
+ * entries once it holds more than its part of the memory budget.
+ *
+ * Lookups of a missing or expired key are coalesced: the first one is told
+ * to produce the response and must `Complete` the key, lookups arriving
+ * meanwhile register a waiter which `Complete` calls with the result instead
+ * of running the handler again.
+ */
+class ResponseCache {
+   public:
+    using Clock = std::chrono::steady_clock;
+    using Waiter =
+        std::function<void(const std::shared_ptr<const CachedResponse>&)>;
+
+    enum class Lookup {
+        Hit,      // the cached response is fresh
+        Produce,  // the caller runs the handler and completes the key
+        Wait      // another request produces it, the waiter gets the result
+    };
+
+   private:
+    static constexpr std::size_t shardCount = 16;
+
+    struct Entry {
+        std::shared_ptr<const CachedResponse> response;  // null until stored
+        Clock::time_point                     expires;
+        bool                                  producing = false;
+        std::vector<Waiter>                   waiters;
+        std::list<std::string>::iterator      recency;  // position in `lru`
+    };
+
+    struct alignas(64) Shard {
+        std::mutex                             lock;
+        std::unordered_map<std::string, Entry> entries;
+        std::list<std::string>                 lru;  // most recent first
+        std::size_t                            memoryUsed = 0;
+    };
+
+    std::size_t                   shardBudget;
+    std::array<Shard, shardCount> shards;
+    std::hash<std::string_view>   hasher;
+
+    Shard& shardOf(const std::string& key) {
+        return shards[hasher(key) % shardCount];
+    }
+
+    /* caller holds the lock of `shard` */
+    static void forget(Shard& shard, Entry& entry) {
+        if (entry.response != nullptr) {
+            shard.memoryUsed -= entry.response->Footprint();
+            entry.response = nullptr;
+        }
+    }
+
+    /* drops idle entries from the cold end until `shard` fits its budget,
+     * caller holds its lock */
+    void evict(Shard& shard) {
+        auto key = shard.lru.end();
+        while (shard.memoryUsed > shardBudget && key != shard.lru.begin()) {
+            --key;
+            auto entry = shard.entries.find(*key);
+            if (entry->second.producing) {
+                continue;  // its waiters still need it
+            }
+            forget(shard, entry->second);
+            key = shard.lru.erase(key);
+            shard.entries.erase(entry);
+        }
+    }
+
+   public:
+    /** @param memoryBudget: Upper bound for the bytes of all responses. */
+    explicit ResponseCache(std::size_t memoryBudget)
+        : shardBudget(memoryBudget / shardCount) {}
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    /**
+     * @brief Looks `key` up at `now`. A `Hit` sets `cached`, a `Wait` stores
+     * the waiter returned by `makeWaiter`, which is called under the shard
+     * lock before any other thread can complete the key.
+     */
+    template <typename MakeWaiter>
+    Lookup Find(const std::string& key, Clock::time_point now,
+                std::shared_ptr<const CachedResponse>& cached,
+                MakeWaiter&& makeWaiter) {
+        Shard&                      shard = shardOf(key);
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        auto entry = shard.entries.find(key);
+        if (entry == shard.entries.end()) {
+            shard.lru.push_front(key);
+            entry = shard.entries.emplace(key, Entry()).first;
+            entry->second.recency = shard.lru.begin();
+        } else {
+            shard.lru.splice(shard.lru.begin(), shard.lru,
+                             entry->second.recency);
+        }
+
+        Entry& found = entry->second;
+        if (found.response != nullptr && found.expires > now) {
+            cached = found.response;
+            return Lookup::Hit;
+        }
+        if (found.producing) {
+            found.waiters.push_back(makeWaiter());
+            return Lookup::Wait;
+        }
+        found.producing = true;
+        return Lookup::Produce;
+    }
+
+    /**
+     * @brief Ends the production of `key` with `response`, stored until
+     * `expires` when `store` is set, and hands it to every waiter on the
+     * calling thread.
+     */
+    void Complete(const std::string&                           key,
+                  const std::shared_ptr<const CachedResponse>& response,
+                  Clock::time_point expires, bool store) {
+        std::vector<Waiter> waiters;
+        {
+            Shard&                      shard = shardOf(key);
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            auto entry = shard.entries.find(key);
+            if (entry == shard.entries.end()) {
+                return;  // not produced through `Find`
+            }
+            Entry& found = entry->second;
+            found.producing = false;
+            waiters.swap(found.waiters);
+            forget(shard, found);
+
+            if (store && response->Footprint() <= shardBudget) {
+                found.response = response;
+                found.expires = expires;
+                shard.memoryUsed += response->Footprint();
+                evict(shard);
+            } else {
+                shard.lru.erase(found.recency);
+                shard.entries.erase(entry);
+            }
+        }
+
+        for (Waiter& waiter : waiters) {
+            waiter(response);
+        }
+    }
+};
+}  // namespace DinoScale
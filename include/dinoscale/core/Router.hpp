@@ -0,0 +1,422 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../constants/methods.hpp"
+#include "EmbeddedAssets.hpp"
+#include "HTTPRequest.hpp"
+#include "HTTPResponse.hpp"
+#include "ResponseCache.hpp"
+#include "Task.hpp"
+#include "WebSocketFrame.hpp"
+
+namespace DinoScale {
+using RouteHandler = std::function<void(const HTTPRequest&, HTTPResponse&)>;
+
+/** Handler running as a coroutine on the reactor thread, see `HandlerIO`. */
+using AsyncRouteHandler = std::function<Task<HTTPResponse>(HTTPRequest&)>;
+
+class WebSocket;
+
+/**
+ * @brief Callbacks of a WebSocket route, all run on the reactor thread of
+ * the connection. `onOpen` sees the upgrade request, `onMessage` every
+ * complete text or binary message, valid until it returns, and `onClose`
+ * the code the connection closed with, once, whoever closed it. Unset
+ * callbacks are skipped.
+ */
+struct WebSocketHandlers {
+    std::function<void(WebSocket&, const HTTPRequest&)> onOpen;
+    std::function<void(WebSocket&, std::string_view, WebSocketOpcode)>
+                                                        onMessage;
+    std::function<void(WebSocket&, WebSocketCloseCode)> onClose;
+};
+
+/**
+ * @brief What a route serves: the output of `handler` or `asyncHandler` when
+ * one is set, an embedded `asset`, the asset of `bundle` named by the `*asset`
+ * capture, a WebSocket upgraded to when `webSocket` is set, otherwise the
+ * static file at `filePath`.
+ */
+struct Route {
+    std::string       pattern;
+    std::string       filePath;
+    RouteHandler      handler;
+    AsyncRouteHandler asyncHandler;
+
+    /* responses of `handler` are cached when its ttl is set */
+    ResponseCachePolicy cache = {};
+
+    /* compiled into the binary, both outlive the server */
+    const EmbeddedAsset*  asset = nullptr;
+    const EmbeddedBundle* bundle = nullptr;
+
+    /* owned, so its address stays put while the route is copied around */
+    std::shared_ptr<const WebSocketHandlers> webSocket = nullptr;
+
+    /* set by `Router::Add` */
+    HTTPMethod  method = HTTPMethod::GET;
+    std::size_t index = 0;  // position in the order routes were added
+};
+
+/**
+ * @brief Maps request paths onto routes, with one compressed radix tree per
+ * `HTTPMethod`.
+ *
+ * Patterns are made of static text and whole-segment captures: `:name`
+ * matches one non-empty segment and `*name`, only allowed as the last
+ * segment, the rest of the path, e.g. `/users/:id/posts`. Static text wins
+ * over a capture and `:name` over `*name`; when the preferred branch cannot
+ * match the whole path the lookup falls back to the next one.
+ *
+ * Routes are added while the server is configured. `Freeze` then lays every
+ * tree out in one flat array, breadth first, with the children of a node
+ * stored next to each other and their first bytes kept in a separate array
+ * that is scanned when picking a branch. Lookups walk that array without
+ * allocating, visiting one node per matched run of the path however many
+ * routes exist.
+ */
+class Router {
+   private:
+    static constexpr std::uint32_t none = UINT32_MAX;
+
+    enum class Kind : std::uint8_t { Static, Param, Wildcard };
+
+    /* mutable tree, only alive until `Freeze` */
+    struct BuildNode {
+        Kind        kind = Kind::Static;
+        std::string text;  // static bytes, or the capture name
+        int         route = -1;
+
+        std::vector<std::unique_ptr<BuildNode>> children;  // distinct 1st bytes
+        std::unique_ptr<BuildNode>              param;
+        std::unique_ptr<BuildNode>              wildcard;
+    };
+
+    struct Node {
+        Kind          kind;
+        std::uint32_t textOffset;  // into `text`
+        std::uint32_t textLength;
+        std::uint32_t firstChild;  // static children are contiguous
+        std::uint32_t childCount;
+        std::uint32_t param;
+        std::uint32_t wildcard;
+        std::int32_t  route;
+    };
+
+    std::array<std::unique_ptr<BuildNode>, HTTPMethodCount> builders;
+
+    std::vector<Node> nodes;
+    std::vector<char> firstBytes;  // first static byte of each node
+    std::string       text;        // static bytes and names of all nodes
+    std::array<std::uint32_t, HTTPMethodCount> roots;
+
+    std::deque<Route> routes;  // stable addresses for the returned pointers
+    bool              frozen = false;
+
+    static std::size_t commonPrefix(std::string_view a, std::string_view b) {
+        std::size_t length = std::min(a.size(), b.size());
+        std::size_t i = 0;
+        while (i < length && a[i] == b[i]) {
+            i++;
+        }
+        return i;
+    }
+
+    /* walks or extends the static path below `node` by `bytes`, splitting
+     * edges where they diverge, and returns the node ending at `bytes` */
+    static BuildNode* insertStatic(BuildNode* node, std::string_view bytes) {
+        while (!bytes.empty()) {
+            auto child = std::find_if(
+                node->children.begin(), node->children.end(),
+                [&](const auto& c) { return c->text[0] == bytes[0]; });
+
+            if (child == node->children.end()) {
+                auto leaf = std::make_unique<BuildNode>();
+                leaf->text = bytes;
+                node->children.push_back(std::move(leaf));
+                return node->children.back().get();
+            }
+
+            std::size_t shared = commonPrefix((*child)->text, bytes);
+            if (shared < (*child)->text.size()) {
+                // the edge diverges midway, split it at the shared prefix
+                auto middle = std::make_unique<BuildNode>();
+                middle->text = (*child)->text.substr(0, shared);
+                (*child)->text.erase(0, shared);
+                middle->children.push_back(std::move(*child));
+                *child = std::move(middle);
+            }
+            node = child->get();
+            bytes.remove_prefix(shared);
+        }
+        return node;
+    }
+
+    /* attaches the capture `name` of `kind` below `node`, two captures at the
+     * same place must agree on their name */
+    static BuildNode* insertCapture(BuildNode* node, Kind kind,
+                                    std::string_view name) {
+        std::unique_ptr<BuildNode>& slot =
+            kind == Kind::Param ? node->param : node->wildcard;
+        if (slot == nullptr) {
+            slot = std::make_unique<BuildNode>();
+            slot->kind = kind;
+            slot->text = name;
+        } else if (slot->text != name) {
+            return nullptr;
+        }
+        return slot.get();
+    }
+
+    /* copies the tree below `root` into `nodes`, returns the root index */
+    std::uint32_t flatten(BuildNode* root) {
+        std::uint32_t rootIndex = nodes.size();
+        std::vector<std::pair<BuildNode*, std::uint32_t>> queue;
+        queue.emplace_back(root, rootIndex);
+        nodes.emplace_back();
+        firstBytes.push_back(0);
+
+        auto reserve = [&](BuildNode* built) {
+            std::uint32_t index = nodes.size();
+            nodes.emplace_back();
+            firstBytes.push_back(built->kind == Kind::Static ? built->text[0]
+                                                             : 0);
+            queue.emplace_back(built, index);
+            return index;
+        };
+
+        for (std::size_t next = 0; next < queue.size(); next++) {
+            auto [built, index] = queue[next];
+
+            std::sort(built->children.begin(), built->children.end(),
+                      [](const auto& a, const auto& b) {
+                          return a->text[0] < b->text[0];
+                      });
+
+            Node node;
+            node.kind = built->kind;
+            node.textOffset = text.size();
+            node.textLength = built->text.size();
+            node.route = built->route;
+            text.append(built->text);
+
+            node.firstChild = nodes.size();
+            node.childCount = built->children.size();
+            for (auto& child : built->children) {
+                reserve(child.get());
+            }
+            node.param = built->param ? reserve(built->param.get()) : none;
+            node.wildcard =
+                built->wildcard ? reserve(built->wildcard.get()) : none;
+
+            nodes[index] = node;
+        }
+        return rootIndex;
+    }
+
+    std::string_view textOf(const Node& node) const {
+        return std::string_view(text).substr(node.textOffset, node.textLength);
+    }
+
+    /* matches `path` against the subtree at `index`, captures are pushed to
+     * `params` and popped again when a branch is abandoned */
+    std::int32_t match(std::uint32_t index, std::string_view path,
+                       SmallVector<RouteParam, 8>& params) const {
+        const Node& node = nodes[index];
+
+        switch (node.kind) {
+            case Kind::Static:
+                if (path.size() < node.textLength ||
+                    std::memcmp(path.data(), text.data() + node.textOffset,
+                                node.textLength) != 0) {
+                    return -1;
+                }
+                path.remove_prefix(node.textLength);
+                break;
+            case Kind::Param: {
+                std::size_t length = std::min(path.find('/'), path.size());
+                if (length == 0) {
+                    return -1;
+                }
+                params.push_back({textOf(node), path.substr(0, length)});
+                path.remove_prefix(length);
+                break;
+            }
+            case Kind::Wildcard:
+                params.push_back({textOf(node), path});
+                return node.route;
+        }
+
+        std::int32_t route = -1;
+        if (path.empty()) {
+            route = node.route;
+        } else {
+            const char* bytes = firstBytes.data() + node.firstChild;
+            const char* found = std::find(bytes, bytes + node.childCount,
+                                          path[0]);
+            if (found != bytes + node.childCount) {
+                route = match(node.firstChild + (found - bytes), path, params);
+            }
+        }
+        if (route < 0 && node.param != none) {
+            route = match(node.param, path, params);
+        }
+        if (route < 0 && node.wildcard != none) {
+            route = match(node.wildcard, path, params);
+        }
+
+        if (route < 0 && node.kind == Kind::Param) {
+            params.pop_back();
+        }
+        return route;
+    }
+
+    const Route* find(HTTPMethod method, std::string_view path,
+                      SmallVector<RouteParam, 8>& params) const {
+        std::uint32_t root = roots[static_cast<std::size_t>(method)];
+        if (!frozen || root == none) {
+            return nullptr;
+        }
+        std::int32_t route = match(root, path, params);
+        return route < 0 ? nullptr : &routes[route];
+    }
+
+   public:
+    Router() { roots.fill(none); }
+
+    Router(const Router&) = delete;
+    Router& operator=(const Router&) = delete;
+
+    /**
+     * @brief Registers `route` for `method` requests matching `pattern`.
+     * @return false if the pattern is invalid, if it is already registered,
+     * if a capture conflicts with an existing capture name at the same place,
+     * or if the router is frozen.
+     */
+    bool Add(HTTPMethod method, std::string_view pattern, Route route) {
+        if (frozen || pattern.empty() || pattern[0] != '/') {
+            return false;
+        }
+
+        auto& root = builders[static_cast<std::size_t>(method)];
+        if (root == nullptr) {
+            root = std::make_unique<BuildNode>();
+        }
+
+        BuildNode*  node = root.get();
+        std::size_t position = 0;
+        while (node != nullptr && position < pattern.size()) {
+            // static text runs up to the next segment starting with a capture
+            std::size_t capture = position;
+            while (capture < pattern.size() &&
+                   !((pattern[capture] == ':' || pattern[capture] == '*') &&
+                     capture > 0 && pattern[capture - 1] == '/')) {
+                capture++;
+            }
+            node = insertStatic(node,
+                                pattern.substr(position, capture - position));
+            if (capture == pattern.size()) {
+                break;
+            }
+
+            Kind kind = pattern[capture] == ':' ? Kind::Param : Kind::Wildcard;
+            std::size_t nameEnd =
+                std::min(pattern.find('/', capture), pattern.size());
+            std::string_view name =
+                pattern.substr(capture + 1, nameEnd - capture - 1);
+            if (name.empty() ||
+                (kind == Kind::Wildcard && nameEnd != pattern.size())) {
+                return false;  // unnamed, or a wildcard before the end
+            }
+            node = insertCapture(node, kind, name);
+            position = nameEnd;
+        }
+        if (node == nullptr || node->route >= 0) {
+            return false;
+        }
+
+        route.pattern = pattern;
+        route.method = method;
+        route.index = routes.size();
+        node->route = routes.size();
+        routes.push_back(std::move(route));
+        return true;
+    }
+
+    /**
+     * @brief Lays the trees out for lookup, no route can be added afterwards.
+     */
+    void Freeze() {
+        if (frozen) {
+            return;
+        }
+        for (std::size_t method = 0; method < HTTPMethodCount; method++) {
+            if (builders[method] != nullptr) {
+                roots[method] = flatten(builders[method].get());
+                builders[method].reset();
+            }
+        }
+        frozen = true;
+    }
+
+    bool IsFrozen() const { return frozen; }
+
+    std::size_t RouteCount() const { return routes.size(); }
+
+    /** Route number `index`, in the order routes were added. */
+    const Route& RouteAt(std::size_t index) const { return routes[index]; }
+
+    /**
+     * @brief Finds the route of `request` and stores its captures in the
+     * request. `HEAD` requests without a route of their own use the `GET`
+     * route, the server then leaves out the body.
+     * @return nullptr if no route of the request method matches.
+     */
+    const Route* Match(HTTPRequest& request) const {
+        request.params.clear();
+        const Route* route = find(request.Method(), request.Path(),
+                                  request.params);
+        if (route == nullptr && request.Method() == HTTPMethod::HEAD) {
+            route = find(HTTPMethod::GET, request.Path(), request.params);
+        }
+        return route;
+    }
+
+    /**
+     * @brief Comma separated methods having a route for `path`, the value of
+     * the `Allow` header of a 405 response.
+     * @return Empty if no method matches.
+     */
+    std::string AllowedMethods(std::string_view path) const {
+        SmallVector<RouteParam, 8> params;
+        std::string                allowed;
+        for (std::size_t method = 0; method < HTTPMethodCount; method++) {
+            HTTPMethod candidate = static_cast<HTTPMethod>(method);
+            params.clear();
+            bool matched = find(candidate, path, params) != nullptr;
+            if (!matched && candidate == HTTPMethod::HEAD) {
+                matched = find(HTTPMethod::GET, path, params) != nullptr;
+            }
+            if (!matched) {
+                continue;
+            }
+            if (!allowed.empty()) {
+                allowed.append(", ");
+            }
+            allowed.append(HTTPMethodName(candidate));
+        }
+        return allowed;
+    }
+};
+}  // namespace DinoScale
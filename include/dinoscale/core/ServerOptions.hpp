@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "RequestBody.hpp"
+
+namespace DinoScale {
+/**
+ * @brief How reactors drive socket I/O.
+ */
+enum class IOBackend {
+    Epoll,   // wait for readiness, then read and write with system calls
+    IOUring  // submit the reads and writes themselves in batches
+};
+
+/**
+ * @brief Tunables of a `DinoScale` server. Passed once through
+ * `DinoScale::SetOptions` before `startListening` is called, every field has a
+ * default which is suitable for most deployments.
+ */
+struct ServerOptions {
+    /** Number of reactors serving connections, each on its own thread with its
+     * own `SO_REUSEPORT` listening socket. 0 starts one per hardware thread. */
+    unsigned workerCount = 0;
+
+    /** Pins reactor `i` to CPU `i` (modulo the number of CPUs) so that its
+     * connections stay hot in one core's caches. */
+    bool pinWorkersToCores = false;
+
+    /** I/O backend of the reactors. io_uring needs Linux 6.0 or later, where
+     * it is unavailable (older kernels, seccomp filters, or
+     * `kernel.io_uring_disabled`) the reactors fall back to epoll. */
+    IOBackend ioBackend = IOBackend::Epoll;
+
+    /** Length of the queue of connections the kernel has completed but no
+     * reactor accepted yet, per listening socket. Capped by
+     * `net.core.somaxconn`. */
+    int listenBacklog = 1024;
+
+    /** Connections served at once over all reactors, 0 removes the limit.
+     * Once a reactor holds its share it stops accepting, further clients
+     * wait in the listen backlog until a connection closes. */
+    std::size_t maxConnections = 0;
+
+    /** Persistent connections are closed after serving this many requests,
+     * 0 removes the limit. */
+    unsigned maxRequestsPerConnection = 1000;
+
+    /** Serves clients opening a connection with the HTTP/2 preface (h2c with
+     * prior knowledge) over HTTP/2, sharing the routes of HTTP/1.1. Their
+     * streams count as requests towards `maxRequestsPerConnection`. */
+    bool http2 = true;
+
+    /** Streams an HTTP/2 client may have open at once. */
+    unsigned http2MaxStreams = 100;
+
+    /** Largest message a WebSocket client may send, counting all of its
+     * fragments. Larger ones close the connection with code 1009. */
+    std::size_t webSocketMaxMessageSize = 1024 * 1024;
+
+    /** Bytes queued for a WebSocket client which does not keep up, beyond
+     * which further messages to it are dropped and its frames are left
+     * unread until it caught up. */
+    std::size_t webSocketMaxQueuedBytes = 4 * 1024 * 1024;
+
+    /** WebSockets without any traffic for this long are closed, 0 keeps
+     * them open. Clients that stay quiet for longer should ping. */
+    std::chrono::seconds webSocketIdleTimeout{60};
+
+    /** Persistent connections without any traffic for this long between
+     * requests are closed. */
+    std::chrono::seconds keepAliveTimeout{5};
+
+    /** Time a client has to send a complete request head, counted from its
+     * first byte or, for the first request, from the connection being
+     * accepted. Trickling bytes in does not extend it, so slowloris style
+     * clients are dropped. */
+    std::chrono::seconds headerTimeout{10};
+
+    /** Longest silence while receiving a request body. */
+    std::chrono::seconds bodyTimeout{30};
+
+    /** Longest time a queued response may wait for the client to read any
+     * of it. */
+    std::chrono::seconds writeTimeout{30};
+
+    /** Memory threshold, spool directory and maximum size of request bodies,
+     * and of the chunk extensions and trailers framing them. Bodies beyond
+     * the memory threshold are streamed to a temporary file. */
+    BodyLimits bodyLimits;
+
+    /** Memory shared by all reactors for caching static files together with
+     * their serialized headers, 0 disables the cache. */
+    std::size_t staticCacheBudget = 64 * 1024 * 1024;
+
+    /** Static files above this size are never cached. */
+    std::size_t staticCacheMaxFileSize = 1024 * 1024;
+
+    /** Memory shared by all reactors for the responses of routes created with
+     * a `ResponseCachePolicy`, 0 disables their caching. */
+    std::size_t responseCacheBudget = 16 * 1024 * 1024;
+
+    /** Uncached static files of at least this size are sent with `sendfile`,
+     * the bytes go from the page cache to the socket without being copied
+     * through the server's memory. */
+    std::size_t sendfileThreshold = 64 * 1024;
+
+    /** Static file requests asking for more byte ranges than this are
+     * answered with the whole file. */
+    std::size_t maxByteRanges = 16;
+
+    /** Connection objects each reactor creates up front, more are made when
+     * needed and all of them are recycled as clients come and go. */
+    std::size_t preallocatedConnections = 256;
+
+    /** Bytes of idle I/O buffers each reactor keeps for reuse once a burst of
+     * traffic is over, the rest is returned to the allocator. */
+    std::size_t bufferPoolBudget = 16 * 1024 * 1024;
+
+    /** Threads of the work stealing pool running route handlers, so that slow
+     * handlers never hold up a reactor. 0 runs handlers on the reactor thread
+     * of their connection, the fastest choice for cheap handlers. */
+    unsigned handlerThreads = 0;
+
+    /** Requests waiting for a handler thread beyond which new ones are
+     * answered right away with `503 Service Unavailable`, 0 removes the
+     * limit. */
+    std::size_t maxQueuedHandlers = 1024;
+
+    /** Queue delay the handler pool aims for. Once requests waited longer
+     * than this for a handler thread during a whole `sheddingInterval`, those
+     * waiting too long are answered with `503 Service Unavailable` instead of
+     * being run, which keeps the latency of admitted requests bounded during
+     * spikes. 0 disables shedding. */
+    std::chrono::milliseconds sheddingTarget{20};
+    std::chrono::milliseconds sheddingInterval{100};
+
+    /** Sent as `Retry-After` with responses of shed requests. */
+    std::chrono::seconds retryAfter{1};
+
+    /** Hands log lines to a background writer thread instead of writing them
+     * on the reactor threads, see `Logger::EnableAsync`. */
+    bool asyncLogging = true;
+
+    /** Path of a `GET` route answering with the server metrics in the
+     * Prometheus text format, e.g. `/metrics`. Empty leaves the route out,
+     * metrics are collected either way. */
+    std::string metricsPath;
+};
+}  // namespace DinoScale
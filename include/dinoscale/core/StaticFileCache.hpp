@@ -0,0 +1,530 @@
+#pragma once
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "../constants/mimes.hpp"
+#include "../constants/statuses.hpp"
+#include "../utils/HTTPDate.hpp"
+#include "ContentCoding.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Strong validator of a file version, derived from its size and
+ * modification time with nanosecond resolution. Encoded representations of
+ * the file get the coding appended, each needs a validator of its own.
+ */
+inline std::string MakeETag(std::size_t size, const timespec& modified,
+                            ContentCoding coding = ContentCoding::Identity) {
+    char etag[80];
+    if (coding == ContentCoding::Identity) {
+        std::snprintf(etag, sizeof(etag), "\"%zx-%llx%08lx\"", size,
+                      static_cast<long long>(modified.tv_sec),
+                      static_cast<long>(modified.tv_nsec));
+    } else {
+        std::snprintf(etag, sizeof(etag), "\"%zx-%llx%08lx-%s\"", size,
+                      static_cast<long long>(modified.tv_sec),
+                      static_cast<long>(modified.tv_nsec),
+                      ContentCodingName(coding).data());
+    }
+    return etag;
+}
+
+/**
+ * @brief A static file held in memory together with its response header,
+ * serialized once when the file is loaded. Compressed representations of a
+ * file are cached files of their own.
+ */
+struct CachedFile {
+    std::string path;  // file the bytes came from, a sibling when encoded
+    std::string body;
+
+    /** `HTTP/1.1 200 OK` followed by Content-Type, Content-Encoding unless
+     * identity, Content-Length, ETag, Last-Modified, Vary for compressible
+     * types and Accept-Ranges, each line terminated by CRLF.
+     * Connection handling and the blank line are appended per request. */
+    std::string header;
+
+    /** Offset of the first header field in `header`, lets other statuses
+     * reuse the fields behind their own status line. */
+    std::size_t fieldsOffset = 0;
+
+    std::string      etag;
+    std::string      lastModified;  // IMF-fixdate of `modified`
+    std::string_view contentType;
+    std::string_view contentEncoding;  // empty for identity
+    bool             varies = false;   // has encoded representations
+    struct timespec  modified {};
+    std::size_t      pathSize = 0;  // size of `path` when it was read
+
+    /** Steady clock milliseconds of the last mtime check, only used when
+     * inotify is unavailable. */
+    mutable std::atomic<long long> validatedAt{0};
+
+    std::string_view Fields() const {
+        return std::string_view(header).substr(fieldsOffset);
+    }
+};
+
+/**
+ * @brief Shared in-memory cache of static files.
+ *
+ * Entries are handed out as `shared_ptr`s, so a file evicted or invalidated
+ * while a response still references it stays alive until that response is
+ * written. The cache is bounded by a memory budget and evicts the least
+ * recently used files first. A background thread watches the directories of
+ * cached files with inotify and drops entries as soon as their file changes;
+ * without inotify an entry's mtime is re-checked at most once per second.
+ * A hit therefore costs one hash lookup under a short lock and no syscall.
+ */
+class StaticFileCache {
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::shared_ptr<const CachedFile> file;
+        std::list<std::string>::iterator  recency;  // position in `lru`
+    };
+
+    std::size_t   memoryBudget;
+    std::size_t   maxFileSize;
+    std::size_t   memoryUsed = 0;
+    std::uint64_t generation = 0;  // bumped by every inotify event
+
+    std::mutex                             lock;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string>                 lru;  // most recently used first
+
+    /* inotify watch descriptor to the path prefix of files in that directory,
+     * and the reverse mapping to avoid watching a directory twice */
+    std::unordered_map<int, std::string> watchedPrefixes;
+    std::unordered_map<std::string, int> watchByPrefix;
+
+    int         inotifyFd = -1;
+    int         stopFd = -1;
+    std::thread watcher;
+
+    static long long nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   Clock::now().time_since_epoch())
+            .count();
+    }
+
+    static bool sameTime(const timespec& a, const timespec& b) {
+        return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+    }
+
+    /* key of the representation of `path` in `coding`, NUL never occurs in
+     * paths; valid until the next call on the same thread */
+    static const std::string& keyOf(const std::string& path,
+                                    ContentCoding      coding) {
+        if (coding == ContentCoding::Identity) {
+            return path;
+        }
+        thread_local std::string key;
+        key.assign(path);
+        key.push_back('\0');
+        key.append(ContentCodingName(coding));
+        return key;
+    }
+
+    /* a cached file standing for a representation which does not exist or
+     * is not worth sending, checked against `path` */
+    static std::shared_ptr<CachedFile> missing(const std::string& path,
+                                               const struct stat* info) {
+        auto file = std::make_shared<CachedFile>();
+        file->path = path;
+        if (info != nullptr) {
+            file->modified = info->st_mtim;
+            file->pathSize = info->st_size;
+        }
+        file->validatedAt = nowMs();
+        return file;
+    }
+
+    static bool isMissing(const CachedFile& file) {
+        return file.header.empty();
+    }
+
+    /* serializes the header from the other fields of `file` */
+    static void serialize(CachedFile& file) {
+        file.header = HTTPStatusLine(HTTPStatusCode::OK);
+        file.fieldsOffset = file.header.size();
+        file.header.append("Content-Type: ");
+        file.header.append(file.contentType);
+        if (!file.contentEncoding.empty()) {
+            file.header.append("\r\nContent-Encoding: ");
+            file.header.append(file.contentEncoding);
+        }
+        file.header.append("\r\nContent-Length: ");
+        file.header.append(std::to_string(file.body.size()));
+        file.header.append("\r\nETag: ");
+        file.header.append(file.etag);
+        file.header.append("\r\nLast-Modified: ");
+        file.header.append(file.lastModified);
+        if (file.varies) {
+            file.header.append("\r\nVary: Accept-Encoding");
+        }
+        file.header.append("\r\nAccept-Ranges: bytes\r\n");
+    }
+
+    /* reads `source` as the representation of `path` in `coding` and
+     * serializes its header, nullptr if it is unusable */
+    std::shared_ptr<CachedFile> load(const std::string& path,
+                                     const std::string& source,
+                                     ContentCoding      coding) {
+        int fd = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+            static_cast<std::size_t>(info.st_size) > maxFileSize) {
+            close(fd);
+            return nullptr;
+        }
+
+        auto file = std::make_shared<CachedFile>();
+        file->path = source;
+        file->modified = info.st_mtim;
+        file->body.resize(info.st_size);
+
+        std::size_t total = 0;
+        while (total < file->body.size()) {
+            ssize_t bytesRead = read(fd, file->body.data() + total,
+                                     file->body.size() - total);
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytesRead <= 0) {
+                break;
+            }
+            total += bytesRead;
+        }
+        close(fd);
+        file->body.resize(total);  // the file may have shrunk meanwhile
+        file->pathSize = total;
+
+        file->etag = MakeETag(total, info.st_mtim, coding);
+        char date[32];
+        file->lastModified.assign(
+            date, FormatHTTPDate(info.st_mtim.tv_sec, date));
+        file->contentType = MimeTypeForPath(path);
+        if (coding != ContentCoding::Identity) {
+            file->contentEncoding = ContentCodingName(coding);
+        }
+        file->varies = IsCompressible(file->contentType);
+        serialize(*file);
+
+        file->validatedAt = nowMs();
+        return file;
+    }
+
+    /**
+     * @brief Loads the representation of `path` in `coding` from its
+     * precompressed sibling, e.g. `path.gz`. Without one, gzip is produced
+     * from the cached file itself. Representations which do not exist or
+     * do not come out smaller yield a `missing` file.
+     */
+    std::shared_ptr<CachedFile> loadEncoded(const std::string& path,
+                                            ContentCoding      coding) {
+        std::string sibling = path;
+        sibling.append(ContentCodingSuffix(coding));
+        std::shared_ptr<CachedFile> file = load(path, sibling, coding);
+        if (file != nullptr) {
+            return file;
+        }
+
+        std::shared_ptr<const CachedFile> identity =
+            coding == ContentCoding::Gzip ? Get(path) : nullptr;
+        if (identity == nullptr) {
+            struct stat info;
+            return missing(sibling,
+                           stat(sibling.c_str(), &info) == 0 ? &info : nullptr);
+        }
+
+        file = std::make_shared<CachedFile>();
+        if (!GzipCompress(identity->body, file->body) ||
+            file->body.size() >= identity->body.size()) {
+            struct stat info{};
+            info.st_mtim = identity->modified;
+            info.st_size = identity->pathSize;
+            return missing(identity->path, &info);
+        }
+        file->path = identity->path;
+        file->modified = identity->modified;
+        file->pathSize = identity->pathSize;
+        file->etag = MakeETag(identity->pathSize, identity->modified, coding);
+        file->lastModified = identity->lastModified;
+        file->contentType = identity->contentType;
+        file->contentEncoding = ContentCodingName(coding);
+        file->varies = true;
+        serialize(*file);
+        file->validatedAt = nowMs();
+        return file;
+    }
+
+    /* caller holds `lock` */
+    void watchDirectoryOf(const std::string& path) {
+        if (inotifyFd < 0) {
+            return;
+        }
+        std::size_t slash = path.rfind('/');
+        std::string prefix =
+            slash == std::string::npos ? "" : path.substr(0, slash + 1);
+        if (watchByPrefix.count(prefix)) {
+            return;
+        }
+
+        std::string directory = prefix.empty() ? "." : prefix;
+        int watch = inotify_add_watch(
+            inotifyFd, directory.c_str(),
+            IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_MOVED_TO |
+                IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_DELETE_SELF);
+        if (watch >= 0) {
+            watchedPrefixes[watch] = prefix;
+            watchByPrefix[prefix] = watch;
+        }
+    }
+
+    /* caller holds `lock` */
+    void erase(std::unordered_map<std::string, Entry>::iterator entry) {
+        memoryUsed -= entry->second.file->body.size() +
+                      entry->second.file->header.size();
+        lru.erase(entry->second.recency);
+        entries.erase(entry);
+    }
+
+    /* drains inotify until the cache is destroyed */
+    void watch() {
+        alignas(inotify_event) char buffer[16384];
+        pollfd descriptors[2] = {
+            {inotifyFd, POLLIN, 0},
+            {stopFd,    POLLIN, 0},
+        };
+
+        while (true) {
+            if (poll(descriptors, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            if (descriptors[1].revents) {
+                return;
+            }
+
+            ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> guard(lock);
+            generation++;
+            for (char* position = buffer; position < buffer + length;) {
+                auto* event = reinterpret_cast<inotify_event*>(position);
+                position += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // events were lost, any file may have changed
+                    entries.clear();
+                    lru.clear();
+                    memoryUsed = 0;
+                    continue;
+                }
+                auto prefix = watchedPrefixes.find(event->wd);
+                if (prefix == watchedPrefixes.end()) {
+                    continue;
+                }
+                if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+                    // the directory is gone, forget every file inside it
+                    for (auto entry = entries.begin();
+                         entry != entries.end();) {
+                        auto next = std::next(entry);
+                        if (entry->first.compare(0, prefix->second.size(),
+                                                 prefix->second) == 0) {
+                            erase(entry);
+                        }
+                        entry = next;
+                    }
+                    watchByPrefix.erase(prefix->second);
+                    watchedPrefixes.erase(prefix);
+                    continue;
+                }
+                if (event->len == 0) {
+                    continue;
+                }
+
+                // a change to `name` or its sibling `name.gz` invalidates
+                // the representations derived from it
+                std::string name = prefix->second + event->name;
+                for (ContentCoding coding :
+                     {ContentCoding::Identity, ContentCoding::Gzip,
+                      ContentCoding::Brotli}) {
+                    std::string_view suffix = ContentCodingSuffix(coding);
+                    std::string      source = name;
+                    if (!suffix.empty() && name.size() > suffix.size() &&
+                        name.compare(name.size() - suffix.size(),
+                                     suffix.size(), suffix) == 0) {
+                        source.resize(name.size() - suffix.size());
+                        auto sibling = entries.find(keyOf(source, coding));
+                        if (sibling != entries.end()) {
+                            erase(sibling);
+                        }
+                    }
+                    auto entry = entries.find(keyOf(name, coding));
+                    if (entry != entries.end()) {
+                        erase(entry);
+                    }
+                }
+            }
+        }
+    }
+
+   public:
+    /**
+     * @param memoryBudget: Upper bound for the bytes of all cached files.
+     * @param maxFileSize: Larger files are never cached.
+     */
+    StaticFileCache(std::size_t memoryBudget, std::size_t maxFileSize)
+        : memoryBudget(memoryBudget), maxFileSize(maxFileSize) {
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        stopFd = eventfd(0, EFD_CLOEXEC);
+        if (inotifyFd >= 0 && stopFd >= 0) {
+            watcher = std::thread(&StaticFileCache::watch, this);
+        } else if (inotifyFd >= 0) {
+            close(inotifyFd);
+            inotifyFd = -1;
+        }
+    }
+
+    StaticFileCache(const StaticFileCache&) = delete;
+    StaticFileCache& operator=(const StaticFileCache&) = delete;
+
+    /**
+     * @brief Returns the cached file at `path` in `coding`, reading or
+     * compressing it on a miss, see `loadEncoded`.
+     * @return nullptr if the file cannot be read or is too large to cache,
+     * or if it has no representation in `coding`.
+     */
+    std::shared_ptr<const CachedFile> Get(
+        const std::string& path,
+        ContentCoding      coding = ContentCoding::Identity) {
+        std::uint64_t loadGeneration;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            loadGeneration = generation;
+            auto entry = entries.find(keyOf(path, coding));
+            if (entry != entries.end()) {
+                const CachedFile& file = *entry->second.file;
+                bool fresh = true;
+
+                if (inotifyFd < 0 && nowMs() - file.validatedAt >= 1000) {
+                    struct stat info;
+                    fresh = stat(file.path.c_str(), &info) == 0 &&
+                            sameTime(info.st_mtim, file.modified) &&
+                            static_cast<std::size_t>(info.st_size) ==
+                                file.pathSize;
+                    file.validatedAt = nowMs();
+                }
+
+                if (fresh) {
+                    lru.splice(lru.begin(), lru, entry->second.recency);
+                    if (isMissing(file)) {
+                        return nullptr;
+                    }
+                    return entry->second.file;
+                }
+                erase(entry);
+            }
+        }
+
+        std::shared_ptr<CachedFile> file =
+            coding == ContentCoding::Identity ? load(path, path, coding)
+                                              : loadEncoded(path, coding);
+        if (file == nullptr) {
+            return nullptr;
+        }
+
+        std::size_t footprint = file->body.size() + file->header.size();
+        if (footprint > memoryBudget) {
+            return file;  // served once without being kept
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (generation != loadGeneration) {
+            // a change notification raced with reading the file, the bytes
+            // may already be stale so they are not kept
+            return isMissing(*file) ? nullptr : file;
+        }
+        watchDirectoryOf(path);
+
+        const std::string& key = keyOf(path, coding);
+        auto               existing = entries.find(key);
+        if (existing != entries.end()) {
+            erase(existing);  // another thread loaded it concurrently
+        }
+        while (memoryUsed + footprint > memoryBudget && !lru.empty()) {
+            erase(entries.find(lru.back()));
+        }
+
+        lru.push_front(key);
+        entries.emplace(key, Entry{file, lru.begin()});
+        memoryUsed += footprint;
+        return isMissing(*file) ? nullptr : file;
+    }
+
+    /** Drops the entries of `path`, it is read again on the next request. */
+    void Invalidate(const std::string& path) {
+        std::lock_guard<std::mutex> guard(lock);
+        for (ContentCoding coding : {ContentCoding::Identity,
+                                     ContentCoding::Gzip,
+                                     ContentCoding::Brotli}) {
+            auto entry = entries.find(keyOf(path, coding));
+            if (entry != entries.end()) {
+                erase(entry);
+            }
+        }
+    }
+
+    /** Bytes currently held by cached files. */
+    std::size_t MemoryUsed() {
+        std::lock_guard<std::mutex> guard(lock);
+        return memoryUsed;
+    }
+
+    ~StaticFileCache() {
+        if (watcher.joinable()) {
+            uint64_t stop = 1;
+            ssize_t  ignored = write(stopFd, &stop, sizeof(stop));
+            (void)ignored;
+            watcher.join();
+        }
+        if (inotifyFd >= 0) {
+            close(inotifyFd);
+        }
+        if (stopFd >= 0) {
+            close(stopFd);
+        }
+    }
+};
+}  // namespace DinoScale
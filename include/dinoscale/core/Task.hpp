@@ -0,0 +1,157 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include "../utils/FrameStack.hpp"
+
+namespace DinoScale {
+template <typename T>
+class Task;
+
+namespace detail {
+/* what the promises of every `Task` share */
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr      error;
+
+    /* frames come from the frame stack of the connection being served */
+    static void* operator new(std::size_t size) {
+        return FrameStack::AllocateFrame(size);
+    }
+
+    static void operator delete(void* frame) { FrameStack::FreeFrame(frame); }
+
+    /* a finished task carries on with the coroutine awaiting it */
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<Promise> task) noexcept {
+            return task.promise().continuation;
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter        final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    template <typename Value>
+    void return_value(Value&& result) {
+        value.emplace(std::forward<Value>(result));
+    }
+
+    T take() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+
+    void return_void() const {}
+
+    void take() const {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+}  // namespace detail
+
+/**
+ * @brief Result of a coroutine which runs once it is awaited, the return type
+ * of coroutine route handlers and of the coroutines they call.
+ *
+ * Awaiting a task starts it and resumes the awaiting coroutine directly when
+ * it finishes, without going through the reactor or growing the stack.
+ * Exceptions thrown inside propagate to the awaiting coroutine. While a
+ * connection is being served, frames are taken from its `FrameStack` instead
+ * of the heap.
+ */
+template <typename T = void>
+class [[nodiscard]] Task {
+   public:
+    using promise_type = detail::TaskPromise<T>;
+
+   private:
+    std::coroutine_handle<promise_type> handle;
+
+   public:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : handle(handle) {}
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> task;
+
+            bool await_ready() const noexcept { return task.done(); }
+
+            std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<> awaiting) noexcept {
+                task.promise().continuation = awaiting;
+                return task;
+            }
+
+            T await_resume() { return task.promise().take(); }
+        };
+        return Awaiter{handle};
+    }
+
+    /**
+     * @brief Hands the not yet started coroutine over to the caller, which
+     * resumes it and destroys it once it is done.
+     */
+    std::coroutine_handle<> Release() { return std::exchange(handle, {}); }
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+};
+
+namespace detail {
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(
+        std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+}  // namespace detail
+}  // namespace DinoScale
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "../utils/SHA1.hpp"
+#include "../utils/Strings.hpp"
+
+namespace DinoScale {
+/** Frame types of RFC 6455, the low nibble of the first frame byte. */
+enum class WebSocketOpcode : std::uint8_t {
+    Continuation = 0x0,
+    Text = 0x1,
+    Binary = 0x2,
+    Close = 0x8,
+    Ping = 0x9,
+    Pong = 0xa
+};
+
+/** Status codes carried by close frames. */
+enum class WebSocketCloseCode : std::uint16_t {
+    Normal = 1000,
+    GoingAway = 1001,
+    ProtocolError = 1002,
+    UnsupportedData = 1003,
+    NoStatus = 1005,  // never sent, a close frame without a code
+    Abnormal = 1006,  // never sent, the connection dropped without one
+    InvalidPayload = 1007,
+    PolicyViolation = 1008,
+    MessageTooBig = 1009,
+    InternalError = 1011
+};
+
+/** Largest payload of a ping, pong or close frame. */
+inline constexpr std::size_t WebSocketMaxControlPayload = 125;
+
+/* how clients prove they speak the protocol, appended to their key */
+inline constexpr std::string_view WebSocketGUID =
+    "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/**
+ * @brief Whether `key` can be a `Sec-WebSocket-Key`: 16 bytes in base64, so
+ * 22 characters of the alphabet and the `==` padding.
+ */
+inline bool IsWebSocketKey(std::string_view key) {
+    if (key.size() != 24 || key.substr(22) != "==") {
+        return false;
+    }
+    for (char c : key.substr(0, 22)) {
+        bool valid = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+                     (c >= '0' && c <= '9') || c == '+' || c == '/';
+        if (!valid) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Appends the `Sec-WebSocket-Accept` answering the client's `key`. */
+inline void AppendWebSocketAccept(std::string& out, std::string_view key) {
+    std::string keyed;
+    keyed.reserve(key.size() + WebSocketGUID.size());
+    keyed.append(key).append(WebSocketGUID);
+    SHA1Digest digest = SHA1(keyed);
+    AppendBase64(out, digest.data(), digest.size());
+}
+
+/**
+ * @brief Appends the header of an unmasked frame carrying `length` payload
+ * bytes, as servers send them.
+ * @param final: Whether the frame ends its message.
+ */
+inline void AppendWebSocketFrameHeader(std::string& out, WebSocketOpcode opcode,
+                                       std::size_t length, bool final = true) {
+    out += static_cast<char>((final ? 0x80 : 0) |
+                             static_cast<std::uint8_t>(opcode));
+    if (length < 126) {
+        out += static_cast<char>(length);
+    } else if (length <= 0xffff) {
+        out += static_cast<char>(126);
+        out += static_cast<char>(length >> 8);
+        out += static_cast<char>(length);
+    } else {
+        out += static_cast<char>(127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out += static_cast<char>(static_cast<std::uint64_t>(length) >>
+                                     shift);
+        }
+    }
+}
+}  // namespace DinoScale
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Format string of a log call, `{}` stands for the next argument and
+ * `{{` / `}}` for literal braces. Built at compile time, so a placeholder
+ * count that does not match the arguments fails to compile.
+ */
+template <typename... Args>
+class LogFormatString {
+   private:
+    std::string_view text;
+
+    static consteval std::size_t countPlaceholders(std::string_view format) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < format.size(); i++) {
+            if (format[i] == '{') {
+                if (i + 1 < format.size() && format[i + 1] == '{') {
+                    i++;
+                } else if (i + 1 < format.size() && format[i + 1] == '}') {
+                    count++;
+                    i++;
+                } else {
+                    throw "log format: '{' must be followed by '}' or '{'";
+                }
+            } else if (format[i] == '}') {
+                if (i + 1 < format.size() && format[i + 1] == '}') {
+                    i++;
+                } else {
+                    throw "log format: unmatched '}'";
+                }
+            }
+        }
+        return count;
+    }
+
+   public:
+    template <typename String>
+        requires std::is_convertible_v<const String&, std::string_view>
+    consteval LogFormatString(const String& format) : text(format) {
+        if (countPlaceholders(text) != sizeof...(Args)) {
+            throw "log format: placeholder count does not match arguments";
+        }
+    }
+
+    std::string_view Get() const { return text; }
+};
+
+/* keeps the arguments from taking part in deducing the format string type */
+template <typename... Args>
+using LogFormat = LogFormatString<std::type_identity_t<Args>...>;
+
+namespace LogFormatting {
+inline void appendValue(std::string& out, std::string_view value) {
+    out.append(value);
+}
+
+inline void appendValue(std::string& out, const char* value) {
+    out.append(value == nullptr ? "(null)" : value);
+}
+
+inline void appendValue(std::string& out, const std::string& value) {
+    out.append(value);
+}
+
+inline void appendValue(std::string& out, char value) { out.push_back(value); }
+
+inline void appendValue(std::string& out, bool value) {
+    out.append(value ? "true" : "false");
+}
+
+template <typename Number>
+    requires std::is_arithmetic_v<Number>
+void appendValue(std::string& out, Number value) {
+    char text[32];
+    auto result = std::to_chars(text, text + sizeof(text), value);
+    out.append(text, result.ptr - text);
+}
+
+template <typename Enum>
+    requires std::is_enum_v<Enum>
+void appendValue(std::string& out, Enum value) {
+    appendValue(out, static_cast<std::underlying_type_t<Enum>>(value));
+}
+
+/* copies `format` up to its next placeholder, unescaping braces, and
+ * returns the rest after the placeholder */
+inline std::string_view appendLiteral(std::string& out,
+                                      std::string_view format) {
+    std::size_t i = 0;
+    while (i < format.size()) {
+        char c = format[i];
+        if (c == '{' && format[i + 1] == '}') {
+            return format.substr(i + 2);
+        }
+        out.push_back(c);
+        i += (c == '{' || c == '}') ? 2 : 1;  // skips the escaping brace
+    }
+    return {};
+}
+}  // namespace LogFormatting
+
+/**
+ * @brief Appends `format` to `out` with every `{}` replaced by the next
+ * argument. Numbers are written with `std::to_chars`, so nothing but `out`
+ * may allocate.
+ */
+template <typename... Args>
+void FormatLogMessage(std::string& out, std::string_view format,
+                      const Args&... args) {
+    ((format = LogFormatting::appendLiteral(out, format),
+      LogFormatting::appendValue(out, args)),
+     ...);
+    LogFormatting::appendLiteral(out, format);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Single producer, single consumer byte ring holding formatted log
+ * lines of one thread until the writer thread picks them up.
+ *
+ * A line is published only once all of its bytes are in the ring, so the
+ * consumer always sees whole lines and no per-line framing is needed. Head
+ * and tail live on separate cache lines, and the producer keeps a private
+ * copy of the tail which it only refreshes when the ring looks full, so the
+ * logging thread rarely touches the writer's cache line.
+ */
+class LogRing {
+   private:
+    static constexpr std::size_t cacheLine = 64;
+
+    std::unique_ptr<char[]> data;
+    std::size_t             capacity;  // power of two
+    std::size_t             mask;
+
+    /* producer side */
+    alignas(cacheLine) std::atomic<std::size_t> head{0};
+    std::size_t                                 tailCopy = 0;
+    std::atomic<std::uint64_t>                  dropped{0};
+
+    /* consumer side */
+    alignas(cacheLine) std::atomic<std::size_t> tail{0};
+    std::atomic<bool>                           retired{false};
+
+    static std::size_t roundUp(std::size_t size) {
+        std::size_t power = 1024;
+        while (power < size) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+   public:
+    explicit LogRing(std::size_t size)
+        : capacity(roundUp(size)), mask(capacity - 1) {
+        data = std::make_unique<char[]>(capacity);
+    }
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    std::size_t Capacity() const { return capacity; }
+
+    /**
+     * @brief Appends the concatenation of `pieces` as one line. Called by the
+     * owning thread only.
+     * @return false if the ring has no room for the whole line.
+     */
+    bool TryPush(const std::string_view* pieces, std::size_t count,
+                 std::size_t length) {
+        std::size_t position = head.load(std::memory_order_relaxed);
+        if (position + length - tailCopy > capacity) {
+            tailCopy = tail.load(std::memory_order_acquire);
+            if (position + length - tailCopy > capacity) {
+                return false;
+            }
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            const char* bytes = pieces[i].data();
+            std::size_t remaining = pieces[i].size();
+            while (remaining > 0) {
+                std::size_t offset = position & mask;
+                std::size_t chunk = std::min(remaining, capacity - offset);
+                std::memcpy(data.get() + offset, bytes, chunk);
+                bytes += chunk;
+                remaining -= chunk;
+                position += chunk;
+            }
+        }
+        head.store(position, std::memory_order_release);
+        return true;
+    }
+
+    /** Counts a line that was discarded because the ring was full. */
+    void CountDrop() { dropped.fetch_add(1, std::memory_order_relaxed); }
+
+    /** Returns and resets the number of discarded lines. */
+    std::uint64_t TakeDropped() {
+        return dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Moves every published line to the end of `out`. Called by the
+     * writer thread only.
+     * @return Number of bytes moved.
+     */
+    std::size_t Drain(std::string& out) {
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        std::size_t end = head.load(std::memory_order_acquire);
+        std::size_t length = end - position;
+
+        while (position != end) {
+            std::size_t offset = position & mask;
+            std::size_t chunk = std::min(end - position, capacity - offset);
+            out.append(data.get() + offset, chunk);
+            position += chunk;
+        }
+        tail.store(position, std::memory_order_release);
+        return length;
+    }
+
+    /** Marks the ring as abandoned by its thread, freed once drained. */
+    void Retire() { retired.store(true, std::memory_order_release); }
+
+    bool IsRetired() const { return retired.load(std::memory_order_acquire); }
+};
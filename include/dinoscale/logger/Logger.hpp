@@ -3,22 +3,28 @@
 #ifndef LOGGER_HPP
 #define LOGGER_HPP
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <ctime>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <mutex>
-#include <sstream>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #ifdef __linux__
 #include <sys/stat.h>
 #include <unistd.h>
 #endif
 
-#include "Color.hpp"
+#include "LogFormat.hpp"
+#include "LogRing.hpp"
 
 enum class LogLevel {
     None,
@@ -29,6 +35,31 @@ enum class LogLevel {
     Success
 };
 
+/**
+ * @brief Most verbose level compiled into the program. Calls of the templated
+ * `Logger` API above it expand to nothing, arguments are not even formatted.
+ * Release builds (`NDEBUG`) stop at `Info` unless the macro is defined.
+ */
+#ifndef DINOSCALE_LOG_LEVEL
+#ifdef NDEBUG
+#define DINOSCALE_LOG_LEVEL LogLevel::Info
+#else
+#define DINOSCALE_LOG_LEVEL LogLevel::Debug
+#endif
+#endif
+
+/** Rank of a level by verbosity, `Success` is as verbose as `Info`. */
+constexpr int LogVerbosity(LogLevel level) {
+    return level == LogLevel::Success ? static_cast<int>(LogLevel::Info)
+                                      : static_cast<int>(level);
+}
+
+/** Whether messages of `level` pass the level `threshold`. */
+constexpr bool IsLogLevelEnabled(LogLevel level, LogLevel threshold) {
+    return threshold != LogLevel::None &&
+           LogVerbosity(level) <= LogVerbosity(threshold);
+}
+
 /**
  * @brief Files can be outputted in two modes. This stores the preference option
  * to where to log the messages. This can be either the console or a file.
@@ -38,6 +69,15 @@ enum class LogOutput {
     File
 };
 
+/**
+ * @brief What an asynchronous logger does with a message while the ring
+ * buffer of the logging thread is full.
+ */
+enum class LogOverflow {
+    Drop,  // discard the message, the writer reports how many were lost
+    Block  // wait until the writer thread made room
+};
+
 /**
  * @brief  Logger Class Used to Output Details of Current Application Flow.
  *
@@ -51,50 +91,61 @@ enum class LogOutput {
  */
 class Logger {
    private:
-    LogLevel      logLevel;    // the current output level of the logger
-    LogOutput     logOutput;   // current output option for the logger
+    /* current output level, read by every logging thread */
+    std::atomic<LogLevel> logLevel{LogLevel::Info};
+
+    LogOutput     logOutput = LogOutput::Console;  // current output option
     std::ofstream logFile;     // if output is FILE, then path to the file
     std::mutex    threadLock;  // access file or console in thread safe manner
 
-    /** Stores the level of the log as key and the corresponging name to be
-     * printed as the value. */
-    std::unordered_map<LogLevel, std::string> levelName = {
-        {LogLevel::Info,    Color::FG_CYAN + "INFO : " + Color::FG_RESET    },
-        {LogLevel::Debug,   Color::FG_MAGENTA + "DEBUG : " + Color::FG_RESET},
-        {LogLevel::Warn,    Color::FG_YELLOW + "WARN : " + Color::FG_RESET  },
-        {LogLevel::Error,   Color::FG_RED + "ERROR : " + Color::FG_RESET    },
-        {LogLevel::Success, Color::FG_GREEN + "SUCCESS : " + Color::FG_RESET},
-        {LogLevel::None,    Color::FG_DEFAULT + "NONE : " + Color::FG_RESET },
+    /* asynchronous mode, see EnableAsync */
+    std::atomic<bool>                     async{false};
+    std::size_t                           ringSize = 64 * 1024;
+    LogOverflow                           overflow = LogOverflow::Drop;
+    std::mutex                            ringsLock;  // guards `rings`
+    std::vector<std::shared_ptr<LogRing>> rings;      // one per thread
+    std::thread                           writer;
+    std::atomic<bool>                     stopping{false};
+    std::atomic<bool>                     writerSleeping{false};
+    std::mutex                            wakeLock;
+    std::condition_variable               wake;
+
+    /** Name printed for each level, indexed by the level, colored with the
+     * codes of `Color`. */
+    static constexpr std::string_view levelNames[] = {
+        "\033[39mNONE : \033[0m",  "\033[31mERROR : \033[0m",
+        "\033[33mWARN : \033[0m",  "\033[36mINFO : \033[0m",
+        "\033[35mDEBUG : \033[0m", "\033[32mSUCCESS : \033[0m",
     };
 
+    static constexpr std::string_view levelNameOf(LogLevel level) {
+        return levelNames[static_cast<int>(level)];
+    }
+
     /**
      * @brief Stores the globally available instance of the Logger class.
      * Uses singleton design pattern.
      */
-    static std::shared_ptr<Logger> loggerInstance;
+    inline static std::shared_ptr<Logger> loggerInstance;
 
     /**
-     * @brief A function which generates the current time of the system in a
-     * human readable format.
-     *
-     * @return Current time of the system in a string format.
+     * @brief Current time of the system in a human readable format. The text
+     * is cached per thread and only rebuilt when the second changes.
      */
-    const std::string getLocalTime() {
-        std::tm localTime;
-
-        // current time of the system
-        auto currentTime = std::chrono::system_clock::now();
-        auto in_time_t = std::chrono::system_clock::to_time_t(currentTime);
-        localtime_r(&in_time_t, &localTime);
+    static std::string_view getLocalTime() {
+        thread_local std::time_t cachedSecond = -1;
+        thread_local char        text[32];
+        thread_local std::size_t length = 0;
 
-        // it was easier to manipulate, can also use other ways of string
-        // formatting.
-        std::stringstream date;
-        date << localTime.tm_mday << "/" << 1 + localTime.tm_mon << "/"
-             << 1900 + localTime.tm_year << " " << 1 + localTime.tm_hour << ":"
-             << 1 + localTime.tm_min << ":" << 1 + localTime.tm_sec;
-
-        return date.str();
+        std::time_t now = std::time(nullptr);
+        if (now != cachedSecond) {
+            std::tm localTime;
+            localtime_r(&now, &localTime);
+            length = std::strftime(text, sizeof(text), "%d/%m/%Y %H:%M:%S",
+                                   &localTime);
+            cachedSecond = now;
+        }
+        return std::string_view(text, length);
     }
 
     /**
@@ -102,14 +153,141 @@ class Logger {
      * @param message : String message
      * @return void
      */
-    void writeln(const std::string& message) {
+    void writeln(std::string_view message) {
         if (logOutput == LogOutput::File) {
-            logFile << message;
+            logFile.write(message.data(), message.size());
         } else {
-            std::cout << message;
+            std::cout.write(message.data(), message.size());
+        }
+    }
+
+    /* ring of the calling thread, registered with the writer on first use */
+    LogRing& threadRing() {
+        struct Owner {
+            std::shared_ptr<LogRing> ring;
+            ~Owner() {
+                if (ring != nullptr) {
+                    ring->Retire();
+                }
+            }
+        };
+        thread_local Owner owner;
+
+        if (owner.ring == nullptr) {
+            owner.ring = std::make_shared<LogRing>(ringSize);
+            std::lock_guard<std::mutex> guard(ringsLock);
+            rings.push_back(owner.ring);
+        }
+        return *owner.ring;
+    }
+
+    void wakeWriter() {
+        if (writerSleeping.load(std::memory_order_relaxed) &&
+            writerSleeping.exchange(false)) {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            wake.notify_one();
+        }
+    }
+
+    /* moves every pending line into `batch`, returns false if none were */
+    bool drainRings(std::string& batch) {
+        std::lock_guard<std::mutex> guard(ringsLock);
+        for (auto ring = rings.begin(); ring != rings.end();) {
+            bool retired = (*ring)->IsRetired();
+            (*ring)->Drain(batch);
+
+            if (std::uint64_t dropped = (*ring)->TakeDropped()) {
+                batch.append("[").append(getLocalTime()).append("][");
+                batch.append(levelNameOf(LogLevel::Warn)).append("]");
+                batch.append(std::to_string(dropped));
+                batch.append(" log messages dropped, the buffer was full\n");
+            }
+
+            // a retired ring gets no more lines once its thread is gone
+            ring = retired ? rings.erase(ring) : std::next(ring);
+        }
+        return !batch.empty();
+    }
+
+    void writeBatch(std::string_view batch) {
+        std::lock_guard<std::mutex> guard(threadLock);
+        writeln(batch);
+        if (logOutput == LogOutput::File) {
+            logFile.flush();
+        } else {
+            std::cout.flush();
+        }
+    }
+
+    /* body of the writer thread, batches lines of all threads per write */
+    void writeLoop() {
+        std::string batch;
+        batch.reserve(ringSize);
+
+        while (true) {
+            bool stop = stopping.load();
+            batch.clear();
+            if (drainRings(batch)) {
+                writeBatch(batch);
+                continue;
+            }
+            if (stop) {
+                return;
+            }
+
+            // lines pushed before the flag is seen are picked up by the
+            // second drain, later ones wake the writer up
+            writerSleeping.store(true);
+            if (drainRings(batch)) {
+                writerSleeping.store(false);
+                writeBatch(batch);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(wakeLock);
+            wake.wait_for(lock, std::chrono::milliseconds(100), [this] {
+                return !writerSleeping.load() || stopping.load();
+            });
+            writerSleeping.store(false);
         }
     }
 
+    /* writes one line, or queues it in asynchronous mode */
+    void emit(LogLevel messageLevel, std::string_view message) {
+        std::string_view level = levelNameOf(messageLevel);
+        std::string_view pieces[] = {"[", getLocalTime(), "][", level, "]",
+                                     message, "\n"};
+        std::size_t      length = 0;
+        for (std::string_view piece : pieces) {
+            length += piece.size();
+        }
+
+        if (!async.load(std::memory_order_acquire)) {
+            thread_local std::string line;
+            line.clear();
+            for (std::string_view piece : pieces) {
+                line.append(piece);
+            }
+            std::lock_guard<std::mutex> guard(threadLock);
+            writeln(line);
+            return;
+        }
+
+        LogRing& ring = threadRing();
+        if (length > ring.Capacity()) {
+            ring.CountDrop();  // could never fit, even in an empty ring
+            return;
+        }
+        while (!ring.TryPush(pieces, std::size(pieces), length)) {
+            if (overflow == LogOverflow::Drop) {
+                ring.CountDrop();
+                break;
+            }
+            wakeWriter();
+            std::this_thread::yield();
+        }
+        wakeWriter();
+    }
+
    public:
     /**
      * Get Single Logger Instance or Create new Object if Not Created
@@ -165,7 +343,10 @@ class Logger {
      * used.
      * @param message: Message to be logged.
      */
-    void Log(std::string message) { Log(message, this->logLevel); }
+    void Log(std::string_view message) {
+        LogLevel level = logLevel.load(std::memory_order_relaxed);
+        emit(level, message);
+    }
 
     /**
      * Log given message with defined parameters and generate message to pass on
@@ -180,19 +361,80 @@ class Logger {
      * Maybe have a flag to check if the user wants to quit the application
      * automatically if error level logs are written.
      */
-    void Log(std::string message, LogLevel messageLevel) {
-        auto time = getLocalTime();
-        // we could have checked if the messageLevel
-        // existed on the map, but as it is an enum class,
-        // int values as argument are not allowed, hence
-        // only valid keys are passed, thus not checking.
-        auto level = levelName.find(messageLevel)->second;
-        auto logstring =
-            std::string('[' + time + ']' + '[' + level + ']' + message + '\n');
+    void Log(std::string_view message, LogLevel messageLevel) {
+        if (IsLogLevelEnabled(messageLevel,
+                              logLevel.load(std::memory_order_relaxed))) {
+            emit(messageLevel, message);
+        }
+    }
+
+    /**
+     * @brief Logs `format` with each `{}` replaced by the next argument, e.g.
+     * `Log<LogLevel::Debug>("route {} added", route)`.
+     *
+     * Levels above `DINOSCALE_LOG_LEVEL` compile to nothing. Otherwise the
+     * message is only formatted when the level passes the runtime level set by
+     * `SetPreferences`, into a buffer reused by the calling thread.
+     */
+    template <LogLevel level, typename... Args>
+    void Log(LogFormat<Args...> format, const Args&... args) {
+        if constexpr (IsLogLevelEnabled(level, DINOSCALE_LOG_LEVEL)) {
+            if (!IsLogLevelEnabled(level,
+                                   logLevel.load(std::memory_order_relaxed))) {
+                return;
+            }
+            thread_local std::string message;
+            message.clear();
+            FormatLogMessage(message, format.Get(), args...);
+            emit(level, message);
+        }
+    }
+
+    template <typename... Args>
+    void Error(LogFormat<Args...> format, const Args&... args) {
+        Log<LogLevel::Error, Args...>(format, args...);
+    }
 
-        threadLock.lock();
-        writeln(logstring);
-        threadLock.unlock();
+    template <typename... Args>
+    void Warn(LogFormat<Args...> format, const Args&... args) {
+        Log<LogLevel::Warn, Args...>(format, args...);
+    }
+
+    template <typename... Args>
+    void Info(LogFormat<Args...> format, const Args&... args) {
+        Log<LogLevel::Info, Args...>(format, args...);
+    }
+
+    template <typename... Args>
+    void Debug(LogFormat<Args...> format, const Args&... args) {
+        Log<LogLevel::Debug, Args...>(format, args...);
+    }
+
+    template <typename... Args>
+    void Success(LogFormat<Args...> format, const Args&... args) {
+        Log<LogLevel::Success, Args...>(format, args...);
+    }
+
+    /**
+     * @brief Switches to asynchronous logging. Each logging thread then
+     * formats its lines into a lock-free ring of its own and a background
+     * thread writes the lines of all rings in batches, so `Log` never waits
+     * on the console or the file. Has no effect when already enabled.
+     *
+     * @param bufferSize: Bytes of the ring of each thread.
+     * @param overflowPolicy: Whether a full ring drops the message or blocks
+     * the logging thread until there is room.
+     */
+    void EnableAsync(std::size_t bufferSize = 64 * 1024,
+                     LogOverflow overflowPolicy = LogOverflow::Drop) {
+        std::lock_guard<std::mutex> guard(ringsLock);
+        if (async.load()) {
+            return;
+        }
+        ringSize = bufferSize;
+        overflow = overflowPolicy;
+        writer = std::thread(&Logger::writeLoop, this);
+        async.store(true);
     }
 
     /**
@@ -200,6 +442,15 @@ class Logger {
      * destruction.
      */
     ~Logger() {
+        if (writer.joinable()) {
+            // the writer drains every ring before it exits
+            stopping.store(true);
+            {
+                std::lock_guard<std::mutex> guard(wakeLock);
+                wake.notify_one();
+            }
+            writer.join();
+        }
         if (this->logFile.is_open()) {
             this->logFile.flush();
             this->logFile.close();
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace DinoScale {
+/**
+ * @brief Monotonic counter written by one thread and read by any.
+ *
+ * With a single writer the increment needs no atomic read-modify-write: a
+ * relaxed load and store cost about as much as a plain integer, while readers
+ * on other threads still never see a torn value.
+ */
+class Counter {
+   private:
+    std::atomic<std::uint64_t> value{0};
+
+   public:
+    /** Called by the owning thread only. */
+    void Add(std::uint64_t amount = 1) {
+        value.store(value.load(std::memory_order_relaxed) + amount,
+                    std::memory_order_relaxed);
+    }
+
+    std::uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+};
+
+/** Connections and traffic of one reactor, counted by its thread. */
+struct ConnectionCounters {
+    Counter opened;
+    Counter closed;
+    Counter timedOut;        // closed by one of the connection timeouts
+    Counter shed;            // requests answered with 503 by admission control
+    Counter cacheHits;       // requests answered from the response cache
+    Counter cacheMisses;     // requests running the handler of a cached route
+    Counter cacheCoalesced;  // requests waiting for another one's handler
+    Counter webSocketsOpened;
+    Counter webSocketsClosed;
+    Counter webSocketMessagesReceived;
+    Counter webSocketMessagesSent;  // counted once per recipient
+    Counter bytesReceived;
+    Counter bytesSent;
+};
+}  // namespace DinoScale
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "Counter.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Log-linear latency histogram in microseconds, in the style of HDR
+ * histograms: every power of two is split into 8 equal buckets, so a
+ * recorded value is known within 12.5% anywhere from microseconds to hours
+ * while the whole histogram is a fixed array of 272 counters.
+ *
+ * Recording is an index computation and two counter increments, written by
+ * one thread and read by any, see `Counter`.
+ */
+class LatencyHistogram {
+   public:
+    static constexpr int         subBucketBits = 3;
+    static constexpr std::size_t subBuckets = 1 << subBucketBits;
+    static constexpr std::size_t linearBuckets = 2 * subBuckets;  // 0 to 15
+    static constexpr int         maxExponent = 36;  // values below 2^36 us
+    static constexpr std::size_t bucketCount =
+        linearBuckets + (maxExponent - subBucketBits - 1) * subBuckets;
+
+    /** Bucket holding `micros`, larger values land in the last bucket. */
+    static constexpr std::size_t BucketOf(std::uint64_t micros) {
+        if (micros < linearBuckets) {
+            return micros;
+        }
+        int exponent = std::bit_width(micros) - 1;
+        if (exponent >= maxExponent) {
+            return bucketCount - 1;
+        }
+        std::size_t octave = exponent - subBucketBits - 1;
+        std::size_t step = (micros >> (exponent - subBucketBits)) &
+                           (subBuckets - 1);
+        return linearBuckets + octave * subBuckets + step;
+    }
+
+    /** Largest value counted in `bucket`. */
+    static constexpr std::uint64_t UpperBound(std::size_t bucket) {
+        if (bucket < linearBuckets) {
+            return bucket;
+        }
+        std::size_t   octave = (bucket - linearBuckets) / subBuckets;
+        std::size_t   step = (bucket - linearBuckets) % subBuckets;
+        int           shift = octave + 1;
+        std::uint64_t lower = (subBuckets + step) << shift;
+        return lower + (std::uint64_t(1) << shift) - 1;
+    }
+
+    /** Last bucket whose values are all below `2^exponent` microseconds. */
+    static constexpr std::size_t LastBucketBelow(int exponent) {
+        return BucketOf((std::uint64_t(1) << exponent) - 1);
+    }
+
+    /**
+     * @brief Sum of histograms read at one point in time, used to aggregate
+     * the histograms of all threads.
+     */
+    struct Snapshot {
+        std::array<std::uint64_t, bucketCount> buckets{};
+        std::uint64_t                          count = 0;
+        std::uint64_t                          sum = 0;  // microseconds
+
+        void Add(const LatencyHistogram& histogram) {
+            for (std::size_t i = 0; i < bucketCount; i++) {
+                std::uint64_t value = histogram.buckets[i].Get();
+                buckets[i] += value;
+                count += value;
+            }
+            sum += histogram.sum.Get();
+        }
+
+        void Add(const Snapshot& other) {
+            for (std::size_t i = 0; i < bucketCount; i++) {
+                buckets[i] += other.buckets[i];
+            }
+            count += other.count;
+            sum += other.sum;
+        }
+
+        /** Recorded values up to `UpperBound(bucket)`. */
+        std::uint64_t CountThrough(std::size_t bucket) const {
+            std::uint64_t total = 0;
+            for (std::size_t i = 0; i <= bucket; i++) {
+                total += buckets[i];
+            }
+            return total;
+        }
+
+        /** Upper bound of the bucket holding the `quantile` of the values. */
+        std::uint64_t Quantile(double quantile) const {
+            if (count == 0) {
+                return 0;
+            }
+            std::uint64_t rank = quantile * count;
+            rank = rank < count ? rank + 1 : count;
+
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < bucketCount; i++) {
+                seen += buckets[i];
+                if (seen >= rank) {
+                    return UpperBound(i);
+                }
+            }
+            return UpperBound(bucketCount - 1);
+        }
+    };
+
+   private:
+    std::array<Counter, bucketCount> buckets;
+    Counter                          sum;
+
+   public:
+    /** Called by the owning thread only. */
+    void Record(std::uint64_t micros) {
+        buckets[BucketOf(micros)].Add();
+        sum.Add(micros);
+    }
+};
+
+static_assert(LatencyHistogram::bucketCount == 272);
+static_assert(LatencyHistogram::BucketOf(15) == 15);
+static_assert(LatencyHistogram::BucketOf(16) == 16);
+static_assert(LatencyHistogram::UpperBound(23) == 31);
+static_assert(LatencyHistogram::BucketOf(32) == 24);
+static_assert(LatencyHistogram::UpperBound(LatencyHistogram::bucketCount - 1) ==
+              (std::uint64_t(1) << LatencyHistogram::maxExponent) - 1);
+}  // namespace DinoScale
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../constants/statuses.hpp"
+#include "Counter.hpp"
+#include "LatencyHistogram.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Metrics of one reactor thread: request latency per route and per
+ * status class, responses per status code and connection traffic.
+ *
+ * Everything is allocated up front and written by the owning thread only,
+ * so recording takes no lock and no allocation. Other threads read the
+ * counters while `Metrics` aggregates them.
+ */
+class MetricsShard {
+   private:
+    friend class Metrics;
+
+    static constexpr int firstStatus = 100;
+    static constexpr int lastStatus = 599;
+    static constexpr int statusClasses = 5;  // 1xx to 5xx
+
+    std::size_t                                       routeCount;
+    std::unique_ptr<LatencyHistogram[]>               routes;  // + no route
+    std::array<LatencyHistogram, statusClasses>       classes;
+    std::array<Counter, lastStatus - firstStatus + 1> statuses;
+    ConnectionCounters                                connections;
+
+    void countStatus(HTTPStatusCode status) {
+        int code = static_cast<int>(status);
+        if (code >= firstStatus && code <= lastStatus) {
+            statuses[code - firstStatus].Add();
+        }
+    }
+
+   public:
+    /** @param routeCount: Number of routes, all known before any request. */
+    explicit MetricsShard(std::size_t routeCount)
+        : routeCount(routeCount),
+          routes(std::make_unique<LatencyHistogram[]>(routeCount + 1)) {}
+
+    MetricsShard(const MetricsShard&) = delete;
+    MetricsShard& operator=(const MetricsShard&) = delete;
+
+    /**
+     * @brief Records a request answered with `status` after `elapsed`.
+     * @param route: Index of the matched route, `routeCount` or more for a
+     * request without a route.
+     */
+    void RecordRequest(std::size_t route, HTTPStatusCode status,
+                       std::chrono::steady_clock::duration elapsed) {
+        std::uint64_t micros =
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                .count();
+        routes[route < routeCount ? route : routeCount].Record(micros);
+
+        int statusClass = static_cast<int>(status) / 100 - 1;
+        if (statusClass >= 0 && statusClass < statusClasses) {
+            classes[statusClass].Record(micros);
+        }
+        countStatus(status);
+    }
+
+    /** Counts a request refused before it reached the router. */
+    void RecordRejected(HTTPStatusCode status) { countStatus(status); }
+
+    /** Counters the reactor of this thread updates. */
+    ConnectionCounters& Connections() { return connections; }
+};
+
+namespace detail {
+/* Prometheus histogram buckets: 2^4 us to 2^25 us (about 34 s) */
+constexpr int firstBoundExponent = 4;
+constexpr int lastBoundExponent = 25;
+
+inline void appendUnsigned(std::string& out, std::uint64_t value) {
+    out.append(std::to_string(value));
+}
+
+inline void appendSeconds(std::string& out, double micros) {
+    char text[32];
+    int  length = std::snprintf(text, sizeof(text), "%.9g", micros / 1e6);
+    out.append(text, length);
+}
+
+/* label value with backslash, double quote and line feed escaped */
+inline void appendLabelValue(std::string& out, std::string_view value) {
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (c == '\n') {
+            out.append("\\n");
+        } else {
+            out.push_back(c);
+        }
+    }
+}
+
+inline void appendFamily(std::string& out, std::string_view name,
+                         std::string_view type, std::string_view help) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+inline void appendSample(std::string& out, std::string_view name,
+                         std::uint64_t value) {
+    out.append(name).append(" ");
+    appendUnsigned(out, value);
+    out.append("\n");
+}
+
+/* `labels` is the label list without braces, e.g. `code="2xx"` */
+inline void appendHistogram(std::string& out, std::string_view name,
+                            std::string_view                   labels,
+                            const LatencyHistogram::Snapshot& histogram) {
+    for (int exponent = firstBoundExponent; exponent <= lastBoundExponent;
+         exponent++) {
+        out.append(name).append("_bucket{").append(labels).append(",le=\"");
+        appendSeconds(out, double(std::uint64_t(1) << exponent));
+        out.append("\"} ");
+        appendUnsigned(out, histogram.CountThrough(
+                                LatencyHistogram::LastBucketBelow(exponent)));
+        out.append("\n");
+    }
+    out.append(name).append("_bucket{").append(labels);
+    out.append(",le=\"+Inf\"} ");
+    appendUnsigned(out, histogram.count);
+    out.append("\n");
+
+    out.append(name).append("_sum{").append(labels).append("} ");
+    appendSeconds(out, histogram.sum);
+    out.append("\n");
+    out.append(name).append("_count{").append(labels).append("} ");
+    appendUnsigned(out, histogram.count);
+    out.append("\n");
+}
+
+inline void appendQuantiles(std::string& out, std::string_view name,
+                            std::string_view                   labels,
+                            const LatencyHistogram::Snapshot& histogram) {
+    struct Quantile {
+        double           value;
+        std::string_view label;
+    };
+    for (Quantile quantile : {Quantile{0.5, "0.5"}, Quantile{0.9, "0.9"},
+                              Quantile{0.99, "0.99"},
+                              Quantile{0.999, "0.999"}}) {
+        out.append(name).append("{").append(labels).append(",quantile=\"");
+        out.append(quantile.label).append("\"} ");
+        appendSeconds(out, histogram.Quantile(quantile.value));
+        out.append("\n");
+    }
+    out.append(name).append("_sum{").append(labels).append("} ");
+    appendSeconds(out, histogram.sum);
+    out.append("\n");
+    out.append(name).append("_count{").append(labels).append("} ");
+    appendUnsigned(out, histogram.count);
+    out.append("\n");
+}
+}  // namespace detail
+
+/**
+ * @brief Server wide metrics made of one `MetricsShard` per reactor thread,
+ * aggregated only when they are read.
+ */
+class Metrics {
+   private:
+    struct RouteLabels {
+        std::string method;
+        std::string pattern;
+    };
+
+    std::vector<RouteLabels> routes;  // index is the route index
+
+    mutable std::mutex                          shardsLock;
+    std::vector<std::unique_ptr<MetricsShard>> shards;
+
+   public:
+    /**
+     * @brief Names the next route, in the order of the route indices. All
+     * routes are added before the first shard.
+     */
+    void AddRoute(std::string_view method, std::string_view pattern) {
+        routes.push_back({std::string(method), std::string(pattern)});
+    }
+
+    /** Creates the shard of a new reactor thread, valid as long as `this`. */
+    MetricsShard& AddShard() {
+        std::lock_guard<std::mutex> guard(shardsLock);
+        shards.push_back(std::make_unique<MetricsShard>(routes.size()));
+        return *shards.back();
+    }
+
+    /**
+     * @brief Sums up every shard in the Prometheus text exposition format.
+     * Routes and status codes appear once they served a request.
+     */
+    std::string RenderPrometheus() const {
+        std::vector<LatencyHistogram::Snapshot> routeTotals(routes.size() +
+                                                            1);
+        std::array<LatencyHistogram::Snapshot, MetricsShard::statusClasses>
+                                   classTotals;
+        std::vector<std::uint64_t> statusTotals(MetricsShard::lastStatus -
+                                                MetricsShard::firstStatus + 1);
+        std::uint64_t opened = 0, closed = 0, timedOut = 0, shed = 0,
+                      received = 0, sent = 0;
+        std::array<std::uint64_t, 3> cacheLookups{};  // hit, miss, coalesced
+        std::uint64_t webSocketsOpened = 0, webSocketsClosed = 0;
+        std::array<std::uint64_t, 2> webSocketMessages{};  // received, sent
+        {
+            std::lock_guard<std::mutex> guard(shardsLock);
+            for (const std::unique_ptr<MetricsShard>& shard : shards) {
+                for (std::size_t i = 0; i <= routes.size(); i++) {
+                    routeTotals[i].Add(shard->routes[i]);
+                }
+                for (std::size_t i = 0; i < classTotals.size(); i++) {
+                    classTotals[i].Add(shard->classes[i]);
+                }
+                for (std::size_t i = 0; i < statusTotals.size(); i++) {
+                    statusTotals[i] += shard->statuses[i].Get();
+                }
+                // closed first, so the active count never goes negative
+                closed += shard->connections.closed.Get();
+                opened += shard->connections.opened.Get();
+                timedOut += shard->connections.timedOut.Get();
+                shed += shard->connections.shed.Get();
+                cacheLookups[0] += shard->connections.cacheHits.Get();
+                cacheLookups[1] += shard->connections.cacheMisses.Get();
+                cacheLookups[2] += shard->connections.cacheCoalesced.Get();
+                webSocketsClosed += shard->connections.webSocketsClosed.Get();
+                webSocketsOpened += shard->connections.webSocketsOpened.Get();
+                webSocketMessages[0] +=
+                    shard->connections.webSocketMessagesReceived.Get();
+                webSocketMessages[1] +=
+                    shard->connections.webSocketMessagesSent.Get();
+                received += shard->connections.bytesReceived.Get();
+                sent += shard->connections.bytesSent.Get();
+            }
+        }
+
+        std::string out;
+        detail::appendFamily(out, "dinoscale_connections_active", "gauge",
+                             "Open client connections.");
+        detail::appendSample(out, "dinoscale_connections_active",
+                             opened >= closed ? opened - closed : 0);
+        detail::appendFamily(out, "dinoscale_connections_total", "counter",
+                             "Accepted client connections.");
+        detail::appendSample(out, "dinoscale_connections_total", opened);
+        detail::appendFamily(out, "dinoscale_connections_timed_out_total",
+                             "counter",
+                             "Connections closed by a header, body, "
+                             "keep-alive or write timeout.");
+        detail::appendSample(out, "dinoscale_connections_timed_out_total",
+                             timedOut);
+        detail::appendFamily(out, "dinoscale_requests_shed_total", "counter",
+                             "Requests answered with 503 because the "
+                             "handler queue was overloaded.");
+        detail::appendSample(out, "dinoscale_requests_shed_total", shed);
+        detail::appendFamily(out, "dinoscale_response_cache_lookups_total",
+                             "counter",
+                             "Requests to cached routes by whether they were "
+                             "answered from the cache, ran the handler or "
+                             "waited for another request running it.");
+        static constexpr std::array<std::string_view, 3> lookupResults = {
+            "hit", "miss", "coalesced"};
+        for (std::size_t i = 0; i < lookupResults.size(); i++) {
+            out.append("dinoscale_response_cache_lookups_total{result=\"");
+            out.append(lookupResults[i]);
+            out.append("\"} ");
+            detail::appendUnsigned(out, cacheLookups[i]);
+            out.append("\n");
+        }
+        detail::appendFamily(out, "dinoscale_websockets_active", "gauge",
+                             "Connections upgraded to WebSocket.");
+        detail::appendSample(out, "dinoscale_websockets_active",
+                             webSocketsOpened >= webSocketsClosed
+                                 ? webSocketsOpened - webSocketsClosed
+                                 : 0);
+        detail::appendFamily(out, "dinoscale_websocket_messages_total",
+                             "counter",
+                             "WebSocket messages received from clients and "
+                             "sent to them, broadcasts once per recipient.");
+        static constexpr std::array<std::string_view, 2> directions = {
+            "received", "sent"};
+        for (std::size_t i = 0; i < directions.size(); i++) {
+            out.append("dinoscale_websocket_messages_total{direction=\"");
+            out.append(directions[i]);
+            out.append("\"} ");
+            detail::appendUnsigned(out, webSocketMessages[i]);
+            out.append("\n");
+        }
+        detail::appendFamily(out, "dinoscale_received_bytes_total", "counter",
+                             "Bytes received from clients.");
+        detail::appendSample(out, "dinoscale_received_bytes_total", received);
+        detail::appendFamily(out, "dinoscale_sent_bytes_total", "counter",
+                             "Bytes sent to clients.");
+        detail::appendSample(out, "dinoscale_sent_bytes_total", sent);
+
+        detail::appendFamily(out, "dinoscale_responses_total", "counter",
+                             "Responses by status code.");
+        for (std::size_t i = 0; i < statusTotals.size(); i++) {
+            if (statusTotals[i] == 0) {
+                continue;
+            }
+            out.append("dinoscale_responses_total{code=\"");
+            detail::appendUnsigned(out, i + MetricsShard::firstStatus);
+            out.append("\"} ");
+            detail::appendUnsigned(out, statusTotals[i]);
+            out.append("\n");
+        }
+
+        detail::appendFamily(
+            out, "dinoscale_status_duration_seconds", "histogram",
+            "Time from a complete request to its queued response, by status "
+            "class.");
+        for (std::size_t i = 0; i < classTotals.size(); i++) {
+            if (classTotals[i].count == 0) {
+                continue;
+            }
+            std::string labels = "code=\"" + std::to_string(i + 1) + "xx\"";
+            detail::appendHistogram(out, "dinoscale_status_duration_seconds",
+                                    labels, classTotals[i]);
+        }
+
+        std::vector<std::string> routeLabels(routeTotals.size());
+        for (std::size_t i = 0; i < routeTotals.size(); i++) {
+            std::string& labels = routeLabels[i];
+            if (i == routes.size()) {
+                labels = "method=\"\",route=\"\"";  // no route matched
+                continue;
+            }
+            labels = "method=\"" + routes[i].method + "\",route=\"";
+            detail::appendLabelValue(labels, routes[i].pattern);
+            labels.push_back('"');
+        }
+
+        detail::appendFamily(
+            out, "dinoscale_request_duration_seconds", "histogram",
+            "Time from a complete request to its queued response, by route.");
+        for (std::size_t i = 0; i < routeTotals.size(); i++) {
+            if (routeTotals[i].count > 0) {
+                detail::appendHistogram(out,
+                                        "dinoscale_request_duration_seconds",
+                                        routeLabels[i], routeTotals[i]);
+            }
+        }
+
+        detail::appendFamily(
+            out, "dinoscale_request_latency_seconds", "summary",
+            "Latency quantiles by route, within 12.5%, since the start.");
+        for (std::size_t i = 0; i < routeTotals.size(); i++) {
+            if (routeTotals[i].count > 0) {
+                detail::appendQuantiles(out,
+                                        "dinoscale_request_latency_seconds",
+                                        routeLabels[i], routeTotals[i]);
+            }
+        }
+        return out;
+    }
+};
+}  // namespace DinoScale
@@ -0,0 +1,747 @@
+#pragma once
+
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../core/HTTPRequest.hpp"
+#include "../core/HandlerIO.hpp"
+#include "../core/RequestBody.hpp"
+#include "../metrics/Counter.hpp"
+#include "../utils/Arena.hpp"
+#include "../utils/BufferPool.hpp"
+#include "../utils/FileDescriptor.hpp"
+#include "../utils/FrameStack.hpp"
+#include "../utils/TimerWheel.hpp"
+
+namespace DinoScale {
+class Connection;
+class Reactor;
+
+/**
+ * @brief A protocol a connection switched to, which interprets all of its
+ * input from then on instead of the HTTP/1.1 request parser, e.g.
+ * `HTTP2Session`. Destroyed together with the connection.
+ */
+class ConnectionProtocol {
+   public:
+    virtual ~ConnectionProtocol() = default;
+
+    /** Consumes the input of `connection` and queues what it answers, like
+     * `RequestProcessor::ProcessRequests`. */
+    virtual void Process(Connection& connection, Reactor& reactor) = 0;
+
+    /**
+     * @brief Called once everything queued on `connection` was sent, to
+     * queue output which was held back meanwhile.
+     * @return true if anything was queued, or input left unread by
+     * `IsInputPaused` is to be processed now.
+     */
+    virtual bool Drained(Connection& connection) = 0;
+
+    /** Whether the connection is left unread until its output drained, e.g.
+     * while a client does not read what answers its frames. */
+    virtual bool IsInputPaused() const { return false; }
+
+    /** How long the connection may stay silent, `keepAlive` by default like
+     * between HTTP/1.1 requests. */
+    virtual std::chrono::steady_clock::duration IdleTimeout(
+        std::chrono::steady_clock::duration keepAlive) const {
+        return keepAlive;
+    }
+};
+
+/**
+ * @brief Result of driving one side of a connection until the kernel would
+ * block.
+ */
+enum class IOStatus {
+    Ok,          // made progress and the socket would now block
+    PeerClosed,  // peer shut down its writing side
+    BufferFull,  // input exceeded the configured limit
+    Error        // unrecoverable socket error
+};
+
+/**
+ * @brief How long a connection may take in each of its states before it is
+ * closed, zero disables the respective limit.
+ */
+struct ConnectionTimeouts {
+    /** Receiving a complete request head, from its first byte or from the
+     * connection being accepted. Not extended by further bytes, so clients
+     * trickling a head in never hold a connection for longer. */
+    std::chrono::steady_clock::duration header{};
+
+    /** Silence while a request body is being received. */
+    std::chrono::steady_clock::duration body{};
+
+    /** Silence between requests on a persistent connection. */
+    std::chrono::steady_clock::duration keepAlive{};
+
+    /** Queued output without the client accepting any of it. */
+    std::chrono::steady_clock::duration write{};
+};
+
+/**
+ * @brief A piece of queued output: bytes owned by the segment, bytes copied
+ * into the connection's arena, bytes owned elsewhere and referenced by the
+ * segment, or a range of an open file which is sent with `sendfile` and never
+ * enters user space.
+ */
+struct OutputSegment {
+    std::string data;  // owned bytes, unless `view` is set
+    std::size_t sent = 0;
+
+    std::string_view            view;   // referenced bytes
+    std::shared_ptr<const void> owner;  // keeps `view` alive, may be null
+    bool                        inArena = false;  // `view` is an arena copy
+
+    FileDescriptor file;  // file segment when valid
+    off_t          fileOffset = 0;
+    std::size_t    fileRemaining = 0;
+
+    bool IsFile() const { return file.IsValid(); }
+    bool IsView() const { return view.data() != nullptr; }
+
+    std::string_view Bytes() const {
+        return IsView() ? view : std::string_view(data);
+    }
+};
+
+/**
+ * @brief State of a single non-blocking client socket.
+ *
+ * The connection only knows how to move bytes between the socket and its
+ * buffers. Reading drains the socket until `EAGAIN` (required by edge
+ * triggered epoll) and writing pushes the queued segments until the kernel
+ * buffer fills up, remembering where it stopped (including the offset inside
+ * a file being sent) so the next `EPOLLOUT` resumes from there. Interpreting
+ * the bytes is left to the server, the connection only carries the state of
+ * the request in progress (parser and body) between reads.
+ *
+ * Connections are pooled by their reactor: `Close` returns every buffer to
+ * the reactor's `BufferPool` and `Open` serves the next socket with the same
+ * object. Input lives in a pooled buffer held only while unconsumed bytes
+ * are buffered, and copied output lives in an arena reset whenever all
+ * output is sent, so a connection between requests holds no I/O memory and
+ * steady state serving does not allocate.
+ *
+ * A coroutine handler serving the request at the input front runs inside
+ * the connection: its frames live on the connection's `FrameStack` and the
+ * connection implements the `HandlerIO` it awaits, recording what the handler
+ * waits for until the reactor or the server wakes it up. Closing the
+ * connection destroys a handler still waiting.
+ *
+ * A connection may switch to another `ConnectionProtocol`, which then
+ * receives all of its input. Such a protocol multiplexes requests, so the
+ * connection keeps being read while handlers of some of them run elsewhere.
+ */
+class Connection : public HandlerIO {
+   public:
+    static constexpr int maxGather = 64;  // iovecs per send
+
+   private:
+    static constexpr std::size_t firstInputSize = 16384;
+    static constexpr std::size_t inlineString = 64;  // see `Write(string&&)`
+
+    int                        fd;
+    std::size_t                maxInput;  // bound for buffered request bytes
+    ConnectionCounters&        counters;  // traffic of the owning reactor
+    BufferPool&                buffers;   // I/O buffers of the owning reactor
+    PooledBuffer               input;     // bytes received but not consumed
+    std::size_t                inputSize;
+    std::vector<OutputSegment> output;      // segments queued for the client
+    std::size_t                outputHead;  // first segment not fully sent
+    Arena                      arena;       // copies of queued bytes
+    bool                       peerClosed;  // peer will not send anything more
+    bool                       closeAfterWrite;
+    unsigned                   suspensions;   // handlers running off the loop
+    bool                       abandoned;     // closed while suspended
+    unsigned                   requestCount;  // requests served so far
+
+    std::unique_ptr<ConnectionProtocol> protocol;  // null for HTTP/1.1
+
+    HTTPRequestParser parser;   // progress on the request at the input front
+    HTTPRequest       request;  // that request, once its head is parsed
+    RequestBody       body;     // body of that request
+
+    /* last time bytes were received or sent, and the first byte of the
+     * request at the input front arrived (or the socket was accepted) */
+    std::chrono::steady_clock::time_point lastActivity;
+    std::chrono::steady_clock::time_point requestStarted;
+
+    TimerNode<Connection> timer;  // fires at the deadline, see `Deadline`
+
+    FrameStack              frames;   // of the coroutine handler
+    std::coroutine_handle<> handler;  // serving the request at the front
+    std::coroutine_handle<> waiter;   // where the handler is suspended
+    Wait                    waitingFor;
+    std::chrono::steady_clock::time_point wakeAt;  // of `Wait::Timer`
+
+    /* releases the segment at the front of the output, the arena starts
+     * over once everything queued is sent */
+    void popOutput() {
+        output[outputHead] = OutputSegment();
+        if (++outputHead == output.size()) {
+            output.clear();
+            outputHead = 0;
+            arena.Reset();
+        }
+    }
+
+    /* drops `count` sent bytes of the memory segments at the front */
+    void advance(std::size_t count) {
+        while (count > 0) {
+            OutputSegment& segment = output[outputHead];
+            std::size_t    left = segment.Bytes().size() - segment.sent;
+            if (count < left) {
+                segment.sent += count;
+                return;
+            }
+            count -= left;
+            popOutput();
+        }
+    }
+
+    /* makes room for more input, moving it to a buffer twice as large */
+    void growInput() {
+        PooledBuffer larger = buffers.Take(
+            input.IsValid() ? input.Capacity() * 2 : firstInputSize);
+        if (inputSize > 0) {
+            std::memcpy(larger.Data(), input.Data(), inputSize);
+        }
+        input = std::move(larger);
+    }
+
+   public:
+    /**
+     * @param maxInput: Bound for buffered request bytes.
+     * @param counters: Traffic counters of the owning reactor.
+     * @param buffers: Buffer pool of the owning reactor, must outlive the
+     * connection.
+     */
+    Connection(std::size_t maxInput, ConnectionCounters& counters,
+               BufferPool& buffers)
+        : fd(-1),
+          maxInput(maxInput),
+          counters(counters),
+          buffers(buffers),
+          inputSize(0),
+          outputHead(0),
+          arena(buffers),
+          peerClosed(false),
+          closeAfterWrite(false),
+          suspensions(0),
+          abandoned(false),
+          requestCount(0),
+          frames(buffers),
+          waitingFor(Wait::None) {
+        timer.owner = this;
+        output.reserve(16);
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    /** Starts serving the accepted socket `socket`. */
+    void Open(int socket) {
+        fd = socket;
+        lastActivity = std::chrono::steady_clock::now();
+        requestStarted = lastActivity;
+    }
+
+    /**
+     * @brief Closes the socket and drops every piece of state, returning the
+     * buffers to the pool. The connection can then `Open` another socket.
+     */
+    void Close() {
+        DropHandler();
+        protocol.reset();
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        input.Reset();
+        inputSize = 0;
+        output.clear();
+        outputHead = 0;
+        arena.Release();
+        parser.Reset();
+        body.Release();
+        peerClosed = false;
+        closeAfterWrite = false;
+        suspensions = 0;
+        abandoned = false;
+        requestCount = 0;
+    }
+
+    int Fd() const { return fd; }
+
+    /**
+     * @brief Reads everything currently available on the socket.
+     */
+    IOStatus ReadAvailable() {
+        lastActivity = std::chrono::steady_clock::now();
+        if (inputSize == 0) {
+            requestStarted = lastActivity;
+        }
+
+        while (true) {
+            if (inputSize >= maxInput) {
+                return IOStatus::BufferFull;
+            }
+            if (inputSize == input.Capacity()) {
+                growInput();
+            }
+
+            ssize_t bytesReceived = recv(fd, input.Data() + inputSize,
+                                         input.Capacity() - inputSize, 0);
+            if (bytesReceived > 0) {
+                inputSize += bytesReceived;
+                counters.bytesReceived.Add(bytesReceived);
+                continue;
+            }
+
+            if (bytesReceived == 0) {
+                peerClosed = true;
+                return IOStatus::PeerClosed;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return IOStatus::Ok;
+            }
+            return IOStatus::Error;
+        }
+    }
+
+    /**
+     * @brief Appends bytes a completion based backend received on the
+     * socket. Unlike `ReadAvailable` the input may grow past the limit by one
+     * chunk, the backend closes the connection if it is not consumed.
+     */
+    void AppendInput(std::string_view data) {
+        lastActivity = std::chrono::steady_clock::now();
+        if (inputSize == 0) {
+            requestStarted = lastActivity;
+        }
+        while (input.Capacity() - inputSize < data.size()) {
+            growInput();
+        }
+        std::memcpy(input.Data() + inputSize, data.data(), data.size());
+        inputSize += data.size();
+        counters.bytesReceived.Add(data.size());
+    }
+
+    /** Records that the peer shut down its writing side. */
+    void MarkPeerClosed() { peerClosed = true; }
+
+    /**
+     * @brief Describes the unsent memory segments at the front of the output
+     * as `vectors`, up to the first file segment.
+     * @param file: Set to the file segment ending the run, which is the front
+     * segment when the run is empty, or to null.
+     * @return Number of vectors filled.
+     */
+    int GatherOutput(iovec* vectors, int maxCount,
+                     const OutputSegment*& file) const {
+        int         count = 0;
+        std::size_t next = outputHead;
+        for (; next < output.size() && count < maxCount; next++) {
+            if (output[next].IsFile()) {
+                break;
+            }
+            std::string_view bytes = output[next].Bytes();
+            std::size_t skip = next == outputHead ? output[next].sent : 0;
+            vectors[count].iov_base = const_cast<char*>(bytes.data()) + skip;
+            vectors[count].iov_len = bytes.size() - skip;
+            count++;
+        }
+        bool fileFollows = next < output.size() && output[next].IsFile();
+        file = fileFollows ? &output[next] : nullptr;
+        return count;
+    }
+
+    /** Drops `count` bytes sent from the vectors of `GatherOutput`. */
+    void CompleteSend(std::size_t count) {
+        if (count > 0) {
+            lastActivity = std::chrono::steady_clock::now();
+        }
+        counters.bytesSent.Add(count);
+        advance(count);
+    }
+
+    /** Drops `count` bytes sent from the file segment at the front, the
+     * backend having read them at its `fileOffset`. */
+    void CompleteFileSend(std::size_t count) {
+        OutputSegment& segment = output[outputHead];
+        lastActivity = std::chrono::steady_clock::now();
+        counters.bytesSent.Add(count);
+        segment.fileOffset += count;
+        segment.fileRemaining -= count;
+        if (segment.fileRemaining == 0) {
+            popOutput();
+        }
+    }
+
+    /**
+     * @brief Writes as much pending output as the socket accepts. Runs of
+     * memory segments leave in a single `sendmsg` gathering all of them, and
+     * memory directly followed by a file is sent with `MSG_MORE`, so a
+     * response header and the start of its file share TCP segments.
+     */
+    IOStatus Flush() {
+        while (HasPendingOutput()) {
+            OutputSegment& segment = output[outputHead];
+            ssize_t        bytesSent;
+
+            if (segment.IsFile()) {
+                bytesSent = sendfile(fd, segment.file.Get(),
+                                     &segment.fileOffset,
+                                     segment.fileRemaining);
+                if (bytesSent == 0) {
+                    // the file shrank below the announced Content-Length
+                    return IOStatus::Error;
+                }
+                if (bytesSent > 0) {
+                    lastActivity = std::chrono::steady_clock::now();
+                    counters.bytesSent.Add(bytesSent);
+                    segment.fileRemaining -= bytesSent;
+                    if (segment.fileRemaining == 0) {
+                        popOutput();
+                    }
+                    continue;
+                }
+            } else {
+                iovec                vectors[maxGather];
+                const OutputSegment* file;
+
+                msghdr message{};
+                message.msg_iov = vectors;
+                message.msg_iovlen = GatherOutput(vectors, maxGather, file);
+                int flags = MSG_NOSIGNAL | (file != nullptr ? MSG_MORE : 0);
+
+                bytesSent = sendmsg(fd, &message, flags);
+                if (bytesSent >= 0) {
+                    CompleteSend(bytesSent);
+                    continue;
+                }
+            }
+
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return IOStatus::Ok;
+            }
+            return IOStatus::Error;
+        }
+        return IOStatus::Ok;
+    }
+
+    /** Bytes received from the client which have not been consumed yet. */
+    std::string_view Input() const {
+        return std::string_view(input.Data(), inputSize);
+    }
+
+    /**
+     * @brief Drops the first `count` bytes of the input once they are
+     * handled. The buffer goes back to the pool once the input is empty.
+     */
+    void Consume(std::size_t count) {
+        ConsumeAt(0, count);
+        parser.Reset();
+        if (inputSize == 0) {
+            input.Reset();
+        } else {
+            // the next request was received together with this one
+            requestStarted = lastActivity;
+        }
+    }
+
+    /**
+     * @brief Drops `count` bytes starting at `offset`. Used to take body bytes
+     * which follow the head while keeping the head, and the views into it, at
+     * the front of the input.
+     */
+    void ConsumeAt(std::size_t offset, std::size_t count) {
+        std::memmove(input.Data() + offset, input.Data() + offset + count,
+                     inputSize - offset - count);
+        inputSize -= count;
+    }
+
+    HTTPRequestParser& Parser() { return parser; }
+
+    HTTPRequest& Request() { return request; }
+
+    RequestBody& Body() { return body; }
+
+    /**
+     * @brief Queues a copy of `data` to be sent by the next `Flush`. The copy
+     * is taken from the arena and continues the previous copy when possible.
+     */
+    void Write(std::string_view data) {
+        if (data.empty()) {
+            return;
+        }
+        if (HasPendingOutput() && output.back().inArena &&
+            arena.Extend(output.back().view, data)) {
+            return;
+        }
+        OutputSegment& segment = output.emplace_back();
+        segment.view = arena.Copy(data);
+        segment.inArena = true;
+    }
+
+    void Write(const char* data) { Write(std::string_view(data)); }
+
+    /**
+     * @brief Queues `data`, taking over its bytes instead of copying them.
+     * Short strings are copied: their bytes live inside the string object,
+     * which moves whenever the output queue grows, and a backend may still
+     * be sending from them.
+     */
+    void Write(std::string&& data) {
+        if (data.size() <= inlineString) {
+            Write(std::string_view(data));
+            return;
+        }
+        output.emplace_back().data = std::move(data);
+    }
+
+    /**
+     * @brief Queues `data` by reference. `owner` keeps the bytes alive until
+     * they are sent, null for memory which outlives the connection.
+     */
+    void WriteShared(std::string_view            data,
+                     std::shared_ptr<const void> owner) {
+        if (data.empty()) {
+            return;
+        }
+        OutputSegment& segment = output.emplace_back();
+        segment.view = data;
+        segment.owner = std::move(owner);
+    }
+
+    /**
+     * @brief Queues `length` bytes of `file` starting at `offset`, they are
+     * copied from the page cache to the socket by the kernel.
+     */
+    void WriteFile(FileDescriptor file, off_t offset, std::size_t length) {
+        if (length == 0) {
+            return;
+        }
+        OutputSegment& segment = output.emplace_back();
+        segment.file = std::move(file);
+        segment.fileOffset = offset;
+        segment.fileRemaining = length;
+    }
+
+    bool HasPendingOutput() const { return outputHead < output.size(); }
+
+    bool IsPeerClosed() const { return peerClosed; }
+
+    /** The connection is closed as soon as the queued output is written. */
+    void CloseAfterWrite() { closeAfterWrite = true; }
+
+    bool IsCloseScheduled() const { return closeAfterWrite; }
+
+    /**
+     * @brief Marks the request at the input front as handed to another
+     * thread. Until `Resume`, the connection is neither read nor closed, so
+     * the input and body it references stay untouched. Under a multiplexing
+     * `ConnectionProtocol` the connection is still read, and every handler
+     * handed off suspends it once more.
+     */
+    void Suspend() { suspensions++; }
+
+    /** Ends one `Suspend`. Time spent in the handler is not counted against
+     * the client by the timeouts. */
+    void Resume() {
+        suspensions--;
+        lastActivity = std::chrono::steady_clock::now();
+    }
+
+    bool IsSuspended() const { return suspensions > 0; }
+
+    /** Records that the connection was closed while suspended, it is
+     * destroyed once its handler finished. */
+    void Abandon() { abandoned = true; }
+
+    bool IsAbandoned() const { return abandoned; }
+
+    /** Hands all further input to `next`. */
+    void SwitchProtocol(std::unique_ptr<ConnectionProtocol> next) {
+        protocol = std::move(next);
+    }
+
+    /** The protocol the connection switched to, null while it speaks
+     * HTTP/1.1. */
+    ConnectionProtocol* Protocol() const { return protocol.get(); }
+
+    void CountRequest() { requestCount++; }
+
+    unsigned RequestCount() const { return requestCount; }
+
+    /**
+     * @brief The moment the connection times out in its current state:
+     * writing while output is queued, receiving a body, receiving a head
+     * while request bytes are buffered (or nothing was received yet), and
+     * idle between requests otherwise, or for as long as the protocol the
+     * connection switched to allows. `time_point::max()` while a handler
+     * builds the response or when the limit of the state is disabled.
+     */
+    std::chrono::steady_clock::time_point Deadline(
+        const ConnectionTimeouts& timeouts) const {
+        using TimePoint = std::chrono::steady_clock::time_point;
+        auto after = [](TimePoint start,
+                        std::chrono::steady_clock::duration limit) {
+            return limit.count() > 0 ? start + limit : TimePoint::max();
+        };
+
+        if (suspensions > 0) {
+            return TimePoint::max();
+        }
+        TimePoint wake =
+            waitingFor == Wait::Timer ? wakeAt : TimePoint::max();
+        if (HasPendingOutput()) {
+            return std::min(wake, after(lastActivity, timeouts.write));
+        }
+        if (handler && waitingFor != Wait::Body) {
+            return wake;
+        }
+        if (protocol) {
+            return after(lastActivity,
+                         protocol->IdleTimeout(timeouts.keepAlive));
+        }
+        if (body.IsActive()) {
+            return after(lastActivity, timeouts.body);
+        }
+        if (inputSize > 0 || requestCount == 0) {
+            return after(requestStarted, timeouts.header);
+        }
+        return after(lastActivity, timeouts.keepAlive);
+    }
+
+    /** Link into the timer wheel of the owning reactor. */
+    TimerNode<Connection>& Timer() { return timer; }
+
+    bool ShouldClose() const {
+        // a handler waiting for body bytes gets no more once the peer closed
+        return !HasPendingOutput() && suspensions == 0 &&
+               (!handler || waitingFor == Wait::Body) &&
+               (closeAfterWrite || peerClosed);
+    }
+
+    /**
+     * @brief Starts the coroutine handler `frame`, created within a
+     * `FrameStack::Scope` of `Frames()`, and runs it until it first waits.
+     * The connection destroys it once it finished.
+     */
+    void StartHandler(std::coroutine_handle<> frame) {
+        handler = frame;
+        waiter = frame;
+        Wake();
+    }
+
+    bool HasHandler() const { return static_cast<bool>(handler); }
+
+    Wait WaitingFor() const { return waitingFor; }
+
+    /** Resumes the waiting handler, which runs until it waits again or
+     * finishes. */
+    void Wake() {
+        std::coroutine_handle<> next = std::exchange(waiter, nullptr);
+        waitingFor = Wait::None;
+        {
+            FrameStack::Scope scope(frames);
+            next.resume();
+        }
+        if (handler && handler.done()) {
+            handler.destroy();
+            handler = nullptr;
+        }
+    }
+
+    /** Whether the handler waits for a time which has come by `now`. */
+    bool WakeDue(std::chrono::steady_clock::time_point now) const {
+        return waitingFor == Wait::Timer && wakeAt <= now;
+    }
+
+    /**
+     * @brief Wakes a handler waiting for its output to be sent once nothing
+     * is left to send, or lets the protocol queue more.
+     * @return false if no handler was woken and nothing was queued.
+     */
+    bool WakeIfDrained() {
+        if (HasPendingOutput()) {
+            return false;
+        }
+        if (protocol) {
+            return protocol->Drained(*this);
+        }
+        if (waitingFor != Wait::Drain) {
+            return false;
+        }
+        Wake();
+        return true;
+    }
+
+    /** Destroys a handler which has not finished, e.g. on a broken body. */
+    void DropHandler() {
+        if (handler) {
+            handler.destroy();
+            handler = nullptr;
+        }
+        waiter = nullptr;
+        waitingFor = Wait::None;
+    }
+
+    FrameStack& Frames() { return frames; }
+
+    /**
+     * @brief Whether the input is left unread for now: while suspended, and
+     * while a coroutine handler waits for anything but its body, so that
+     * a client sending ahead fills the socket buffer instead of ours.
+     * A multiplexing protocol reads on while suspended, unless it pauses
+     * the input itself.
+     */
+    bool IsInputPaused() const {
+        return (suspensions > 0 && !protocol) ||
+               (handler && waitingFor != Wait::Body) ||
+               (protocol && protocol->IsInputPaused());
+    }
+
+    ~Connection() { Close(); }
+
+   protected:
+    void suspendOn(Wait wait, std::coroutine_handle<> frame,
+                   std::chrono::steady_clock::time_point time) override {
+        waitingFor = wait;
+        waiter = frame;
+        wakeAt = time;
+    }
+
+    std::string_view bodyChunk() const override { return body.Chunk(); }
+
+    void dropBodyChunk() override { body.DropChunk(); }
+
+    bool bodyComplete() const override { return body.IsComplete(); }
+
+    void queue(std::string_view data) override { Write(data); }
+};
+}  // namespace DinoScale
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+
+namespace DinoScale {
+/**
+ * @brief Thin RAII wrapper around a Linux epoll instance. Every descriptor is
+ * registered together with an opaque pointer which is handed back untouched
+ * by `Wait`, so the owner decides how to dispatch readiness events.
+ */
+class Epoll {
+   private:
+    int epollFd;
+
+   public:
+    Epoll() : epollFd(epoll_create1(EPOLL_CLOEXEC)) {}
+
+    Epoll(const Epoll&) = delete;
+    Epoll& operator=(const Epoll&) = delete;
+
+    bool IsValid() const { return epollFd >= 0; }
+
+    /**
+     * @brief Starts watching `fd` for `events`.
+     * @param tag: Value returned in `epoll_event::data.ptr` for this fd.
+     */
+    bool Add(int fd, uint32_t events, void* tag) {
+        epoll_event event{};
+        event.events = events;
+        event.data.ptr = tag;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    bool Modify(int fd, uint32_t events, void* tag) {
+        epoll_event event{};
+        event.events = events;
+        event.data.ptr = tag;
+        return epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == 0;
+    }
+
+    void Remove(int fd) { epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr); }
+
+    /**
+     * @brief Blocks until at least one registered descriptor is ready.
+     * @param timeoutMs: -1 waits forever, 0 polls without blocking.
+     * @return Number of entries filled in `events`, 0 on timeout or signal.
+     */
+    int Wait(epoll_event* events, int maxEvents, int timeoutMs = -1) {
+        int ready = epoll_wait(epollFd, events, maxEvents, timeoutMs);
+        if (ready < 0 && errno == EINTR) {
+            return 0;
+        }
+        return ready;
+    }
+
+    ~Epoll() {
+        if (epollFd >= 0) {
+            close(epollFd);
+        }
+    }
+};
+}  // namespace DinoScale
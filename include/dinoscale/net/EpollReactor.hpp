@@ -0,0 +1,210 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "Connection.hpp"
+#include "Epoll.hpp"
+#include "Reactor.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Portable reactor multiplexing the listening socket and all of its
+ * connections over one edge triggered epoll instance, then reading and
+ * writing each ready socket with plain system calls.
+ */
+class EpollReactor : public Reactor {
+   private:
+    static constexpr int maxEvents = 256;
+
+    Epoll epoll;
+
+    /* Tags registered for the listening socket and the mailbox, connections
+     * use their own address as the tag. */
+    char listenerTag;
+    char mailboxTag;
+
+    /* stopped at the connection limit, the backlog is not drained */
+    bool acceptPaused = false;
+
+    void acceptConnections() {
+        while (true) {
+            if (atConnectionLimit()) {
+                acceptPaused = true;
+                return;
+            }
+            acceptPaused = false;
+
+            int clientFd = accept4(listenFd, nullptr, nullptr,
+                                   SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (clientFd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    logger.Error("accept failed: {}", strerror(errno));
+                }
+                return;
+            }
+
+            int noDelay = 1;
+            setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay,
+                       sizeof(noDelay));
+
+            Connection* connection = takeConnection(clientFd);
+            uint32_t    events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            if (!epoll.Add(clientFd, events, connection)) {
+                logger.Error("cannot watch client socket");
+                releaseConnection(connection);
+                continue;
+            }
+            counters.opened.Add();
+            updateDeadline(connection);
+        }
+    }
+
+    void clearMailboxSignal() {
+        std::uint64_t signals;
+        while (read(mailboxFd.Get(), &signals, sizeof(signals)) < 0 &&
+               errno == EINTR) {
+        }
+    }
+
+    void handleConnection(Connection* connection, uint32_t events) {
+        if (isClosed(connection)) {
+            return;  // by an earlier event of the batch
+        }
+        if (events & EPOLLERR) {
+            closeConnection(connection);
+            return;
+        }
+
+        do {
+            // the request being handled elsewhere still points into the
+            // input, and a waiting coroutine handler reads none
+            if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) &&
+                !connection->IsInputPaused()) {
+                while (true) {
+                    IOStatus status = connection->ReadAvailable();
+                    if (status == IOStatus::Error) {
+                        closeConnection(connection);
+                        return;
+                    }
+
+                    std::size_t buffered = connection->Input().size();
+                    processor.ProcessRequests(*connection, *this);
+
+                    if (status != IOStatus::BufferFull ||
+                        connection->IsCloseScheduled() ||
+                        connection->IsInputPaused()) {
+                        break;
+                    }
+
+                    // the socket was not drained, so edge triggered epoll will
+                    // not report it again; keep reading while requests get
+                    // consumed
+                    if (connection->Input().size() >= buffered) {
+                        // a single request larger than the input limit
+                        closeConnection(connection);
+                        return;
+                    }
+                }
+            }
+
+            if (connection->Flush() == IOStatus::Error) {
+                closeConnection(connection);
+                return;
+            }
+
+            // a handler waiting for its output to be sent carries on, then
+            // the input it left unread is processed
+            events |= EPOLLIN;
+        } while (connection->WakeIfDrained());
+
+        if (connection->ShouldClose()) {
+            closeConnection(connection);
+            return;
+        }
+        updateDeadline(connection);
+    }
+
+    void closeConnection(Connection* connection) override {
+        timers.Cancel(connection->Timer());
+        epoll.Remove(connection->Fd());
+        counters.closed.Add();
+        if (connection->IsSuspended()) {
+            // a handler still uses it, released once the handler is done
+            connection->Abandon();
+            return;
+        }
+        releaseConnection(connection);
+    }
+
+    void resumeConnection(Connection* connection) override {
+        // edge triggered reads were skipped while suspended, continue with
+        // whatever the client sent meanwhile
+        handleConnection(connection, EPOLLIN);
+    }
+
+    void retireConnection(Connection* connection) override {
+        releaseConnection(connection);
+    }
+
+   public:
+    EpollReactor(const ReactorConfig& config, RequestProcessor& processor,
+                 ConnectionCounters& counters)
+        : Reactor(config, processor, counters) {}
+
+    bool Run() override {
+        if (!epoll.IsValid() ||
+            !epoll.Add(listenFd, EPOLLIN | EPOLLET, &listenerTag)) {
+            logger.Error("cannot watch listening socket");
+            return false;
+        }
+        if (!mailboxFd.IsValid() ||
+            !epoll.Add(mailboxFd.Get(), EPOLLIN | EPOLLET, &mailboxTag)) {
+            logger.Error("cannot watch reactor mailbox");
+            return false;
+        }
+
+        epoll_event events[maxEvents];
+        running = true;
+
+        while (running) {
+            int ready = epoll.Wait(events, maxEvents, timerTimeoutMs());
+            if (ready < 0) {
+                logger.Error("epoll_wait failed: {}", strerror(errno));
+                return false;
+            }
+
+            for (int i = 0; i < ready; i++) {
+                void* tag = events[i].data.ptr;
+                if (tag == &listenerTag) {
+                    acceptConnections();
+                } else if (tag == &mailboxTag) {
+                    clearMailboxSignal();
+                    drainMailbox();
+                } else {
+                    handleConnection(static_cast<Connection*>(tag),
+                                     events[i].events);
+                }
+            }
+
+            expireTimers();
+            recycleConnections();
+
+            // the listener reports no new edge for clients already waiting
+            if (acceptPaused && !atConnectionLimit()) {
+                acceptConnections();
+            }
+        }
+        return true;
+    }
+};
+}  // namespace DinoScale
@@ -0,0 +1,1293 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../constants/statuses.hpp"
+#include "../core/HPACK.hpp"
+#include "../core/HTTPRequest.hpp"
+#include "../core/RequestBody.hpp"
+#include "../utils/FileDescriptor.hpp"
+#include "../utils/Strings.hpp"
+#include "Connection.hpp"
+
+namespace DinoScale {
+/** First bytes on a connection whose client speaks HTTP/2 with prior
+ * knowledge, RFC 9113 section 3.4. */
+inline constexpr std::string_view HTTP2Preface =
+    "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+/** Error codes of `RST_STREAM` and `GOAWAY` frames. */
+enum class HTTP2Error : std::uint32_t {
+    NoError = 0x0,
+    ProtocolError = 0x1,
+    InternalError = 0x2,
+    FlowControlError = 0x3,
+    SettingsTimeout = 0x4,
+    StreamClosed = 0x5,
+    FrameSizeError = 0x6,
+    RefusedStream = 0x7,
+    Cancel = 0x8,
+    CompressionError = 0x9,
+    ConnectError = 0xa,
+    EnhanceYourCalm = 0xb,
+    InadequateSecurity = 0xc,
+    HTTP11Required = 0xd
+};
+
+/**
+ * @brief Limits of an `HTTP2Session`, announced to the client in the
+ * server's `SETTINGS` where the protocol has a setting for them.
+ */
+struct HTTP2Limits {
+    /** Streams a client may have open at once. */
+    std::uint32_t maxConcurrentStreams = 100;
+
+    /** Request body bytes a client may send ahead on each stream, and on the
+     * whole connection. */
+    std::uint32_t streamWindow = 256 * 1024;
+    std::uint32_t connectionWindow = 1024 * 1024;
+
+    /** Decoded size of a request head, counted as RFC 9113 section 6.5.2
+     * does. */
+    std::uint32_t maxHeaderListSize = 30720;
+
+    /** Streams served before the connection is wound down with `GOAWAY`, 0
+     * for no limit. */
+    unsigned maxRequests = 0;
+
+    BodyLimits bodyLimits;
+};
+
+class HTTP2Session;
+
+/**
+ * @brief One request and its response on an HTTP/2 connection. The request
+ * head is decoded into storage of the stream, which owns everything the
+ * views of `Request()` point to.
+ */
+class HTTP2Stream {
+    friend class HTTP2Session;
+
+   private:
+    std::uint32_t id;
+    HTTPRequest   request;
+    RequestBody   body;
+    std::string   fields;  // decoded names and values `request` views
+
+    bool          remoteClosed = false;  // the client sent END_STREAM
+    bool          responded = false;     // response HEADERS are queued
+    bool          queued = false;        // in the session's ready queue
+    bool          broken = false;  // the body falls short, reset at its end
+    bool          hasLength = false;  // the client sent a content-length
+    std::size_t   length = 0;
+
+    std::int64_t              sendWindow;
+    std::int64_t              receiveWindow;
+    std::deque<OutputSegment> pending;  // response body held back by flow
+                                        // control
+
+   public:
+    HTTP2Stream(std::uint32_t id, std::int64_t sendWindow,
+                std::int64_t receiveWindow)
+        : id(id), sendWindow(sendWindow), receiveWindow(receiveWindow) {}
+
+    HTTP2Stream(const HTTP2Stream&) = delete;
+    HTTP2Stream& operator=(const HTTP2Stream&) = delete;
+
+    std::uint32_t Id() const { return id; }
+
+    HTTPRequest& Request() { return request; }
+};
+
+/**
+ * @brief Collects a response serialized for HTTP/1.1, with the same calls a
+ * `Connection` takes, so the writers of the server serve HTTP/2 streams
+ * unchanged. `HTTP2Session::Respond` turns the head into HPACK fields and
+ * the body into DATA frames.
+ */
+class StreamOutput {
+    friend class HTTP2Session;
+
+   private:
+    static constexpr std::size_t coalesceLimit = 4096;
+
+    std::string                head;  // status line and fields, CRLF each
+    bool                       headComplete = false;
+    std::vector<OutputSegment> body;
+    bool                       broken = false;
+
+    void appendBody(std::string_view data) {
+        if (data.empty()) {
+            return;
+        }
+        // small pieces, such as the part heads of a multipart body, are
+        // gathered into one segment
+        if (!body.empty() && !body.back().IsView() && !body.back().IsFile() &&
+            body.back().data.size() + data.size() <= coalesceLimit) {
+            body.back().data.append(data);
+            return;
+        }
+        body.emplace_back().data.assign(data);
+    }
+
+   public:
+    void Write(std::string_view data) {
+        if (headComplete) {
+            appendBody(data);
+            return;
+        }
+        std::size_t from = head.size() < 3 ? 0 : head.size() - 3;
+        head.append(data);
+        std::size_t end = head.find("\r\n\r\n", from);
+        if (end == std::string::npos) {
+            return;
+        }
+        headComplete = true;
+        appendBody(std::string_view(head).substr(end + 4));
+        head.resize(end + 2);
+    }
+
+    void Write(const char* data) { Write(std::string_view(data)); }
+
+    void Write(std::string&& data) {
+        if (!headComplete || data.size() <= coalesceLimit) {
+            Write(std::string_view(data));
+            return;
+        }
+        body.emplace_back().data = std::move(data);
+    }
+
+    void WriteShared(std::string_view            data,
+                     std::shared_ptr<const void> owner) {
+        if (!headComplete) {
+            Write(data);
+            return;
+        }
+        if (data.empty()) {
+            return;
+        }
+        OutputSegment& segment = body.emplace_back();
+        segment.view = data;
+        segment.owner = std::move(owner);
+    }
+
+    void WriteFile(FileDescriptor file, off_t offset, std::size_t length) {
+        if (length == 0) {
+            return;
+        }
+        OutputSegment& segment = body.emplace_back();
+        segment.file = std::move(file);
+        segment.fileOffset = offset;
+        segment.fileRemaining = length;
+    }
+
+    /** The body cannot be completed, the stream is reset after it. */
+    void CloseAfterWrite() { broken = true; }
+
+    void Clear() {
+        head.clear();
+        headComplete = false;
+        body.clear();
+        broken = false;
+    }
+};
+
+/**
+ * @brief Serves the streams of HTTP/2 connections, implemented by the
+ * server like `RequestProcessor`.
+ */
+class StreamProcessor {
+   public:
+    /**
+     * @brief Called once the request of `stream` is complete. The response
+     * is handed to `session.Respond`, right away or later through
+     * `Reactor::Post` after suspending `connection`; the stream may be reset
+     * meanwhile, which the session then ignores.
+     */
+    virtual void ProcessStream(Connection& connection, Reactor& reactor,
+                               HTTP2Session&                       session,
+                               const std::shared_ptr<HTTP2Stream>& stream) = 0;
+
+    /** Answers `stream` with a bodiless `status` instead of serving it. */
+    virtual void RejectStream(Connection& connection, HTTP2Session& session,
+                              HTTP2Stream& stream, HTTPStatusCode status) = 0;
+
+   protected:
+    ~StreamProcessor() = default;
+};
+
+/**
+ * @brief The server side of an HTTP/2 connection in cleartext (h2c), whose
+ * client sent the connection preface.
+ *
+ * Frames are parsed out of the connection input as soon as they are
+ * complete. Header blocks are decoded with one HPACK context per direction
+ * into the `HTTPRequest` of a stream, and every complete request goes to the
+ * `StreamProcessor`, so all streams share the router and handlers of
+ * HTTP/1.1, and many of them can be served at once.
+ *
+ * Responses are queued per stream and sent as DATA frames, one frame per
+ * ready stream in turn, as far as the flow control windows of the client
+ * allow. At most `pumpBudget` bytes are queued until the connection output
+ * drained, the rest follows from `Drained`. Bodies referenced by a response
+ * are framed without being copied; files are read in frame sized chunks.
+ *
+ * Frames the session answers by itself, such as PING, are only parsed while
+ * less than `controlBudget` bytes of other frames wait to be sent. Beyond
+ * it the input is paused until the output drained, so a client which does
+ * not read fills its socket buffer rather than the server's memory. One
+ * keeping more than `maxQueuedAcks` PING and SETTINGS acknowledgements
+ * unsent is sent `GOAWAY` with `ENHANCE_YOUR_CALM`.
+ *
+ * Request bodies are accepted within windows of `HTTP2Limits`, which are
+ * replenished once half of them was used. Server push is not supported.
+ */
+class HTTP2Session : public ConnectionProtocol {
+   private:
+    enum FrameType : std::uint8_t {
+        Data = 0x0,
+        Headers = 0x1,
+        Priority = 0x2,
+        ResetStream = 0x3,
+        Settings = 0x4,
+        PushPromise = 0x5,
+        Ping = 0x6,
+        GoAway = 0x7,
+        WindowUpdate = 0x8,
+        Continuation = 0x9
+    };
+
+    static constexpr std::uint8_t endStreamFlag = 0x1;
+    static constexpr std::uint8_t ackFlag = 0x1;
+    static constexpr std::uint8_t endHeadersFlag = 0x4;
+    static constexpr std::uint8_t paddedFlag = 0x8;
+    static constexpr std::uint8_t priorityFlag = 0x20;
+
+    static constexpr std::size_t  frameHeaderSize = 9;
+    static constexpr std::size_t  maxFrameSize = 16384;  // ours, the default
+    static constexpr std::int64_t maxWindow = 0x7fffffff;
+    static constexpr std::size_t  pumpBudget = 256 * 1024;
+    static constexpr std::size_t  controlBudget = 64 * 1024;
+    static constexpr unsigned     maxQueuedAcks = 1000;
+    static constexpr std::size_t  maxHeaderBlock = 64 * 1024;
+
+    static constexpr std::size_t absent = static_cast<std::size_t>(-1);
+
+    /* where a decoded field lives in the `fields` of its stream */
+    struct FieldSpan {
+        std::size_t name;
+        std::size_t nameLength;
+        std::size_t value;
+        std::size_t valueLength;
+    };
+
+    StreamProcessor& processor;
+    HTTP2Limits      limits;
+
+    HPACKDecoder decoder;
+    HPACKEncoder encoder;
+
+    std::unordered_map<std::uint32_t, std::shared_ptr<HTTP2Stream>> streams;
+    std::deque<std::uint32_t> ready;  // streams with DATA to send
+    std::uint32_t             lastStreamId = 0;  // highest one opened
+
+    bool prefaceReceived = false;
+    bool goingAway = false;      // we sent GOAWAY
+    bool peerGoingAway = false;  // the client sent GOAWAY
+    bool failed = false;         // connection error, input is dropped
+
+    std::int64_t  sendWindow = 65535;  // of the connection
+    std::int64_t  receiveWindow = 65535;
+    std::int64_t  peerStreamWindow = 65535;  // initial window of new streams
+    std::uint32_t peerMaxFrameSize = maxFrameSize;
+    std::size_t   inFlight = 0;  // DATA bytes queued since output drained
+    std::size_t   controlQueued = 0;  // other frame bytes queued since then
+    unsigned      queuedAcks = 0;     // PING and SETTINGS ACKs among them
+
+    std::uint32_t continuationStream = 0;  // header block being continued
+    bool          continuationEnd = false;
+    std::string   inboundBlock;
+
+    // reused across frames
+    std::string            outboundBlock;
+    std::string            fieldName;
+    std::vector<FieldSpan> spans;
+
+    static std::uint32_t readUint32(const char* bytes) {
+        auto data = reinterpret_cast<const unsigned char*>(bytes);
+        return static_cast<std::uint32_t>(data[0]) << 24 |
+               static_cast<std::uint32_t>(data[1]) << 16 |
+               static_cast<std::uint32_t>(data[2]) << 8 | data[3];
+    }
+
+    static void storeUint32(char* out, std::uint32_t value) {
+        out[0] = static_cast<char>(value >> 24);
+        out[1] = static_cast<char>(value >> 16);
+        out[2] = static_cast<char>(value >> 8);
+        out[3] = static_cast<char>(value);
+    }
+
+    void writeFrameHeader(Connection& connection, std::size_t length,
+                          FrameType type, std::uint8_t flags,
+                          std::uint32_t stream) {
+        if (type != Data) {
+            controlQueued += frameHeaderSize + length;  // DATA is `inFlight`
+        }
+        char header[frameHeaderSize];
+        header[0] = static_cast<char>(length >> 16);
+        header[1] = static_cast<char>(length >> 8);
+        header[2] = static_cast<char>(length);
+        header[3] = static_cast<char>(type);
+        header[4] = static_cast<char>(flags);
+        storeUint32(header + 5, stream & 0x7fffffff);
+        connection.Write(std::string_view(header, sizeof(header)));
+    }
+
+    void writeReset(Connection& connection, std::uint32_t stream,
+                    HTTP2Error error) {
+        char payload[4];
+        storeUint32(payload, static_cast<std::uint32_t>(error));
+        writeFrameHeader(connection, sizeof(payload), ResetStream, 0, stream);
+        connection.Write(std::string_view(payload, sizeof(payload)));
+    }
+
+    void writeWindowUpdate(Connection& connection, std::uint32_t stream,
+                           std::uint32_t increment) {
+        char payload[4];
+        storeUint32(payload, increment);
+        writeFrameHeader(connection, sizeof(payload), WindowUpdate, 0, stream);
+        connection.Write(std::string_view(payload, sizeof(payload)));
+    }
+
+    void writeGoAway(Connection& connection, HTTP2Error error) {
+        char payload[8];
+        storeUint32(payload, lastStreamId);
+        storeUint32(payload + 4, static_cast<std::uint32_t>(error));
+        writeFrameHeader(connection, sizeof(payload), GoAway, 0, 0);
+        connection.Write(std::string_view(payload, sizeof(payload)));
+    }
+
+    /* the server's SETTINGS and the growth of the connection window, the
+     * first frames it sends */
+    void writeSettings(Connection& connection) {
+        std::pair<std::uint16_t, std::uint32_t> settings[] = {
+            {0x3, limits.maxConcurrentStreams},  // MAX_CONCURRENT_STREAMS
+            {0x4, limits.streamWindow},          // INITIAL_WINDOW_SIZE
+            {0x6, limits.maxHeaderListSize},     // MAX_HEADER_LIST_SIZE
+        };
+        char payload[sizeof(settings) / sizeof(settings[0]) * 6];
+        char* position = payload;
+        for (auto [id, value] : settings) {
+            position[0] = static_cast<char>(id >> 8);
+            position[1] = static_cast<char>(id);
+            storeUint32(position + 2, value);
+            position += 6;
+        }
+        writeFrameHeader(connection, sizeof(payload), Settings, 0, 0);
+        connection.Write(std::string_view(payload, sizeof(payload)));
+
+        if (limits.connectionWindow > receiveWindow) {
+            writeWindowUpdate(connection, 0,
+                              limits.connectionWindow - receiveWindow);
+            receiveWindow = limits.connectionWindow;
+        }
+    }
+
+    /* sends `block` as HEADERS and as many CONTINUATION frames as the
+     * client's frame size requires */
+    void writeHeaders(Connection& connection, std::uint32_t stream,
+                      std::string_view block, bool endStream) {
+        FrameType    type = Headers;
+        std::uint8_t flags = endStream ? endStreamFlag : 0;
+        do {
+            std::string_view fragment = block.substr(0, peerMaxFrameSize);
+            block.remove_prefix(fragment.size());
+            if (block.empty()) {
+                flags |= endHeadersFlag;
+            }
+            writeFrameHeader(connection, fragment.size(), type, flags, stream);
+            connection.Write(fragment);
+            type = Continuation;
+            flags = 0;
+        } while (!block.empty());
+    }
+
+    /* breaks the connection with GOAWAY, anything still arriving is dropped */
+    void fail(Connection& connection, HTTP2Error error) {
+        if (failed) {
+            return;
+        }
+        failed = true;
+        writeGoAway(connection, error);
+        connection.CloseAfterWrite();
+    }
+
+    /* counts an ACK about to be queued, false if the client left too many
+     * of them unread and the connection failed */
+    bool countAck(Connection& connection) {
+        if (++queuedAcks > maxQueuedAcks) {
+            fail(connection, HTTP2Error::EnhanceYourCalm);
+            return false;
+        }
+        return true;
+    }
+
+    /* winds the connection down, streams already opened are still served */
+    void goAway(Connection& connection) {
+        if (!goingAway) {
+            goingAway = true;
+            writeGoAway(connection, HTTP2Error::NoError);
+        }
+    }
+
+    void closeIfDone(Connection& connection) {
+        if ((goingAway || peerGoingAway) && streams.empty()) {
+            connection.CloseAfterWrite();
+        }
+    }
+
+    bool isCurrent(const HTTP2Stream& stream) const {
+        auto found = streams.find(stream.id);
+        return found != streams.end() && found->second.get() == &stream;
+    }
+
+    /* forgets `stream`, whose response is complete, asking the client to
+     * stop sending a request body it has not finished */
+    void closeStream(Connection& connection, HTTP2Stream& stream) {
+        if (!stream.remoteClosed) {
+            writeReset(connection, stream.id, HTTP2Error::NoError);
+        }
+        streams.erase(stream.id);
+        closeIfDone(connection);
+    }
+
+    void schedule(HTTP2Stream& stream) {
+        if (!stream.queued && !stream.pending.empty() &&
+            stream.sendWindow > 0) {
+            stream.queued = true;
+            ready.push_back(stream.id);
+        }
+    }
+
+    /* reads `length` bytes of `file` at `offset`, false if it fell short */
+    static bool readFile(int file, off_t offset, char* out,
+                         std::size_t length) {
+        std::size_t total = 0;
+        while (total < length) {
+            ssize_t bytesRead =
+                pread(file, out + total, length - total, offset + total);
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytesRead <= 0) {
+                return false;
+            }
+            total += bytesRead;
+        }
+        return true;
+    }
+
+    /* queues the next DATA frame of `stream`, false if the stream was reset
+     * instead */
+    bool sendData(Connection& connection, HTTP2Stream& stream) {
+        OutputSegment& segment = stream.pending.front();
+        std::size_t    left = segment.IsFile()
+                                  ? segment.fileRemaining
+                                  : segment.Bytes().size() - segment.sent;
+        std::size_t length = std::min<std::size_t>(
+            {left, peerMaxFrameSize, static_cast<std::size_t>(sendWindow),
+             static_cast<std::size_t>(stream.sendWindow)});
+        bool         last = length == left && stream.pending.size() == 1;
+        std::uint8_t flags = last && !stream.broken ? endStreamFlag : 0;
+
+        if (segment.IsFile()) {
+            std::string chunk(length, '\0');
+            if (!readFile(segment.file.Get(), segment.fileOffset,
+                          chunk.data(), length)) {
+                Reset(connection, stream, HTTP2Error::InternalError);
+                return false;
+            }
+            writeFrameHeader(connection, length, Data, flags, stream.id);
+            connection.Write(std::move(chunk));
+            segment.fileOffset += length;
+            segment.fileRemaining -= length;
+        } else {
+            writeFrameHeader(connection, length, Data, flags, stream.id);
+            connection.WriteShared(segment.view.substr(segment.sent, length),
+                                   segment.owner);
+            segment.sent += length;
+        }
+        if (length == left) {
+            stream.pending.pop_front();
+        }
+        sendWindow -= length;
+        stream.sendWindow -= length;
+        inFlight += frameHeaderSize + length;
+        return true;
+    }
+
+    /* queues DATA frames of the ready streams in turn, as far as the windows
+     * and the budget allow; true if any were queued */
+    bool pump(Connection& connection) {
+        bool queued = false;
+        while (!ready.empty() && !failed && sendWindow > 0 &&
+               inFlight < pumpBudget) {
+            std::uint32_t id = ready.front();
+            ready.pop_front();
+            auto found = streams.find(id);
+            if (found == streams.end()) {
+                continue;  // reset meanwhile
+            }
+            HTTP2Stream& stream = *found->second;
+            stream.queued = false;
+            if (stream.sendWindow <= 0 || !sendData(connection, stream)) {
+                continue;
+            }
+            queued = true;
+            if (!stream.pending.empty()) {
+                schedule(stream);
+            } else if (stream.broken) {
+                Reset(connection, stream, HTTP2Error::InternalError);
+            } else {
+                closeStream(connection, stream);
+            }
+        }
+        return queued;
+    }
+
+    static bool isConnectionSpecific(std::string_view name) {
+        return name == "connection" || name == "keep-alive" ||
+               name == "proxy-connection" || name == "transfer-encoding" ||
+               name == "upgrade";
+    }
+
+    /* field names are tokens sent in lower case */
+    static bool isFieldName(std::string_view name) {
+        if (name.empty()) {
+            return false;
+        }
+        for (char c : name) {
+            bool valid = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                         std::string_view("!#$%&'*+-.^_`|~").find(c) !=
+                             std::string_view::npos;
+            if (!valid) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool isFieldValue(std::string_view value) {
+        return value.find_first_of(std::string_view("\r\n\0", 3)) ==
+               std::string_view::npos;
+    }
+
+    /* index of a request pseudo-header field, -1 for any other */
+    static int pseudoIndex(std::string_view name) {
+        if (name == ":method") return 0;
+        if (name == ":scheme") return 1;
+        if (name == ":path") return 2;
+        if (name == ":authority") return 3;
+        return -1;
+    }
+
+    static HPACKEncoder::Indexing indexingOf(std::string_view name,
+                                             std::string_view value) {
+        if (name == "set-cookie") {
+            return HPACKEncoder::Indexing::Never;
+        }
+        // these change with every response, indexing them evicts the rest
+        if (name == "content-length" || name == "etag" ||
+            name == "last-modified" || name == "content-range" ||
+            name == "date" || value.size() > 512) {
+            return HPACKEncoder::Indexing::None;
+        }
+        return HPACKEncoder::Indexing::Incremental;
+    }
+
+    /**
+     * @brief Decodes the header block opening `stream` into its request.
+     * @param malformed: Set if the request breaks the rules of RFC 9113
+     * section 8.2, the stream is reset then.
+     * @param status: Set to an error status to answer the request with
+     * instead of serving it, left untouched otherwise.
+     * @return false if the block broke the compression context.
+     */
+    bool decodeRequest(HTTP2Stream& stream, std::string_view block,
+                       bool& malformed, HTTPStatusCode& status) {
+        std::string& fields = stream.fields;
+        std::size_t  pseudo[4] = {absent, absent, absent, absent};
+        std::size_t  listSize = 0;
+        std::size_t  cookies = 0;
+        bool         regularSeen = false;
+        bool         tooLarge = false;
+        fields.clear();
+        spans.clear();
+        malformed = false;
+
+        bool decoded = decoder.Decode(block, [&](std::string_view name,
+                                                 std::string_view value) {
+            listSize += name.size() + value.size() + 32;
+            if (malformed || tooLarge) {
+                return;  // decoded all the same, for the table
+            }
+            if (listSize > limits.maxHeaderListSize) {
+                tooLarge = true;
+                return;
+            }
+            if (!isFieldValue(value)) {
+                malformed = true;
+                return;
+            }
+            if (!name.empty() && name[0] == ':') {
+                int index = pseudoIndex(name);
+                if (regularSeen || index < 0 ||
+                    pseudo[index] != absent) {
+                    malformed = true;
+                    return;
+                }
+                pseudo[index] = spans.size();
+            } else {
+                if (!isFieldName(name) || isConnectionSpecific(name) ||
+                    (name == "te" && value != "trailers")) {
+                    malformed = true;
+                    return;
+                }
+                regularSeen = true;
+                cookies += name == "cookie";
+            }
+            spans.push_back({fields.size(), name.size(),
+                             fields.size() + name.size(), value.size()});
+            fields.append(name);
+            fields.append(value);
+        });
+        if (!decoded || malformed) {
+            return decoded;
+        }
+        if (tooLarge) {
+            status = HTTPStatusCode::Request_Header_Fields_Too_Large;
+            return true;
+        }
+        // CONNECT, which has neither scheme nor path, is not supported
+        if (pseudo[0] == absent || pseudo[1] == absent ||
+            pseudo[2] == absent ||
+            spans[pseudo[2]].valueLength == 0) {
+            malformed = true;
+            return true;
+        }
+
+        // split cookies are joined into one field, RFC 9113 section 8.2.3
+        std::size_t joinedCookie = absent;
+        if (cookies > 1) {
+            std::size_t name = fields.size();
+            fields.append("cookie");
+            std::size_t value = fields.size();
+            for (const FieldSpan& span : spans) {
+                if (std::string_view(fields).substr(
+                        span.name, span.nameLength) == "cookie") {
+                    if (fields.size() > value) {
+                        fields.append("; ");
+                    }
+                    fields.append(fields, span.value, span.valueLength);
+                }
+            }
+            joinedCookie = spans.size();
+            spans.push_back({name, 6, value, fields.size() - value});
+        }
+
+        // `fields` is complete, the views of the request can be taken
+        auto view = [&](std::size_t offset, std::size_t length) {
+            return std::string_view(fields).substr(offset, length);
+        };
+        HTTPRequest& request = stream.request;
+        request.methodName =
+            view(spans[pseudo[0]].value, spans[pseudo[0]].valueLength);
+        request.target =
+            view(spans[pseudo[2]].value, spans[pseudo[2]].valueLength);
+        std::size_t queryStart = request.target.find('?');
+        request.path = request.target.substr(0, queryStart);
+        request.query = queryStart == std::string_view::npos
+                            ? std::string_view()
+                            : request.target.substr(queryStart + 1);
+        request.versionMinor = 1;
+        request.headLength = 0;
+        request.headers.clear();
+        bool hostSeen = false;
+        for (std::size_t i = 0; i < spans.size(); i++) {
+            const FieldSpan& span = spans[i];
+            std::string_view name = view(span.name, span.nameLength);
+            if (name[0] == ':' || (name == "cookie" && cookies > 1 &&
+                                   i != joinedCookie)) {
+                continue;
+            }
+            hostSeen = hostSeen || name == "host";
+            request.headers.push_back(
+                {name, view(span.value, span.valueLength)});
+        }
+        if (!hostSeen && pseudo[3] != absent) {
+            request.headers.push_back(
+                {"host",
+                 view(spans[pseudo[3]].value, spans[pseudo[3]].valueLength)});
+        }
+
+        stream.hasLength = request.HasHeader("content-length");
+        if (!request.ContentLength(stream.length)) {
+            malformed = true;
+            return true;
+        }
+        if (!ParseHTTPMethod(request.methodName, request.method)) {
+            status = HTTPStatusCode::Not_Implemented;
+        } else if (limits.bodyLimits.maxSize != 0 &&
+                   stream.length > limits.bodyLimits.maxSize) {
+            status = HTTPStatusCode::Payload_Too_Large;
+        }
+        return true;
+    }
+
+    /* hands the complete request of `stream` to the processor */
+    void dispatch(Connection& connection, Reactor& reactor,
+                  std::shared_ptr<HTTP2Stream> stream) {
+        stream->remoteClosed = true;
+        stream->body.Finish();
+        if (stream->hasLength && stream->body.Size() != stream->length) {
+            Reset(connection, *stream, HTTP2Error::ProtocolError);
+            return;
+        }
+        stream->request.body = &stream->body;
+        processor.ProcessStream(connection, reactor, *this, stream);
+        if (limits.maxRequests != 0 &&
+            connection.RequestCount() >= limits.maxRequests) {
+            goAway(connection);
+        }
+    }
+
+    /* a complete header block: a new request, or the trailers of one */
+    void onHeaderBlock(Connection& connection, Reactor& reactor,
+                       std::uint32_t id, std::string_view block,
+                       bool endStream) {
+        auto discard = [this, &connection](std::string_view block) {
+            if (!decoder.Decode(block,
+                                [](std::string_view, std::string_view) {})) {
+                fail(connection, HTTP2Error::CompressionError);
+                return false;
+            }
+            return true;
+        };
+
+        auto found = streams.find(id);
+        if (found != streams.end()) {
+            // trailers, which are not passed on
+            std::shared_ptr<HTTP2Stream> stream = found->second;
+            if (!discard(block)) {
+                return;
+            }
+            if (stream->remoteClosed) {
+                Reset(connection, *stream, HTTP2Error::StreamClosed);
+            } else if (!endStream) {
+                Reset(connection, *stream, HTTP2Error::ProtocolError);
+            } else if (!stream->responded) {
+                dispatch(connection, reactor, std::move(stream));
+            }
+            return;
+        }
+        if (id % 2 == 0 || id <= lastStreamId) {
+            fail(connection, id <= lastStreamId ? HTTP2Error::StreamClosed
+                                                : HTTP2Error::ProtocolError);
+            return;
+        }
+        lastStreamId = id;
+
+        if (goingAway || peerGoingAway) {
+            discard(block);
+            return;
+        }
+        if (streams.size() >= limits.maxConcurrentStreams) {
+            if (discard(block)) {
+                writeReset(connection, id, HTTP2Error::RefusedStream);
+            }
+            return;
+        }
+
+        auto stream = std::make_shared<HTTP2Stream>(id, peerStreamWindow,
+                                                    limits.streamWindow);
+        bool           malformed;
+        HTTPStatusCode status = HTTPStatusCode::OK;
+        if (!decodeRequest(*stream, block, malformed, status)) {
+            fail(connection, HTTP2Error::CompressionError);
+            return;
+        }
+        if (malformed) {
+            writeReset(connection, id, HTTP2Error::ProtocolError);
+            return;
+        }
+        streams.emplace(id, stream);
+        stream->remoteClosed = endStream;
+        if (status != HTTPStatusCode::OK) {
+            processor.RejectStream(connection, *this, *stream, status);
+            return;
+        }
+        stream->body.BeginDelimited(limits.bodyLimits);
+        if (endStream) {
+            dispatch(connection, reactor, std::move(stream));
+        }
+    }
+
+    void onData(Connection& connection, Reactor& reactor, std::uint32_t id,
+                std::uint8_t flags, std::string_view payload) {
+        std::size_t frameLength = payload.size();
+        if (id == 0) {
+            fail(connection, HTTP2Error::ProtocolError);
+            return;
+        }
+        if (flags & paddedFlag) {
+            if (payload.empty() ||
+                static_cast<unsigned char>(payload[0]) >= payload.size()) {
+                fail(connection, HTTP2Error::ProtocolError);
+                return;
+            }
+            std::size_t padding = static_cast<unsigned char>(payload[0]);
+            payload = payload.substr(1, payload.size() - 1 - padding);
+        }
+
+        // counted against the connection even when the stream is gone
+        receiveWindow -= frameLength;
+        if (receiveWindow < 0) {
+            fail(connection, HTTP2Error::FlowControlError);
+            return;
+        }
+
+        auto found = streams.find(id);
+        if (found == streams.end()) {
+            if (id > lastStreamId) {
+                fail(connection, HTTP2Error::ProtocolError);
+            }
+            return;  // reset or answered, what is still in flight is dropped
+        }
+        std::shared_ptr<HTTP2Stream> stream = found->second;
+        if (stream->remoteClosed) {
+            Reset(connection, *stream, HTTP2Error::StreamClosed);
+            return;
+        }
+        stream->receiveWindow -= frameLength;
+        if (stream->receiveWindow < 0) {
+            Reset(connection, *stream, HTTP2Error::FlowControlError);
+            return;
+        }
+        bool endStream = flags & endStreamFlag;
+        if (stream->responded) {
+            // rejected early, the body is not wanted
+            stream->remoteClosed = endStream;
+            return;
+        }
+
+        std::size_t consumed;
+        BodyStatus  status = stream->body.Feed(payload, consumed);
+        if (status == BodyStatus::TooLarge ||
+            status == BodyStatus::StorageFailed) {
+            stream->remoteClosed = endStream;
+            processor.RejectStream(
+                connection, *this, *stream,
+                status == BodyStatus::TooLarge
+                    ? HTTPStatusCode::Payload_Too_Large
+                    : HTTPStatusCode::Internal_Server_Error);
+            return;
+        }
+        if (endStream) {
+            dispatch(connection, reactor, std::move(stream));
+            return;
+        }
+        if (stream->receiveWindow <= limits.streamWindow / 2) {
+            writeWindowUpdate(connection, id,
+                              limits.streamWindow - stream->receiveWindow);
+            stream->receiveWindow = limits.streamWindow;
+        }
+    }
+
+    void onSettings(Connection& connection, std::uint8_t flags,
+                    std::string_view payload) {
+        if (flags & ackFlag) {
+            if (!payload.empty()) {
+                fail(connection, HTTP2Error::FrameSizeError);
+            }
+            return;
+        }
+        if (payload.size() % 6 != 0) {
+            fail(connection, HTTP2Error::FrameSizeError);
+            return;
+        }
+        for (; !payload.empty(); payload.remove_prefix(6)) {
+            std::uint16_t id =
+                static_cast<unsigned char>(payload[0]) << 8 |
+                static_cast<unsigned char>(payload[1]);
+            std::uint32_t value = readUint32(payload.data() + 2);
+            switch (id) {
+                case 0x1:  // HEADER_TABLE_SIZE
+                    encoder.SetPeerCapacity(value);
+                    break;
+                case 0x2:  // ENABLE_PUSH
+                    if (value > 1) {
+                        fail(connection, HTTP2Error::ProtocolError);
+                        return;
+                    }
+                    break;
+                case 0x4: {  // INITIAL_WINDOW_SIZE
+                    if (value > maxWindow) {
+                        fail(connection, HTTP2Error::FlowControlError);
+                        return;
+                    }
+                    // applies to the streams already open as well
+                    std::int64_t delta = value - peerStreamWindow;
+                    peerStreamWindow = value;
+                    for (auto& [streamId, stream] : streams) {
+                        stream->sendWindow += delta;
+                        if (stream->sendWindow > maxWindow) {
+                            fail(connection, HTTP2Error::FlowControlError);
+                            return;
+                        }
+                        schedule(*stream);
+                    }
+                    break;
+                }
+                case 0x5:  // MAX_FRAME_SIZE
+                    if (value < maxFrameSize || value > 0xffffff) {
+                        fail(connection, HTTP2Error::ProtocolError);
+                        return;
+                    }
+                    peerMaxFrameSize = value;
+                    break;
+                default:
+                    break;  // unknown settings are ignored
+            }
+        }
+        if (countAck(connection)) {
+            writeFrameHeader(connection, 0, Settings, ackFlag, 0);
+        }
+    }
+
+    void onWindowUpdate(Connection& connection, std::uint32_t id,
+                        std::string_view payload) {
+        if (payload.size() != 4) {
+            fail(connection, HTTP2Error::FrameSizeError);
+            return;
+        }
+        std::uint32_t increment = readUint32(payload.data()) & 0x7fffffff;
+        if (id == 0) {
+            sendWindow += increment;
+            if (increment == 0 || sendWindow > maxWindow) {
+                fail(connection, increment == 0
+                                     ? HTTP2Error::ProtocolError
+                                     : HTTP2Error::FlowControlError);
+            }
+            return;
+        }
+        auto found = streams.find(id);
+        if (found == streams.end()) {
+            if (id > lastStreamId) {
+                fail(connection, HTTP2Error::ProtocolError);
+            }
+            return;
+        }
+        HTTP2Stream& stream = *found->second;
+        stream.sendWindow += increment;
+        if (increment == 0 || stream.sendWindow > maxWindow) {
+            Reset(connection, stream,
+                  increment == 0 ? HTTP2Error::ProtocolError
+                                 : HTTP2Error::FlowControlError);
+            return;
+        }
+        schedule(stream);
+    }
+
+    void onFrame(Connection& connection, Reactor& reactor, FrameType type,
+                 std::uint8_t flags, std::uint32_t id,
+                 std::string_view payload) {
+        if (continuationStream != 0 &&
+            (type != Continuation || id != continuationStream)) {
+            fail(connection, HTTP2Error::ProtocolError);
+            return;
+        }
+
+        switch (type) {
+            case Data:
+                onData(connection, reactor, id, flags, payload);
+                break;
+            case Headers: {
+                if (id == 0) {
+                    fail(connection, HTTP2Error::ProtocolError);
+                    return;
+                }
+                std::size_t padding = 0;
+                if (flags & paddedFlag) {
+                    if (payload.empty()) {
+                        fail(connection, HTTP2Error::ProtocolError);
+                        return;
+                    }
+                    padding = static_cast<unsigned char>(payload[0]);
+                    payload.remove_prefix(1);
+                }
+                if (flags & priorityFlag) {
+                    if (payload.size() < 5) {
+                        fail(connection, HTTP2Error::FrameSizeError);
+                        return;
+                    }
+                    payload.remove_prefix(5);  // priorities are ignored
+                }
+                if (padding > payload.size()) {
+                    fail(connection, HTTP2Error::ProtocolError);
+                    return;
+                }
+                payload.remove_suffix(padding);
+                if (flags & endHeadersFlag) {
+                    onHeaderBlock(connection, reactor, id, payload,
+                                  flags & endStreamFlag);
+                    return;
+                }
+                continuationStream = id;
+                continuationEnd = flags & endStreamFlag;
+                inboundBlock.assign(payload);
+                break;
+            }
+            case Continuation:
+                if (continuationStream == 0) {
+                    fail(connection, HTTP2Error::ProtocolError);
+                    return;
+                }
+                inboundBlock.append(payload);
+                if (inboundBlock.size() > maxHeaderBlock) {
+                    fail(connection, HTTP2Error::EnhanceYourCalm);
+                    return;
+                }
+                if (flags & endHeadersFlag) {
+                    continuationStream = 0;
+                    onHeaderBlock(connection, reactor, id, inboundBlock,
+                                  continuationEnd);
+                }
+                break;
+            case Priority:
+                if (id == 0) {
+                    fail(connection, HTTP2Error::ProtocolError);
+                } else if (payload.size() != 5) {
+                    fail(connection, HTTP2Error::FrameSizeError);
+                }
+                break;
+            case ResetStream:
+                if (id == 0 || id > lastStreamId) {
+                    fail(connection, HTTP2Error::ProtocolError);
+                } else if (payload.size() != 4) {
+                    fail(connection, HTTP2Error::FrameSizeError);
+                } else {
+                    // a handler still running answers into the void
+                    streams.erase(id);
+                    closeIfDone(connection);
+                }
+                break;
+            case Settings:
+                if (id != 0) {
+                    fail(connection, HTTP2Error::ProtocolError);
+                    return;
+                }
+                onSettings(connection, flags, payload);
+                break;
+            case Ping:
+                if (id != 0) {
+                    fail(connection, HTTP2Error::ProtocolError);
+                } else if (payload.size() != 8) {
+                    fail(connection, HTTP2Error::FrameSizeError);
+                } else if (!(flags & ackFlag) && countAck(connection)) {
+                    writeFrameHeader(connection, 8, Ping, ackFlag, 0);
+                    connection.Write(payload);
+                }
+                break;
+            case GoAway:
+                if (id != 0) {
+                    fail(connection, HTTP2Error::ProtocolError);
+                } else if (payload.size() < 8) {
+                    fail(connection, HTTP2Error::FrameSizeError);
+                } else {
+                    peerGoingAway = true;
+                    closeIfDone(connection);
+                }
+                break;
+            case WindowUpdate:
+                onWindowUpdate(connection, id, payload);
+                break;
+            case PushPromise:
+                // clients never push
+                fail(connection, HTTP2Error::ProtocolError);
+                break;
+            default:
+                break;  // unknown frame types are ignored
+        }
+    }
+
+   public:
+    HTTP2Session(StreamProcessor& processor, const HTTP2Limits& limits)
+        : processor(processor), limits(limits) {}
+
+    /**
+     * @brief Handles every complete frame in the input of `connection`,
+     * starting with the client preface, and queues the frames answering
+     * them. Frames are left in the input while the session pauses it.
+     */
+    void Process(Connection& connection, Reactor& reactor) override {
+        std::string_view input = connection.Input();
+        if (failed) {
+            connection.Consume(input.size());
+            return;
+        }
+        std::size_t offset = 0;
+        if (!prefaceReceived) {
+            if (input.size() < HTTP2Preface.size()) {
+                return;
+            }
+            if (input.substr(0, HTTP2Preface.size()) != HTTP2Preface) {
+                fail(connection, HTTP2Error::ProtocolError);
+                connection.Consume(input.size());
+                return;
+            }
+            prefaceReceived = true;
+            offset = HTTP2Preface.size();
+            writeSettings(connection);
+        }
+
+        while (!failed && !IsInputPaused() &&
+               input.size() - offset >= frameHeaderSize) {
+            auto header =
+                reinterpret_cast<const unsigned char*>(input.data() + offset);
+            std::size_t length = header[0] << 16 | header[1] << 8 | header[2];
+            if (length > maxFrameSize) {
+                fail(connection, HTTP2Error::FrameSizeError);
+                break;
+            }
+            if (input.size() - offset < frameHeaderSize + length) {
+                break;  // the rest of the frame is on its way
+            }
+            std::uint32_t id =
+                readUint32(input.data() + offset + 5) & 0x7fffffff;
+            std::string_view payload =
+                input.substr(offset + frameHeaderSize, length);
+            offset += frameHeaderSize + length;
+            onFrame(connection, reactor, static_cast<FrameType>(header[3]),
+                    header[4], id, payload);
+        }
+        connection.Consume(failed ? input.size() : offset);
+        if (failed) {
+            return;
+        }
+
+        if (receiveWindow <= limits.connectionWindow / 2) {
+            writeWindowUpdate(connection, 0,
+                              limits.connectionWindow - receiveWindow);
+            receiveWindow = limits.connectionWindow;
+        }
+        pump(connection);
+    }
+
+    /** Continues sending the response bodies held back, and reading the
+     * input if it was paused. */
+    bool Drained(Connection& connection) override {
+        bool paused = IsInputPaused();
+        inFlight = 0;
+        controlQueued = 0;
+        queuedAcks = 0;
+        return pump(connection) || paused;
+    }
+
+    bool IsInputPaused() const override {
+        return controlQueued >= controlBudget;
+    }
+
+    /**
+     * @brief Sends the response collected in `output` on `stream`, and
+     * clears `output`. The head becomes HPACK fields without those specific
+     * to HTTP/1.1 connections, and the body follows as DATA frames. Ignored
+     * if the stream was reset meanwhile.
+     */
+    void Respond(Connection& connection, HTTP2Stream& stream,
+                 StreamOutput& output) {
+        if (failed || !isCurrent(stream) || stream.responded) {
+            output.Clear();
+            return;
+        }
+        stream.responded = true;
+        std::string_view head = output.head;
+        if (!output.headComplete || head.size() < 12) {
+            output.Clear();
+            Reset(connection, stream, HTTP2Error::InternalError);
+            return;
+        }
+
+        outboundBlock.clear();
+        encoder.Begin(outboundBlock);
+        encoder.Encode(outboundBlock, ":status", head.substr(9, 3),
+                       HPACKEncoder::Indexing::Incremental);
+        std::size_t lineStart = head.find("\r\n") + 2;
+        while (lineStart < head.size()) {
+            std::size_t      lineEnd = head.find("\r\n", lineStart);
+            std::string_view line = head.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 2;
+            std::size_t colon = line.find(':');
+            if (colon == std::string_view::npos) {
+                continue;
+            }
+            fieldName.assign(line.substr(0, colon));
+            for (char& c : fieldName) {
+                c = ToLowerASCII(c);
+            }
+            if (isConnectionSpecific(fieldName)) {
+                continue;
+            }
+            std::string_view value = TrimWhitespace(line.substr(colon + 1));
+            encoder.Encode(outboundBlock, fieldName, value,
+                           indexingOf(fieldName, value));
+        }
+
+        bool endStream = output.body.empty() && !output.broken;
+        writeHeaders(connection, stream.id, outboundBlock, endStream);
+        for (OutputSegment& segment : output.body) {
+            if (!segment.IsView() && !segment.IsFile()) {
+                // owned bytes become shared, each frame references them
+                auto owned =
+                    std::make_shared<std::string>(std::move(segment.data));
+                segment.view = *owned;
+                segment.owner = std::move(owned);
+            }
+            stream.pending.push_back(std::move(segment));
+        }
+        stream.broken = output.broken;
+        output.Clear();
+
+        if (endStream) {
+            closeStream(connection, stream);
+        } else if (stream.pending.empty()) {
+            Reset(connection, stream, HTTP2Error::InternalError);
+        } else {
+            schedule(stream);
+            pump(connection);
+        }
+    }
+
+    /** Resets `stream` with `error`, unless it is closed already. */
+    void Reset(Connection& connection, HTTP2Stream& stream,
+               HTTP2Error error) {
+        if (!isCurrent(stream)) {
+            return;
+        }
+        writeReset(connection, stream.id, error);
+        streams.erase(stream.id);
+        closeIfDone(connection);
+    }
+};
+}  // namespace DinoScale
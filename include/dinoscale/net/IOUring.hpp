@@ -0,0 +1,345 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string_view>
+
+namespace DinoScale {
+/**
+ * @brief Thin RAII wrapper around an io_uring instance, driven with the raw
+ * system calls so that no library is needed. Submission entries are filled
+ * in place and handed to the kernel in one batch by `Enter`, completions are
+ * read straight from the shared completion ring.
+ *
+ * The ring belongs to the thread which created it: it is set up for a single
+ * issuer and runs completion work only when that thread waits in `Enter`.
+ */
+class IOUring {
+   private:
+    int      ringFd = -1;
+    unsigned features = 0;
+
+    void*       ringMemory = MAP_FAILED;  // both rings, see `setUp`
+    std::size_t ringMemorySize = 0;
+    void*       sqeMemory = MAP_FAILED;
+    std::size_t sqeMemorySize = 0;
+
+    unsigned*     sqHead = nullptr;
+    unsigned*     sqTail = nullptr;
+    unsigned      sqMask = 0;
+    unsigned      sqEntries = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned      sqLocalTail = 0;  // published to the kernel by `Enter`
+
+    unsigned*     cqHead = nullptr;
+    unsigned*     cqTail = nullptr;
+    unsigned      cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    static unsigned acquire(unsigned* shared) {
+        return std::atomic_ref<unsigned>(*shared).load(
+            std::memory_order_acquire);
+    }
+
+    static void release(unsigned* shared, unsigned value) {
+        std::atomic_ref<unsigned>(*shared).store(value,
+                                                 std::memory_order_release);
+    }
+
+    static void* map(std::size_t size, int fd, off_t offset) {
+        return mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, offset);
+    }
+
+    bool setUp(unsigned entries, unsigned completionEntries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL |
+                       IORING_SETUP_SINGLE_ISSUER |
+                       IORING_SETUP_DEFER_TASKRUN;
+        params.cq_entries = completionEntries;
+        ringFd = syscall(__NR_io_uring_setup, entries, &params);
+        if (ringFd < 0 && errno == EINVAL) {
+            // kernels before 6.1 lack the single issuer flags
+            std::memset(&params, 0, sizeof(params));
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = completionEntries;
+            ringFd = syscall(__NR_io_uring_setup, entries, &params);
+        }
+        if (ringFd < 0) {
+            return false;
+        }
+        features = params.features;
+        if (!(features & IORING_FEAT_SINGLE_MMAP) ||
+            !(features & IORING_FEAT_NODROP) ||
+            !(features & IORING_FEAT_SUBMIT_STABLE) ||
+            !(features & IORING_FEAT_EXT_ARG)) {
+            return false;
+        }
+
+        // with a single mmap, one mapping holds both rings
+        ringMemorySize = std::max<std::size_t>(
+            params.sq_off.array + params.sq_entries * sizeof(unsigned),
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        ringMemory = map(ringMemorySize, ringFd, IORING_OFF_SQ_RING);
+        if (ringMemory == MAP_FAILED) {
+            return false;
+        }
+
+        sqeMemorySize = params.sq_entries * sizeof(io_uring_sqe);
+        sqeMemory = map(sqeMemorySize, ringFd, IORING_OFF_SQES);
+        if (sqeMemory == MAP_FAILED) {
+            return false;
+        }
+
+        char* sq = static_cast<char*>(ringMemory);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqEntries = params.sq_entries;
+        sqes = static_cast<io_uring_sqe*>(sqeMemory);
+        sqLocalTail = *sqTail;
+
+        // entry i of the submission ring is always slot i of `sqes`
+        unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sqEntries; i++) {
+            array[i] = i;
+        }
+
+        char* cq = static_cast<char*>(ringMemory);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+   public:
+    /**
+     * @param entries: Size of the submission ring.
+     * @param completionEntries: Size of the completion ring, multishot
+     * operations post many completions per submission.
+     */
+    IOUring(unsigned entries, unsigned completionEntries) {
+        if (!setUp(entries, completionEntries) && ringFd >= 0) {
+            close(ringFd);
+            ringFd = -1;
+        }
+    }
+
+    IOUring(const IOUring&) = delete;
+    IOUring& operator=(const IOUring&) = delete;
+
+    bool IsValid() const { return ringFd >= 0; }
+
+    /** Whether the kernel implements every one of `opcodes`. */
+    bool Supports(std::initializer_list<int> opcodes) {
+        constexpr unsigned opCount = 256;
+        alignas(io_uring_probe) unsigned char
+            memory[sizeof(io_uring_probe) +
+                   opCount * sizeof(io_uring_probe_op)] = {};
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(memory);
+        if (Register(IORING_REGISTER_PROBE, probe, opCount) < 0) {
+            return false;
+        }
+        return std::all_of(opcodes.begin(), opcodes.end(), [&](int opcode) {
+            return opcode <= probe->last_op &&
+                   (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+        });
+    }
+
+    /** @return 0 or a negated errno. */
+    int Register(unsigned opcode, void* argument, unsigned count) {
+        if (syscall(__NR_io_uring_register, ringFd, opcode, argument, count) <
+            0) {
+            return -errno;
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Makes room for `count` entries, submitting the prepared ones if
+     * needed, so that a chain of linked entries is never split.
+     */
+    bool Reserve(unsigned count) {
+        if (sqEntries - (sqLocalTail - acquire(sqHead)) >= count) {
+            return true;
+        }
+        Enter(0, nullptr);
+        return sqEntries - (sqLocalTail - acquire(sqHead)) >= count;
+    }
+
+    /**
+     * @brief Next free submission entry, zeroed, with `opcode`, `fd` and
+     * `userData` set. A full ring is submitted first.
+     * @return null if the kernel accepts no more entries for now.
+     */
+    io_uring_sqe* Prepare(std::uint8_t opcode, int fd,
+                          std::uint64_t userData) {
+        if (!Reserve(1)) {
+            return nullptr;
+        }
+        io_uring_sqe* sqe = &sqes[sqLocalTail & sqMask];
+        sqLocalTail++;
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->user_data = userData;
+        return sqe;
+    }
+
+    /**
+     * @brief Submits every prepared entry and, when `waitCount` is not zero,
+     * waits in the same system call until that many completions are ready.
+     * @param timeout: Bounds the wait, null waits forever.
+     * @return Entries submitted, or a negated errno such as `-ETIME` when the
+     * timeout expired.
+     */
+    int Enter(unsigned waitCount, const __kernel_timespec* timeout) {
+        release(sqTail, sqLocalTail);
+        unsigned pending = sqLocalTail - acquire(sqHead);
+
+        unsigned               flags = 0;
+        io_uring_getevents_arg argument{};
+        if (waitCount > 0) {
+            flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+            argument.ts = reinterpret_cast<std::uint64_t>(timeout);
+        }
+        long result =
+            syscall(__NR_io_uring_enter, ringFd, pending, waitCount, flags,
+                    waitCount > 0 ? &argument : nullptr,
+                    waitCount > 0 ? sizeof(argument) : 0);
+        return result < 0 ? -errno : static_cast<int>(result);
+    }
+
+    /**
+     * @brief Hands every completion ready so far to `handler`, which may
+     * prepare new entries.
+     * @return Number of completions handled.
+     */
+    template <typename Handler>
+    unsigned ForEachCompletion(Handler&& handler) {
+        unsigned head = *cqHead;
+        unsigned tail = acquire(cqTail);
+        unsigned count = 0;
+        for (; head != tail; head++, count++) {
+            io_uring_cqe completion = cqes[head & cqMask];
+            release(cqHead, head + 1);
+            handler(completion);
+        }
+        return count;
+    }
+
+    ~IOUring() {
+        if (sqeMemory != MAP_FAILED) {
+            munmap(sqeMemory, sqeMemorySize);
+        }
+        if (ringMemory != MAP_FAILED) {
+            munmap(ringMemory, ringMemorySize);
+        }
+        if (ringFd >= 0) {
+            close(ringFd);
+        }
+    }
+};
+
+/**
+ * @brief Equally sized receive buffers registered with an `IOUring` as a
+ * provided buffer ring. The kernel picks a buffer for every receive and names
+ * it in the completion, `Recycle` hands it back once its bytes are consumed.
+ * Connections thus hold no receive memory while they wait for data.
+ */
+class ProvidedBuffers {
+   private:
+    io_uring_buf_ring* ring = nullptr;
+    std::size_t        ringSize = 0;
+    char*              memory = nullptr;
+    std::size_t        memorySize = 0;
+    unsigned           count = 0;
+    unsigned           size = 0;
+    std::uint16_t      tail = 0;
+
+    static void* map(std::size_t bytes) {
+        void* address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return address == MAP_FAILED ? nullptr : address;
+    }
+
+   public:
+    ProvidedBuffers() = default;
+
+    ProvidedBuffers(const ProvidedBuffers&) = delete;
+    ProvidedBuffers& operator=(const ProvidedBuffers&) = delete;
+
+    /**
+     * @brief Allocates `bufferCount` buffers of `bufferSize` bytes and
+     * registers them with `uring` as buffer group `group`.
+     * @param bufferCount: A power of two up to 32768.
+     */
+    bool Register(IOUring& uring, std::uint16_t group, unsigned bufferCount,
+                  unsigned bufferSize) {
+        count = bufferCount;
+        size = bufferSize;
+        ringSize = count * sizeof(io_uring_buf);
+        memorySize = std::size_t(count) * size;
+        ring = static_cast<io_uring_buf_ring*>(map(ringSize));
+        memory = static_cast<char*>(map(memorySize));
+        if (ring == nullptr || memory == nullptr) {
+            return false;
+        }
+
+        io_uring_buf_reg registration{};
+        registration.ring_addr = reinterpret_cast<std::uint64_t>(ring);
+        registration.ring_entries = count;
+        registration.bgid = group;
+        if (uring.Register(IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+            return false;
+        }
+
+        for (unsigned id = 0; id < count; id++) {
+            Recycle(id);
+        }
+        return true;
+    }
+
+    /** The first `length` bytes of buffer `id`. */
+    std::string_view Data(unsigned id, std::size_t length) const {
+        return std::string_view(memory + std::size_t(id) * size, length);
+    }
+
+    /** Makes buffer `id` available to the kernel again. */
+    void Recycle(unsigned id) {
+        // entries start at the ring itself; `ring->bufs` would be off by
+        // eight bytes in C++, where the empty struct in front of the header's
+        // flexible array takes space
+        io_uring_buf& buffer =
+            reinterpret_cast<io_uring_buf*>(ring)[tail & (count - 1)];
+        buffer.addr = reinterpret_cast<std::uint64_t>(memory) +
+                      std::uint64_t(id) * size;
+        buffer.len = size;
+        buffer.bid = id;
+        tail++;
+        std::atomic_ref<std::uint16_t>(ring->tail).store(
+            tail, std::memory_order_release);
+    }
+
+    ~ProvidedBuffers() {
+        if (memory != nullptr) {
+            munmap(memory, memorySize);
+        }
+        if (ring != nullptr) {
+            munmap(ring, ringSize);
+        }
+    }
+};
+}  // namespace DinoScale
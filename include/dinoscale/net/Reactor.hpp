@@ -0,0 +1,364 @@
+#pragma once
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../logger/Logger.hpp"
+#include "../metrics/Counter.hpp"
+#include "../utils/BufferPool.hpp"
+#include "../utils/FileDescriptor.hpp"
+#include "../utils/TimerWheel.hpp"
+#include "Connection.hpp"
+
+namespace DinoScale {
+class Reactor;
+
+/**
+ * @brief Turns the bytes buffered on a connection into responses. The server
+ * implements this so that the networking layer stays free of HTTP details.
+ */
+class RequestProcessor {
+   public:
+    /**
+     * @brief Called whenever new input arrived on `connection`. Implementations
+     * consume every complete request from `Input()`, queue the responses with
+     * `Write()` and leave partial requests in place until more bytes arrive.
+     * A request answered on another thread suspends the connection and
+     * finishes through `Reactor::Post` on the `reactor` owning it.
+     */
+    virtual void ProcessRequests(Connection& connection, Reactor& reactor) = 0;
+
+   protected:
+    ~RequestProcessor() = default;
+};
+
+/**
+ * @brief Construction parameters shared by every reactor implementation.
+ */
+struct ReactorConfig {
+    /** Bound, listening and non-blocking server socket. */
+    int listenFd = -1;
+
+    /** Connections buffering more than this many bytes without producing a
+     * response are dropped. */
+    std::size_t maxRequestSize = 0;
+
+    /** Limits for the states of a connection, enforced by its timer. */
+    ConnectionTimeouts timeouts;
+
+    /** Open connections beyond which no more are accepted, 0 for no limit.
+     * Clients wait in the listen backlog meanwhile. */
+    std::size_t maxConnections = 0;
+
+    /** Connections created up front. */
+    std::size_t preallocatedConnections = 0;
+
+    /** Bytes of idle I/O buffers kept for reuse. */
+    std::size_t bufferCacheLimit = 0;
+};
+
+/**
+ * @brief Single threaded event loop serving a listening socket and all of the
+ * connections accepted from it. This is the I/O backend interface of the
+ * server: `EpollReactor` waits for readiness with epoll, `UringReactor`
+ * submits the socket operations themselves through io_uring.
+ *
+ * The base keeps what does not depend on how I/O is driven. Connection
+ * objects and their I/O buffers are recycled within the reactor: a closed
+ * connection goes back to a free list together with its buffers, so
+ * accepting and serving clients allocates only while the number of open
+ * connections grows beyond anything seen before. Work finished on other
+ * threads comes back through a mailbox signalled with an eventfd.
+ *
+ * Every connection has one timer in a hierarchical timing wheel, armed for
+ * the deadline of its current state (see `Connection::Deadline`). Deadlines
+ * moving later, which is what serving requests does, only cost a comparison:
+ * the timer stays where it is and re-checks the deadline when it fires.
+ * Only a deadline moving earlier relinks the timer.
+ */
+class Reactor {
+   protected:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds timerTick{10};
+
+    int                    listenFd;
+    RequestProcessor&      processor;
+    std::size_t            maxRequestSize;
+    std::size_t            maxConnections;
+    ConnectionTimeouts     timeouts;
+    TimerWheel<Connection> timers;
+    bool                   running;
+    ConnectionCounters&    counters;
+
+    BufferPool buffers;  // declared first, connections hold its buffers
+
+    std::vector<std::unique_ptr<Connection>> connections;  // every one made
+    std::vector<Connection*>                 spare;  // closed, ready for reuse
+    std::vector<Connection*>                 released;  // closed this batch
+    std::vector<Connection*>                 open;  // indexed by descriptor
+    std::size_t                              openCount;
+
+    /* work finished on other threads, waiting to be applied on this one */
+    struct Completion {
+        Connection*                       connection;
+        std::function<void(Connection&)> task;
+    };
+
+    FileDescriptor          mailboxFd;  // eventfd signalled by `Post`
+    std::mutex              mailboxLock;
+    std::vector<Completion> mailbox;
+    std::vector<Completion> delivered;  // swapped with `mailbox` when drained
+
+    /* posted tasks of the reactor as a whole, e.g. broadcasts */
+    std::vector<std::function<void()>> tasks;
+    std::vector<std::function<void()>> deliveredTasks;
+
+    Logger& logger;
+
+    /* a connection serving `clientFd`, recycled when possible */
+    Connection* takeConnection(int clientFd) {
+        if (spare.empty()) {
+            connections.push_back(std::make_unique<Connection>(
+                maxRequestSize, counters, buffers));
+            spare.push_back(connections.back().get());
+        }
+        Connection* connection = spare.back();
+        spare.pop_back();
+        connection->Open(clientFd);
+
+        if (static_cast<std::size_t>(clientFd) >= open.size()) {
+            open.resize(clientFd + 1, nullptr);
+        }
+        open[clientFd] = connection;
+        openCount++;
+        return connection;
+    }
+
+    /* whether accepting has to wait for a connection to close */
+    bool atConnectionLimit() const {
+        return maxConnections != 0 && openCount >= maxConnections;
+    }
+
+    /* closes the socket of `connection`, it goes back to the free list once
+     * the current batch of events is handled */
+    void releaseConnection(Connection* connection) {
+        timers.Cancel(connection->Timer());
+        open[connection->Fd()] = nullptr;
+        openCount--;
+        connection->Close();
+        released.push_back(connection);
+    }
+
+    /**
+     * @brief Puts the connections released during a batch of events back
+     * to the free list. Until then a later event of the batch naming one of
+     * them finds it closed, rather than reused for another client.
+     */
+    void recycleConnections() {
+        spare.insert(spare.end(), released.begin(), released.end());
+        released.clear();
+    }
+
+    /* whether `connection` was closed, events still reported for it in the
+     * current batch are stale */
+    static bool isClosed(const Connection* connection) {
+        return connection->Fd() < 0 || connection->IsAbandoned();
+    }
+
+    /** Closes `connection`, or abandons it while a handler still uses it. */
+    virtual void closeConnection(Connection* connection) = 0;
+
+    /** Carries on with `connection` after a posted task ran on it. */
+    virtual void resumeConnection(Connection* connection) = 0;
+
+    /** Releases a connection abandoned while suspended, its handler is done. */
+    virtual void retireConnection(Connection* connection) = 0;
+
+    /* applies completions posted by other threads, the eventfd signal has
+     * been consumed by the caller */
+    void drainMailbox() {
+        {
+            std::lock_guard<std::mutex> guard(mailboxLock);
+            delivered.swap(mailbox);
+            deliveredTasks.swap(tasks);
+        }
+
+        for (Completion& completion : delivered) {
+            Connection* connection = completion.connection;
+            connection->Resume();
+            if (connection->IsAbandoned()) {
+                if (!connection->IsSuspended()) {
+                    retireConnection(connection);  // its last handler is done
+                }
+                continue;
+            }
+
+            completion.task(*connection);
+            resumeConnection(connection);
+        }
+        delivered.clear();
+
+        for (std::function<void()>& task : deliveredTasks) {
+            task();
+        }
+        deliveredTasks.clear();
+    }
+
+    void signalMailbox() {
+        std::uint64_t signal = 1;
+        ssize_t       ignored = write(mailboxFd.Get(), &signal, sizeof(signal));
+        (void)ignored;
+    }
+
+    /**
+     * @brief Arms the timer of `connection` for the deadline of its current
+     * state. Called after every event handled on the connection.
+     */
+    void updateDeadline(Connection* connection) {
+        Clock::time_point      deadline = connection->Deadline(timeouts);
+        TimerNode<Connection>& timer = connection->Timer();
+        if (deadline == Clock::time_point::max()) {
+            return;  // nothing to enforce, a firing timer finds the same
+        }
+        if (!timer.IsScheduled() || deadline < timers.ExpiryOf(timer)) {
+            timers.Schedule(timer, deadline);
+        }
+    }
+
+    /**
+     * @brief Fires the timers which are due, waking coroutine handlers whose
+     * sleep is over and closing every connection whose deadline has passed.
+     * Timers firing before a deadline which moved later are armed again for
+     * it.
+     */
+    void expireTimers() {
+        Clock::time_point now = Clock::now();
+        timers.Advance(now, [this, now](Connection& connection) {
+            Clock::time_point deadline = connection.Deadline(timeouts);
+            if (deadline == Clock::time_point::max()) {
+                return;  // re-armed once the connection leaves this state
+            }
+            if (deadline > now) {
+                timers.Schedule(connection.Timer(), deadline);
+                return;
+            }
+            if (connection.WakeDue(now)) {
+                connection.Wake();
+                resumeConnection(&connection);
+                return;
+            }
+            counters.timedOut.Add();
+            closeConnection(&connection);
+        });
+    }
+
+    /** Milliseconds until a timer is due, -1 if none is scheduled. */
+    int timerTimeoutMs() const {
+        Clock::duration wait = timers.TimeUntilNext(Clock::now());
+        if (wait == Clock::duration::max()) {
+            return -1;
+        }
+        // rounded up, waking before the tick would only wait again
+        return std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+    }
+
+   public:
+    /**
+     * @param processor: Receives the input of every connection.
+     * @param counters: Counts the connections and their traffic, updated by
+     * the reactor thread only.
+     */
+    Reactor(const ReactorConfig& config, RequestProcessor& processor,
+            ConnectionCounters& counters)
+        : listenFd(config.listenFd),
+          processor(processor),
+          maxRequestSize(config.maxRequestSize),
+          maxConnections(config.maxConnections),
+          timeouts(config.timeouts),
+          timers(timerTick, Clock::now()),
+          running(false),
+          counters(counters),
+          buffers(config.bufferCacheLimit),
+          openCount(0),
+          mailboxFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+          logger(*Logger::GetInstance()) {
+        connections.reserve(config.preallocatedConnections);
+        spare.reserve(config.preallocatedConnections);
+        for (std::size_t i = 0; i < config.preallocatedConnections; i++) {
+            connections.push_back(std::make_unique<Connection>(
+                maxRequestSize, counters, buffers));
+            spare.push_back(connections.back().get());
+        }
+    }
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    virtual ~Reactor() = default;
+
+    /**
+     * @brief Serves connections until `Stop` is called.
+     * @return false if the loop could not be set up.
+     */
+    virtual bool Run() = 0;
+
+    void Stop() { running = false; }
+
+    /**
+     * @brief Runs `task` on the reactor thread with `connection`, which must
+     * be suspended, then ends one suspension and carries on with the
+     * connection. Safe to call from any thread, the reactor is woken up
+     * through its eventfd.
+     */
+    void Post(Connection* connection, std::function<void(Connection&)> task) {
+        bool wasEmpty;
+        {
+            std::lock_guard<std::mutex> guard(mailboxLock);
+            wasEmpty = mailbox.empty() && tasks.empty();
+            mailbox.push_back({connection, std::move(task)});
+        }
+        if (wasEmpty) {
+            signalMailbox();
+        }
+    }
+
+    /**
+     * @brief Runs `task` on the reactor thread, after the connection tasks
+     * posted with it. Output it queues on a connection is sent through
+     * `Serve`. Safe to call from any thread.
+     */
+    void Post(std::function<void()> task) {
+        bool wasEmpty;
+        {
+            std::lock_guard<std::mutex> guard(mailboxLock);
+            wasEmpty = mailbox.empty() && tasks.empty();
+            tasks.push_back(std::move(task));
+        }
+        if (wasEmpty) {
+            signalMailbox();
+        }
+    }
+
+    /**
+     * @brief Carries on with `connection` after a task of this reactor
+     * queued output on it, as after an event: the output is sent and the
+     * connection closed if it is done. A connection closed meanwhile is
+     * left alone. Reactor thread only.
+     */
+    void Serve(Connection& connection) {
+        if (!isClosed(&connection)) {
+            resumeConnection(&connection);
+        }
+    }
+
+    std::size_t ConnectionCount() const { return openCount; }
+};
+}  // namespace DinoScale
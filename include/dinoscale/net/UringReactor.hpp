@@ -0,0 +1,577 @@
+#pragma once
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "../utils/FileDescriptor.hpp"
+#include "Connection.hpp"
+#include "IOUring.hpp"
+#include "Reactor.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Reactor submitting the socket operations themselves through
+ * io_uring instead of waiting for readiness, which needs Linux 6.0 or later.
+ *
+ * - One multishot accept delivers every new connection.
+ * - One multishot receive per connection delivers its bytes in buffers the
+ *   kernel picks from a provided buffer ring, so idle connections hold no
+ *   receive memory. While the input of a connection is paused, its receive
+ *   is not armed again, and cancelled once it parked `maxParked` buffers,
+ *   so a client sending ahead fills its socket buffer rather than the ring
+ *   shared by every connection.
+ * - Queued output leaves in one `sendmsg` per run of memory segments. A file
+ *   segment is spliced from the file through a pipe into the socket by two
+ *   more entries linked behind it, so the bytes stay in the kernel as with
+ *   `sendfile`.
+ * - Everything prepared while handling a batch of completions is submitted
+ *   by the same `io_uring_enter` which waits for the next batch.
+ *
+ * Sockets are accepted in blocking mode, io_uring never blocks on them
+ * itself and the splice into the socket then waits for room instead of
+ * failing. A closed socket is shut down at once but its connection is only
+ * released after every operation still referring to it completed.
+ */
+class UringReactor : public Reactor {
+   private:
+    static constexpr unsigned      submissionEntries = 1024;
+    static constexpr unsigned      completionEntries = 8192;
+    static constexpr unsigned      receiveBufferCount = 512;  // power of two
+    static constexpr unsigned      receiveBufferSize = 4096;
+    static constexpr std::uint16_t receiveGroup = 0;
+    static constexpr std::size_t   maxParked = 4;  // per paused connection
+    static constexpr int           pipeSize = 256 * 1024;
+
+    /* kind of operation a completion belongs to, kept in its user data
+     * together with the descriptor it works on */
+    enum Operation : std::uint8_t {
+        Accept,
+        Mailbox,
+        Receive,
+        Send,
+        SpliceIn,   // file into the pipe
+        SpliceOut,  // pipe into the socket
+        Cancel,     // of the receive of a paused connection
+    };
+
+    /* receive buffer held back while its connection is suspended */
+    struct Parked {
+        std::uint16_t buffer;
+        unsigned      length;
+    };
+
+    /* io_uring state of the socket behind one descriptor, reused by every
+     * connection which gets the same descriptor */
+    struct Socket {
+        Connection* connection = nullptr;
+        unsigned    inFlight = 0;   // submitted, not completed operations
+        unsigned    sendsLeft = 0;  // operations of the send chain in flight
+        bool        receiving = false;   // a multishot receive is armed
+        bool        cancelling = false;  // its cancellation is in flight
+        bool        sendFailed = false;  // an operation of the chain failed
+        bool        closing = false;     // shut down, released when idle
+
+        std::vector<Parked> parked;
+
+        FileDescriptor pipeRead;  // both ends empty between send chains
+        FileDescriptor pipeWrite;
+        unsigned       pipeCapacity = 0;
+        unsigned       spliceLength = 0;  // bytes of the current splices
+
+        iovec  vectors[Connection::maxGather];  // read by the kernel when the
+        msghdr message;                         // chain is submitted
+    };
+
+    ProvidedBuffers receiveBuffers;  // must outlive `uring`
+    IOUring         uring;
+    bool            usable;
+
+    std::vector<std::unique_ptr<Socket>> sockets;  // indexed by descriptor
+    std::vector<int>                     starved;  // waiting for buffers
+    bool                                 acceptPaused;
+    std::uint64_t                        mailboxSignals;
+
+    static std::uint64_t userData(int fd, Operation operation) {
+        return (std::uint64_t(fd) << 8) | operation;
+    }
+
+    Socket& socketOf(int fd) {
+        if (static_cast<std::size_t>(fd) >= sockets.size()) {
+            sockets.resize(fd + 1);
+        }
+        if (!sockets[fd]) {
+            sockets[fd] = std::make_unique<Socket>();
+        }
+        return *sockets[fd];
+    }
+
+    void armAccept() {
+        io_uring_sqe* sqe =
+            uring.Prepare(IORING_OP_ACCEPT, listenFd, userData(0, Accept));
+        if (sqe == nullptr) {
+            acceptPaused = true;  // retried when a connection is released
+            return;
+        }
+        // with a connection limit every accept is armed on its own, a
+        // multishot accept would take the whole backlog at once
+        sqe->ioprio = maxConnections == 0 ? IORING_ACCEPT_MULTISHOT : 0;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        acceptPaused = false;
+    }
+
+    bool armMailbox() {
+        io_uring_sqe* sqe = uring.Prepare(IORING_OP_READ, mailboxFd.Get(),
+                                          userData(0, Mailbox));
+        if (sqe == nullptr) {
+            return false;
+        }
+        sqe->addr = reinterpret_cast<std::uint64_t>(&mailboxSignals);
+        sqe->len = sizeof(mailboxSignals);
+        return true;
+    }
+
+    void armReceive(Socket& socket) {
+        int           fd = socket.connection->Fd();
+        io_uring_sqe* sqe =
+            uring.Prepare(IORING_OP_RECV, fd, userData(fd, Receive));
+        if (sqe == nullptr) {
+            closeConnection(socket.connection);
+            return;
+        }
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = receiveGroup;
+        socket.receiving = true;
+        socket.inFlight++;
+    }
+
+    /* ends the multishot receive of `socket`, whose connection parked as
+     * much input as it may */
+    void cancelReceive(Socket& socket) {
+        int           fd = socket.connection->Fd();
+        io_uring_sqe* sqe =
+            uring.Prepare(IORING_OP_ASYNC_CANCEL, -1, userData(fd, Cancel));
+        if (sqe == nullptr) {
+            return;  // tried again with the next buffer parked
+        }
+        sqe->addr = userData(fd, Receive);
+        socket.cancelling = true;
+        socket.inFlight++;
+    }
+
+    /* whether the connection still wants a receive armed, which it does not
+     * while its input is paused */
+    static bool wantsInput(const Socket& socket) {
+        return socket.connection != nullptr && !socket.closing &&
+               !socket.receiving && !socket.connection->IsPeerClosed() &&
+               !socket.connection->IsInputPaused();
+    }
+
+    void recycle(std::uint16_t buffer) {
+        receiveBuffers.Recycle(buffer);
+        if (starved.empty()) {
+            return;
+        }
+        for (int fd : starved) {
+            Socket& socket = *sockets[fd];
+            if (wantsInput(socket)) {
+                armReceive(socket);
+            }
+        }
+        starved.clear();
+    }
+
+    /* hands input to the processor, then sends what it queued */
+    void serve(Socket& socket) {
+        Connection& connection = *socket.connection;
+        processor.ProcessRequests(connection, *this);
+        if (!connection.IsInputPaused() && !connection.IsCloseScheduled() &&
+            connection.Input().size() >= maxRequestSize) {
+            // a single request larger than the input limit
+            closeConnection(&connection);
+            return;
+        }
+        flush(socket);
+    }
+
+    /* appends the input received while the connection was paused */
+    void unpark(Socket& socket) {
+        for (Parked parked : socket.parked) {
+            socket.connection->AppendInput(
+                receiveBuffers.Data(parked.buffer, parked.length));
+            recycle(parked.buffer);
+        }
+        socket.parked.clear();
+    }
+
+    void flush(Socket& socket) {
+        Connection& connection = *socket.connection;
+        // a handler waiting for its output to be sent carries on, then the
+        // input it left unread is processed
+        while (socket.sendsLeft == 0 && !socket.closing &&
+               connection.WakeIfDrained()) {
+            unpark(socket);
+            processor.ProcessRequests(connection, *this);
+        }
+        if (socket.sendsLeft == 0 && connection.HasPendingOutput()) {
+            startSend(socket);
+        }
+        if (socket.sendsLeft == 0 && !socket.closing &&
+            connection.ShouldClose()) {
+            closeConnection(&connection);
+        }
+        // the receive is left unarmed while the input is paused
+        if (wantsInput(socket)) {
+            armReceive(socket);
+        }
+        if (!socket.closing) {
+            updateDeadline(&connection);
+        }
+    }
+
+    bool openPipe(Socket& socket) {
+        int ends[2];
+        if (pipe2(ends, O_CLOEXEC) < 0) {
+            return false;
+        }
+        socket.pipeRead = FileDescriptor(ends[0]);
+        socket.pipeWrite = FileDescriptor(ends[1]);
+        fcntl(ends[1], F_SETPIPE_SZ, pipeSize);  // a smaller pipe works too
+        int capacity = fcntl(ends[1], F_GETPIPE_SZ);
+        socket.pipeCapacity = capacity > 0 ? capacity : 4096;
+        return true;
+    }
+
+    /* the splice entries sending the next chunk of `file`, room for them
+     * has been reserved */
+    void prepareSplice(Socket& socket, const OutputSegment& file) {
+        static const long pageSize = sysconf(_SC_PAGESIZE);
+
+        // the pipe holds one page per slot, so a chunk starting inside a page
+        // ends early enough to fit; otherwise the first splice comes up short
+        // and breaks the chain
+        int      fd = socket.connection->Fd();
+        unsigned room = socket.pipeCapacity - file.fileOffset % pageSize;
+        unsigned length =
+            file.fileRemaining < room ? file.fileRemaining : room;
+
+        io_uring_sqe* in = uring.Prepare(
+            IORING_OP_SPLICE, socket.pipeWrite.Get(), userData(fd, SpliceIn));
+        in->splice_fd_in = file.file.Get();
+        in->splice_off_in = file.fileOffset;
+        in->off = -1;
+        in->len = length;
+        in->splice_flags = SPLICE_F_MOVE;
+        in->flags = IOSQE_IO_LINK;  // a short read cancels the send
+
+        io_uring_sqe* out =
+            uring.Prepare(IORING_OP_SPLICE, fd, userData(fd, SpliceOut));
+        out->splice_fd_in = socket.pipeRead.Get();
+        out->splice_off_in = -1;
+        out->off = -1;
+        out->len = length;
+        out->splice_flags =
+            SPLICE_F_MOVE | (length < file.fileRemaining ? SPLICE_F_MORE : 0);
+
+        socket.spliceLength = length;
+        socket.sendsLeft += 2;
+        socket.inFlight += 2;
+    }
+
+    /* links a send of the memory at the front and the splice of a file
+     * following it into one chain */
+    void startSend(Socket& socket) {
+        Connection&          connection = *socket.connection;
+        int                  fd = connection.Fd();
+        const OutputSegment* file;
+        int                  count = connection.GatherOutput(
+            socket.vectors, Connection::maxGather, file);
+
+        bool ready = file == nullptr || socket.pipeRead.IsValid() ||
+                     openPipe(socket);
+        if (!ready || !uring.Reserve((count > 0) + (file != nullptr) * 2)) {
+            closeConnection(&connection);
+            return;
+        }
+
+        if (count > 0) {
+            io_uring_sqe* sqe =
+                uring.Prepare(IORING_OP_SENDMSG, fd, userData(fd, Send));
+            socket.message = msghdr{};
+            socket.message.msg_iov = socket.vectors;
+            socket.message.msg_iovlen = count;
+            sqe->addr = reinterpret_cast<std::uint64_t>(&socket.message);
+            // all or nothing, so that the linked splices see a whole head
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            if (file != nullptr) {
+                sqe->msg_flags |= MSG_MORE;
+                sqe->flags = IOSQE_IO_LINK;
+            }
+            socket.sendsLeft++;
+            socket.inFlight++;
+        }
+        if (file != nullptr) {
+            prepareSplice(socket, *file);
+        }
+    }
+
+    void onAccept(int result, std::uint32_t flags) {
+        if (result >= 0) {
+            int clientFd = result;
+            int noDelay = 1;
+            setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay,
+                       sizeof(noDelay));
+
+            Socket& socket = socketOf(clientFd);
+            socket.connection = takeConnection(clientFd);
+            socket.closing = false;
+            socket.sendFailed = false;
+            counters.opened.Add();
+            updateDeadline(socket.connection);
+            armReceive(socket);
+        }
+
+        if (flags & IORING_CQE_F_MORE) {
+            return;
+        }
+        if (result < 0 && result != -ECONNABORTED && result != -EINTR) {
+            // e.g. out of descriptors, wait for a connection to close
+            logger.Error("accept failed: {}", strerror(-result));
+            acceptPaused = true;
+        } else if (atConnectionLimit()) {
+            acceptPaused = true;  // armed again once a connection closes
+        } else {
+            armAccept();
+        }
+    }
+
+    void onReceive(Socket& socket, int result, std::uint32_t flags) {
+        if (!(flags & IORING_CQE_F_MORE)) {
+            socket.receiving = false;
+            socket.inFlight--;
+        }
+
+        Connection& connection = *socket.connection;
+        if (result > 0) {
+            std::uint16_t buffer = flags >> IORING_CQE_BUFFER_SHIFT;
+            if (socket.closing) {
+                recycle(buffer);
+            } else if (connection.IsInputPaused()) {
+                // the handler still reads the input or waits for something
+                // else, append it on resume
+                socket.parked.push_back({buffer, unsigned(result)});
+                if (socket.receiving && !socket.cancelling &&
+                    socket.parked.size() >= maxParked) {
+                    cancelReceive(socket);
+                }
+            } else {
+                connection.AppendInput(receiveBuffers.Data(buffer, result));
+                recycle(buffer);
+                serve(socket);
+            }
+        } else if (socket.closing || result == -ECANCELED) {
+            // ended by the shutdown, or while the input is paused
+        } else if (result == 0) {
+            connection.MarkPeerClosed();
+            if (!connection.IsSuspended()) {
+                flush(socket);
+            }
+        } else if (result == -ENOBUFS) {
+            starved.push_back(connection.Fd());
+            return;
+        } else {
+            closeConnection(&connection);
+        }
+
+        if (socket.closing) {
+            finishClose(socket);
+        } else if (wantsInput(socket)) {
+            armReceive(socket);
+        }
+    }
+
+    void onSent(Socket& socket, Operation operation, int result) {
+        socket.inFlight--;
+        socket.sendsLeft--;
+
+        Connection& connection = *socket.connection;
+        if (socket.closing || socket.sendFailed || result < 0) {
+            socket.sendFailed = true;
+        } else if (operation == Send) {
+            connection.CompleteSend(result);
+        } else if (operation == SpliceIn) {
+            socket.sendFailed = unsigned(result) != socket.spliceLength;
+        } else {
+            connection.CompleteFileSend(result);
+            socket.sendFailed = unsigned(result) != socket.spliceLength;
+        }
+
+        if (socket.sendsLeft > 0) {
+            return;  // the rest of the chain completes next
+        }
+        if (socket.sendFailed) {
+            // a broken chain may leave bytes in the pipe, start over with a
+            // new one; no entry refers to it anymore
+            socket.pipeRead.Reset();
+            socket.pipeWrite.Reset();
+        }
+        if (socket.closing) {
+            finishClose(socket);
+        } else if (socket.sendFailed) {
+            closeConnection(&connection);
+        } else {
+            flush(socket);
+        }
+    }
+
+    void dispatch(const io_uring_cqe& completion) {
+        int       fd = static_cast<int>(completion.user_data >> 8);
+        Operation operation = static_cast<Operation>(completion.user_data);
+        switch (operation) {
+            case Accept:
+                onAccept(completion.res, completion.flags);
+                break;
+            case Mailbox:
+                if (!armMailbox()) {
+                    logger.Error("cannot watch reactor mailbox");
+                }
+                drainMailbox();
+                break;
+            case Receive:
+                onReceive(*sockets[fd], completion.res, completion.flags);
+                break;
+            case Send:
+            case SpliceIn:
+            case SpliceOut:
+                onSent(*sockets[fd], operation, completion.res);
+                break;
+            case Cancel: {
+                Socket& socket = *sockets[fd];
+                socket.cancelling = false;
+                socket.inFlight--;
+                if (socket.closing) {
+                    finishClose(socket);
+                }
+                break;
+            }
+        }
+    }
+
+    /* releases a closing connection once nothing refers to it anymore */
+    void finishClose(Socket& socket) {
+        Connection* connection = socket.connection;
+        if (connection == nullptr || socket.inFlight > 0 ||
+            connection->IsSuspended()) {
+            return;
+        }
+        for (Parked parked : socket.parked) {
+            recycle(parked.buffer);
+        }
+        socket.parked.clear();
+        socket.connection = nullptr;
+        socket.sendFailed = false;
+        releaseConnection(connection);
+        if (acceptPaused && !atConnectionLimit()) {
+            armAccept();
+        }
+    }
+
+    void closeConnection(Connection* connection) override {
+        Socket& socket = *sockets[connection->Fd()];
+        if (socket.closing) {
+            return;
+        }
+        socket.closing = true;
+        timers.Cancel(connection->Timer());
+        counters.closed.Add();
+        // completes the pending receive and fails sends still waiting
+        shutdown(connection->Fd(), SHUT_RDWR);
+        if (connection->IsSuspended()) {
+            connection->Abandon();
+            return;
+        }
+        finishClose(socket);
+    }
+
+    void resumeConnection(Connection* connection) override {
+        Socket& socket = *sockets[connection->Fd()];
+        if (socket.closing) {
+            // e.g. reached by a broadcast while its operations complete
+            finishClose(socket);
+            return;
+        }
+        unpark(socket);
+        serve(socket);
+        if (socket.closing) {
+            finishClose(socket);
+        }
+    }
+
+    void retireConnection(Connection* connection) override {
+        finishClose(*sockets[connection->Fd()]);
+    }
+
+   public:
+    /** Check `IsValid` before `Run`, io_uring may be unavailable. */
+    UringReactor(const ReactorConfig& config, RequestProcessor& processor,
+                 ConnectionCounters& counters)
+        : Reactor(config, processor, counters),
+          uring(submissionEntries, completionEntries),
+          acceptPaused(false),
+          mailboxSignals(0) {
+        // only the operations submitted are probed; registering the
+        // provided buffer ring fails before Linux 5.19
+        usable = uring.IsValid() &&
+                 uring.Supports({IORING_OP_ACCEPT, IORING_OP_RECV,
+                                 IORING_OP_SENDMSG, IORING_OP_SPLICE,
+                                 IORING_OP_READ, IORING_OP_ASYNC_CANCEL}) &&
+                 receiveBuffers.Register(uring, receiveGroup,
+                                         receiveBufferCount,
+                                         receiveBufferSize);
+    }
+
+    bool IsValid() const { return usable; }
+
+    bool Run() override {
+        if (!usable || !mailboxFd.IsValid()) {
+            logger.Error("io_uring reactor is unusable");
+            return false;
+        }
+        armAccept();
+        if (!armMailbox()) {
+            logger.Error("cannot watch reactor mailbox");
+            return false;
+        }
+        running = true;
+
+        while (running) {
+            int               waitMs = timerTimeoutMs();
+            __kernel_timespec timeout{waitMs / 1000, waitMs % 1000 * 1000000LL};
+            int result = uring.Enter(1, waitMs >= 0 ? &timeout : nullptr);
+            if (result < 0 && result != -ETIME && result != -EINTR &&
+                result != -EBUSY) {
+                logger.Error("io_uring_enter failed: {}", strerror(-result));
+                return false;
+            }
+
+            uring.ForEachCompletion(
+                [this](const io_uring_cqe& completion) {
+                    dispatch(completion);
+                });
+
+            expireTimers();
+            recycleConnections();
+        }
+        return true;
+    }
+};
+}  // namespace DinoScale
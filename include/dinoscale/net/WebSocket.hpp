@@ -0,0 +1,621 @@
+#pragma once
+
+#include <algorithm>
+#include <any>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../core/HTTPRequest.hpp"
+#include "../core/Router.hpp"
+#include "../core/WebSocketFrame.hpp"
+#include "../logger/Logger.hpp"
+#include "../metrics/Counter.hpp"
+#include "../simd/Mask.hpp"
+#include "../utils/Strings.hpp"
+#include "Connection.hpp"
+#include "Reactor.hpp"
+
+namespace DinoScale {
+/** Limits of a `WebSocket`, from the server options. */
+struct WebSocketLimits {
+    /** Largest message a client may send, counting all of its fragments.
+     * A larger one closes the connection with `MessageTooBig`. */
+    std::size_t maxMessageSize = 1024 * 1024;
+
+    /** Bytes queued for a client which does not keep up, beyond which
+     * further messages to it are dropped and its frames are left unread
+     * until it caught up. */
+    std::size_t maxQueuedBytes = 4 * 1024 * 1024;
+
+    /** Silence after which the connection is dropped, 0 for none. */
+    std::chrono::steady_clock::duration idleTimeout = std::chrono::seconds(60);
+};
+
+class WebSocket;
+
+/**
+ * @brief Set of WebSockets receiving the same messages, e.g. the clients of
+ * a chat room or of a price feed.
+ *
+ * `Broadcast` may be called from any thread. It frames the message once
+ * and posts it once to every reactor with members, which queues the frame
+ * on each of its members by reference: thousands of subscribers share a
+ * single copy of the bytes, and the reactors fan it out in parallel without
+ * touching the sockets of each other. Members are kept per reactor and
+ * leave in constant time, sockets leave their groups when they close.
+ * A group must outlive the server.
+ */
+class WebSocketGroup {
+    friend class WebSocket;
+
+   private:
+    /* the members owned by one reactor, only sent to on its thread */
+    struct Shard {
+        Reactor*                reactor;
+        std::vector<WebSocket*> members;
+    };
+
+    mutable std::mutex                  lock;
+    std::vector<std::unique_ptr<Shard>> shards;  // kept, deliveries point here
+    std::size_t                         size = 0;
+
+    /* queues `frame` on the members of `shard`, on its reactor thread */
+    void deliver(Shard& shard, const std::shared_ptr<const std::string>& frame);
+
+   public:
+    WebSocketGroup() = default;
+    WebSocketGroup(const WebSocketGroup&) = delete;
+    WebSocketGroup& operator=(const WebSocketGroup&) = delete;
+
+    /** Adds `socket`, from its reactor thread. Joining twice is a no-op. */
+    void Join(WebSocket& socket);
+
+    /** Removes `socket`, from its reactor thread. */
+    void Leave(WebSocket& socket);
+
+    /** Sockets in the group. */
+    std::size_t Size() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return size;
+    }
+
+    /**
+     * @brief Sends `message` to every member as a `Text` or `Binary` frame.
+     * Members joining or leaving meanwhile may or may not receive it.
+     */
+    void Broadcast(std::string_view message,
+                   WebSocketOpcode  opcode = WebSocketOpcode::Text) {
+        auto frame = std::make_shared<std::string>();
+        frame->reserve(message.size() + 10);
+        AppendWebSocketFrameHeader(*frame, opcode, message.size());
+        frame->append(message);
+        std::shared_ptr<const std::string> shared = std::move(frame);
+
+        std::lock_guard<std::mutex> guard(lock);
+        for (const std::unique_ptr<Shard>& shard : shards) {
+            if (shard->members.empty()) {
+                continue;
+            }
+            Shard* target = shard.get();
+            target->reactor->Post(
+                [this, target, shared] { deliver(*target, shared); });
+        }
+    }
+};
+
+/**
+ * @brief A connection upgraded to the WebSocket protocol of RFC 6455, the
+ * `ConnectionProtocol` interpreting its input once the handshake of a
+ * WebSocket route succeeded, see `DinoScale::createWebSocket`.
+ *
+ * Frames are parsed incrementally: a header is read once all of its bytes
+ * arrived, and the payload is unmasked with `Mask::Apply` straight out of
+ * the input into the message buffer as it arrives, so the input never holds
+ * more than the bytes of one read and a message needs a single copy however
+ * it is fragmented. Pings are answered, pongs ignored, close frames echoed.
+ * No frame is read while more than `maxQueuedBytes` wait to be sent, so a
+ * client sending pings without reading the pongs is held back by TCP.
+ * Violations of the protocol close the connection with the code the RFC
+ * asks for; extensions are not negotiated, so frames with reserved bits set
+ * are refused.
+ *
+ * All methods are for the reactor thread of the connection, i.e. the
+ * callbacks of its route. Other threads reach sockets through a
+ * `WebSocketGroup`.
+ */
+class WebSocket : public ConnectionProtocol {
+    friend class WebSocketGroup;
+
+   private:
+    /* a group the socket joined and its position among the members there */
+    struct Membership {
+        WebSocketGroup* group;
+        std::size_t     index;
+    };
+
+    /* buffers of messages above this size are released once delivered */
+    static constexpr std::size_t retainedCapacity = 64 * 1024;
+
+    Connection&              connection;
+    Reactor&                 reactor;
+    const WebSocketHandlers& handlers;
+    ConnectionCounters&      counters;
+    WebSocketLimits          limits;
+    Logger&                  logger;
+
+    /* the frame being received */
+    bool            inFrame = false;
+    bool            finalFrame = false;
+    WebSocketOpcode opcode = WebSocketOpcode::Continuation;
+    unsigned char   key[4] = {};
+    std::uint64_t   remaining = 0;  // payload bytes still to arrive
+    std::size_t     maskOffset = 0;
+
+    /* the message being reassembled, and the payload of a control frame,
+     * which may arrive between its fragments */
+    bool            inMessage = false;
+    WebSocketOpcode messageOpcode = WebSocketOpcode::Text;
+    std::string     message;
+    std::string     control;
+
+    bool               receiving = true;  // no close frame or error yet
+    bool               closing = false;   // our close frame was queued
+    bool               processing = false;  // in a callback of this socket
+    WebSocketCloseCode closeCode = WebSocketCloseCode::Abnormal;
+    std::size_t        queuedBytes = 0;  // since the output last drained
+
+    /* whether a flush is posted to the reactor, expiring with the socket
+     * so that the flush finds out whether it is still around */
+    std::shared_ptr<bool> flushPosted = std::make_shared<bool>(false);
+
+    std::vector<Membership> groups;
+    std::any                userData;
+
+    static bool isControl(WebSocketOpcode code) {
+        return static_cast<std::uint8_t>(code) >= 0x8;
+    }
+
+    /* codes a close frame may carry, RFC 6455 section 7.4 */
+    static bool isValidCloseCode(std::uint16_t code) {
+        return (code >= 1000 && code <= 1003) ||
+               (code >= 1007 && code <= 1014) ||
+               (code >= 3000 && code <= 4999);
+    }
+
+    /* sends what was queued from outside a callback of this socket once the
+     * reactor gets to it, a flush right away could close it under the
+     * caller */
+    void scheduleFlush() {
+        if (processing || *flushPosted) {
+            return;
+        }
+        *flushPosted = true;
+        reactor.Post([this, token = std::weak_ptr<bool>(flushPosted)] {
+            if (token.expired()) {
+                return;  // closed meanwhile
+            }
+            *flushPosted = false;
+            reactor.Serve(connection);
+        });
+    }
+
+    void writeFrame(WebSocketOpcode code, std::string_view payload) {
+        thread_local std::string header;
+        header.clear();
+        AppendWebSocketFrameHeader(header, code, payload.size());
+        connection.Write(std::string_view(header));
+        if (!payload.empty()) {
+            connection.Write(payload);
+        }
+        queuedBytes += header.size() + payload.size();
+        scheduleFlush();
+    }
+
+    /* queues a frame of a broadcast, false if it was dropped */
+    bool writeShared(const std::shared_ptr<const std::string>& frame) {
+        if (closing || queuedBytes > limits.maxQueuedBytes) {
+            return false;
+        }
+        connection.WriteShared(*frame, frame);
+        queuedBytes += frame->size();
+        counters.webSocketMessagesSent.Add();
+        return true;
+    }
+
+    void writeClose(WebSocketCloseCode code, std::string_view reason) {
+        closing = true;
+        char payload[WebSocketMaxControlPayload];
+        auto value = static_cast<std::uint16_t>(code);
+        payload[0] = static_cast<char>(value >> 8);
+        payload[1] = static_cast<char>(value);
+        reason = reason.substr(0, sizeof(payload) - 2);
+        reason.copy(payload + 2, reason.size());
+        writeFrame(WebSocketOpcode::Close,
+                   std::string_view(payload, reason.size() + 2));
+    }
+
+    /* fails the connection: answers with `code` and stops reading */
+    void fail(WebSocketCloseCode code) {
+        if (!closing) {
+            writeClose(code, {});
+        }
+        receiving = false;
+        closeCode = code;
+        connection.CloseAfterWrite();
+    }
+
+    /* runs a callback, an escaping exception fails the connection */
+    template <typename Callback>
+    void run(const Callback& callback) {
+        bool outer = !std::exchange(processing, true);
+        try {
+            callback();
+        } catch (const std::exception& error) {
+            logger.Error("WebSocket handler failed: {}", error.what());
+            fail(WebSocketCloseCode::InternalError);
+        }
+        if (outer) {
+            processing = false;
+        }
+    }
+
+    /**
+     * @brief Reads the frame header at the front of `bytes`.
+     * @return Its length, 0 while incomplete or if the frame was refused.
+     */
+    std::size_t readHeader(std::string_view bytes) {
+        if (bytes.size() < 2) {
+            return 0;
+        }
+        auto          first = static_cast<std::uint8_t>(bytes[0]);
+        auto          second = static_cast<std::uint8_t>(bytes[1]);
+        bool          masked = (second & 0x80) != 0;
+        std::uint64_t length = second & 0x7f;
+        std::size_t   lengthEnd =
+            2 + (length == 126 ? 2 : length == 127 ? 8 : 0);
+        // an unmasked frame is refused without waiting for a key
+        std::size_t size = lengthEnd + (masked ? 4 : 0);
+        if (bytes.size() < size) {
+            return 0;
+        }
+        for (std::size_t i = 2; i < lengthEnd; i++) {
+            length = (i == 2 ? 0 : length << 8) |
+                     static_cast<std::uint8_t>(bytes[i]);
+        }
+
+        bool final = (first & 0x80) != 0;
+        auto code = static_cast<WebSocketOpcode>(first & 0x0f);
+        bool valid = (first & 0x70) == 0 &&  // reserved for extensions
+                     masked &&  // clients mask every frame
+                     (length >> 63) == 0;
+        switch (code) {
+            case WebSocketOpcode::Continuation:
+                valid = valid && inMessage;
+                break;
+            case WebSocketOpcode::Text:
+            case WebSocketOpcode::Binary:
+                valid = valid && !inMessage;
+                break;
+            case WebSocketOpcode::Close:
+            case WebSocketOpcode::Ping:
+            case WebSocketOpcode::Pong:
+                valid = valid && final &&
+                        length <= WebSocketMaxControlPayload;
+                break;
+            default:
+                valid = false;
+                break;
+        }
+        if (!valid) {
+            fail(WebSocketCloseCode::ProtocolError);
+            return 0;
+        }
+        if (!isControl(code)) {
+            if (length > limits.maxMessageSize - message.size()) {
+                fail(WebSocketCloseCode::MessageTooBig);
+                return 0;
+            }
+            if (code != WebSocketOpcode::Continuation) {
+                inMessage = true;
+                messageOpcode = code;
+                message.reserve(length);  // all of it, unless fragmented
+            }
+        } else {
+            control.clear();
+        }
+
+        std::memcpy(key, bytes.data() + lengthEnd, sizeof(key));
+        inFrame = true;
+        finalFrame = final;
+        opcode = code;
+        remaining = length;
+        maskOffset = 0;
+        return size;
+    }
+
+    /* acts on the frame whose payload was received completely */
+    void finishFrame() {
+        switch (opcode) {
+            case WebSocketOpcode::Ping:
+                if (!closing) {
+                    writeFrame(WebSocketOpcode::Pong, control);
+                }
+                return;
+            case WebSocketOpcode::Pong:
+                return;
+            case WebSocketOpcode::Close:
+                finishClose();
+                return;
+            default:
+                break;
+        }
+        if (!finalFrame) {
+            return;
+        }
+        inMessage = false;
+        if (messageOpcode == WebSocketOpcode::Text && !IsValidUTF8(message)) {
+            fail(WebSocketCloseCode::InvalidPayload);
+            return;
+        }
+        counters.webSocketMessagesReceived.Add();
+        if (handlers.onMessage && !closing) {
+            run([&] { handlers.onMessage(*this, message, messageOpcode); });
+        }
+        if (message.capacity() > retainedCapacity) {
+            std::string().swap(message);
+        } else {
+            message.clear();
+        }
+    }
+
+    /* the client closes: checks its code and echoes it */
+    void finishClose() {
+        WebSocketCloseCode code = WebSocketCloseCode::NoStatus;
+        if (control.size() == 1) {
+            fail(WebSocketCloseCode::ProtocolError);
+            return;
+        }
+        if (control.size() >= 2) {
+            std::uint16_t value =
+                static_cast<std::uint8_t>(control[0]) << 8 |
+                static_cast<std::uint8_t>(control[1]);
+            if (!isValidCloseCode(value)) {
+                fail(WebSocketCloseCode::ProtocolError);
+                return;
+            }
+            if (!IsValidUTF8(std::string_view(control).substr(2))) {
+                fail(WebSocketCloseCode::InvalidPayload);
+                return;
+            }
+            code = static_cast<WebSocketCloseCode>(value);
+        }
+        if (!closing) {
+            writeClose(code == WebSocketCloseCode::NoStatus
+                           ? WebSocketCloseCode::Normal
+                           : code,
+                       {});
+        }
+        receiving = false;
+        closeCode = code;
+        connection.CloseAfterWrite();
+    }
+
+   public:
+    WebSocket(Connection& connection, Reactor& reactor,
+              const WebSocketHandlers& handlers, ConnectionCounters& counters,
+              const WebSocketLimits& limits)
+        : connection(connection),
+          reactor(reactor),
+          handlers(handlers),
+          counters(counters),
+          limits(limits),
+          logger(*Logger::GetInstance()) {
+        counters.webSocketsOpened.Add();
+    }
+
+    WebSocket(const WebSocket&) = delete;
+    WebSocket& operator=(const WebSocket&) = delete;
+
+    /** Leaves every group, then tells the route how the connection ended. */
+    ~WebSocket() override {
+        while (!groups.empty()) {
+            groups.back().group->Leave(*this);
+        }
+        closing = true;
+        counters.webSocketsClosed.Add();
+        if (handlers.onClose) {
+            run([&] { handlers.onClose(*this, closeCode); });
+        }
+    }
+
+    /** Runs the `onOpen` callback for the upgrade `request`. */
+    void Open(const HTTPRequest& request) {
+        if (handlers.onOpen) {
+            run([&] { handlers.onOpen(*this, request); });
+        }
+    }
+
+    /** Consumes the frames received so far, the last one possibly in
+     * part. */
+    void Process(Connection&, Reactor&) override {
+        std::string_view input = connection.Input();
+        std::size_t      used = 0;
+        processing = true;
+
+        while (receiving) {
+            if (!inFrame) {
+                if (IsInputPaused()) {
+                    break;  // read on once the client caught up
+                }
+                std::size_t headerLength = readHeader(input.substr(used));
+                if (headerLength == 0) {
+                    break;
+                }
+                used += headerLength;
+            }
+
+            std::string& payload = isControl(opcode) ? control : message;
+            std::size_t  length = static_cast<std::size_t>(
+                std::min<std::uint64_t>(remaining, input.size() - used));
+            std::size_t  offset = payload.size();
+            payload.resize(offset + length);
+            Mask::Apply(input.data() + used, payload.data() + offset, length,
+                        key, maskOffset);
+            used += length;
+            maskOffset += length;
+            remaining -= length;
+            if (remaining > 0) {
+                break;  // the rest of the payload is on its way
+            }
+            inFrame = false;
+            finishFrame();
+        }
+
+        processing = false;
+        // once closed, whatever follows is of no interest
+        connection.Consume(receiving ? used : input.size());
+    }
+
+    /** The client took everything queued, it is no longer behind. */
+    bool Drained(Connection&) override {
+        bool paused = IsInputPaused();
+        queuedBytes = 0;
+        return paused;
+    }
+
+    bool IsInputPaused() const override {
+        return queuedBytes > limits.maxQueuedBytes;
+    }
+
+    std::chrono::steady_clock::duration IdleTimeout(
+        std::chrono::steady_clock::duration) const override {
+        return limits.idleTimeout;
+    }
+
+    /**
+     * @brief Queues `message` as one `Text` or `Binary` frame. Text must be
+     * UTF-8.
+     * @return false if the message was dropped: the socket is closing, or
+     * the client fell more than `maxQueuedBytes` behind.
+     */
+    bool Send(std::string_view message,
+              WebSocketOpcode  opcode = WebSocketOpcode::Text) {
+        if (closing || queuedBytes > limits.maxQueuedBytes) {
+            return false;
+        }
+        writeFrame(opcode, message);
+        counters.webSocketMessagesSent.Add();
+        return true;
+    }
+
+    /** Pings the client, which answers with a pong carrying `payload`. */
+    void Ping(std::string_view payload = {}) {
+        if (!closing) {
+            writeFrame(WebSocketOpcode::Ping,
+                       payload.substr(0, WebSocketMaxControlPayload));
+        }
+    }
+
+    /**
+     * @brief Starts the closing handshake. Nothing is sent afterwards and
+     * messages still arriving are dropped, the connection closes once the
+     * client answered.
+     */
+    void Close(WebSocketCloseCode code = WebSocketCloseCode::Normal,
+               std::string_view   reason = {}) {
+        if (!closing) {
+            closeCode = code;
+            writeClose(code, reason);
+        }
+    }
+
+    /** Whether messages can still be sent, i.e. no close frame was. */
+    bool IsOpen() const { return !closing; }
+
+    /** Bytes queued for the client and not yet taken by it. */
+    std::size_t QueuedBytes() const { return queuedBytes; }
+
+    /** State of the application attached to the socket, e.g. a user
+     * name set in `onOpen`. */
+    std::any& UserData() { return userData; }
+};
+
+inline void WebSocketGroup::deliver(
+    Shard& shard, const std::shared_ptr<const std::string>& frame) {
+    // the pointers are copied, serving a member may make it leave
+    thread_local std::vector<WebSocket*> recipients;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        recipients.assign(shard.members.begin(), shard.members.end());
+    }
+    for (WebSocket* socket : recipients) {
+        if (socket->writeShared(frame) && !socket->processing) {
+            shard.reactor->Serve(socket->connection);
+        }
+    }
+    recipients.clear();
+}
+
+inline void WebSocketGroup::Join(WebSocket& socket) {
+    for (const WebSocket::Membership& membership : socket.groups) {
+        if (membership.group == this) {
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    auto shard = std::find_if(
+        shards.begin(), shards.end(),
+        [&](const std::unique_ptr<Shard>& candidate) {
+            return candidate->reactor == &socket.reactor;
+        });
+    if (shard == shards.end()) {
+        shards.push_back(std::make_unique<Shard>(Shard{&socket.reactor, {}}));
+        shard = shards.end() - 1;
+    }
+    socket.groups.push_back({this, (*shard)->members.size()});
+    (*shard)->members.push_back(&socket);
+    size++;
+}
+
+inline void WebSocketGroup::Leave(WebSocket& socket) {
+    auto membership = std::find_if(
+        socket.groups.begin(), socket.groups.end(),
+        [&](const WebSocket::Membership& candidate) {
+            return candidate.group == this;
+        });
+    if (membership == socket.groups.end()) {
+        return;
+    }
+    std::size_t index = membership->index;
+    socket.groups.erase(membership);
+
+    std::lock_guard<std::mutex> guard(lock);
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        if (shard->reactor != &socket.reactor) {
+            continue;
+        }
+        // the last member takes the place of the one leaving
+        std::vector<WebSocket*>& members = shard->members;
+        WebSocket*               moved = members.back();
+        members[index] = moved;
+        members.pop_back();
+        for (WebSocket::Membership& other : moved->groups) {
+            if (other.group == this) {
+                other.index = index;
+            }
+        }
+        break;
+    }
+    size--;
+}
+}  // namespace DinoScale
@@ -1,3 +1,5 @@
+#pragma once
+
 #if __WIN32
 
 #include <windows.h>
@@ -22,40 +24,90 @@
 #define DINOSCALE_H_
 
 #include "constants/methods.hpp"
+#include "constants/mimes.hpp"
 #include "constants/statuses.hpp"
+#include "core/ConditionalRequest.hpp"
+#include "core/ContentCoding.hpp"
+#include "core/HTTPRequest.hpp"
+#include "core/HTTPResponse.hpp"
+#include "core/HandlerIO.hpp"
+#include "core/LoadShedder.hpp"
+#include "core/ResponseCache.hpp"
+#include "core/Router.hpp"
+#include "core/ServerOptions.hpp"
+#include "core/StaticFileCache.hpp"
+#include "core/Task.hpp"
 #include "logger/Logger.hpp"
+#include "metrics/Metrics.hpp"
+#include "net/EpollReactor.hpp"
+#include "net/HTTP2Session.hpp"
+#include "net/Reactor.hpp"
+#include "net/UringReactor.hpp"
+#include "net/WebSocket.hpp"
+#include "utils/FileDescriptor.hpp"
+#include "utils/HTTPDate.hpp"
+#include "utils/ThreadPool.hpp"
 
 #endif
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <charconv>
 #include <cstring>
+#include <ctime>
+#include <exception>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
-#include <unordered_map>
+#include <thread>
+#include <vector>
 
 namespace DinoScale {
-class DinoScale {
+class DinoScale : private RequestProcessor, private StreamProcessor {
    private:
-    const int        maxSimultaneousConnections = 20;
-    static const int maxBufferSize = 30720;
-    Logger           logger;
+    static constexpr int maxBufferSize = 30720;
+    Logger&              logger;
 
-    SOCKET sock;
-    SOCKET newSocket;
+    SOCKET              sock;       // listening socket of the first reactor
+    std::vector<SOCKET> listeners;  // one listening socket per reactor
 
     socklen_t          socketAddressLength;
     struct sockaddr_in socketAddress;
 
     const std::string machineIpAddress;
-    std::string       serverMessage;
+    ServerOptions     options;
+
+    /* Routes are only added before startListening, which freezes the router,
+     * afterwards the reactors read it concurrently without any locking. */
+    Router router;
+    bool   listening = false;
+
+    std::unique_ptr<StaticFileCache> fileCache;  // shared by all reactors
+    std::unique_ptr<ResponseCache>   responseCache;  // of handler routes
+    std::unique_ptr<ThreadPool>      handlerPool;  // null runs handlers inline
+    std::unique_ptr<LoadShedder>     shedder;      // with `handlerPool`
+    std::string                      retryAfter;   // seconds, for 503s
+
+    /* the reactors serving, kept until `startListening` returns so that
+     * handlers still running can post to them after a `Stop` */
+    std::mutex                            reactorsLock;
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    bool                                  stopping = false;
 
-    std::unordered_map<HTTPMethod, std::string> routeToFileMapList[5];
+    /* one shard per reactor, `threadMetrics` is the one of the calling
+     * reactor thread; every request is recorded on its reactor thread */
+    Metrics                                    metrics;
+    inline static thread_local MetricsShard* threadMetrics = nullptr;
 
     /* function to start a server */
     int startServer() {
-        int err;
-
 #if _WIN32
         /* in case of windows, we need to initialize the sockets before
         working with the sockets hence requesting socket version of 2.2 */
@@ -63,144 +115,1396 @@ class DinoScale {
         WSADATA wsaData;
         WORD    windowsVersionRequested = MAKEWORD(2, 2);
 
-        err = WSAStartup(windowsVersionRequested, &wsaData) != 0;
+        int err = WSAStartup(windowsVersionRequested, &wsaData) != 0;
         if (err != 0) {
             exitWithError("WSAStartup failed");
             return 1;
         }
 #endif
 
-        sock = socket(AF_INET, SOCK_STREAM, 0);
+        sock = openListeningSocket();
         if (sock < 0) {
-            exitWithError("invalid socket");
             return 1;
         }
+        listeners.push_back(sock);
+        return 0;
+    }
 
-        err = bind(sock, (sockaddr*)&socketAddress, socketAddressLength);
+    /**
+     * @brief Creates a non-blocking socket bound to the server address. Every
+     * reactor binds its own socket to the same address with `SO_REUSEPORT`
+     * and the kernel spreads incoming connections across them.
+     */
+    SOCKET openListeningSocket() {
+        SOCKET listener =
+            socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listener < 0) {
+            exitWithError("invalid socket");
+            return -1;
+        }
+
+        // allows restarting the server while old connections are in TIME_WAIT
+        int enable = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+        int err =
+            bind(listener, (sockaddr*)&socketAddress, socketAddressLength);
         if (err < 0) {
             exitWithError("cannot connect socket to address");
-            return 1;
+            return -1;
         }
-        return 0;
+        return listener;
     }
 
     void closeServer() {
+        for (SOCKET listener : listeners) {
+#ifdef _WIN32
+            closesocket(listener);
+#else
+            close(listener);
+#endif
+        }
 #ifdef _WIN32
-        closesocket(sock);
-        closesocket(newSocket);
         WSACleanup();
 #endif
     }
 
-    void acceptConnection() {
-        newSocket =
-            accept(sock, (sockaddr*)&socketAddress, &socketAddressLength);
+    /**
+     * @brief Runs one reactor on the calling thread until it stops.
+     * @param index: Position of the reactor, used to pick its CPU.
+     */
+    void runReactor(SOCKET listener, unsigned index) {
+        if (options.pinWorkersToCores) {
+            unsigned cpuCount =
+                std::max(1u, std::thread::hardware_concurrency());
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(index % cpuCount, &cpus);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+                logger.Warn("cannot pin reactor {} to its core", index);
+            }
+        }
 
-        if (newSocket < 0) {
-            std::ostringstream oss;
-            oss << "Server failed to accept incoming connection from ADDRESS: "
-                << inet_ntoa(socketAddress.sin_addr)
-                << "; PORT: " << ntohs(socketAddress.sin_port);
-            exitWithError(oss.str());
+        threadMetrics = &metrics.AddShard();
+        ReactorConfig config;
+        config.listenFd = listener;
+        config.maxRequestSize = maxBufferSize;
+        config.timeouts.header = options.headerTimeout;
+        config.timeouts.body = options.bodyTimeout;
+        config.timeouts.keepAlive = options.keepAliveTimeout;
+        config.timeouts.write = options.writeTimeout;
+        config.maxConnections =
+            (options.maxConnections + listeners.size() - 1) / listeners.size();
+        config.preallocatedConnections = options.preallocatedConnections;
+        config.bufferCacheLimit = options.bufferPoolBudget;
+
+        RequestProcessor&        processor = *this;
+        std::unique_ptr<Reactor> reactor;
+        if (options.ioBackend == IOBackend::IOUring) {
+            auto uring = std::make_unique<UringReactor>(
+                config, processor, threadMetrics->Connections());
+            if (uring->IsValid()) {
+                reactor = std::move(uring);
+            } else {
+                logger.Warn("io_uring is unavailable, reactor {} uses epoll",
+                            index);
+            }
+        }
+        if (!reactor) {
+            reactor = std::make_unique<EpollReactor>(
+                config, processor, threadMetrics->Connections());
         }
+
+        Reactor* running = reactor.get();
+        {
+            std::lock_guard<std::mutex> guard(reactorsLock);
+            if (stopping) {
+                return;
+            }
+            reactors.push_back(std::move(reactor));
+        }
+        if (!running->Run()) {
+            exitWithError("event loop stopped unexpectedly");
+        }
+    }
+
+    /**
+     * @brief Queues a bodiless error response and closes the connection once it
+     * is written, the rest of the input can no longer be trusted.
+     */
+    void rejectRequest(Connection& connection, HTTPStatusCode status) {
+        threadMetrics->RecordRejected(status);
+        connection.Consume(connection.Input().size());
+        connection.Write(HTTPStatusLine(status));
+        connection.Write("Content-Length: 0\r\n");
+        endHead(connection, "Connection: close\r\n\r\n");
+        connection.CloseAfterWrite();
     }
 
-    void parseHttpRequest(const char* buffer, std::string& method,
-                          std::string& route, std::string& headers,
-                          std::string& body) {
-        std::string request(buffer);
-        std::size_t pos = request.find("\r\n\r\n");
+    /* queues the Date header and `connectionHeader`, which ends the head */
+    template <typename Output>
+    static void endHead(Output& output, std::string_view connectionHeader) {
+        output.Write(CachedDateHeader());
+        output.Write(connectionHeader);
+    }
 
-        if (pos == std::string::npos) {
-            exitWithError("invalid request: no end of headers found");
+    /**
+     * @brief Answers every complete request waiting in the connection input,
+     * in the order they arrived.
+     *
+     * Clients may pipeline several requests without waiting for the answers,
+     * all of them are handled from the same read. A request whose head is
+     * still incomplete stays in the input until more bytes arrive, while the
+     * body is streamed out of the input into the connection's `RequestBody`
+     * as it arrives.
+     * HTTP/1.1 connections are kept open unless the client asks otherwise or
+     * the connection reached `maxRequestsPerConnection`.
+     * A coroutine handler waiting for its body is fed from the input instead,
+     * the requests behind it wait until it finished.
+     * A connection starting with the HTTP/2 preface switches to an
+     * `HTTP2Session`, whose streams come back through `ProcessStream`, and
+     * one upgraded by a WebSocket route to a `WebSocket`.
+     */
+    void ProcessRequests(Connection& connection, Reactor& reactor) override {
+        if (connection.Protocol() != nullptr) {
+            connection.Protocol()->Process(connection, reactor);
+            return;
+        }
+        if (options.http2 && connection.RequestCount() == 0) {
+            std::string_view input = connection.Input();
+            std::size_t      compared =
+                std::min(input.size(), HTTP2Preface.size());
+            if (input.substr(0, compared) == HTTP2Preface.substr(0, compared)) {
+                if (compared < HTTP2Preface.size()) {
+                    return;  // the rest of the preface is on its way
+                }
+                StreamProcessor& processor = *this;
+                connection.SwitchProtocol(
+                    std::make_unique<HTTP2Session>(processor, http2Limits()));
+                connection.Protocol()->Process(connection, reactor);
+                return;
+            }
         }
 
-        headers = request.substr(0, pos);
-        body = request.substr(pos + 4);  // Skip the "\r\n\r\n" sequence
+        HTTPRequest& request = connection.Request();
+
+        while (!connection.IsCloseScheduled() && !connection.IsSuspended()) {
+            if (connection.Protocol() != nullptr) {
+                // upgraded by the request answered last
+                connection.Protocol()->Process(connection, reactor);
+                return;
+            }
+            if (connection.HasHandler()) {
+                if (connection.WaitingFor() != HandlerIO::Wait::Body ||
+                    !feedHandler(connection)) {
+                    return;
+                }
+                continue;
+            }
+
+            std::string_view input = connection.Input();
+
+            switch (connection.Parser().Parse(input, request)) {
+                case ParseStatus::Complete:
+                    break;
+                case ParseStatus::Incomplete:
+                    if (input.size() >= maxBufferSize) {
+                        rejectRequest(
+                            connection,
+                            HTTPStatusCode::Request_Header_Fields_Too_Large);
+                    }
+                    return;
+                case ParseStatus::Malformed:
+                    rejectRequest(connection, HTTPStatusCode::Bad_Request);
+                    return;
+                case ParseStatus::UnsupportedMethod:
+                    rejectRequest(connection,
+                                  HTTPStatusCode::Not_Implemented);
+                    return;
+            }
+
+            RequestBody& body = connection.Body();
+            if (!body.IsActive()) {
+                BodyStatus status = body.Begin(request, options.bodyLimits);
+                if (status != BodyStatus::Incomplete &&
+                    status != BodyStatus::Complete) {
+                    rejectBody(connection, status);
+                    return;
+                }
+
+                // the client waits for a go-ahead before sending the body
+                std::string_view expect = request.Header("Expect");
+                if (!expect.empty()) {
+                    if (!EqualsIgnoreCase(expect, "100-continue")) {
+                        rejectRequest(connection,
+                                      HTTPStatusCode::Expectation_Failed);
+                        return;
+                    }
+                    if (status == BodyStatus::Incomplete &&
+                        input.size() == request.HeadLength()) {
+                        connection.Write(
+                            HTTPStatusLine(HTTPStatusCode::Continue));
+                        connection.Write("\r\n");
+                    }
+                }
+
+                // a coroutine handler reads the body as it arrives
+                if (status == BodyStatus::Incomplete) {
+                    const Route* route = router.Match(request);
+                    if (route != nullptr && route->asyncHandler) {
+                        body.Stream();
+                        request.body = &body;
+                        startHandler(connection, *route,
+                                     countRequest(connection, request),
+                                     std::chrono::steady_clock::now());
+                        continue;
+                    }
+                }
+            }
+
+            // move the body bytes received so far out of the input, the head
+            // stays in front so the views of `request` remain valid
+            std::size_t consumed;
+            BodyStatus  status =
+                body.Feed(input.substr(request.HeadLength()), consumed);
+            connection.ConsumeAt(request.HeadLength(), consumed);
+
+            if (status == BodyStatus::Incomplete) {
+                return;  // the body is still on its way
+            }
+            if (status != BodyStatus::Complete) {
+                rejectBody(connection, status);
+                return;
+            }
+
+            bool keepAlive = countRequest(connection, request);
+
+            logger.Debug("{} {} received", request.MethodName(),
+                         request.Target());
+
+            request.body = &body;
+            auto started = std::chrono::steady_clock::now();
+            if (!prepareResponse(connection, reactor, request, keepAlive,
+                                 started)) {
+                continue;  // finished by the handler pool or coroutine
+            }
+            finishRequest(connection, keepAlive);
+        }
+    }
 
-        std::string line = headers.substr(0, request.find_first_of('\r'));
-        std::istringstream iss(line);
-        std::string        value;
+    /* counts a request on its connection, returns whether to keep it open */
+    bool countRequest(Connection& connection, const HTTPRequest& request) {
+        connection.CountRequest();
+        return request.KeepAlive() &&
+               (options.maxRequestsPerConnection == 0 ||
+                connection.RequestCount() < options.maxRequestsPerConnection);
+    }
 
-        int count = 0;
+    /**
+     * @brief Moves the body bytes received so far to the coroutine handler
+     * waiting for them and resumes it.
+     * @return true if the handler finished and the next request can be read.
+     */
+    bool feedHandler(Connection& connection) {
+        HTTPRequest& request = connection.Request();
+        RequestBody& body = connection.Body();
 
-        while (std::getline(iss, value, ' ')) {
-            logger.Log("value : " + value);
+        std::size_t consumed;
+        BodyStatus  status = body.Feed(
+            connection.Input().substr(request.HeadLength()), consumed);
+        connection.ConsumeAt(request.HeadLength(), consumed);
 
-            if (count == 0) {
-                // for the first iteration, the output is the http method
-                method = value;
-            } else if (count == 1) {
-                // for the second method the output is route
-                route = value;
+        if (status != BodyStatus::Incomplete &&
+            status != BodyStatus::Complete) {
+            bool streaming = connection.IsStreaming();
+            connection.DropHandler();
+            if (streaming) {
+                // too late for an error response
+                connection.CloseAfterWrite();
             } else {
-                // currently have no idea what is the use of the other
-                // parameters of header
+                rejectBody(connection, status);
+            }
+            return false;
+        }
+        if (status == BodyStatus::Incomplete && body.Chunk().empty()) {
+            return false;
+        }
+        connection.Wake();
+        return !connection.HasHandler();
+    }
+
+    /* runs the coroutine handler of `route` until it first waits */
+    void startHandler(Connection& connection, const Route& route,
+                      bool keepAlive,
+                      std::chrono::steady_clock::time_point started) {
+        HTTPRequest& request = connection.Request();
+        connection.beginExchange(keepAlive ? "Connection: keep-alive\r\n\r\n"
+                                           : "Connection: close\r\n\r\n",
+                                 request.VersionMinor() >= 1,
+                                 request.Method() == HTTPMethod::HEAD);
+        request.io = &connection;
+
+        FrameStack::Scope scope(connection.Frames());
+        Task<> task = serveAsync(connection, route, keepAlive, started);
+        connection.StartHandler(task.Release());
+    }
+
+    /**
+     * @brief Awaits the coroutine handler of `route` and queues its response,
+     * or ends the response it streamed. A handler leaving part of the body
+     * unread closes the connection, the rest cannot be skipped reliably.
+     */
+    Task<> serveAsync(Connection& connection, const Route& route,
+                      bool keepAlive,
+                      std::chrono::steady_clock::time_point started) {
+        HTTPRequest& request = connection.Request();
+        HTTPResponse response;
+        try {
+            response = co_await route.asyncHandler(request);
+        } catch (const std::exception& error) {
+            logger.Error("handler of {} failed: {}", route.pattern,
+                         error.what());
+            response.Clear();
+            response.SetStatus(HTTPStatusCode::Internal_Server_Error);
+        }
+
+        if (!connection.Body().IsComplete()) {
+            keepAlive = false;
+        }
+        HTTPStatusCode status = response.Status();
+        if (connection.IsStreaming()) {
+            status = connection.streamStatus;
+            if (!connection.chunked) {
+                keepAlive = false;  // the end of the body is the close
+            }
+            connection.endStream(response);
+        } else {
+            WriteResponse(connection, response,
+                          keepAlive ? "Connection: keep-alive\r\n\r\n"
+                                    : "Connection: close\r\n\r\n",
+                          request.Method() == HTTPMethod::HEAD);
+        }
+        recordRequest(&route, status, started);
+        finishRequest(connection, keepAlive);
+    }
+
+    /* drops the answered request from the connection */
+    void finishRequest(Connection& connection, bool keepAlive) {
+        connection.Consume(connection.Request().HeadLength());
+        connection.Body().Reset();
+        if (!keepAlive) {
+            connection.CloseAfterWrite();
+        }
+    }
+
+    /* maps a failed body onto its error response */
+    void rejectBody(Connection& connection, BodyStatus status) {
+        connection.Body().Reset();
+        switch (status) {
+            case BodyStatus::TooLarge:
+                rejectRequest(connection, HTTPStatusCode::Payload_Too_Large);
+                break;
+            case BodyStatus::FieldsTooLarge:
+                rejectRequest(connection,
+                              HTTPStatusCode::Request_Header_Fields_Too_Large);
+                break;
+            case BodyStatus::NotImplemented:
+                rejectRequest(connection, HTTPStatusCode::Not_Implemented);
+                break;
+            case BodyStatus::StorageFailed:
+                logger.Error("cannot spool request body");
+                rejectRequest(connection,
+                              HTTPStatusCode::Internal_Server_Error);
+                break;
+            default:
+                rejectRequest(connection, HTTPStatusCode::Bad_Request);
                 break;
+        }
+    }
+
+    /**
+     * @brief Queues the response to `request` on `connection`: the output of
+     * the route's handler or its static file. Paths without a route get
+     * `error.html` with a 404, or a 405 when another method has a route.
+     *
+     * @return false if the handler was handed to the pool. The connection is
+     * then suspended and the pool posts the response back to `reactor`, which
+     * keeps responses in request order as nothing else is read meanwhile.
+     * Also false for a coroutine handler, which runs on the reactor thread
+     * and finishes the request itself, and once the connection switched to
+     * a `WebSocket`.
+     */
+    bool prepareResponse(Connection& connection, Reactor& reactor,
+                         HTTPRequest& request, bool keepAlive,
+                         std::chrono::steady_clock::time_point started) {
+        std::string_view connectionHeader =
+            keepAlive ? "Connection: keep-alive\r\n\r\n"
+                      : "Connection: close\r\n\r\n";
+        bool headOnly = request.Method() == HTTPMethod::HEAD;
+
+        const Route* route = router.Match(request);
+        if (route == nullptr) {
+            HTTPStatusCode status =
+                answerUnrouted(connection, request, connectionHeader, headOnly);
+            recordRequest(nullptr, status, started);
+            return true;
+        }
+
+        if (route->webSocket) {
+            HTTPStatusCode status = upgradeWebSocket(
+                connection, reactor, request, *route, connectionHeader);
+            recordRequest(route, status, started);
+            if (status == HTTPStatusCode::Switching_Protocols) {
+                finishRequest(connection, true);
+                return false;
+            }
+            return true;
+        }
+
+        if (route->asyncHandler) {
+            startHandler(connection, *route, keepAlive, started);
+            return false;
+        }
+
+        if (route->asset != nullptr || route->bundle != nullptr) {
+            HTTPStatusCode status =
+                sendAsset(connection, request, *route, connectionHeader,
+                          headOnly);
+            recordRequest(route, status, started);
+            return true;
+        }
+
+        if (!route->handler) {
+            HTTPStatusCode status =
+                sendFile(connection, request, route->filePath, true,
+                         connectionHeader, headOnly);
+            recordRequest(route, status, started);
+            return true;
+        }
+
+        // the handler of a cached route only runs to fill the cache
+        std::string cacheKey;
+        if (responseCache != nullptr && route->cache.ttl.count() > 0 &&
+            (request.Method() == HTTPMethod::GET || headOnly)) {
+            makeCacheKey(cacheKey, *route, request);
+            std::shared_ptr<const CachedResponse> cached;
+            ResponseCache::Lookup lookup = responseCache->Find(
+                cacheKey, started, cached, [&] {
+                    connection.Suspend();
+                    return cacheWaiter(connection, reactor, *route,
+                                       connectionHeader, keepAlive, headOnly,
+                                       started);
+                });
+            if (lookup == ResponseCache::Lookup::Hit) {
+                threadMetrics->Connections().cacheHits.Add();
+                writeCached(connection, cached, connectionHeader, headOnly);
+                recordRequest(route, cached->status, started);
+                return true;
             }
-            count++;
+            if (lookup == ResponseCache::Lookup::Wait) {
+                threadMetrics->Connections().cacheCoalesced.Add();
+                return false;  // answered by the request filling the cache
+            }
+            threadMetrics->Connections().cacheMisses.Add();
+        }
+
+        if (handlerPool == nullptr) {
+            // reused, so its buffers are allocated once per reactor thread
+            thread_local HTTPResponse response;
+            response.Clear();
+            runHandler(*route, request, response);
+            HTTPStatusCode status = response.Status();
+            if (!cacheKey.empty()) {
+                writeCached(connection,
+                            fillCache(*route, cacheKey, response, true),
+                            connectionHeader, headOnly);
+            } else {
+                WriteResponse(connection, response, connectionHeader,
+                              headOnly);
+            }
+            recordRequest(route, status, started);
+            return true;
+        }
+
+        std::size_t queued = handlerPool->Pending();
+        if (options.maxQueuedHandlers != 0 &&
+            queued >= options.maxQueuedHandlers) {
+            thread_local HTTPResponse rejected;
+            rejected.Clear();
+            shedRequest(rejected);
+            if (!cacheKey.empty()) {
+                // the requests waiting for this one are refused as well
+                writeCached(connection,
+                            fillCache(*route, cacheKey, rejected, false),
+                            connectionHeader, headOnly);
+            } else {
+                WriteResponse(connection, rejected, connectionHeader,
+                              headOnly);
+            }
+            threadMetrics->Connections().shed.Add();
+            recordRequest(route, HTTPStatusCode::Service_Unavailable, started);
+            return true;
+        }
+        if (queued == 0) {
+            shedder->MarkEmpty(started);
         }
+
+        connection.Suspend();
+        handlerPool->Submit([this, &reactor, connection = &connection, route,
+                             connectionHeader, keepAlive, headOnly, started,
+                             cacheKey = std::move(cacheKey)] {
+            auto response = std::make_shared<HTTPResponse>();
+            bool admitted =
+                shedder->Admit(started, std::chrono::steady_clock::now());
+            if (admitted) {
+                runHandler(*route, connection->Request(), *response);
+            } else {
+                shedRequest(*response);
+            }
+            // filled here, so that waiting requests need not wait for this
+            // reactor to pick the response up
+            std::shared_ptr<const CachedResponse> cached;
+            if (!cacheKey.empty()) {
+                cached = fillCache(*route, cacheKey, *response, admitted);
+            }
+            reactor.Post(connection, [this, route, response, cached,
+                                      connectionHeader, keepAlive, headOnly,
+                                      admitted, started](Connection& owner) {
+                HTTPStatusCode status = response->Status();
+                if (cached != nullptr) {
+                    writeCached(owner, cached, connectionHeader, headOnly);
+                } else {
+                    WriteResponse(owner, *response, connectionHeader,
+                                  headOnly);
+                }
+                if (!admitted) {
+                    threadMetrics->Connections().shed.Add();
+                }
+                recordRequest(route, status, started);
+                finishRequest(owner, keepAlive);
+            });
+        });
+        return false;
     }
-    void sendResponse() {
-        int  bytesSent;
-        long totalBytesSent = 0;
 
-        while (totalBytesSent < serverMessage.size()) {
-            bytesSent =
-                send(newSocket, serverMessage.c_str(), serverMessage.size(), 0);
-            if (bytesSent < 0) {
+    /**
+     * @brief Answers the opening handshake of a WebSocket route. A valid one
+     * gets `101 Switching Protocols` and the connection switches to a
+     * `WebSocket`, the route's `onOpen` runs right away so it can send the
+     * first messages. Requests which are no upgrade get a 426 naming the
+     * protocol, the route only speaks WebSocket.
+     * @return the status answered.
+     */
+    HTTPStatusCode upgradeWebSocket(Connection& connection, Reactor& reactor,
+                                    const HTTPRequest& request,
+                                    const Route&       route,
+                                    std::string_view   connectionHeader) {
+        bool upgrade = request.Method() == HTTPMethod::GET &&
+                       request.VersionMinor() >= 1 &&
+                       HasToken(request.Header("Upgrade"), "websocket") &&
+                       HasToken(request.Header("Connection"), "upgrade");
+        std::string_view key = request.Header("Sec-WebSocket-Key");
+        if (upgrade && !IsWebSocketKey(key)) {
+            connection.Write(HTTPStatusLine(HTTPStatusCode::Bad_Request));
+            connection.Write("Content-Length: 0\r\n");
+            endHead(connection, connectionHeader);
+            return HTTPStatusCode::Bad_Request;
+        }
+        if (!upgrade || request.Header("Sec-WebSocket-Version") != "13") {
+            connection.Write(HTTPStatusLine(HTTPStatusCode::Upgrade_Required));
+            connection.Write(
+                "Upgrade: websocket\r\nSec-WebSocket-Version: 13\r\n"
+                "Content-Length: 0\r\n");
+            endHead(connection, connectionHeader);
+            return HTTPStatusCode::Upgrade_Required;
+        }
+
+        std::string head(HTTPStatusLine(HTTPStatusCode::Switching_Protocols));
+        head += "Upgrade: websocket\r\nSec-WebSocket-Accept: ";
+        AppendWebSocketAccept(head, key);
+        head += "\r\n";
+        connection.Write(head);
+        endHead(connection, "Connection: Upgrade\r\n\r\n");
+
+        auto session = std::make_unique<WebSocket>(
+            connection, reactor, *route.webSocket,
+            threadMetrics->Connections(), webSocketLimits());
+        WebSocket& socket = *session;
+        connection.SwitchProtocol(std::move(session));
+        socket.Open(request);
+        return HTTPStatusCode::Switching_Protocols;
+    }
+
+    /* limits of the WebSocket connections, from the server options */
+    WebSocketLimits webSocketLimits() const {
+        WebSocketLimits limits;
+        limits.maxMessageSize = options.webSocketMaxMessageSize;
+        limits.maxQueuedBytes = options.webSocketMaxQueuedBytes;
+        limits.idleTimeout = options.webSocketIdleTimeout;
+        return limits;
+    }
+
+    /* limits of the HTTP/2 sessions, from the server options */
+    HTTP2Limits http2Limits() const {
+        HTTP2Limits limits;
+        limits.maxConcurrentStreams = options.http2MaxStreams;
+        limits.maxHeaderListSize = maxBufferSize;
+        limits.maxRequests = options.maxRequestsPerConnection;
+        limits.bodyLimits = options.bodyLimits;
+        return limits;
+    }
+
+    /* collects the response of an HTTP/2 stream, reused per reactor thread */
+    static StreamOutput& streamOutput() {
+        thread_local StreamOutput output;
+        output.Clear();
+        return output;
+    }
+
+    /**
+     * @brief Answers the request of an HTTP/2 stream like `prepareResponse`
+     * answers one of HTTP/1.1, through the same routes, caches and handler
+     * pool, with heads ending without a `Connection` field. Other streams
+     * of the connection are served meanwhile, so the connection is only
+     * suspended to keep it alive until a response computed elsewhere is
+     * posted back. Coroutine handlers and WebSockets own the connection
+     * they run on and are refused with `HTTP_1_1_REQUIRED`, the client
+     * retries over HTTP/1.1.
+     */
+    void ProcessStream(Connection& connection, Reactor& reactor,
+                       HTTP2Session&                       session,
+                       const std::shared_ptr<HTTP2Stream>& stream) override {
+        HTTPRequest& request = stream->Request();
+        connection.CountRequest();
+        logger.Debug("{} {} received on stream {}", request.MethodName(),
+                     request.Target(), stream->Id());
+
+        auto started = std::chrono::steady_clock::now();
+        bool headOnly = request.Method() == HTTPMethod::HEAD;
+
+        const Route* route = router.Match(request);
+        if (route != nullptr && (route->asyncHandler || route->webSocket)) {
+            session.Reset(connection, *stream, HTTP2Error::HTTP11Required);
+            return;
+        }
+        if (route == nullptr || route->asset != nullptr ||
+            route->bundle != nullptr || !route->handler) {
+            StreamOutput&  output = streamOutput();
+            HTTPStatusCode status;
+            if (route == nullptr) {
+                status = answerUnrouted(output, request, "\r\n", headOnly);
+            } else if (route->asset != nullptr || route->bundle != nullptr) {
+                status = sendAsset(output, request, *route, "\r\n", headOnly);
+            } else {
+                status = sendFile(output, request, route->filePath, true,
+                                  "\r\n", headOnly);
+            }
+            session.Respond(connection, *stream, output);
+            recordRequest(route, status, started);
+            return;
+        }
+
+        // the handler of a cached route only runs to fill the cache
+        std::string cacheKey;
+        if (responseCache != nullptr && route->cache.ttl.count() > 0 &&
+            (request.Method() == HTTPMethod::GET || headOnly)) {
+            makeCacheKey(cacheKey, *route, request);
+            std::shared_ptr<const CachedResponse> cached;
+            ResponseCache::Lookup lookup = responseCache->Find(
+                cacheKey, started, cached, [&] {
+                    connection.Suspend();
+                    return [this, &reactor, &session, connection = &connection,
+                            stream, route, headOnly, started](
+                               const std::shared_ptr<const CachedResponse>&
+                                   filled) {
+                        reactor.Post(connection, [this, &session, stream, route,
+                                                  filled, headOnly,
+                                                  started](Connection& owner) {
+                            StreamOutput& output = streamOutput();
+                            writeCached(output, filled, "\r\n", headOnly);
+                            session.Respond(owner, *stream, output);
+                            recordRequest(route, filled->status, started);
+                        });
+                    };
+                });
+            if (lookup == ResponseCache::Lookup::Hit) {
+                threadMetrics->Connections().cacheHits.Add();
+                StreamOutput& output = streamOutput();
+                writeCached(output, cached, "\r\n", headOnly);
+                session.Respond(connection, *stream, output);
+                recordRequest(route, cached->status, started);
+                return;
+            }
+            if (lookup == ResponseCache::Lookup::Wait) {
+                threadMetrics->Connections().cacheCoalesced.Add();
+                return;  // answered by the request filling the cache
+            }
+            threadMetrics->Connections().cacheMisses.Add();
+        }
+
+        if (handlerPool == nullptr) {
+            thread_local HTTPResponse response;
+            response.Clear();
+            runHandler(*route, request, response);
+            HTTPStatusCode status = response.Status();
+            StreamOutput&  output = streamOutput();
+            if (!cacheKey.empty()) {
+                writeCached(output, fillCache(*route, cacheKey, response, true),
+                            "\r\n", headOnly);
+            } else {
+                WriteResponse(output, response, "\r\n", headOnly);
+            }
+            session.Respond(connection, *stream, output);
+            recordRequest(route, status, started);
+            return;
+        }
+
+        std::size_t queued = handlerPool->Pending();
+        if (options.maxQueuedHandlers != 0 &&
+            queued >= options.maxQueuedHandlers) {
+            thread_local HTTPResponse rejected;
+            rejected.Clear();
+            shedRequest(rejected);
+            StreamOutput& output = streamOutput();
+            if (!cacheKey.empty()) {
+                writeCached(output,
+                            fillCache(*route, cacheKey, rejected, false),
+                            "\r\n", headOnly);
+            } else {
+                WriteResponse(output, rejected, "\r\n", headOnly);
+            }
+            session.Respond(connection, *stream, output);
+            threadMetrics->Connections().shed.Add();
+            recordRequest(route, HTTPStatusCode::Service_Unavailable, started);
+            return;
+        }
+        if (queued == 0) {
+            shedder->MarkEmpty(started);
+        }
+
+        // the session lives as long as the connection, which the suspension
+        // keeps open until the response is posted back
+        connection.Suspend();
+        handlerPool->Submit([this, &reactor, &session, connection = &connection,
+                             stream, route, headOnly, started,
+                             cacheKey = std::move(cacheKey)] {
+            auto response = std::make_shared<HTTPResponse>();
+            bool admitted =
+                shedder->Admit(started, std::chrono::steady_clock::now());
+            if (admitted) {
+                runHandler(*route, stream->Request(), *response);
+            } else {
+                shedRequest(*response);
+            }
+            std::shared_ptr<const CachedResponse> cached;
+            if (!cacheKey.empty()) {
+                cached = fillCache(*route, cacheKey, *response, admitted);
+            }
+            reactor.Post(connection, [this, &session, stream, route, response,
+                                      cached, headOnly, admitted,
+                                      started](Connection& owner) {
+                HTTPStatusCode status = response->Status();
+                StreamOutput&  output = streamOutput();
+                if (cached != nullptr) {
+                    writeCached(output, cached, "\r\n", headOnly);
+                } else {
+                    WriteResponse(output, *response, "\r\n", headOnly);
+                }
+                session.Respond(owner, *stream, output);
+                if (!admitted) {
+                    threadMetrics->Connections().shed.Add();
+                }
+                recordRequest(route, status, started);
+            });
+        });
+    }
+
+    /* answers an HTTP/2 stream whose request is refused before routing */
+    void RejectStream(Connection& connection, HTTP2Session& session,
+                      HTTP2Stream& stream, HTTPStatusCode status) override {
+        threadMetrics->RecordRejected(status);
+        StreamOutput& output = streamOutput();
+        output.Write(HTTPStatusLine(status));
+        output.Write("Content-Length: 0\r\n");
+        endHead(output, "\r\n");
+        session.Respond(connection, stream, output);
+    }
+
+    /* answers a path without a route: `error.html` with a 404, or a 405
+     * when another method has a route */
+    template <typename Output>
+    HTTPStatusCode answerUnrouted(Output& output, const HTTPRequest& request,
+                                  std::string_view connectionHeader,
+                                  bool             headOnly) {
+        std::string allowed = router.AllowedMethods(request.Path());
+        if (allowed.empty()) {
+            return sendFile(output, request, "error.html", false,
+                            connectionHeader, headOnly);
+        }
+        output.Write(HTTPStatusLine(HTTPStatusCode::Method_Not_Allowed));
+        output.Write("Allow: ");
+        output.Write(allowed);
+        output.Write("\r\nContent-Length: 0\r\n");
+        endHead(output, connectionHeader);
+        return HTTPStatusCode::Method_Not_Allowed;
+    }
+
+    /* the response cache key of `request` to `route`: the route, which
+     * stands for the method, the target and the varying header values */
+    static void makeCacheKey(std::string& key, const Route& route,
+                             const HTTPRequest& request) {
+        key.assign(std::to_string(route.index));
+        key.push_back(' ');
+        key.append(request.Target());
+        for (const std::string& header : route.cache.varyHeaders) {
+            key.push_back('\n');  // never part of a header value
+            key.append(request.Header(header));
+        }
+    }
+
+    /**
+     * @brief Stores the response of the handler which ran for `key` in the
+     * response cache, unless `store` is false or it is not a 200, and passes
+     * it to the requests waiting for it.
+     */
+    std::shared_ptr<const CachedResponse> fillCache(const Route&       route,
+                                                    const std::string& key,
+                                                    HTTPResponse&      response,
+                                                    bool               store) {
+        std::shared_ptr<const CachedResponse> cached =
+            CachedResponse::From(response);
+        responseCache->Complete(
+            key, cached, std::chrono::steady_clock::now() + route.cache.ttl,
+            store && cached->status == HTTPStatusCode::OK);
+        return cached;
+    }
+
+    /* queues a response from the response cache */
+    template <typename Output>
+    static void writeCached(
+        Output& output, const std::shared_ptr<const CachedResponse>& cached,
+        std::string_view connectionHeader, bool headOnly) {
+        output.Write(cached->head);
+        endHead(output, connectionHeader);
+        if (!headOnly && !cached->body.empty()) {
+            output.WriteShared(cached->body, cached);
+        }
+    }
+
+    /**
+     * @brief Answers the suspended `connection` with the response another
+     * request produces for the same cache key, on the thread producing it.
+     */
+    ResponseCache::Waiter cacheWaiter(
+        Connection& connection, Reactor& reactor, const Route& route,
+        std::string_view connectionHeader, bool keepAlive, bool headOnly,
+        std::chrono::steady_clock::time_point started) {
+        return [this, &reactor, connection = &connection, route = &route,
+                connectionHeader, keepAlive, headOnly,
+                started](const std::shared_ptr<const CachedResponse>& cached) {
+            reactor.Post(connection, [this, route, cached, connectionHeader,
+                                      keepAlive, headOnly,
+                                      started](Connection& owner) {
+                writeCached(owner, cached, connectionHeader, headOnly);
+                recordRequest(route, cached->status, started);
+                finishRequest(owner, keepAlive);
+            });
+        };
+    }
+
+    /* turns `response` into the answer to a request refused for overload */
+    void shedRequest(HTTPResponse& response) {
+        response.SetStatus(HTTPStatusCode::Service_Unavailable);
+        response.SetHeader("Retry-After", retryAfter);
+    }
+
+    /* records the latency of a request whose response was just queued */
+    void recordRequest(const Route* route, HTTPStatusCode status,
+                       std::chrono::steady_clock::time_point started) {
+        threadMetrics->RecordRequest(
+            route != nullptr ? route->index : router.RouteCount(), status,
+            std::chrono::steady_clock::now() - started);
+    }
+
+    /* calls the handler of `route`, a throwing handler yields a 500 */
+    void runHandler(const Route& route, const HTTPRequest& request,
+                    HTTPResponse& response) {
+        try {
+            route.handler(request, response);
+        } catch (const std::exception& error) {
+            logger.Error("handler of {} failed: {}", route.pattern,
+                         error.what());
+            response.Clear();
+            response.SetStatus(HTTPStatusCode::Internal_Server_Error);
+        }
+    }
+
+    /* validators and type of a static file, from the cache or its inode */
+    struct FileVersion {
+        std::size_t      size;
+        std::string_view etag;
+        std::string_view lastModified;
+        std::string_view contentType;
+        std::time_t      modified;
+        std::string_view contentEncoding;  // empty for identity
+        bool             varies;  // other codings exist, see `Vary`
+    };
+
+    /* queues `name` followed by the decimal `value` and CRLF */
+    template <typename Output>
+    static void writeNumberField(Output& output, std::string_view name,
+                                 std::size_t value) {
+        char  line[64];
+        char* end = std::copy(name.begin(), name.end(), line);
+        end = std::to_chars(end, line + sizeof(line) - 2, value).ptr;
+        *end++ = '\r';
+        *end++ = '\n';
+        output.Write(std::string_view(line, end - line));
+    }
+
+    /* formats `Content-Range: bytes first-last/size` and CRLF into `out`,
+     * which holds at least 96 characters, and returns its length */
+    static std::size_t formatContentRange(char* out, const ByteRange& range,
+                                          std::size_t size) {
+        std::string_view prefix = "Content-Range: bytes ";
+        char* end = std::copy(prefix.begin(), prefix.end(), out);
+        end = std::to_chars(end, out + 96, range.offset).ptr;
+        *end++ = '-';
+        end = std::to_chars(end, out + 96, range.offset + range.length - 1)
+                  .ptr;
+        *end++ = '/';
+        end = std::to_chars(end, out + 96, size).ptr;
+        *end++ = '\r';
+        *end++ = '\n';
+        return end - out;
+    }
+
+    template <typename Output>
+    static void writeValidators(Output& output, const FileVersion& file) {
+        output.Write("ETag: ");
+        output.Write(file.etag);
+        output.Write("\r\nLast-Modified: ");
+        output.Write(file.lastModified);
+        output.Write("\r\n");
+        if (file.varies) {
+            output.Write("Vary: Accept-Encoding\r\n");
+        }
+    }
+
+    /* queues the Content-Type and Content-Encoding lines of `file` */
+    template <typename Output>
+    static void writeRepresentation(Output& output, const FileVersion& file) {
+        output.Write("Content-Type: ");
+        output.Write(file.contentType);
+        output.Write("\r\n");
+        if (!file.contentEncoding.empty()) {
+            output.Write("Content-Encoding: ");
+            output.Write(file.contentEncoding);
+            output.Write("\r\n");
+        }
+    }
+
+    /**
+     * @brief Answers a GET or HEAD of a static file without sending the whole
+     * file when the request allows it: 304 if the client's copy is current
+     * according to `If-None-Match` or `If-Modified-Since`, 206 with the
+     * requested parts if `Range` names satisfiable byte ranges and any
+     * `If-Range` still matches, 416 if all of them lie beyond the end.
+     * Several ranges are sent as `multipart/byteranges`.
+     *
+     * @param writeBody: Called as `writeBody(offset, length, last)` to queue
+     * bytes of the file, `last` on its final call.
+     * @return false if the whole file is to be sent, nothing is queued then.
+     */
+    template <typename Output, typename BodyWriter>
+    bool answerConditional(Output& output, const HTTPRequest& request,
+                           const FileVersion& file,
+                           std::string_view connectionHeader, bool headOnly,
+                           BodyWriter&& writeBody, HTTPStatusCode& status) {
+        if (IsNotModified(request.Header("If-None-Match"),
+                          request.Header("If-Modified-Since"), file.etag,
+                          file.modified)) {
+            status = HTTPStatusCode::Not_Modified;
+            output.Write(HTTPStatusLine(status));
+            writeValidators(output, file);
+            endHead(output, connectionHeader);
+            return true;
+        }
+
+        std::string_view rangeHeader = request.Header("Range");
+        if (headOnly || rangeHeader.empty() ||
+            !IfRangeMatches(request.Header("If-Range"), file.etag,
+                            file.modified)) {
+            return false;
+        }
+
+        // reused, so parsing ranges allocates once per reactor thread
+        thread_local ByteRanges ranges;
+        RangeStatus             rangeStatus = ParseByteRanges(
+            rangeHeader, file.size, options.maxByteRanges, ranges);
+        if (rangeStatus == RangeStatus::Ignored) {
+            return false;
+        }
+        if (rangeStatus == RangeStatus::Unsatisfiable) {
+            status = HTTPStatusCode::Range_Not_Satisfiable;
+            output.Write(HTTPStatusLine(status));
+            writeNumberField(output, "Content-Range: bytes */", file.size);
+            output.Write("Content-Length: 0\r\n");
+            endHead(output, connectionHeader);
+            return true;
+        }
+
+        status = HTTPStatusCode::Partial_Content;
+        output.Write(HTTPStatusLine(status));
+        char contentRange[96];
+
+        if (ranges.size() == 1) {
+            const ByteRange& range = ranges[0];
+            writeRepresentation(output, file);
+            writeNumberField(output, "Content-Length: ", range.length);
+            output.Write(std::string_view(
+                contentRange,
+                formatContentRange(contentRange, range, file.size)));
+            writeValidators(output, file);
+            endHead(output, connectionHeader);
+            writeBody(range.offset, range.length, true);
+            return true;
+        }
+
+        // every part is preceded by its own head naming the range
+        thread_local std::mt19937_64 random{std::random_device{}()};
+        char                         boundary[16];
+        std::uint64_t                bits = random();
+        for (char& digit : boundary) {
+            digit = "0123456789abcdef"[bits & 15];
+            bits >>= 4;
+        }
+        std::string_view boundaryView(boundary, sizeof(boundary));
+        std::string_view partType = "\r\nContent-Type: ";
+
+        std::size_t partFixed =
+            4 + boundaryView.size() + partType.size() +
+            file.contentType.size() + 2 + 2;  // CRLF "--" ... CRLF CRLF
+        std::size_t length = 4 + boundaryView.size() + 4;  // closing line
+        for (const ByteRange& range : ranges) {
+            length += partFixed +
+                      formatContentRange(contentRange, range, file.size) +
+                      range.length;
+        }
+
+        output.Write("Content-Type: multipart/byteranges; boundary=");
+        output.Write(boundaryView);
+        output.Write("\r\n");
+        if (!file.contentEncoding.empty()) {
+            // the ranges count bytes of the encoded file
+            output.Write("Content-Encoding: ");
+            output.Write(file.contentEncoding);
+            output.Write("\r\n");
+        }
+        writeNumberField(output, "Content-Length: ", length);
+        writeValidators(output, file);
+        endHead(output, connectionHeader);
+
+        for (std::size_t i = 0; i < ranges.size(); i++) {
+            output.Write("\r\n--");
+            output.Write(boundaryView);
+            output.Write(partType);
+            output.Write(file.contentType);
+            output.Write("\r\n");
+            output.Write(std::string_view(
+                contentRange,
+                formatContentRange(contentRange, ranges[i], file.size)));
+            output.Write("\r\n");
+            writeBody(ranges[i].offset, ranges[i].length,
+                      i + 1 == ranges.size());
+        }
+        output.Write("\r\n--");
+        output.Write(boundaryView);
+        output.Write("--\r\n");
+        return true;
+    }
+
+    /**
+     * @brief Queues `length` bytes of `file` starting at `offset`. The
+     * descriptor is handed over to the output unless `keepFile`, when
+     * further parts of the same file follow.
+     */
+    template <typename Output>
+    void writeFileBytes(Output& output, FileDescriptor& file, off_t offset,
+                        std::size_t length, bool keepFile) {
+        if (length >= options.sendfileThreshold) {
+            // the kernel copies the pages to the socket as it drains
+            FileDescriptor source =
+                keepFile ? FileDescriptor(fcntl(file.Get(), F_DUPFD_CLOEXEC, 0))
+                         : std::move(file);
+            if (!source.IsValid()) {
+                // the announced length can no longer be honoured
+                output.CloseAfterWrite();
+                return;
+            }
+            output.WriteFile(std::move(source), offset, length);
+            return;
+        }
+
+        std::string content(length, '\0');
+        std::size_t total = 0;
+        while (total < length) {
+            ssize_t bytesRead = pread(file.Get(), content.data() + total,
+                                      length - total, offset + total);
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytesRead <= 0) {
                 break;
             }
-            totalBytesSent += bytesSent;
+            total += bytesRead;
+        }
+        if (total < length) {
+            // the announced length can no longer be honoured
+            output.CloseAfterWrite();
+        }
+        content.resize(total);
+        output.Write(std::move(content));
+    }
+
+    /**
+     * @brief Picks the cached representation of `fileName` in the best coding
+     * `request` accepts, preferring brotli over gzip.
+     * @return nullptr if the identity is to be sent.
+     */
+    std::shared_ptr<const CachedFile> cachedEncoding(
+        const HTTPRequest& request, const std::string& fileName) {
+        std::string_view accepted = request.Header("Accept-Encoding");
+        if (accepted.empty() || !IsCompressible(MimeTypeForPath(fileName))) {
+            return nullptr;
+        }
+        for (ContentCoding coding :
+             {ContentCoding::Brotli, ContentCoding::Gzip}) {
+            if (AcceptsCoding(accepted, coding)) {
+                std::shared_ptr<const CachedFile> file =
+                    fileCache->Get(fileName, coding);
+                if (file != nullptr) {
+                    return file;
+                }
+            }
         }
+        return nullptr;
+    }
 
-        if (totalBytesSent == serverMessage.size()) {
-            logger.Log("------ Server Response sent to client ------");
-        } else {
-            logger.Log("Error sending response to client.");
+    /**
+     * @brief Opens the precompressed sibling of `fileName` in the best coding
+     * `request` accepts, for files the cache does not hold.
+     * @return ContentCoding::Identity if there is none, `file` is not
+     * touched then.
+     */
+    static ContentCoding openEncoding(const HTTPRequest& request,
+                                      const std::string& fileName,
+                                      FileDescriptor&    file) {
+        std::string_view accepted = request.Header("Accept-Encoding");
+        if (accepted.empty() || !IsCompressible(MimeTypeForPath(fileName))) {
+            return ContentCoding::Identity;
+        }
+        for (ContentCoding coding :
+             {ContentCoding::Brotli, ContentCoding::Gzip}) {
+            if (AcceptsCoding(accepted, coding)) {
+                std::string sibling = fileName;
+                sibling.append(ContentCodingSuffix(coding));
+                FileDescriptor encoded(
+                    open(sibling.c_str(), O_RDONLY | O_CLOEXEC));
+                struct stat info;
+                if (encoded.IsValid() && fstat(encoded.Get(), &info) == 0 &&
+                    S_ISREG(info.st_mode)) {
+                    file = std::move(encoded);
+                    return coding;
+                }
+            }
         }
+        return ContentCoding::Identity;
     }
 
-    void prepareResponse(HTTPMethod method, std::string route,
-                         std::string body) {
-        if (method == HTTPMethod::GET) {
-            std::string        htmlFile;
-            std::ostringstream oss;
-            std::stringstream  strStream;
-            std::ifstream      requestedFile;
-            std::string        fileName = "error.html";
+    /**
+     * @brief Queues `fileName` with a 200 status when `found`, 404 otherwise.
+     * Found files also answer conditional and range requests, see
+     * `answerConditional`, and are sent compressed when the client accepts
+     * it: from a `.br` or `.gz` sibling if there is one, otherwise gzip
+     * compressed once by the static file cache.
+     * @param headOnly: Leaves out the body to answer a `HEAD` request.
+     * @return Status of the queued response.
+     */
+    template <typename Output>
+    HTTPStatusCode sendFile(Output& output, const HTTPRequest& request,
+                            const std::string& fileName, bool found,
+                            std::string_view connectionHeader, bool headOnly) {
+        HTTPStatusCode status =
+            found ? HTTPStatusCode::OK : HTTPStatusCode::Not_Found;
+        std::shared_ptr<const CachedFile> file;
+        if (fileCache) {
+            file = found ? cachedEncoding(request, fileName) : nullptr;
+            if (file == nullptr) {
+                file = fileCache->Get(fileName);
+            }
+        }
+        if (file != nullptr) {
+            // the header was serialized when the file entered the cache and
+            // the body is sent from the cache, kept alive by `file`
+            if (found) {
+                FileVersion version{file->body.size(), file->etag,
+                                    file->lastModified, file->contentType,
+                                    file->modified.tv_sec,
+                                    file->contentEncoding, file->varies};
+                auto writeBody = [&](std::size_t offset, std::size_t length,
+                                     bool) {
+                    output.WriteShared(
+                        std::string_view(file->body).substr(offset, length),
+                        file);
+                };
+                if (answerConditional(output, request, version,
+                                      connectionHeader, headOnly, writeBody,
+                                      status)) {
+                    return status;
+                }
+                output.Write(file->header);
+            } else {
+                output.Write(HTTPStatusLine(HTTPStatusCode::Not_Found));
+                output.Write(file->Fields());
+            }
+            endHead(output, connectionHeader);
+            if (!headOnly) {
+                output.WriteShared(file->body, file);
+            }
+            return status;
+        }
+
+        // not cacheable, served straight from the file
+        FileDescriptor requestedFile;
+        ContentCoding  coding =
+            found ? openEncoding(request, fileName, requestedFile)
+                  : ContentCoding::Identity;
+        if (coding == ContentCoding::Identity) {
+            requestedFile =
+                FileDescriptor(open(fileName.c_str(), O_RDONLY | O_CLOEXEC));
+        }
+        struct stat info;
+        if (!requestedFile.IsValid() ||
+            fstat(requestedFile.Get(), &info) != 0 ||
+            !S_ISREG(info.st_mode)) {
+            output.Write(HTTPStatusLine(HTTPStatusCode::Not_Found));
+            output.Write("Content-Length: 0\r\n");
+            endHead(output, connectionHeader);
+            return HTTPStatusCode::Not_Found;
+        }
 
-            oss << "HTTP/1.1 200 OK\nContent-Type: text/html\nContent-Length: ";
+        std::size_t size = info.st_size;
+        std::string      etag = MakeETag(size, info.st_mtim, coding);
+        char             date[32];
+        std::string_view lastModified(
+            date, FormatHTTPDate(info.st_mtim.tv_sec, date));
+        std::string_view contentType = MimeTypeForPath(fileName);
+        std::string_view contentEncoding;
+        if (coding != ContentCoding::Identity) {
+            contentEncoding = ContentCodingName(coding);
+        }
+        FileVersion version{size, etag, lastModified, contentType,
+                            info.st_mtim.tv_sec, contentEncoding,
+                            IsCompressible(contentType)};
 
-            int verbPosition = method;
+        if (found) {
+            auto writeBody = [&](std::size_t offset, std::size_t length,
+                                 bool last) {
+                writeFileBytes(output, requestedFile, offset, length, !last);
+            };
+            if (answerConditional(output, request, version, connectionHeader,
+                                  headOnly, writeBody, status)) {
+                return status;
+            }
+        }
 
-            std::unordered_map<std::string, std::string>& routeToFileMap =
-                routeToFileMapList[verbPosition];
+        output.Write(HTTPStatusLine(status));
+        writeRepresentation(output, version);
+        writeNumberField(output, "Content-Length: ", size);
+        writeValidators(output, version);
+        output.Write("Accept-Ranges: bytes\r\n");
+        endHead(output, connectionHeader);
 
-            for (auto routeToFile : routeToFileMap)
-                std::cout << routeToFile.first << " " << routeToFile.second
-                          << std::endl;
+        if (!headOnly) {
+            writeFileBytes(output, requestedFile, 0, size, false);
+        }
+        return status;
+    }
 
-            logger.Log("route is " + route + ".");
-            if (routeToFileMap.find(route) != routeToFileMap.end()) {
-                fileName = routeToFileMap.at(route);
+    /**
+     * @brief Queues the embedded asset of `route`, or the one of its bundle
+     * named by the `*asset` capture, `index.html` for a directory. A missing
+     * asset is answered with the bundle's `error.html` and a 404 status.
+     * Header and body were laid out at build time and are sent without
+     * copying, conditional and range requests are answered like for files.
+     * @return Status of the queued response.
+     */
+    template <typename Output>
+    HTTPStatusCode sendAsset(Output& output, const HTTPRequest& request,
+                             const Route& route,
+                             std::string_view connectionHeader,
+                             bool             headOnly) {
+        const EmbeddedAsset* asset = route.asset;
+        if (asset == nullptr) {
+            std::string_view path = request.Param("asset");
+            if (path.empty() || path.back() == '/') {
+                // reused, so directory lookups allocate once per thread
+                thread_local std::string index;
+                index.assign(path);
+                index.append("index.html");
+                asset = route.bundle->Find(index);
+            } else {
+                asset = route.bundle->Find(path);
             }
-            requestedFile.open(fileName, std::ios::in);
+        }
 
-            if (requestedFile
-                    .is_open()) {  // always check whether the file is open
-                strStream << requestedFile.rdbuf();  // read the file
+        if (asset == nullptr) {
+            const EmbeddedAsset* error = route.bundle->Find("error.html");
+            output.Write(HTTPStatusLine(HTTPStatusCode::Not_Found));
+            if (error == nullptr) {
+                output.Write("Content-Length: 0\r\n");
+                endHead(output, connectionHeader);
+                return HTTPStatusCode::Not_Found;
             }
-            htmlFile = strStream.str();
-            // log(htmlFile);
-            oss << htmlFile.size() << "\n\n" << htmlFile;
+            output.Write(error->Fields());
+            endHead(output, connectionHeader);
+            if (!headOnly) {
+                output.WriteShared(error->body, nullptr);
+            }
+            return HTTPStatusCode::Not_Found;
+        }
 
-            serverMessage = oss.str();
-            // htmlFile.clear();
-        } else if (method == HTTPMethod::POST) {
-        } else if (method == HTTPMethod::PUT) {
-        } else if (method == HTTPMethod::DELETE) {
+        HTTPStatusCode status = HTTPStatusCode::OK;
+        FileVersion    version{asset->body.size(), asset->etag,
+                            asset->lastModified, asset->contentType,
+                            asset->modified,     {},
+                            false};
+        auto writeBody = [&](std::size_t offset, std::size_t length, bool) {
+            output.WriteShared(asset->body.substr(offset, length), nullptr);
+        };
+        if (answerConditional(output, request, version, connectionHeader,
+                              headOnly, writeBody, status)) {
+            return status;
+        }
+        output.WriteShared(asset->header, nullptr);
+        endHead(output, connectionHeader);
+        if (!headOnly) {
+            output.WriteShared(asset->body, nullptr);
+        }
+        return status;
+    }
+
+    void addRoute(HTTPMethod method, const std::string& pattern, Route route) {
+        if (listening) {
+            exitWithError("routes cannot be added while listening");
+        }
+        if (!router.Add(method, pattern, std::move(route))) {
+            exitWithError("route " + pattern +
+                          " is invalid or already defined");
         }
+        logger.Debug("route {} added", pattern);
     }
 
     void exitWithError(std::string errorMessage) {
@@ -208,89 +1512,203 @@ class DinoScale {
         log(WSAGetLastError());
 #endif
 
-        logger.Log(errorMessage, LogLevel::Error);
+        logger.Error("{}", errorMessage);
         exit(1);
     }
 
    public:
     DinoScale(std::string machineIpAddress = "127.0.0.1", u_short port = 6969)
-        : machineIpAddress(machineIpAddress) {
-        // TODO :: Fix how to dereference shared_ptr in cpp
-        this->logger = Logger::GetInstance();
-
+        : logger(*Logger::GetInstance()), machineIpAddress(machineIpAddress) {
         socketAddress.sin_family = AF_INET;
         socketAddress.sin_port = htons(port);
         socketAddress.sin_addr.s_addr =
             inet_addr(this->machineIpAddress.c_str());
         socketAddressLength = sizeof(socketAddress);
 
-        // routeToFileMapList = new std::unordered_map<std::string,
-        // std::string>[httpVerbToNumberMapping.size()];
-
         int serverStartingError = startServer();
         if (serverStartingError != 0) {
-            std::ostringstream oss;
-            oss << "Failed to start server with PORT: "
-                << ntohs(socketAddress.sin_port);
-            logger.Log(oss.str());
+            logger.Error("Failed to start server with PORT: {}",
+                         ntohs(socketAddress.sin_port));
         };
     }
+    /**
+     * @brief Replaces the server tunables, must be called before
+     * `startListening`.
+     */
+    void SetOptions(const ServerOptions& serverOptions) {
+        if (listening) {
+            exitWithError("options cannot change once the server is listening");
+        }
+        options = serverOptions;
+    }
+
+    /**
+     * @brief Serves the static file at `path` for requests matching `route`.
+     * Routes may capture segments, e.g. `/users/:id`, see `Router`.
+     */
     void createRoute(HTTPMethod method, std::string route, std::string path) {
-        // todo : need to cause an error if unknown http verb is used
-        // if (httpVerbToNumberMapping.find(method) ==
-        // httpVerbToNumberMapping.end()) {
-        //     log("here");
-        //     exitWithError("http verb not defined");
-        // }
-
-        // log("create routes");
-        // int verbPosition = httpVerbToNumberMapping.at(method);
-        // if (routeToFileMapList[verbPosition].find(route) !=
-        //     routeToFileMapList[verbPosition].end()) {
-        //     exitWithError("route " + route + " is already defined");
-        // } else {
-        //     log("route " + route + " added");
-        //     routeToFileMapList[verbPosition].insert({route, path});
-        // }
+        addRoute(method, route, Route{"", std::move(path), nullptr, nullptr});
+    }
+
+    /**
+     * @brief Answers requests matching `route` with the response built by
+     * `handler`, which runs on the reactor thread of the connection.
+     */
+    void createRoute(HTTPMethod method, std::string route,
+                     RouteHandler handler) {
+        addRoute(method, route, Route{"", "", std::move(handler), nullptr});
+    }
+
+    /**
+     * @brief Like the handler route above, but the serialized response is
+     * kept for `cache.ttl` and answers `GET` and `HEAD` requests with the same
+     * target and `cache.varyHeaders` values without running `handler`. When
+     * it expired, only the first request runs the handler again and requests
+     * arriving meanwhile wait for its response. Only `200 OK` responses are
+     * kept.
+     */
+    void createRoute(HTTPMethod method, std::string route, RouteHandler handler,
+                     ResponseCachePolicy cache) {
+        addRoute(method, route,
+                 Route{"", "", std::move(handler), nullptr, std::move(cache)});
+    }
+
+    /**
+     * @brief Answers requests matching `route` with the coroutine `handler`,
+     * which runs on the reactor thread of the connection and may await the
+     * `HandlerIO` of its request instead of blocking, see `Task`.
+     */
+    void createRoute(HTTPMethod method, std::string route,
+                     AsyncRouteHandler handler) {
+        addRoute(method, route, Route{"", "", nullptr, std::move(handler)});
+    }
+
+    /**
+     * @brief Serves the embedded `asset` for requests matching `route`,
+     * e.g. `*Assets::bundle.Find("index.html")` of a header generated by the
+     * `dinoscale_embed_assets` CMake function.
+     */
+    void createRoute(HTTPMethod method, std::string route,
+                     const EmbeddedAsset& asset) {
+        Route embedded{"", "", nullptr, nullptr};
+        embedded.asset = &asset;
+        addRoute(method, route, std::move(embedded));
+    }
+
+    /**
+     * @brief Upgrades `GET` requests matching `route` to WebSocket
+     * connections driven by `handlers`, which run on the reactor thread of
+     * the connection. Other requests to `route` get `426 Upgrade Required`.
+     */
+    void createWebSocket(std::string route, WebSocketHandlers handlers) {
+        Route upgraded{"", "", nullptr, nullptr};
+        upgraded.webSocket =
+            std::make_shared<const WebSocketHandlers>(std::move(handlers));
+        addRoute(HTTPMethod::GET, route, std::move(upgraded));
+    }
+
+    /**
+     * @brief Serves every asset of `bundle` below `prefix` for `GET` and
+     * `HEAD`, e.g. `css/site.css` of a bundle mounted at `/static` as
+     * `/static/css/site.css`. Requests for a directory get its `index.html`,
+     * paths without an asset the `error.html` of the bundle with a 404.
+     * Routes with static segments below `prefix` still take precedence.
+     */
+    void MountAssets(std::string prefix, const EmbeddedBundle& bundle) {
+        while (!prefix.empty() && prefix.back() == '/') {
+            prefix.pop_back();
+        }
+        Route mounted{"", "", nullptr, nullptr};
+        mounted.bundle = &bundle;
+        addRoute(HTTPMethod::GET, prefix + "/*asset", std::move(mounted));
     }
 
     void startListening() {
-        std::ostringstream oss;
+        unsigned workerCount = options.workerCount;
+        if (workerCount == 0) {
+            workerCount = std::max(1u, std::thread::hardware_concurrency());
+        }
 
-        if (listen(this->sock, this->maxSimultaneousConnections) < 0) {
-            exitWithError("Socket listen failed");
+        while (listeners.size() < workerCount) {
+            listeners.push_back(openListeningSocket());
         }
 
-        oss << "\n*** Listening on ADDRESS: "
-            << inet_ntoa(socketAddress.sin_addr)
-            << " PORT: " << ntohs(socketAddress.sin_port) << " ***\n\n";
+        for (SOCKET listener : listeners) {
+            if (listen(listener, options.listenBacklog) < 0) {
+                exitWithError("Socket listen failed");
+            }
+        }
 
-        std::string listeningString = oss.str();
-        logger.Log(listeningString);
+        if (options.asyncLogging) {
+            logger.EnableAsync();
+        }
 
-        int bytesRecieved;
-        while (true) {
-            logger.Log("----- Waiting for a new connection -----");
-            // waits until a request comes to the server
-            acceptConnection();
+        logger.Info("\n*** Listening on ADDRESS: {} PORT: {} WORKERS: {} ***\n",
+                    inet_ntoa(socketAddress.sin_addr),
+                    ntohs(socketAddress.sin_port), workerCount);
 
-            // recieving requests from client
-            char buffer[DinoScale::maxBufferSize] = {0};
-            int  bytesReceived = recv(newSocket, buffer, maxBufferSize, 0);
-            if (bytesReceived < 0) {
-                exitWithError(
-                    "failed to receive bytes from client socket connection");
-            }
+        if (options.handlerThreads > 0) {
+            handlerPool = std::make_unique<ThreadPool>(options.handlerThreads);
+            shedder = std::make_unique<LoadShedder>(options.sheddingTarget,
+                                                    options.sheddingInterval);
+            retryAfter = std::to_string(options.retryAfter.count());
+        }
+
+        if (options.staticCacheBudget > 0) {
+            fileCache = std::make_unique<StaticFileCache>(
+                options.staticCacheBudget, options.staticCacheMaxFileSize);
+        }
+
+        if (options.responseCacheBudget > 0) {
+            responseCache =
+                std::make_unique<ResponseCache>(options.responseCacheBudget);
+        }
+
+        if (!options.metricsPath.empty()) {
+            addRoute(HTTPMethod::GET, options.metricsPath,
+                     Route{"", "",
+                           [this](const HTTPRequest&, HTTPResponse& response) {
+                               response.SetHeader(
+                                   "Content-Type",
+                                   "text/plain; version=0.0.4; charset=utf-8");
+                               response.Send(metrics.RenderPrometheus());
+                           },
+                           nullptr});
+        }
+
+        // from here on the route table is only read
+        router.Freeze();
+        for (std::size_t i = 0; i < router.RouteCount(); i++) {
+            const Route& route = router.RouteAt(i);
+            metrics.AddRoute(HTTPMethodName(route.method), route.pattern);
+        }
+        listening = true;
 
-            std::string method, route, headers, body;
-            parseHttpRequest(buffer, method, route, headers, body);
-            prepareResponse(method, route, body);
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < workerCount; i++) {
+            workers.emplace_back(&DinoScale::runReactor, this, listeners[i], i);
+        }
+        runReactor(listeners[0], 0);
 
-            std::ostringstream oss;
-            oss << "------ Received Request from client ------";
-            logger.Log(oss.str());
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        // runs the handlers still queued, their responses go nowhere
+        handlerPool.reset();
+        reactors.clear();
+    }
 
-            sendResponse();
+    /**
+     * @brief Stops every reactor, closing their connections, and makes
+     * `startListening` return. Safe to call from any thread, also while the
+     * reactors are still starting. The server cannot listen again.
+     */
+    void Stop() {
+        std::lock_guard<std::mutex> guard(reactorsLock);
+        stopping = true;
+        for (const std::unique_ptr<Reactor>& reactor : reactors) {
+            Reactor* target = reactor.get();
+            target->Post([target] { target->Stop(); });
         }
     }
 
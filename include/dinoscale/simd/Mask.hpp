@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Masking of WebSocket payloads, every byte XORed with one of a 4 byte key in
+ * turn. As with `Scan`, the implementation is picked at compile time: AVX2
+ * XORs 32 bytes per step, SSE2, which every x86-64 compiler enables, 16
+ * bytes, and the portable loop 8 bytes at a time in a 64 bit word. The key is
+ * first repeated into a 32 byte pattern starting at the right key byte, so
+ * every step is a plain load, XOR and store however the payload is split
+ * into reads.
+ */
+namespace DinoScale::Mask {
+/**
+ * @brief XORs `length` bytes of `in` with `key` into `out`, which may be
+ * `in`. `offset` is the position within the payload of the first byte, i.e.
+ * how many payload bytes were unmasked before.
+ */
+inline void Apply(const char* in, char* out, std::size_t length,
+                  const unsigned char key[4], std::size_t offset) {
+    alignas(32) unsigned char pattern[32];
+    for (std::size_t i = 0; i < sizeof(pattern); i++) {
+        pattern[i] = key[(offset + i) % 4];
+    }
+    std::size_t done = 0;
+
+#if defined(__AVX2__)
+    const __m256i wide = _mm256_load_si256((const __m256i*)pattern);
+    for (; length - done >= 32; done += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(in + done));
+        _mm256_storeu_si256((__m256i*)(out + done),
+                            _mm256_xor_si256(bytes, wide));
+    }
+#elif defined(__SSE2__)
+    const __m128i wide = _mm_load_si128((const __m128i*)pattern);
+    for (; length - done >= 16; done += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(in + done));
+        _mm_storeu_si128((__m128i*)(out + done), _mm_xor_si128(bytes, wide));
+    }
+#endif
+    // 32, 16 and 8 are multiples of 4, the pattern still starts right here
+    std::uint64_t word;
+    std::memcpy(&word, pattern, sizeof(word));
+    for (; length - done >= 8; done += 8) {
+        std::uint64_t bytes;
+        std::memcpy(&bytes, in + done, sizeof(bytes));
+        bytes ^= word;
+        std::memcpy(out + done, &bytes, sizeof(bytes));
+    }
+    for (std::size_t i = 0; done < length; done++, i++) {
+        out[done] = static_cast<char>(in[done] ^ pattern[i]);
+    }
+}
+}  // namespace DinoScale::Mask
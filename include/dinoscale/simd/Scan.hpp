@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Delimiter scanning used by the request parser. The implementation is picked
+ * at compile time: AVX2 looks at 32 bytes per step, SSE4.2 at 16 bytes using
+ * `pcmpestri` range matching and the scalar loop covers everything else as
+ * well as the tail of every buffer. Build with `-mavx2` or `-msse4.2` (or
+ * `-march=native`) to enable the vector paths.
+ */
+namespace DinoScale::Scan {
+namespace detail {
+/* byte stops a token: space, control character or DEL */
+inline bool isTokenEnd(unsigned char c) { return c <= 0x20 || c == 0x7f; }
+
+/* byte stops a header value: control character other than tab, or DEL */
+inline bool isLineEnd(unsigned char c) {
+    return (c < 0x20 && c != '\t') || c == 0x7f;
+}
+
+#if defined(__AVX2__)
+/* lanes which are <= limit, compared unsigned */
+inline __m256i lessOrEqual(__m256i bytes, char limit) {
+    __m256i bound = _mm256_set1_epi8(limit);
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, bound), bytes);
+}
+#endif
+}  // namespace detail
+
+/**
+ * @brief Finds the first space, control character or DEL in `[begin, end)`,
+ * i.e. the end of a method or request target.
+ * @return `end` if no such byte exists.
+ */
+inline const char* FindTokenEnd(const char* begin, const char* end) {
+#if defined(__AVX2__)
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    while (end - begin >= 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)begin);
+        __m256i stop = _mm256_or_si256(detail::lessOrEqual(bytes, 0x20),
+                                       _mm256_cmpeq_epi8(bytes, del));
+        uint32_t mask = _mm256_movemask_epi8(stop);
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+        begin += 32;
+    }
+#elif defined(__SSE4_2__)
+    // pairs of inclusive ranges: 0x00-0x20 and 0x7f-0x7f
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x20, 0x7f, 0x7f, 0, 0, 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0);
+    while (end - begin >= 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)begin);
+        int     index = _mm_cmpestri(ranges, 4, bytes, 16,
+                                     _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+        if (index != 16) {
+            return begin + index;
+        }
+        begin += 16;
+    }
+#endif
+    while (begin < end && !detail::isTokenEnd(*begin)) {
+        begin++;
+    }
+    return begin;
+}
+
+/**
+ * @brief Finds the first control character (other than tab) or DEL in
+ * `[begin, end)`, which ends a header value or request line.
+ * @return `end` if no such byte exists.
+ */
+inline const char* FindLineEnd(const char* begin, const char* end) {
+#if defined(__AVX2__)
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    while (end - begin >= 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)begin);
+        __m256i control = _mm256_andnot_si256(
+            _mm256_cmpeq_epi8(bytes, tab), detail::lessOrEqual(bytes, 0x1f));
+        __m256i stop = _mm256_or_si256(control, _mm256_cmpeq_epi8(bytes, del));
+        uint32_t mask = _mm256_movemask_epi8(stop);
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+        begin += 32;
+    }
+#elif defined(__SSE4_2__)
+    // 0x00-0x08, 0x0a-0x1f and 0x7f: everything but tab below space
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 0, 0);
+    while (end - begin >= 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)begin);
+        int     index = _mm_cmpestri(ranges, 6, bytes, 16,
+                                     _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+        if (index != 16) {
+            return begin + index;
+        }
+        begin += 16;
+    }
+#endif
+    while (begin < end && !detail::isLineEnd(*begin)) {
+        begin++;
+    }
+    return begin;
+}
+
+/**
+ * @brief Finds the blank line terminating a request head, accepting both
+ * `\r\n\r\n` and bare `\n\n`.
+ *
+ * @param from: Offset to resume from; bytes before it were already searched
+ * by a previous call on the same (possibly shorter) buffer.
+ * @return Offset just past the blank line, or 0 if the head is incomplete.
+ */
+inline std::size_t FindHeadEnd(const char* data, std::size_t length,
+                               std::size_t from) {
+    // every match ends with '\n', memchr is vectorised by the C library
+    std::size_t position = from;
+    while (position < length) {
+        const void* newline = std::memchr(data + position, '\n',
+                                          length - position);
+        if (newline == nullptr) {
+            return 0;
+        }
+        position = static_cast<const char*>(newline) - data;
+
+        if (position >= 1 && data[position - 1] == '\n') {
+            return position + 1;
+        }
+        if (position >= 3 && data[position - 1] == '\r' &&
+            data[position - 2] == '\n' && data[position - 3] == '\r') {
+            return position + 1;
+        }
+        position++;
+    }
+    return 0;
+}
+}  // namespace DinoScale::Scan
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "BufferPool.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Bump allocator for bytes living as long as one batch of output,
+ * carved from blocks of a `BufferPool`.
+ *
+ * Copying into the arena moves a pointer, and a copy that directly follows
+ * the previous one grows it in place, so consecutive small writes end up as
+ * one contiguous run. A full block is followed by one twice its size. `Reset`
+ * keeps the first block for the next batch and returns the others, `Release`
+ * returns all of them.
+ */
+class Arena {
+   private:
+    static constexpr std::size_t firstBlockSize = 4096;
+    static constexpr std::size_t maxBlockSize = 64 * 1024;
+
+    BufferPool&               pool;
+    std::vector<PooledBuffer> blocks;
+    std::size_t               used = 0;  // bytes taken from the last block
+
+    char* top() const { return blocks.back().Data() + used; }
+
+    std::size_t room() const {
+        return blocks.empty() ? 0 : blocks.back().Capacity() - used;
+    }
+
+   public:
+    explicit Arena(BufferPool& pool) : pool(pool) { blocks.reserve(8); }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /** Copies `data` into the arena, the copy lives until `Reset`. */
+    std::string_view Copy(std::string_view data) {
+        if (room() < data.size()) {
+            std::size_t size =
+                blocks.empty()
+                    ? firstBlockSize
+                    : std::min(blocks.back().Capacity() * 2, maxBlockSize);
+            blocks.push_back(pool.Take(std::max(size, data.size())));
+            used = 0;
+        }
+        char* copy = top();
+        std::memcpy(copy, data.data(), data.size());
+        used += data.size();
+        return std::string_view(copy, data.size());
+    }
+
+    /**
+     * @brief Appends `data` to `last` in place when `last` is the latest copy
+     * and the block has room for it.
+     * @return false if `last` is left unchanged.
+     */
+    bool Extend(std::string_view& last, std::string_view data) {
+        if (blocks.empty() || last.data() + last.size() != top() ||
+            room() < data.size()) {
+            return false;
+        }
+        std::memcpy(top(), data.data(), data.size());
+        used += data.size();
+        last = std::string_view(last.data(), last.size() + data.size());
+        return true;
+    }
+
+    /** Invalidates every copy, keeping the first block. */
+    void Reset() {
+        while (blocks.size() > 1) {
+            blocks.pop_back();
+        }
+        used = 0;
+    }
+
+    /** Invalidates every copy and returns all blocks to the pool. */
+    void Release() {
+        blocks.clear();
+        used = 0;
+    }
+};
+}  // namespace DinoScale
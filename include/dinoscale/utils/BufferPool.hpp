@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace DinoScale {
+class BufferPool;
+
+/**
+ * @brief Memory block taken from a `BufferPool`, handed back to it on
+ * destruction. Move-only, like `FileDescriptor`.
+ */
+class PooledBuffer {
+   private:
+    friend class BufferPool;
+
+    char*       data = nullptr;
+    std::size_t capacity = 0;
+    BufferPool* pool = nullptr;
+
+    PooledBuffer(char* data, std::size_t capacity, BufferPool* pool)
+        : data(data), capacity(capacity), pool(pool) {}
+
+   public:
+    PooledBuffer() = default;
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    PooledBuffer(PooledBuffer&& other) noexcept
+        : data(std::exchange(other.data, nullptr)),
+          capacity(std::exchange(other.capacity, 0)),
+          pool(std::exchange(other.pool, nullptr)) {}
+
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            data = std::exchange(other.data, nullptr);
+            capacity = std::exchange(other.capacity, 0);
+            pool = std::exchange(other.pool, nullptr);
+        }
+        return *this;
+    }
+
+    char*       Data() const { return data; }
+    std::size_t Capacity() const { return capacity; }
+    bool        IsValid() const { return data != nullptr; }
+
+    /** Hands the block back to its pool. */
+    inline void Reset();
+
+    ~PooledBuffer() { Reset(); }
+};
+
+/**
+ * @brief Recycles I/O buffers in power-of-two size classes from 4 KiB to
+ * 1 MiB.
+ *
+ * Each reactor owns one pool and uses it from its own thread only, so taking
+ * and returning a buffer is a push or pop on the free list of its class.
+ * Returned buffers are kept until `cacheLimit` bytes are cached, beyond that
+ * they are freed, which bounds the memory the pool holds on to once a burst
+ * of traffic is over. Requests above the largest class bypass the pool.
+ */
+class BufferPool {
+   public:
+    static constexpr std::size_t minSize = 4096;
+    static constexpr std::size_t classCount = 9;  // 4 KiB to 1 MiB
+    static constexpr std::size_t maxSize = minSize << (classCount - 1);
+
+   private:
+    std::array<std::vector<char*>, classCount> free;
+    std::size_t                                cached = 0;  // bytes in `free`
+    std::size_t                                cacheLimit;
+
+    static std::size_t classOf(std::size_t capacity) {
+        return std::bit_width(capacity / minSize) - 1;
+    }
+
+    void give(char* data, std::size_t capacity) {
+        if (capacity > maxSize || cached + capacity > cacheLimit) {
+            ::operator delete(data);
+            return;
+        }
+        free[classOf(capacity)].push_back(data);
+        cached += capacity;
+    }
+
+    friend class PooledBuffer;
+
+   public:
+    /** @param cacheLimit: Bytes of returned buffers kept for reuse. */
+    explicit BufferPool(std::size_t cacheLimit) : cacheLimit(cacheLimit) {}
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /** Returns a buffer of at least `size` bytes, rounded up to its class. */
+    PooledBuffer Take(std::size_t size) {
+        if (size > maxSize) {
+            return PooledBuffer(static_cast<char*>(::operator new(size)), size,
+                                this);
+        }
+
+        std::size_t capacity = std::bit_ceil(size < minSize ? minSize : size);
+        std::vector<char*>& list = free[classOf(capacity)];
+        if (list.empty()) {
+            return PooledBuffer(static_cast<char*>(::operator new(capacity)),
+                                capacity, this);
+        }
+        char* data = list.back();
+        list.pop_back();
+        cached -= capacity;
+        return PooledBuffer(data, capacity, this);
+    }
+
+    /** Bytes held in the free lists. */
+    std::size_t CachedBytes() const { return cached; }
+
+    /** Every buffer taken from the pool must be returned before this. */
+    ~BufferPool() {
+        for (std::vector<char*>& list : free) {
+            for (char* data : list) {
+                ::operator delete(data);
+            }
+        }
+    }
+};
+
+void PooledBuffer::Reset() {
+    if (data != nullptr) {
+        pool->give(data, capacity);
+        data = nullptr;
+        capacity = 0;
+        pool = nullptr;
+    }
+}
+}  // namespace DinoScale
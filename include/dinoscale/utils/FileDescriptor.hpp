@@ -0,0 +1,46 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <utility>
+
+namespace DinoScale {
+/**
+ * @brief Owns a file descriptor and closes it on destruction. Move-only, so
+ * a descriptor always has exactly one owner.
+ */
+class FileDescriptor {
+   private:
+    int fd = -1;
+
+   public:
+    FileDescriptor() = default;
+    explicit FileDescriptor(int fd) : fd(fd) {}
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    FileDescriptor(FileDescriptor&& other) noexcept
+        : fd(std::exchange(other.fd, -1)) {}
+
+    FileDescriptor& operator=(FileDescriptor&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            fd = std::exchange(other.fd, -1);
+        }
+        return *this;
+    }
+
+    int  Get() const { return fd; }
+    bool IsValid() const { return fd >= 0; }
+
+    void Reset() {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    ~FileDescriptor() { Reset(); }
+};
+}  // namespace DinoScale
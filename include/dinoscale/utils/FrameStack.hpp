@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "BufferPool.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Allocator for the coroutine frames of one connection, carved from
+ * blocks of the reactor's `BufferPool`.
+ *
+ * Frames of awaited coroutines nest, a callee is freed before its caller, so
+ * they are kept as a stack: allocating moves a pointer and freeing the top
+ * frame moves it back. A frame freed out of order is only marked and its
+ * memory comes back once the frames above it are gone too. All blocks go
+ * back to the pool when the last frame is freed, so a connection without a
+ * running handler holds no frame memory.
+ *
+ * Coroutine promises allocate through `AllocateFrame`, which uses the stack
+ * made current with a `Scope` on the calling thread and falls back to the
+ * heap without one.
+ */
+class FrameStack {
+   private:
+    static constexpr std::size_t blockSize = 16384;
+
+    /* precedes every frame, padded so that frames stay aligned */
+    struct alignas(std::max_align_t) Header {
+        FrameStack* owner;  // null for frames on the heap
+        std::size_t block;  // index into `blocks`
+        std::size_t offset;
+        bool        freed;
+    };
+
+    BufferPool&               pool;
+    std::vector<PooledBuffer> blocks;
+    std::vector<Header*>      frames;  // live and marked frames, oldest first
+    std::size_t               used = 0;  // bytes taken from the last block
+
+    inline static thread_local FrameStack* current = nullptr;
+
+    void* allocate(std::size_t size) {
+        constexpr std::size_t align = alignof(std::max_align_t);
+        std::size_t need = sizeof(Header) + (size + align - 1) / align * align;
+        if (blocks.empty() || blocks.back().Capacity() - used < need) {
+            blocks.push_back(pool.Take(need > blockSize ? need : blockSize));
+            used = 0;
+        }
+        Header* header = new (blocks.back().Data() + used)
+            Header{this, blocks.size() - 1, used, false};
+        used += need;
+        frames.push_back(header);
+        return header + 1;
+    }
+
+    void free(Header* header) {
+        header->freed = true;
+        while (!frames.empty() && frames.back()->freed) {
+            Header* top = frames.back();
+            frames.pop_back();
+            blocks.resize(top->block + 1);
+            used = top->offset;
+        }
+        if (frames.empty()) {
+            blocks.clear();
+            used = 0;
+        }
+    }
+
+   public:
+    explicit FrameStack(BufferPool& pool) : pool(pool) {}
+
+    FrameStack(const FrameStack&) = delete;
+    FrameStack& operator=(const FrameStack&) = delete;
+
+    /** Makes `stack` the one frames are allocated from on this thread until
+     * the scope ends. */
+    class Scope {
+       private:
+        FrameStack* previous;
+
+       public:
+        explicit Scope(FrameStack& stack) : previous(current) {
+            current = &stack;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope() { current = previous; }
+    };
+
+    /** Memory for a coroutine frame of `size` bytes. */
+    static void* AllocateFrame(std::size_t size) {
+        if (current != nullptr) {
+            return current->allocate(size);
+        }
+        auto* header = static_cast<Header*>(
+            ::operator new(sizeof(Header) + size));
+        header->owner = nullptr;
+        return header + 1;
+    }
+
+    /** Frees a frame from `AllocateFrame`, on the thread of its stack. */
+    static void FreeFrame(void* frame) {
+        Header* header = static_cast<Header*>(frame) - 1;
+        if (header->owner != nullptr) {
+            header->owner->free(header);
+        } else {
+            ::operator delete(header);
+        }
+    }
+
+    /** Number of frames not freed yet. */
+    std::size_t Size() const {
+        std::size_t live = 0;
+        for (const Header* header : frames) {
+            live += !header->freed;
+        }
+        return live;
+    }
+};
+}  // namespace DinoScale
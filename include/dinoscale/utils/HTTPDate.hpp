@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <string_view>
+
+#include "Strings.hpp"
+
+namespace DinoScale {
+/**
+ * @brief Writes `time` as an IMF-fixdate, e.g. `Sun, 06 Nov 1994 08:49:37
+ * GMT`, the only date format HTTP senders may generate. Independent of the
+ * C locale.
+ *
+ * @param out: Receives exactly 29 characters, no terminator.
+ * @return Number of characters written.
+ */
+inline std::size_t FormatHTTPDate(std::time_t time, char* out) {
+    static constexpr char days[] = "SunMonTueWedThuFriSat";
+    static constexpr char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    std::tm utc;
+    gmtime_r(&time, &utc);
+
+    auto twoDigits = [](char* position, int value) {
+        position[0] = '0' + value / 10;
+        position[1] = '0' + value % 10;
+    };
+
+    char* position = out;
+    for (int i = 0; i < 3; i++) *position++ = days[utc.tm_wday * 3 + i];
+    *position++ = ',';
+    *position++ = ' ';
+    twoDigits(position, utc.tm_mday);
+    position += 2;
+    *position++ = ' ';
+    for (int i = 0; i < 3; i++) *position++ = months[utc.tm_mon * 3 + i];
+    *position++ = ' ';
+    int year = utc.tm_year + 1900;
+    twoDigits(position, year / 100);
+    twoDigits(position + 2, year % 100);
+    position += 4;
+    *position++ = ' ';
+    twoDigits(position, utc.tm_hour);
+    position[2] = ':';
+    twoDigits(position + 3, utc.tm_min);
+    position[5] = ':';
+    twoDigits(position + 6, utc.tm_sec);
+    position += 8;
+    for (char c : std::string_view(" GMT")) *position++ = c;
+    return position - out;
+}
+
+/**
+ * @brief Reads an HTTP date in any of the three formats recipients must
+ * accept: IMF-fixdate (`Sun, 06 Nov 1994 08:49:37 GMT`), the obsolete RFC 850
+ * form (`Sunday, 06-Nov-94 08:49:37 GMT`) and asctime (`Sun Nov  6 08:49:37
+ * 1994`). The weekday is not checked against the date.
+ *
+ * @return false if `value` is none of them.
+ */
+inline bool ParseHTTPDate(std::string_view value, std::time_t& time) {
+    static constexpr std::string_view months =
+        "janfebmaraprmayjunjulaugsepoctnovdec";
+
+    auto number = [](std::string_view digits, int& result) {
+        if (digits.empty()) {
+            return false;
+        }
+        result = 0;
+        for (char c : digits) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            result = result * 10 + (c - '0');
+        }
+        return true;
+    };
+    auto month = [](std::string_view name, int& result) {
+        if (name.size() != 3) {
+            return false;
+        }
+        for (std::size_t i = 0; i < months.size(); i += 3) {
+            if (EqualsIgnoreCase(name, months.substr(i, 3))) {
+                result = static_cast<int>(i / 3);
+                return true;
+            }
+        }
+        return false;
+    };
+    auto clock = [&number](std::string_view text, std::tm& tm) {
+        return text.size() == 8 && text[2] == ':' && text[5] == ':' &&
+               number(text.substr(0, 2), tm.tm_hour) &&
+               number(text.substr(3, 2), tm.tm_min) &&
+               number(text.substr(6, 2), tm.tm_sec);
+    };
+
+    value = TrimWhitespace(value);
+    std::tm     tm{};
+    std::size_t comma = value.find(',');
+
+    if (comma == 3 && value.size() == 29) {
+        // IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT"
+        std::string_view rest = value.substr(5);
+        if (rest[2] != ' ' || rest[6] != ' ' || rest[11] != ' ' ||
+            rest.substr(20) != " GMT" ||
+            !number(rest.substr(0, 2), tm.tm_mday) ||
+            !month(rest.substr(3, 3), tm.tm_mon) ||
+            !number(rest.substr(7, 4), tm.tm_year) ||
+            !clock(rest.substr(12, 8), tm)) {
+            return false;
+        }
+        tm.tm_year -= 1900;
+    } else if (comma != std::string_view::npos) {
+        // RFC 850: "Sunday, 06-Nov-94 08:49:37 GMT"
+        std::string_view rest = TrimWhitespace(value.substr(comma + 1));
+        if (rest.size() != 22 || rest[2] != '-' || rest[6] != '-' ||
+            rest[9] != ' ' || rest.substr(18) != " GMT" ||
+            !number(rest.substr(0, 2), tm.tm_mday) ||
+            !month(rest.substr(3, 3), tm.tm_mon) ||
+            !number(rest.substr(7, 2), tm.tm_year) ||
+            !clock(rest.substr(10, 8), tm)) {
+            return false;
+        }
+        if (tm.tm_year < 70) {
+            tm.tm_year += 100;  // two digit years from 1970 to 2069
+        }
+    } else {
+        // asctime: "Sun Nov  6 08:49:37 1994"
+        if (value.size() != 24 || value[3] != ' ' || value[7] != ' ' ||
+            value[10] != ' ' || value[19] != ' ' ||
+            !month(value.substr(4, 3), tm.tm_mon) ||
+            !number(TrimWhitespace(value.substr(8, 2)), tm.tm_mday) ||
+            !clock(value.substr(11, 8), tm) ||
+            !number(value.substr(20, 4), tm.tm_year)) {
+            return false;
+        }
+        tm.tm_year -= 1900;
+    }
+
+    if (tm.tm_mday < 1 || tm.tm_mday > 31 || tm.tm_hour > 23 ||
+        tm.tm_min > 59 || tm.tm_sec > 60) {
+        return false;
+    }
+    time = timegm(&tm);
+    return time != -1;
+}
+
+/**
+ * @brief The `Date` header line of the current second, CRLF included. Built
+ * once per second per thread, so calling it for every response is free.
+ */
+inline std::string_view CachedDateHeader() {
+    thread_local std::time_t cachedSecond = -1;
+    thread_local char        line[64] = "Date: ";
+    thread_local std::size_t length = 0;
+
+    std::time_t now = std::time(nullptr);
+    if (now != cachedSecond) {
+        std::size_t dateLength = FormatHTTPDate(now, line + 6);
+        line[6 + dateLength] = '\r';
+        line[7 + dateLength] = '\n';
+        length = 8 + dateLength;
+        cachedSecond = now;
+    }
+    return std::string_view(line, length);
+}
+}  // namespace DinoScale
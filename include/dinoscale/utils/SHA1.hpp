@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace DinoScale {
+using SHA1Digest = std::array<unsigned char, 20>;
+
+namespace detail {
+constexpr std::uint32_t rotateLeft(std::uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/* runs the compression function of SHA-1 over one 64 byte block */
+inline void sha1Block(std::uint32_t state[5], const unsigned char* block) {
+    std::uint32_t words[80];
+    for (int i = 0; i < 16; i++) {
+        words[i] = std::uint32_t(block[i * 4]) << 24 |
+                   std::uint32_t(block[i * 4 + 1]) << 16 |
+                   std::uint32_t(block[i * 4 + 2]) << 8 |
+                   std::uint32_t(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 80; i++) {
+        words[i] = rotateLeft(
+            words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+    }
+
+    std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+                  e = state[4];
+    for (int i = 0; i < 80; i++) {
+        std::uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        std::uint32_t next = rotateLeft(a, 5) + f + e + k + words[i];
+        e = d;
+        d = c;
+        c = rotateLeft(b, 30);
+        b = a;
+        a = next;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+}  // namespace detail
+
+/**
+ * @brief SHA-1 of `data`. Broken for signatures and only here because the
+ * WebSocket handshake is defined with it, never use it to protect anything.
+ */
+inline SHA1Digest SHA1(std::string_view data) {
+    std::uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476,
+                              0xc3d2e1f0};
+    const unsigned char* bytes =
+        reinterpret_cast<const unsigned char*>(data.data());
+    std::size_t length = data.size();
+    std::size_t whole = length - length % 64;
+    for (std::size_t offset = 0; offset < whole; offset += 64) {
+        detail::sha1Block(state, bytes + offset);
+    }
+
+    // the rest, the 0x80 terminator and the length in bits, in one or two
+    // final blocks
+    unsigned char tail[128] = {};
+    std::size_t   rest = length - whole;
+    std::memcpy(tail, bytes + whole, rest);
+    tail[rest] = 0x80;
+    std::size_t   tailLength = rest < 56 ? 64 : 128;
+    std::uint64_t bits = static_cast<std::uint64_t>(length) * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tailLength - 1 - i] = static_cast<unsigned char>(bits >> (i * 8));
+    }
+    for (std::size_t offset = 0; offset < tailLength; offset += 64) {
+        detail::sha1Block(state, tail + offset);
+    }
+
+    SHA1Digest digest;
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = static_cast<unsigned char>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<unsigned char>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<unsigned char>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<unsigned char>(state[i]);
+    }
+    return digest;
+}
+}  // namespace DinoScale
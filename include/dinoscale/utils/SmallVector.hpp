@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace DinoScale {
+/**
+ * @brief Vector keeping its first `N` elements inline, only spilling to the
+ * heap when more are pushed. Used for per-request collections whose typical
+ * size is known (e.g. headers) so the common case never allocates.
+ *
+ * @note Elements are relocated with `memcpy`, hence restricted to trivially
+ * copyable types.
+ */
+template <typename T, std::size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "SmallVector only stores trivially copyable types");
+
+   private:
+    alignas(T) unsigned char inlineStorage[N * sizeof(T)];
+    T*          items;
+    std::size_t count;
+    std::size_t capacity;
+
+    bool isInline() const {
+        return items == reinterpret_cast<const T*>(inlineStorage);
+    }
+
+    void grow() {
+        std::size_t newCapacity = capacity * 2;
+        T* newItems = static_cast<T*>(std::malloc(newCapacity * sizeof(T)));
+        if (newItems == nullptr) {
+            throw std::bad_alloc();
+        }
+        std::memcpy(newItems, items, count * sizeof(T));
+        if (!isInline()) {
+            std::free(items);
+        }
+        items = newItems;
+        capacity = newCapacity;
+    }
+
+   public:
+    SmallVector()
+        : items(reinterpret_cast<T*>(inlineStorage)), count(0), capacity(N) {}
+
+    SmallVector(const SmallVector&) = delete;
+    SmallVector& operator=(const SmallVector&) = delete;
+
+    void push_back(const T& item) {
+        if (count == capacity) {
+            grow();
+        }
+        items[count++] = item;
+    }
+
+    void pop_back() { count--; }
+
+    /** Removes all elements, heap storage is kept for reuse. */
+    void clear() { count = 0; }
+
+    std::size_t size() const { return count; }
+    bool        empty() const { return count == 0; }
+
+    T&       operator[](std::size_t index) { return items[index]; }
+    const T& operator[](std::size_t index) const { return items[index]; }
+
+    T*       begin() { return items; }
+    T*       end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+    ~SmallVector() {
+        if (!isInline()) {
+            std::free(items);
+        }
+    }
+};
+}  // namespace DinoScale
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace DinoScale {
+/**
+ * @brief ASCII case folding, header names and most header tokens are case
+ * insensitive.
+ */
+constexpr char ToLowerASCII(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (ToLowerASCII(a[i]) != ToLowerASCII(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Strips spaces and tabs from both ends. */
+constexpr std::string_view TrimWhitespace(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+/**
+ * @brief Checks whether the comma separated header value contains `token`,
+ * e.g. `close` inside `Connection: Upgrade, close`.
+ */
+constexpr bool HasToken(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        std::size_t comma = value.find(',');
+        if (EqualsIgnoreCase(TrimWhitespace(value.substr(0, comma)), token)) {
+            return true;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+/** Appends `length` bytes of `data` to `out` in padded base64. */
+inline void AppendBase64(std::string& out, const unsigned char* data,
+                         std::size_t length) {
+    static constexpr char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (std::size_t i = 0; i < length; i += 3) {
+        std::uint32_t group = std::uint32_t(data[i]) << 16;
+        if (i + 1 < length) {
+            group |= std::uint32_t(data[i + 1]) << 8;
+        }
+        if (i + 2 < length) {
+            group |= data[i + 2];
+        }
+        out += alphabet[group >> 18];
+        out += alphabet[(group >> 12) & 63];
+        out += i + 1 < length ? alphabet[(group >> 6) & 63] : '=';
+        out += i + 2 < length ? alphabet[group & 63] : '=';
+    }
+}
+
+/**
+ * @brief Whether `text` is well formed UTF-8: no overlong forms, surrogates
+ * or code points beyond U+10FFFF. Runs of ASCII are skipped 8 bytes at a
+ * time.
+ */
+inline bool IsValidUTF8(std::string_view text) {
+    const unsigned char* bytes =
+        reinterpret_cast<const unsigned char*>(text.data());
+    std::size_t length = text.size();
+    std::size_t i = 0;
+    while (i < length) {
+        if (length - i >= 8) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            if ((word & 0x8080808080808080ull) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        unsigned char lead = bytes[i];
+        if (lead < 0x80) {
+            i++;
+            continue;
+        }
+
+        // the range of the first continuation byte rules out overlong
+        // forms, surrogates and code points above U+10FFFF
+        std::size_t   count;
+        unsigned char low = 0x80, high = 0xbf;
+        if (lead >= 0xc2 && lead <= 0xdf) {
+            count = 1;
+        } else if (lead >= 0xe0 && lead <= 0xef) {
+            count = 2;
+            low = lead == 0xe0 ? 0xa0 : 0x80;
+            high = lead == 0xed ? 0x9f : 0xbf;
+        } else if (lead >= 0xf0 && lead <= 0xf4) {
+            count = 3;
+            low = lead == 0xf0 ? 0x90 : 0x80;
+            high = lead == 0xf4 ? 0x8f : 0xbf;
+        } else {
+            return false;
+        }
+        if (length - i <= count || bytes[i + 1] < low || bytes[i + 1] > high) {
+            return false;
+        }
+        for (std::size_t k = 2; k <= count; k++) {
+            if ((bytes[i + k] & 0xc0) != 0x80) {
+                return false;
+            }
+        }
+        i += count + 1;
+    }
+    return true;
+}
+}  // namespace DinoScale
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DinoScale {
+/**
+ * @brief Fixed set of threads running submitted tasks, with task deques per
+ * thread and work stealing between them.
+ *
+ * Tasks submitted by a pool thread go to its own deque, a thread takes the
+ * newest of those first as it is the one most likely still in its cache.
+ * Tasks submitted from outside the pool are spread round robin over the
+ * inboxes of the threads and run oldest first, so no request waits behind
+ * the ones which arrived after it. Once both are empty a thread steals the
+ * oldest task of another thread, so a long running task never leaves the
+ * tasks queued behind it waiting while other threads are idle. Threads with
+ * nothing to do sleep until a task is submitted.
+ */
+class ThreadPool {
+   private:
+    using Task = std::function<void()>;
+
+    struct Queue {
+        std::mutex       lock;
+        std::deque<Task> tasks;  // submitted by the owning thread
+        std::deque<Task> inbox;  // submitted from outside the pool
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread>            threads;
+
+    std::atomic<std::size_t> nextQueue{0};  // round robin for outside tasks
+    std::atomic<std::size_t> pending{0};    // tasks queued but not yet taken
+    std::atomic<unsigned>    sleepers{0};
+    std::atomic<bool>        stopping{false};
+    std::mutex               sleepLock;
+    std::condition_variable  wake;
+
+    /* pool and deque of the calling thread, if it is a pool thread */
+    inline static thread_local ThreadPool* currentPool = nullptr;
+    inline static thread_local std::size_t currentQueue = 0;
+
+    bool popOwn(std::size_t index, Task& task) {
+        Queue&                      queue = *queues[index];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+        if (!queue.inbox.empty()) {
+            task = std::move(queue.inbox.front());
+            queue.inbox.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    bool steal(std::size_t thief, Task& task) {
+        for (std::size_t i = 1; i < queues.size(); i++) {
+            Queue& victim = *queues[(thief + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.inbox.empty()) {
+                task = std::move(victim.inbox.front());
+                victim.inbox.pop_front();
+                return true;
+            }
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(std::size_t index) {
+        currentPool = this;
+        currentQueue = index;
+
+        Task task;
+        while (true) {
+            if (popOwn(index, task) || steal(index, task)) {
+                pending.fetch_sub(1);
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepLock);
+            if (stopping.load() && pending.load() == 0) {
+                return;
+            }
+            sleepers.fetch_add(1);
+            wake.wait(lock, [this] {
+                return pending.load() > 0 || stopping.load();
+            });
+            sleepers.fetch_sub(1);
+        }
+    }
+
+   public:
+    /** @param threadCount: Number of threads, at least one is started. */
+    explicit ThreadPool(std::size_t threadCount) {
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+        for (std::size_t i = 0; i < threadCount; i++) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (std::size_t i = 0; i < threadCount; i++) {
+            threads.emplace_back(&ThreadPool::work, this, i);
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** Queues `task` to run on one of the pool threads. */
+    void Submit(Task task) {
+        bool        inside = currentPool == this;
+        std::size_t index =
+            inside ? currentQueue : nextQueue.fetch_add(1) % queues.size();
+        {
+            std::lock_guard<std::mutex> guard(queues[index]->lock);
+            (inside ? queues[index]->tasks : queues[index]->inbox)
+                .push_back(std::move(task));
+        }
+
+        // a thread about to sleep either sees the new count or is woken here
+        pending.fetch_add(1);
+        if (sleepers.load() > 0) {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            wake.notify_one();
+        }
+    }
+
+    std::size_t ThreadCount() const { return threads.size(); }
+
+    /** Tasks submitted but not yet taken by a thread. */
+    std::size_t Pending() const { return pending.load(); }
+
+    /** Runs every queued task, then stops the threads. */
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stopping.store(true);
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+};
+}  // namespace DinoScale
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace DinoScale {
+/**
+ * @brief Link of an object into a `TimerWheel`, embedded in the object so
+ * that scheduling never allocates.
+ */
+template <typename Owner>
+struct TimerNode {
+    TimerNode*    prev = nullptr;
+    TimerNode*    next = nullptr;  // null while not scheduled
+    std::uint64_t expiry = 0;      // tick at which the timer fires
+    unsigned      slot = 0;        // level * 64 + slot index in the wheel
+    Owner*        owner = nullptr;
+
+    bool IsScheduled() const { return next != nullptr; }
+};
+
+/**
+ * @brief Hierarchical timing wheel: four levels of 64 slots, each slot
+ * covering 64 times the span of a slot one level below. Scheduling and
+ * cancelling unlink and link a node in O(1). Advancing by one tick fires the
+ * current slot of the lowest level and, every 64 ticks, cascades one slot of
+ * a higher level down, so the cost of a tick does not depend on how many
+ * timers are pending.
+ *
+ * Deadlines are rounded up to whole ticks, a timer never fires early and at
+ * most one tick late. Deadlines beyond the range of the wheel (64^4 ticks)
+ * fire at the end of the range, owners re-check their deadline when fired.
+ */
+template <typename Owner>
+class TimerWheel {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+   private:
+    static constexpr int           slotBits = 6;
+    static constexpr int           slotCount = 1 << slotBits;
+    static constexpr std::uint64_t slotMask = slotCount - 1;
+    static constexpr int           levelCount = 4;
+    static constexpr std::uint64_t range = std::uint64_t{1}
+                                           << (slotBits * levelCount);
+
+    using Node = TimerNode<Owner>;
+
+    Clock::duration   tick;
+    Clock::time_point origin;   // start of tick 0
+    std::uint64_t     current;  // last tick processed
+    std::size_t       count;    // timers scheduled
+
+    Node          slots[levelCount][slotCount];  // list sentinels
+    std::uint64_t occupied[levelCount];          // non-empty slots, a bit each
+
+    void link(Node& node) {
+        std::uint64_t delta = node.expiry - current;
+        if (delta >= range) {
+            node.expiry = current + range - 1;
+            delta = range - 1;
+        }
+        int level = 0;
+        while (delta >= std::uint64_t{1} << (slotBits * (level + 1))) {
+            level++;
+        }
+        unsigned slot = (node.expiry >> (slotBits * level)) & slotMask;
+
+        Node& head = slots[level][slot];
+        node.slot = level * slotCount + slot;
+        node.prev = &head;
+        node.next = head.next;
+        head.next->prev = &node;
+        head.next = &node;
+        occupied[level] |= std::uint64_t{1} << slot;
+        count++;
+    }
+
+    void unlink(Node& node) {
+        node.prev->next = node.next;
+        node.next->prev = node.prev;
+        Node& head = slots[node.slot / slotCount][node.slot % slotCount];
+        if (head.next == &head) {
+            occupied[node.slot / slotCount] &=
+                ~(std::uint64_t{1} << (node.slot % slotCount));
+        }
+        node.prev = nullptr;
+        node.next = nullptr;
+        count--;
+    }
+
+    /* moves the timers of `slot` on `level` to the levels below */
+    void cascade(int level, unsigned slot) {
+        Node& head = slots[level][slot];
+        while (head.next != &head) {
+            Node& node = *head.next;
+            unlink(node);
+            link(node);
+        }
+    }
+
+    /* start of tick `index` */
+    Clock::time_point at(std::uint64_t index) const {
+        return origin + tick * static_cast<Clock::rep>(index);
+    }
+
+    /* ticks until the next tick with timers to fire or cascade */
+    std::uint64_t ticksUntilWork() const {
+        std::uint64_t ticks = slotCount - (current & slotMask);  // cascade
+        bool          higher = false;
+        for (int level = 1; level < levelCount; level++) {
+            higher = higher || occupied[level] != 0;
+        }
+        if (!higher) {
+            ticks = range;
+        }
+        if (occupied[0] != 0) {
+            // bit 0 of the rotated map stands for the next tick
+            std::uint64_t ahead =
+                std::rotr(occupied[0], static_cast<int>((current + 1) &
+                                                        slotMask));
+            std::uint64_t first = std::countr_zero(ahead) + 1;
+            ticks = first < ticks ? first : ticks;
+        }
+        return ticks;
+    }
+
+   public:
+    /**
+     * @param tick: Resolution of the wheel.
+     * @param start: Time of tick 0, usually now.
+     */
+    TimerWheel(Clock::duration tick, Clock::time_point start)
+        : tick(tick), origin(start), current(0), count(0), occupied{} {
+        for (auto& level : slots) {
+            for (Node& head : level) {
+                head.prev = &head;
+                head.next = &head;
+            }
+        }
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /** (Re)schedules `node` to fire once `deadline` has passed. */
+    void Schedule(Node& node, Clock::time_point deadline) {
+        if (node.IsScheduled()) {
+            unlink(node);
+        }
+        std::uint64_t expiry = current + 1;
+        if (deadline > origin) {
+            // rounded up, so the timer does not fire before its deadline
+            std::uint64_t ticks =
+                (deadline - origin + tick - Clock::duration(1)) / tick;
+            expiry = ticks > current ? ticks : current + 1;
+        }
+        node.expiry = expiry;
+        link(node);
+    }
+
+    void Cancel(Node& node) {
+        if (node.IsScheduled()) {
+            unlink(node);
+        }
+    }
+
+    /** Moment at which the scheduled `node` fires. */
+    Clock::time_point ExpiryOf(const Node& node) const {
+        return at(node.expiry);
+    }
+
+    /**
+     * @brief Processes every tick up to `now`, calling `fire(owner)` for each
+     * expired timer. The timer is unscheduled before its callback runs, which
+     * may schedule it again or cancel others.
+     */
+    template <typename Callback>
+    void Advance(Clock::time_point now, Callback&& fire) {
+        if (now <= origin) {
+            return;
+        }
+        std::uint64_t target = (now - origin) / tick;
+        while (current < target) {
+            if (count == 0) {
+                current = target;
+                return;
+            }
+            current++;
+
+            // slots of higher levels move down whenever the level below wraps,
+            // the highest first so their timers reach the lowest level now
+            int top = 0;
+            while (top + 1 < levelCount &&
+                   (current & ((std::uint64_t{1}
+                                << (slotBits * (top + 1))) - 1)) == 0) {
+                top++;
+            }
+            for (int level = top; level > 0; level--) {
+                cascade(level, (current >> (slotBits * level)) & slotMask);
+            }
+
+            Node& head = slots[0][current & slotMask];
+            while (head.next != &head) {
+                Node& node = *head.next;
+                unlink(node);
+                fire(*node.owner);
+            }
+        }
+    }
+
+    /**
+     * @brief Time from `now` until the wheel has work to do, for waiting on
+     * events in between. `Clock::duration::max()` if no timer is scheduled.
+     */
+    Clock::duration TimeUntilNext(Clock::time_point now) const {
+        if (count == 0) {
+            return Clock::duration::max();
+        }
+        Clock::time_point next = at(current + ticksUntilWork());
+        return next > now ? next - now : Clock::duration::zero();
+    }
+
+    std::size_t Size() const { return count; }
+};
+}  // namespace DinoScale
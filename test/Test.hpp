@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstdio>
+#include <exception>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Minimal unit test harness, so the tests build wherever the library does.
+ * Tests are written as with GoogleTest: `TEST(Suite, Name)` defines one,
+ * `EXPECT_*` checks record a failure and carry on, `ASSERT_*` checks end the
+ * test. Every test file is its own executable, built with `main.cpp`, which
+ * runs the tests whose `Suite.Name` contains the first argument, if given.
+ */
+namespace DinoScale::Testing {
+struct TestCase {
+    const char* suite;
+    const char* name;
+    void (*run)();
+};
+
+inline std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+struct Registration {
+    Registration(const char* suite, const char* name, void (*run)()) {
+        Registry().push_back({suite, name, run});
+    }
+};
+
+/* thrown by a failed `ASSERT_*` to leave the test */
+struct AssertionFailed {};
+
+/* failures of the running test, and labels printed along with them */
+inline int                      failures = 0;
+inline std::vector<std::string> contexts;
+
+/** Labels the failures of the checks in its scope, e.g. with a parameter of
+ * a test running once per value. */
+class Context {
+   public:
+    explicit Context(std::string label) {
+        contexts.push_back(std::move(label));
+    }
+    ~Context() { contexts.pop_back(); }
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+};
+
+template <typename T>
+std::string Describe(const T& value) {
+    if constexpr (std::is_enum_v<T>) {
+        return std::to_string(static_cast<long long>(value));
+    } else if constexpr (requires(std::ostream& out) { out << value; }) {
+        std::ostringstream out;
+        out << value;
+        return out.str();
+    } else {
+        return "(not printable)";
+    }
+}
+
+inline void Fail(const char* file, int line, const std::string& message) {
+    failures++;
+    std::fprintf(stderr, "%s:%d: failure\n%s\n", file, line, message.c_str());
+    for (const std::string& context : contexts) {
+        std::fprintf(stderr, "  in %s\n", context.c_str());
+    }
+}
+
+/* compares integers of mixed signedness by value, anything else as is */
+template <typename A, typename B>
+constexpr bool Equal(const A& a, const B& b) {
+    if constexpr (std::is_integral_v<A> && std::is_integral_v<B> &&
+                  !std::is_same_v<A, bool> && !std::is_same_v<B, bool>) {
+        return std::cmp_equal(a, b);
+    } else {
+        return a == b;
+    }
+}
+
+template <typename A, typename B>
+constexpr bool Less(const A& a, const B& b) {
+    if constexpr (std::is_integral_v<A> && std::is_integral_v<B>) {
+        return std::cmp_less(a, b);
+    } else {
+        return a < b;
+    }
+}
+
+template <typename A, typename B, typename Compare>
+bool Check(const A& actual, const B& expected, Compare compare,
+           const char* expression, const char* file, int line) {
+    if (compare(actual, expected)) {
+        return true;
+    }
+    Fail(file, line,
+         std::string("  ") + expression + "\n  left:  " + Describe(actual) +
+             "\n  right: " + Describe(expected));
+    return false;
+}
+
+/** Runs the registered tests matching `filter`, returns the exit status. */
+inline int RunAll(std::string_view filter) {
+    int run = 0;
+    int failed = 0;
+    for (const TestCase& test : Registry()) {
+        std::string name = std::string(test.suite) + "." + test.name;
+        if (name.find(filter) == std::string::npos) {
+            continue;
+        }
+        std::fprintf(stderr, "[ RUN  ] %s\n", name.c_str());
+        failures = 0;
+        contexts.clear();
+        try {
+            test.run();
+        } catch (const AssertionFailed&) {
+        } catch (const std::exception& error) {
+            Fail(__FILE__, __LINE__,
+                 std::string("  uncaught exception: ") + error.what());
+        }
+        run++;
+        if (failures > 0) {
+            failed++;
+        }
+        std::fprintf(stderr, "[ %s ] %s\n", failures > 0 ? "FAIL" : " OK ",
+                     name.c_str());
+    }
+    std::fprintf(stderr, "%d tests, %d failed\n", run, failed);
+    return failed > 0 || run == 0 ? 1 : 0;
+}
+}  // namespace DinoScale::Testing
+
+#define TEST(suite, name)                                          \
+    static void suite##_##name##_test();                           \
+    static ::DinoScale::Testing::Registration                      \
+        suite##_##name##_registration(#suite, #name,               \
+                                      &suite##_##name##_test);     \
+    static void suite##_##name##_test()
+
+#define DINOSCALE_CHECK(actual, expected, compare, text, onFailure) \
+    do {                                                            \
+        if (!::DinoScale::Testing::Check((actual), (expected),      \
+                                         compare, text, __FILE__,   \
+                                         __LINE__)) {               \
+            onFailure;                                              \
+        }                                                           \
+    } while (false)
+
+#define DINOSCALE_COMPARE(expression)       \
+    [](const auto& lhs, const auto& rhs) {  \
+        using ::DinoScale::Testing::Equal;   \
+        using ::DinoScale::Testing::Less;    \
+        return expression;                   \
+    }
+
+#define DINOSCALE_EXPECT(a, b, op, expression) \
+    DINOSCALE_CHECK(a, b, DINOSCALE_COMPARE(expression), #a " " op " " #b, )
+#define DINOSCALE_ASSERT(a, b, op, expression)                         \
+    DINOSCALE_CHECK(a, b, DINOSCALE_COMPARE(expression), #a " " op " " #b, \
+                    throw ::DinoScale::Testing::AssertionFailed())
+
+#define EXPECT_EQ(a, b) DINOSCALE_EXPECT(a, b, "==", Equal(lhs, rhs))
+#define EXPECT_NE(a, b) DINOSCALE_EXPECT(a, b, "!=", !Equal(lhs, rhs))
+#define EXPECT_LT(a, b) DINOSCALE_EXPECT(a, b, "<", Less(lhs, rhs))
+#define EXPECT_LE(a, b) DINOSCALE_EXPECT(a, b, "<=", !Less(rhs, lhs))
+#define EXPECT_GT(a, b) DINOSCALE_EXPECT(a, b, ">", Less(rhs, lhs))
+#define EXPECT_GE(a, b) DINOSCALE_EXPECT(a, b, ">=", !Less(lhs, rhs))
+#define EXPECT_TRUE(a) EXPECT_EQ(static_cast<bool>(a), true)
+#define EXPECT_FALSE(a) EXPECT_EQ(static_cast<bool>(a), false)
+
+#define ASSERT_EQ(a, b) DINOSCALE_ASSERT(a, b, "==", Equal(lhs, rhs))
+#define ASSERT_NE(a, b) DINOSCALE_ASSERT(a, b, "!=", !Equal(lhs, rhs))
+#define ASSERT_LT(a, b) DINOSCALE_ASSERT(a, b, "<", Less(lhs, rhs))
+#define ASSERT_LE(a, b) DINOSCALE_ASSERT(a, b, "<=", !Less(rhs, lhs))
+#define ASSERT_GT(a, b) DINOSCALE_ASSERT(a, b, ">", Less(rhs, lhs))
+#define ASSERT_GE(a, b) DINOSCALE_ASSERT(a, b, ">=", !Less(lhs, rhs))
+#define ASSERT_TRUE(a) ASSERT_EQ(static_cast<bool>(a), true)
+#define ASSERT_FALSE(a) ASSERT_EQ(static_cast<bool>(a), false)
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "server.hpp"
+
+namespace DinoScale::Testing {
+/** A port on the loopback interface nothing listens on right now. */
+inline u_short FreePort() {
+    int         probe = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    socklen_t length = sizeof(address);
+    getsockname(probe, reinterpret_cast<sockaddr*>(&address), &length);
+    close(probe);
+    return ntohs(address.sin_port);
+}
+
+/**
+ * @brief A server listening on a free loopback port on a thread of its own,
+ * stopped when this goes out of scope. `setup` adds the routes.
+ */
+class RunningServer {
+   private:
+    u_short                    port;
+    std::unique_ptr<DinoScale> server;
+    std::thread                thread;
+
+   public:
+    RunningServer(const ServerOptions&                   options,
+                  const std::function<void(DinoScale&)>& setup)
+        : port(FreePort()),
+          server(std::make_unique<DinoScale>("127.0.0.1", port)) {
+        server->SetOptions(options);
+        setup(*server);
+        thread = std::thread([this] { server->startListening(); });
+    }
+
+    RunningServer(const RunningServer&) = delete;
+    RunningServer& operator=(const RunningServer&) = delete;
+
+    ~RunningServer() {
+        server->Stop();
+        thread.join();
+    }
+
+    u_short Port() const { return port; }
+};
+
+/** Status, head and body of a response read by `Client`. */
+struct Response {
+    int         status = 0;
+    std::string head;
+    std::string body;
+
+    /** Value of the header `name`, spelled as the server writes it. */
+    std::string_view Header(std::string_view name) const {
+        std::string needle = "\r\n" + std::string(name) + ": ";
+        std::size_t start = head.find(needle);
+        if (start == std::string::npos) {
+            return {};
+        }
+        start += needle.size();
+        return std::string_view(head).substr(start,
+                                             head.find("\r\n", start) - start);
+    }
+};
+
+/**
+ * @brief Blocking client connection to the loopback interface, failing reads
+ * after five seconds so that a server which does not answer fails the test
+ * rather than hanging it.
+ */
+class Client {
+   private:
+    int         fd;
+    std::string buffered;  // received beyond the last response
+
+   public:
+    explicit Client(u_short port) : fd(-1) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        // the server thread may still be setting up its listener
+        for (int attempt = 0; attempt < 200 && fd < 0; attempt++) {
+            int candidate = socket(AF_INET, SOCK_STREAM, 0);
+            if (connect(candidate, reinterpret_cast<sockaddr*>(&address),
+                        sizeof(address)) == 0) {
+                fd = candidate;
+                break;
+            }
+            close(candidate);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        timeval timeout{5, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    ~Client() { Close(); }
+
+    int Fd() const { return fd; }
+
+    void Send(std::string_view data) {
+        while (!data.empty()) {
+            ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (sent <= 0) {
+                return;
+            }
+            data.remove_prefix(sent);
+        }
+    }
+
+    /** Stops sending, the server sees the end of the input. */
+    void ShutdownWrite() { shutdown(fd, SHUT_WR); }
+
+    void Close() {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    /**
+     * @brief Reads until `size` bytes are buffered.
+     * @return false if the connection ended or the read timed out first.
+     */
+    bool Fill(std::size_t size) {
+        char chunk[16384];
+        while (buffered.size() < size) {
+            ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                return false;
+            }
+            buffered.append(chunk, received);
+        }
+        return true;
+    }
+
+    /** Takes `size` buffered bytes, reading them first if needed. */
+    std::string Take(std::size_t size) {
+        if (!Fill(size)) {
+            size = buffered.size();
+        }
+        std::string taken = buffered.substr(0, size);
+        buffered.erase(0, size);
+        return taken;
+    }
+
+    /** Reads the next response, with a `Content-Length` body if any. A
+     * status of 0 means the connection ended before one arrived. */
+    Response Read() {
+        Response    response;
+        std::size_t headEnd;
+        while ((headEnd = buffered.find("\r\n\r\n")) == std::string::npos) {
+            if (!Fill(buffered.size() + 1)) {
+                return response;
+            }
+        }
+        response.head = Take(headEnd + 4);
+        std::string_view line = response.head;
+        std::from_chars(line.data() + 9, line.data() + 12, response.status);
+
+        std::size_t length = 0;
+        std::string_view value = response.Header("Content-Length");
+        std::from_chars(value.data(), value.data() + value.size(), length);
+        response.body = Take(length);
+        return response;
+    }
+
+    /**
+     * @brief Reads until the server closes the connection.
+     * @return false if it stayed open for the whole read timeout.
+     */
+    bool WaitForClose() {
+        char chunk[16384];
+        while (true) {
+            ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received > 0) {
+                buffered.append(chunk, received);
+                continue;
+            }
+            return received == 0 || errno == ECONNRESET;
+        }
+    }
+};
+}  // namespace DinoScale::Testing
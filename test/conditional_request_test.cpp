@@ -0,0 +1,123 @@
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+#include "Test.hpp"
+#include "core/ConditionalRequest.hpp"
+
+using namespace DinoScale;
+
+namespace {
+constexpr std::string_view etag = "\"5f-1a2b\"";
+constexpr std::string_view lastModified = "Sun, 06 Nov 1994 08:49:37 GMT";
+constexpr std::time_t      modified = 784111777;
+
+/* the ranges of `value` for a representation of 100 bytes, as
+ * "offset+length" joined by spaces */
+std::string ranges(std::string_view value, RangeStatus expected,
+                   std::size_t maxRanges = 16) {
+    ByteRanges  parsed;
+    RangeStatus status = ParseByteRanges(value, 100, maxRanges, parsed);
+    EXPECT_EQ(static_cast<int>(status), static_cast<int>(expected));
+    std::string out;
+    for (const ByteRange& range : parsed) {
+        if (!out.empty()) {
+            out += ' ';
+        }
+        out += std::to_string(range.offset) + "+" +
+               std::to_string(range.length);
+    }
+    return out;
+}
+}  // namespace
+
+TEST(ConditionalRequest, MatchesETagLists) {
+    EXPECT_TRUE(ETagListMatches(etag, etag));
+    EXPECT_TRUE(ETagListMatches("\"a\", \"5f-1a2b\"", etag));
+    EXPECT_TRUE(ETagListMatches(" ,\t\"a\" ,,\"5f-1a2b\"", etag));
+    EXPECT_TRUE(ETagListMatches("*", etag));
+    // the comparison is weak
+    EXPECT_TRUE(ETagListMatches("W/\"5f-1a2b\"", etag));
+    EXPECT_TRUE(ETagListMatches(etag, "W/\"5f-1a2b\""));
+
+    EXPECT_FALSE(ETagListMatches("", etag));
+    EXPECT_FALSE(ETagListMatches("\"5f-1a2c\"", etag));
+    EXPECT_FALSE(ETagListMatches("\"5f-1a2b", etag));
+    EXPECT_FALSE(ETagListMatches("5f-1a2b", etag));
+    EXPECT_FALSE(ETagListMatches("\"a\", bogus, \"5f-1a2b\"", etag));
+}
+
+TEST(ConditionalRequest, EvaluatesNotModified) {
+    EXPECT_TRUE(IsNotModified(etag, "", etag, modified));
+    EXPECT_TRUE(IsNotModified("", lastModified, etag, modified));
+    EXPECT_TRUE(IsNotModified("", lastModified, etag, modified - 1));
+    EXPECT_FALSE(IsNotModified("", lastModified, etag, modified + 1));
+    EXPECT_FALSE(IsNotModified("", "yesterday", etag, modified));
+    EXPECT_FALSE(IsNotModified("", "", etag, modified));
+    // If-Modified-Since does not count once If-None-Match is there
+    EXPECT_FALSE(IsNotModified("\"other\"", lastModified, etag, modified));
+}
+
+TEST(ConditionalRequest, EvaluatesIfRange) {
+    EXPECT_TRUE(IfRangeMatches("", etag, modified));
+    EXPECT_TRUE(IfRangeMatches(etag, etag, modified));
+    EXPECT_TRUE(IfRangeMatches(lastModified, etag, modified));
+
+    // the comparison is strong, dates must be exact
+    EXPECT_FALSE(IfRangeMatches("W/\"5f-1a2b\"", etag, modified));
+    EXPECT_FALSE(IfRangeMatches("W/\"5f-1a2b\"", "W/\"5f-1a2b\"", modified));
+    EXPECT_FALSE(IfRangeMatches("\"5f-1a2c\"", etag, modified));
+    EXPECT_FALSE(IfRangeMatches(lastModified, etag, modified + 1));
+    EXPECT_FALSE(IfRangeMatches("garbage", etag, modified));
+}
+
+TEST(ConditionalRequest, ParsesByteRanges) {
+    EXPECT_EQ(ranges("bytes=0-9", RangeStatus::Satisfiable), "0+10");
+    EXPECT_EQ(ranges("bytes=90-", RangeStatus::Satisfiable), "90+10");
+    EXPECT_EQ(ranges("bytes=-5", RangeStatus::Satisfiable), "95+5");
+    EXPECT_EQ(ranges(" Bytes=10-19, 50-59 ", RangeStatus::Satisfiable),
+              "10+10 50+10");
+    // in the order requested
+    EXPECT_EQ(ranges("bytes=50-59,,0-0", RangeStatus::Satisfiable),
+              "50+10 0+1");
+}
+
+TEST(ConditionalRequest, ClipsRangesToRepresentation) {
+    EXPECT_EQ(ranges("bytes=95-200", RangeStatus::Satisfiable), "95+5");
+    EXPECT_EQ(ranges("bytes=-500", RangeStatus::Satisfiable), "0+100");
+    // ranges beyond the end are left out
+    EXPECT_EQ(ranges("bytes=0-0,100-,200-300", RangeStatus::Satisfiable),
+              "0+1");
+    EXPECT_EQ(ranges("bytes=100-", RangeStatus::Unsatisfiable), "");
+    EXPECT_EQ(ranges("bytes=-0", RangeStatus::Unsatisfiable), "");
+
+    ByteRanges parsed;
+    EXPECT_EQ(static_cast<int>(ParseByteRanges("bytes=-5", 0, 16, parsed)),
+              static_cast<int>(RangeStatus::Unsatisfiable));
+}
+
+TEST(ConditionalRequest, IgnoresUnusableRanges) {
+    const char* values[] = {
+        "",
+        "bytes=",
+        "items=0-9",
+        "bytes 0-9",
+        "bytes=9-0",
+        "bytes=a-9",
+        "bytes=0-9x",
+        "bytes=5",
+        "bytes=-",
+        "bytes=99999999999999999999999-",
+        // more bytes than the representation, by overlapping
+        "bytes=0-59,40-99",
+    };
+    for (const char* value : values) {
+        Testing::Context context(value);
+        EXPECT_EQ(ranges(value, RangeStatus::Ignored), "");
+    }
+    // more ranges than allowed
+    EXPECT_EQ(ranges("bytes=0-0,2-2,4-4", RangeStatus::Ignored, 2), "");
+    EXPECT_EQ(ranges("bytes=0-0,2-2", RangeStatus::Satisfiable, 2),
+              "0+1 2+1");
+}
@@ -0,0 +1,323 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Test.hpp"
+#include "core/HPACK.hpp"
+
+using namespace DinoScale;
+
+namespace {
+using Fields = std::vector<std::pair<std::string, std::string>>;
+
+/* bytes written as in RFC 7541 appendix C, spaces are skipped */
+std::string fromHex(std::string_view hex) {
+    auto digit = [](char c) {
+        return c <= '9' ? c - '0' : c - 'a' + 10;
+    };
+    std::string bytes;
+    for (std::size_t i = 0; i < hex.size(); i++) {
+        if (hex[i] == ' ') {
+            continue;
+        }
+        bytes.push_back(static_cast<char>(digit(hex[i]) << 4 |
+                                          digit(hex[i + 1])));
+        i++;
+    }
+    return bytes;
+}
+
+/* decodes `block`, an empty list with `decoded` false if it failed */
+Fields decode(HPACKDecoder& decoder, std::string_view block,
+              bool* decoded = nullptr) {
+    Fields fields;
+    bool   result = decoder.Decode(
+        block, [&](std::string_view name, std::string_view value) {
+            fields.emplace_back(name, value);
+        });
+    if (decoded != nullptr) {
+        *decoded = result;
+    }
+    return result ? fields : Fields();
+}
+
+bool decodes(std::string_view block) {
+    HPACKDecoder decoder;
+    bool         decoded;
+    decode(decoder, block, &decoded);
+    return decoded;
+}
+
+std::string encode(HPACKEncoder& encoder, const Fields& fields,
+                   HPACKEncoder::Indexing indexing =
+                       HPACKEncoder::Indexing::Incremental) {
+    std::string block;
+    encoder.Begin(block);
+    for (const auto& [name, value] : fields) {
+        encoder.Encode(block, name, value, indexing);
+    }
+    return block;
+}
+
+std::string huffman(std::string_view text) {
+    std::string out;
+    HuffmanEncode(text, out);
+    return out;
+}
+
+/* appendix C.3 and C.4, three requests sharing one context */
+const Fields requests[] = {
+    {{":method", "GET"},
+     {":scheme", "http"},
+     {":path", "/"},
+     {":authority", "www.example.com"}},
+    {{":method", "GET"},
+     {":scheme", "http"},
+     {":path", "/"},
+     {":authority", "www.example.com"},
+     {"cache-control", "no-cache"}},
+    {{":method", "GET"},
+     {":scheme", "https"},
+     {":path", "/index.html"},
+     {":authority", "www.example.com"},
+     {"custom-key", "custom-value"}},
+};
+
+/* appendix C.5 and C.6, three responses with a table of 256 bytes */
+const Fields responses[] = {
+    {{":status", "302"},
+     {"cache-control", "private"},
+     {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+     {"location", "https://www.example.com"}},
+    {{":status", "307"},
+     {"cache-control", "private"},
+     {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+     {"location", "https://www.example.com"}},
+    {{":status", "200"},
+     {"cache-control", "private"},
+     {"date", "Mon, 21 Oct 2013 20:13:22 GMT"},
+     {"location", "https://www.example.com"},
+     {"content-encoding", "gzip"},
+     {"set-cookie",
+      "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"}},
+};
+
+/* a dynamic table size update to 256 bytes */
+constexpr std::string_view resize256 = "3fe101";
+}  // namespace
+
+TEST(Huffman, EncodesAppendixExamples) {
+    EXPECT_EQ(huffman("www.example.com"),
+              fromHex("f1e3 c2e5 f23a 6ba0 ab90 f4ff"));
+    EXPECT_EQ(huffman("no-cache"), fromHex("a8eb 1064 9cbf"));
+    EXPECT_EQ(huffman("custom-key"), fromHex("25a8 49e9 5ba9 7d7f"));
+    EXPECT_EQ(huffman("custom-value"), fromHex("25a8 49e9 5bb8 e8b4 bf"));
+    EXPECT_EQ(huffman("302"), fromHex("6402"));
+    EXPECT_EQ(huffman("private"), fromHex("aec3 771a 4b"));
+    EXPECT_EQ(HuffmanLength("www.example.com"), 12u);
+}
+
+TEST(Huffman, DecodesWhatItEncodes) {
+    std::string every;
+    for (int c = 0; c < 256; c++) {
+        every.push_back(static_cast<char>(c));
+    }
+    for (std::size_t length : {0u, 1u, 7u, 100u, 256u}) {
+        Testing::Context context("length " + std::to_string(length));
+        std::string      text = every.substr(0, length);
+        std::string      decoded;
+        EXPECT_TRUE(HuffmanDecode(huffman(text), decoded));
+        EXPECT_EQ(decoded, text);
+    }
+}
+
+TEST(Huffman, RejectsBrokenPadding) {
+    std::string out;
+    // eight bits of padding
+    EXPECT_FALSE(HuffmanDecode(fromHex("a8eb 1064 9cbf ff"), out));
+    // padding which is not a prefix of end of string: 'a' and zero bits
+    EXPECT_FALSE(HuffmanDecode(fromHex("18"), out));
+    // the end of string code itself
+    EXPECT_FALSE(HuffmanDecode(fromHex("ffff ffff"), out));
+}
+
+TEST(HPACKDecoder, DecodesLiteralFields) {
+    // appendix C.2.1 to C.2.4
+    HPACKDecoder decoder;
+    EXPECT_TRUE(decode(decoder, fromHex("400a 6375 7374 6f6d 2d6b 6579 0d63 "
+                                        "7573 746f 6d2d 6865 6164 6572")) ==
+                Fields({{"custom-key", "custom-header"}}));
+    EXPECT_TRUE(decode(decoder,
+                       fromHex("040c 2f73 616d 706c 652f 7061 7468")) ==
+                Fields({{":path", "/sample/path"}}));
+    EXPECT_TRUE(decode(decoder, fromHex("1008 7061 7373 776f 7264 0673 6563 "
+                                        "7265 74")) ==
+                Fields({{"password", "secret"}}));
+    EXPECT_TRUE(decode(decoder, fromHex("82")) ==
+                Fields({{":method", "GET"}}));
+
+    // only the first was indexed, as index 62
+    EXPECT_TRUE(decode(decoder, fromHex("be")) ==
+                Fields({{"custom-key", "custom-header"}}));
+    bool decoded;
+    decode(decoder, fromHex("bf"), &decoded);
+    EXPECT_FALSE(decoded);
+}
+
+TEST(HPACKDecoder, DecodesRequestsWithoutHuffman) {
+    // appendix C.3
+    const char* blocks[] = {
+        "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d",
+        "8286 84be 5808 6e6f 2d63 6163 6865",
+        "8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 "
+        "6c75 65",
+    };
+    HPACKDecoder decoder;
+    for (int i = 0; i < 3; i++) {
+        Testing::Context context("request " + std::to_string(i + 1));
+        EXPECT_TRUE(decode(decoder, fromHex(blocks[i])) == requests[i]);
+    }
+}
+
+TEST(HPACKDecoder, DecodesRequestsWithHuffman) {
+    // appendix C.4
+    const char* blocks[] = {
+        "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff",
+        "8286 84be 5886 a8eb 1064 9cbf",
+        "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf",
+    };
+    HPACKDecoder decoder;
+    for (int i = 0; i < 3; i++) {
+        Testing::Context context("request " + std::to_string(i + 1));
+        EXPECT_TRUE(decode(decoder, fromHex(blocks[i])) == requests[i]);
+    }
+}
+
+TEST(HPACKDecoder, EvictsFromFullTable) {
+    // appendix C.5, with the table shrunk to 256 bytes by the first block;
+    // the indices of the later blocks only hold after the right evictions
+    const std::string blocks[] = {
+        std::string(resize256) +
+            "4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 "
+            "4f63 7420 3230 3133 2032 303a 3133 3a32 3120 474d 546e 1768 "
+            "7474 7073 3a2f 2f77 7777 2e65 7861 6d70 6c65 2e63 6f6d",
+        "4803 3330 37c1 c0bf",
+        "88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 303a 3133 "
+        "3a32 3220 474d 54c0 5a04 677a 6970 7738 666f 6f3d 4153 444a 4b48 "
+        "514b 425a 584f 5157 454f 5049 5541 5851 5745 4f49 553b 206d 6178 "
+        "2d61 6765 3d33 3630 303b 2076 6572 7369 6f6e 3d31",
+    };
+    HPACKDecoder decoder;
+    for (int i = 0; i < 3; i++) {
+        Testing::Context context("response " + std::to_string(i + 1));
+        EXPECT_TRUE(decode(decoder, fromHex(blocks[i])) == responses[i]);
+    }
+    // the three fields inserted last fill the table, as in C.5.3
+    EXPECT_TRUE(decode(decoder, fromHex("bebf c0")) ==
+                Fields({{"set-cookie", responses[2][5].second},
+                        {"content-encoding", "gzip"},
+                        {"date", "Mon, 21 Oct 2013 20:13:22 GMT"}}));
+    bool decoded;
+    decode(decoder, fromHex("c1"), &decoded);
+    EXPECT_FALSE(decoded);
+}
+
+TEST(HPACKDecoder, ChecksTableSizeUpdates) {
+    // above SETTINGS_HEADER_TABLE_SIZE
+    EXPECT_FALSE(decodes(fromHex("3fe2 1f")));
+    // after a field
+    EXPECT_FALSE(decodes(fromHex("823f e101")));
+
+    // shrinking to zero empties the table
+    HPACKDecoder decoder;
+    decode(decoder, fromHex("400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f "
+                            "6d2d 6865 6164 6572"));
+    EXPECT_EQ(decode(decoder, fromHex("be")).size(), 1u);
+    EXPECT_TRUE(decode(decoder, fromHex("203f e11f")).empty());
+    bool decoded;
+    decode(decoder, fromHex("be"), &decoded);
+    EXPECT_FALSE(decoded);
+}
+
+TEST(HPACKDecoder, RejectsTruncatedBlocks) {
+    const char* blocks[] = {
+        "ff",           // index continues beyond the block
+        "ff80 8080 8080 01",  // integer beyond any sensible size
+        "400a 6375 73",  // name shorter than its length
+        "80",           // index 0
+        "ff3f",         // index beyond both tables
+    };
+    for (const char* block : blocks) {
+        Testing::Context context(block);
+        EXPECT_FALSE(decodes(fromHex(block)));
+    }
+}
+
+TEST(HPACKEncoder, EncodesRequestsAsAppendix) {
+    // appendix C.4, every string is shorter Huffman coded
+    const char* blocks[] = {
+        "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff",
+        "8286 84be 5886 a8eb 1064 9cbf",
+        "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf",
+    };
+    HPACKEncoder encoder;
+    for (int i = 0; i < 3; i++) {
+        Testing::Context context("request " + std::to_string(i + 1));
+        EXPECT_EQ(encode(encoder, requests[i]), fromHex(blocks[i]));
+    }
+}
+
+TEST(HPACKEncoder, EncodesResponsesAsAppendix) {
+    // appendix C.6, preceded by the announcement of the smaller table; "307"
+    // is no shorter Huffman coded, so unlike in the appendix it is left raw
+    const std::string blocks[] = {
+        std::string(resize256) +
+            "4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 44a8 2005 "
+            "9504 0b81 66e0 82a6 2d1b ff6e 919d 29ad 1718 63c7 8f0b 97c8 "
+            "e9ae 82ae 43d3",
+        "4803 3330 37c1 c0bf",
+        "88c1 6196 d07a be94 1054 d444 a820 0595 040b 8166 e084 a62d 1bff "
+        "c05a 839b d9ab 77ad 94e7 821d d7f2 e6c7 b335 dfdf cd5b 3960 d5af "
+        "2708 7f36 72c1 ab27 0fb5 291f 9587 3160 65c0 03ed 4ee5 b106 3d50 "
+        "07",
+    };
+    HPACKEncoder encoder;
+    encoder.SetPeerCapacity(256);
+    HPACKDecoder decoder;
+    for (int i = 0; i < 3; i++) {
+        Testing::Context context("response " + std::to_string(i + 1));
+        std::string      block = encode(encoder, responses[i]);
+        EXPECT_EQ(block, fromHex(blocks[i]));
+        EXPECT_TRUE(decode(decoder, block) == responses[i]);
+    }
+}
+
+TEST(HPACKEncoder, KeepsUnindexedFieldsOutOfTable) {
+    HPACKEncoder encoder;
+    Fields       field = {{"etag", "\"abc\""}};
+    std::string  first = encode(encoder, field, HPACKEncoder::Indexing::None);
+    // literal without indexing, name index 34
+    EXPECT_EQ(first.substr(0, 2), fromHex("0f13"));
+    EXPECT_EQ(encode(encoder, field, HPACKEncoder::Indexing::None), first);
+
+    std::string secret =
+        encode(encoder, {{"authorization", "x"}},
+               HPACKEncoder::Indexing::Never);
+    EXPECT_EQ(secret, fromHex("1f08 0178"));  // never indexed, index 23
+}
+
+TEST(HPACKEncoder, AnnouncesShrinkBeforeGrowth) {
+    HPACKEncoder encoder;
+    encoder.SetPeerCapacity(0);
+    encoder.SetPeerCapacity(1024);
+    std::string block;
+    encoder.Begin(block);
+    // the table was emptied in between, so both sizes are announced
+    EXPECT_EQ(block, fromHex("203f e107"));
+
+    block.clear();
+    encoder.Begin(block);
+    EXPECT_TRUE(block.empty());
+}
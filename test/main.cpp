@@ -0,0 +1,7 @@
+#include <string_view>
+
+#include "Test.hpp"
+
+int main(int argc, char** argv) {
+    return DinoScale::Testing::RunAll(argc > 1 ? argv[1] : std::string_view());
+}
@@ -0,0 +1,301 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "Test.hpp"
+#include "core/HTTPRequest.hpp"
+#include "core/RequestBody.hpp"
+
+using namespace DinoScale;
+
+namespace {
+constexpr std::string_view chunked =
+    "4\r\nWiki\r\n"
+    "6;name=value;flag\r\npedia \r\n"
+    "E\r\nin \r\n\r\nchunks.\r\n"
+    "0\r\n"
+    "Expires: never\r\n"
+    "\r\n";
+
+constexpr std::string_view decoded = "Wikipedia in \r\n\r\nchunks.";
+
+/* decodes `input` fed in pieces of `step` bytes, as reads would deliver it */
+BodyStatus decode(ChunkedDecoder& decoder, std::string_view input,
+                  std::size_t step, std::string& payload) {
+    BodyStatus status = BodyStatus::Incomplete;
+    for (std::size_t offset = 0; offset < input.size(); offset += step) {
+        std::string_view piece = input.substr(offset, step);
+        std::size_t      consumed = 0;
+        status = decoder.Decode(piece, consumed, [&](std::string_view data) {
+            payload.append(data);
+            return true;
+        });
+        if (status != BodyStatus::Incomplete) {
+            return status;
+        }
+        if (consumed != piece.size()) {
+            return BodyStatus::Malformed;
+        }
+    }
+    return status;
+}
+
+BodyStatus decode(std::string_view input, std::size_t fieldLimit = 30720) {
+    ChunkedDecoder decoder;
+    decoder.SetFieldLimit(fieldLimit);
+    std::string payload;
+    return decode(decoder, input, input.size(), payload);
+}
+
+/* starts `body` for the request with the complete head `head` */
+BodyStatus begin(RequestBody& body, std::string_view head,
+                 const BodyLimits& limits = BodyLimits()) {
+    HTTPRequest       request;
+    HTTPRequestParser parser;
+    if (parser.Parse(head, request) != ParseStatus::Complete) {
+        return BodyStatus::Malformed;
+    }
+    return body.Begin(request, limits);
+}
+}  // namespace
+
+TEST(ChunkedDecoder, DecodesInputSplitAnywhere) {
+    for (std::size_t step = 1; step <= chunked.size(); step++) {
+        Testing::Context context("pieces of " + std::to_string(step));
+        ChunkedDecoder   decoder;
+        std::string      payload;
+        EXPECT_EQ(decode(decoder, chunked, step, payload),
+                  BodyStatus::Complete);
+        EXPECT_EQ(payload, decoded);
+    }
+}
+
+TEST(ChunkedDecoder, LeavesFollowingRequestUnconsumed) {
+    std::string    input = std::string(chunked) + "GET / HTTP/1.1\r\n\r\n";
+    ChunkedDecoder decoder;
+    std::size_t    consumed = 0;
+    EXPECT_EQ(decoder.Decode(input, consumed,
+                             [](std::string_view) { return true; }),
+              BodyStatus::Complete);
+    EXPECT_EQ(consumed, chunked.size());
+}
+
+TEST(ChunkedDecoder, AcceptsBareLineFeeds) {
+    ChunkedDecoder decoder;
+    std::string    payload;
+    EXPECT_EQ(decode(decoder, "3\nabc\n0\n\n", 1, payload),
+              BodyStatus::Complete);
+    EXPECT_EQ(payload, "abc");
+}
+
+TEST(ChunkedDecoder, RejectsBrokenFraming) {
+    const char* bodies[] = {
+        "\r\n",                 // no size
+        "x\r\n",                // size which is no hex number
+        "3\r\nabcX\r\n",        // payload longer than the size
+        "3\rabc\r\n0\r\n\r\n",  // CR without LF after the size
+        "0\r\n\rX",             // CR without LF ending the trailer
+    };
+    for (const char* body : bodies) {
+        Testing::Context context(body);
+        EXPECT_EQ(decode(body), BodyStatus::Malformed);
+    }
+}
+
+TEST(ChunkedDecoder, RejectsSizeBeyondFifteenDigits) {
+    EXPECT_EQ(decode("fffffffffffffff\r\n"), BodyStatus::Incomplete);
+    EXPECT_EQ(decode("1000000000000000\r\n"), BodyStatus::TooLarge);
+}
+
+TEST(ChunkedDecoder, StopsWhenSinkRefuses) {
+    ChunkedDecoder decoder;
+    std::size_t    consumed = 0;
+    EXPECT_EQ(decoder.Decode("5\r\nhello\r\n0\r\n\r\n", consumed,
+                             [](std::string_view) { return false; }),
+              BodyStatus::TooLarge);
+    EXPECT_EQ(consumed, 3u);
+}
+
+TEST(ChunkedDecoder, BoundsChunkExtensions) {
+    std::string extension(100, 'x');
+    EXPECT_EQ(decode("1;" + extension + "\r\na\r\n0\r\n\r\n", 100),
+              BodyStatus::Complete);
+    EXPECT_EQ(decode("1;" + extension + "\r\na\r\n0\r\n\r\n", 99),
+              BodyStatus::Malformed);
+
+    // the limit applies to each extension, not to all of them together
+    std::string body;
+    for (int i = 0; i < 10; i++) {
+        body += "1;" + extension + "\r\na\r\n";
+    }
+    EXPECT_EQ(decode(body + "0\r\n\r\n", 100), BodyStatus::Complete);
+}
+
+TEST(ChunkedDecoder, BoundsTrailerSection) {
+    std::string field = "X-Trailer: " + std::string(20, 'v') + "\r\n";
+    std::string trailer;
+    for (int i = 0; i < 10; i++) {
+        trailer += field;
+    }
+    EXPECT_EQ(decode("0\r\n" + trailer + "\r\n", trailer.size()),
+              BodyStatus::Complete);
+    EXPECT_EQ(decode("0\r\n" + trailer + "\r\n", trailer.size() - 1),
+              BodyStatus::FieldsTooLarge);
+
+    // short lines count in full as well
+    std::string lines;
+    for (int i = 0; i < 100; i++) {
+        lines += "a\n";
+    }
+    EXPECT_EQ(decode("0\r\n" + lines + "\r\n", 150),
+              BodyStatus::FieldsTooLarge);
+}
+
+TEST(ChunkedDecoder, StartsOverAfterReset) {
+    ChunkedDecoder decoder;
+    std::string    payload;
+    EXPECT_EQ(decode(decoder, "5\r\nhel", 100, payload),
+              BodyStatus::Incomplete);
+    decoder.Reset();
+    payload.clear();
+    EXPECT_EQ(decode(decoder, chunked, 100, payload), BodyStatus::Complete);
+    EXPECT_EQ(payload, decoded);
+}
+
+TEST(RequestBody, ReceivesContentLengthBody) {
+    RequestBody body;
+    ASSERT_EQ(begin(body, "POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\n"),
+              BodyStatus::Incomplete);
+
+    std::size_t consumed;
+    EXPECT_EQ(body.Feed("hel", consumed), BodyStatus::Incomplete);
+    EXPECT_EQ(consumed, 3u);
+    EXPECT_EQ(body.Feed("loGET /", consumed), BodyStatus::Complete);
+    EXPECT_EQ(consumed, 2u);
+    EXPECT_TRUE(body.IsComplete());
+    EXPECT_EQ(body.InMemory(), "hello");
+}
+
+TEST(RequestBody, CompletesWithoutBody) {
+    RequestBody body;
+    EXPECT_EQ(begin(body, "GET / HTTP/1.1\r\n\r\n"), BodyStatus::Complete);
+    EXPECT_EQ(body.Size(), 0u);
+}
+
+TEST(RequestBody, ChecksFramingHeaders) {
+    RequestBody body;
+    EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                          "Content-Length: 3\r\n\r\n"),
+              BodyStatus::Malformed);
+    EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\n"
+                          "Transfer-Encoding: gzip, chunked\r\n\r\n"),
+              BodyStatus::NotImplemented);
+
+    BodyLimits limits;
+    limits.maxSize = 4;
+    EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\n",
+                    limits),
+              BodyStatus::TooLarge);
+}
+
+TEST(RequestBody, RequiresConsistentContentLength) {
+    RequestBody body;
+    EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\nContent-Length: 5\r\n"
+                          "Content-Length: 40\r\n\r\n"),
+              BodyStatus::Malformed);
+    EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\nContent-Length: 5, 40\r\n\r\n"),
+              BodyStatus::Malformed);
+    EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\nContent-Length: 5,\r\n\r\n"),
+              BodyStatus::Malformed);
+
+    // repeated values which agree are one length
+    EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\nContent-Length: 5\r\n"
+                          "content-length: 5, 5\r\n\r\n"),
+              BodyStatus::Incomplete);
+    std::size_t consumed;
+    EXPECT_EQ(body.Feed("helloGET /", consumed), BodyStatus::Complete);
+    EXPECT_EQ(consumed, 5u);
+}
+
+TEST(RequestBody, RequiresChunkedAsFinalCoding) {
+    const char* heads[] = {
+        "Transfer-Encoding: gzip\r\n",
+        "Transfer-Encoding: chunked, gzip\r\n",
+        "Transfer-Encoding: chunked\r\nTransfer-Encoding: identity\r\n",
+        "Transfer-Encoding: chunked\r\nTransfer-Encoding: chunked\r\n",
+        "Transfer-Encoding: \r\n",
+    };
+    for (const char* head : heads) {
+        Testing::Context context(head);
+        RequestBody      body;
+        EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\n" + std::string(head) +
+                                  "\r\n"),
+                  BodyStatus::Malformed);
+    }
+
+    // the codings of all fields are combined
+    RequestBody body;
+    EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n"
+                          "Transfer-Encoding: chunked\r\n\r\n"),
+              BodyStatus::NotImplemented);
+    EXPECT_EQ(begin(body, "POST / HTTP/1.1\r\nTransfer-Encoding: \r\n"
+                          "Transfer-Encoding: Chunked\r\n\r\n"),
+              BodyStatus::Incomplete);
+}
+
+TEST(RequestBody, AppliesFieldLimitToChunkedBody) {
+    BodyLimits limits;
+    limits.maxFieldSize = 8;
+    RequestBody body;
+    ASSERT_EQ(begin(body,
+                    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n",
+                    limits),
+              BodyStatus::Incomplete);
+    std::size_t consumed;
+    EXPECT_EQ(body.Feed("0\r\nX-Long: value\r\n\r\n", consumed),
+              BodyStatus::FieldsTooLarge);
+}
+
+TEST(RequestBody, RefusesChunkedBodyBeyondMaximum) {
+    BodyLimits limits;
+    limits.maxSize = 4;
+    RequestBody body;
+    ASSERT_EQ(begin(body,
+                    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n",
+                    limits),
+              BodyStatus::Incomplete);
+    std::size_t consumed;
+    EXPECT_EQ(body.Feed("3\r\nabc\r\n3\r\ndef\r\n0\r\n\r\n", consumed),
+              BodyStatus::TooLarge);
+}
+
+TEST(RequestBody, SpoolsBeyondMemoryLimit) {
+    BodyLimits limits;
+    limits.memoryLimit = 16;
+    RequestBody body;
+    ASSERT_EQ(begin(body, "POST / HTTP/1.1\r\nContent-Length: 40\r\n\r\n",
+                    limits),
+              BodyStatus::Incomplete);
+
+    std::string payload;
+    for (int i = 0; i < 40; i++) {
+        payload.push_back(static_cast<char>('a' + i % 26));
+    }
+    std::size_t consumed;
+    EXPECT_EQ(body.Feed(std::string_view(payload).substr(0, 10), consumed),
+              BodyStatus::Incomplete);
+    EXPECT_FALSE(body.IsSpooled());
+    EXPECT_EQ(body.Feed(std::string_view(payload).substr(10), consumed),
+              BodyStatus::Complete);
+    ASSERT_TRUE(body.IsSpooled());
+
+    std::string read(40, '\0');
+    EXPECT_EQ(body.Read(0, read.data(), read.size()), 40u);
+    EXPECT_EQ(read, payload);
+    EXPECT_EQ(body.Read(35, read.data(), 10), 5u);
+    EXPECT_EQ(read.substr(0, 5), payload.substr(35));
+
+    body.Reset();
+    EXPECT_FALSE(body.IsSpooled());
+    EXPECT_EQ(body.SpoolFd(), -1);
+}
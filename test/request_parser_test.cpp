@@ -0,0 +1,243 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "Test.hpp"
+#include "core/HTTPRequest.hpp"
+#include "simd/Scan.hpp"
+
+using namespace DinoScale;
+
+namespace {
+constexpr std::string_view sample =
+    "POST /users/42?sort=name&limit=10 HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "Content-Type:  application/json \r\n"
+    "X-Empty:\r\n"
+    "Content-Length: 2\r\n"
+    "\r\n"
+    "{}";
+
+constexpr std::size_t sampleHead = sample.size() - 2;
+
+ParseStatus parse(std::string_view buffer, HTTPRequest& request) {
+    HTTPRequestParser parser;
+    return parser.Parse(buffer, request);
+}
+
+/* the end of the head of `data` arriving one byte per read after the first
+ * `firstRead` bytes, every search resuming where the last one stopped */
+std::size_t findHeadEndIn(std::string_view data, std::size_t firstRead) {
+    std::size_t scanned = 0;
+    for (std::size_t length = firstRead; length <= data.size(); length++) {
+        std::size_t end = Scan::FindHeadEnd(data.data(), length, scanned);
+        if (end != 0) {
+            return end;
+        }
+        scanned = length;
+    }
+    return 0;
+}
+}  // namespace
+
+TEST(RequestParser, ParsesRequestLineAndHeaders) {
+    HTTPRequest request;
+    ASSERT_EQ(parse(sample, request), ParseStatus::Complete);
+
+    EXPECT_EQ(request.Method(), HTTPMethod::POST);
+    EXPECT_EQ(request.MethodName(), "POST");
+    EXPECT_EQ(request.Target(), "/users/42?sort=name&limit=10");
+    EXPECT_EQ(request.Path(), "/users/42");
+    EXPECT_EQ(request.Query(), "sort=name&limit=10");
+    EXPECT_EQ(request.VersionMinor(), 1);
+    EXPECT_EQ(request.HeadLength(), sampleHead);
+
+    ASSERT_EQ(request.Headers().size(), 4u);
+    EXPECT_EQ(request.Header("host"), "example.com");
+    EXPECT_EQ(request.Header("CONTENT-TYPE"), "application/json");
+    EXPECT_TRUE(request.HasHeader("X-Empty"));
+    EXPECT_EQ(request.Header("X-Empty"), "");
+    EXPECT_FALSE(request.HasHeader("Accept"));
+
+    std::size_t length;
+    EXPECT_TRUE(request.ContentLength(length));
+    EXPECT_EQ(length, 2u);
+}
+
+TEST(RequestParser, ViewsPointIntoTheBuffer) {
+    std::string buffer(sample);
+    HTTPRequest request;
+    ASSERT_EQ(parse(buffer, request), ParseStatus::Complete);
+    EXPECT_EQ(request.Path().data(), buffer.data() + 5);
+    EXPECT_EQ(request.Header("Host").data(), buffer.data() + 50);
+}
+
+TEST(RequestParser, ResumesAcrossEveryReadBoundary) {
+    // the head arrives in two reads split at every possible position, the
+    // buffer growing in place as a connection input does
+    for (std::size_t split = 1; split < sampleHead; split++) {
+        Testing::Context  context("split at " + std::to_string(split));
+        HTTPRequestParser parser;
+        HTTPRequest       request;
+        std::string       buffer(sample.substr(0, split));
+
+        ASSERT_EQ(parser.Parse(buffer, request), ParseStatus::Incomplete);
+        buffer.append(sample.substr(split));
+        ASSERT_EQ(parser.Parse(buffer, request), ParseStatus::Complete);
+        EXPECT_EQ(request.HeadLength(), sampleHead);
+        EXPECT_EQ(request.Header("Content-Type"), "application/json");
+    }
+}
+
+TEST(RequestParser, ResumesByteByByte) {
+    HTTPRequestParser parser;
+    HTTPRequest       request;
+    std::string       buffer;
+    for (std::size_t i = 0; i + 1 < sampleHead; i++) {
+        buffer.push_back(sample[i]);
+        ASSERT_EQ(parser.Parse(buffer, request), ParseStatus::Incomplete);
+    }
+    buffer.push_back(sample[sampleHead - 1]);
+    ASSERT_EQ(parser.Parse(buffer, request), ParseStatus::Complete);
+    EXPECT_EQ(request.Query(), "sort=name&limit=10");
+}
+
+TEST(RequestParser, ParsesPipelinedRequestsAfterReset) {
+    std::string buffer =
+        "GET /first HTTP/1.1\r\nHost: a\r\n\r\n"
+        "GET /second HTTP/1.1\r\nHost: b\r\n\r\n";
+    HTTPRequestParser parser;
+    HTTPRequest       request;
+
+    ASSERT_EQ(parser.Parse(buffer, request), ParseStatus::Complete);
+    EXPECT_EQ(request.Path(), "/first");
+    buffer.erase(0, request.HeadLength());
+    parser.Reset();
+
+    ASSERT_EQ(parser.Parse(buffer, request), ParseStatus::Complete);
+    EXPECT_EQ(request.Path(), "/second");
+    EXPECT_EQ(request.Header("Host"), "b");
+    EXPECT_EQ(request.Headers().size(), 1u);
+}
+
+TEST(RequestParser, AcceptsBareLineFeedsAndLeadingBlankLine) {
+    HTTPRequest request;
+    ASSERT_EQ(parse("\r\nGET / HTTP/1.0\nHost: x\n\n", request),
+              ParseStatus::Complete);
+    EXPECT_EQ(request.Path(), "/");
+    EXPECT_EQ(request.VersionMinor(), 0);
+    EXPECT_EQ(request.Header("Host"), "x");
+}
+
+TEST(RequestParser, RejectsMalformedHeads) {
+    const char* heads[] = {
+        "GET /\r\n\r\n",                           // no version
+        "GET / HTTP/2.0\r\n\r\n",                  // not HTTP/1.x
+        "GET / HTTP/1.1 extra\r\n\r\n",            // junk after the version
+        " GET / HTTP/1.1\r\n\r\n",                 // empty method
+        "GET  / HTTP/1.1\r\n\r\n",                 // empty target
+        "GET / HTTP/1.1\r\nNo colon\r\n\r\n",      // header without colon
+        "GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n",  // obsolete folding
+        "GET / HTTP/1.1\r\nBad Name: x\r\n\r\n",   // space in the name
+        "GET / HTTP/1.1\r\nA: b\x01\r\n\r\n",      // control in the value
+    };
+    for (const char* head : heads) {
+        Testing::Context context(head);
+        HTTPRequest      request;
+        EXPECT_EQ(parse(head, request), ParseStatus::Malformed);
+    }
+}
+
+TEST(RequestParser, ReportsUnknownMethod) {
+    HTTPRequest request;
+    EXPECT_EQ(parse("BREW /pot HTTP/1.1\r\n\r\n", request),
+              ParseStatus::UnsupportedMethod);
+}
+
+TEST(RequestParser, DecidesKeepAliveByVersion) {
+    HTTPRequest request;
+    ASSERT_EQ(parse("GET / HTTP/1.1\r\n\r\n", request), ParseStatus::Complete);
+    EXPECT_TRUE(request.KeepAlive());
+    ASSERT_EQ(parse("GET / HTTP/1.1\r\nConnection: Close\r\n\r\n", request),
+              ParseStatus::Complete);
+    EXPECT_FALSE(request.KeepAlive());
+    ASSERT_EQ(parse("GET / HTTP/1.0\r\n\r\n", request), ParseStatus::Complete);
+    EXPECT_FALSE(request.KeepAlive());
+    ASSERT_EQ(parse("GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n",
+                    request),
+              ParseStatus::Complete);
+    EXPECT_TRUE(request.KeepAlive());
+}
+
+TEST(RequestParser, RejectsContentLengthWhichIsNoNumber) {
+    for (const char* value : {"-1", "1x", "0x10", "", " "}) {
+        Testing::Context context(value);
+        std::string head = std::string("POST / HTTP/1.1\r\nContent-Length: ") +
+                           value + "\r\n\r\n";
+        HTTPRequest request;
+        ASSERT_EQ(parse(head, request), ParseStatus::Complete);
+        std::size_t length;
+        EXPECT_FALSE(request.ContentLength(length));
+    }
+}
+
+TEST(FindHeadEnd, FindsEitherTerminator) {
+    std::string_view crlf = "GET / HTTP/1.1\r\nA: b\r\n\r\nbody";
+    std::string_view lf = "GET / HTTP/1.1\nA: b\n\nbody";
+    EXPECT_EQ(Scan::FindHeadEnd(crlf.data(), crlf.size(), 0), crlf.size() - 4);
+    EXPECT_EQ(Scan::FindHeadEnd(lf.data(), lf.size(), 0), lf.size() - 4);
+}
+
+TEST(FindHeadEnd, ReportsIncompleteHead) {
+    for (std::string_view partial :
+         {"", "GET / HTTP/1.1", "GET / HTTP/1.1\r\n", "GET / HTTP/1.1\r\n\r",
+          "GET / HTTP/1.1\r\nA: b\r\n"}) {
+        EXPECT_EQ(Scan::FindHeadEnd(partial.data(), partial.size(), 0), 0u);
+    }
+}
+
+TEST(FindHeadEnd, FindsTerminatorSplitAcrossReads) {
+    // every prefix length as the first read, then one byte per read, so the
+    // terminator is split at each of its positions
+    std::string_view crlf = "GET / HTTP/1.1\r\nHost: x\r\n\r\n";
+    std::string_view lf = "GET / HTTP/1.1\nHost: x\n\n";
+    for (std::size_t first = 1; first <= crlf.size(); first++) {
+        EXPECT_EQ(findHeadEndIn(crlf, first), crlf.size());
+    }
+    for (std::size_t first = 1; first <= lf.size(); first++) {
+        EXPECT_EQ(findHeadEndIn(lf, first), lf.size());
+    }
+}
+
+TEST(Scan, FindsDelimitersAtEveryOffset) {
+    // the vector paths look at 16 or 32 bytes per step, the delimiter sits
+    // in the first, a later or the scalar tail block
+    for (std::size_t length = 1; length <= 100; length++) {
+        for (std::size_t at = 0; at < length; at++) {
+            std::string token(length, 'a');
+            token[at] = ' ';
+            EXPECT_EQ(Scan::FindTokenEnd(token.data(), token.data() + length) -
+                          token.data(),
+                      at);
+
+            std::string value(length, 'v');
+            value[at] = '\r';
+            EXPECT_EQ(Scan::FindLineEnd(value.data(), value.data() + length) -
+                          value.data(),
+                      at);
+        }
+        std::string plain(length, 'a');
+        EXPECT_EQ(Scan::FindTokenEnd(plain.data(), plain.data() + length),
+                  plain.data() + length);
+    }
+}
+
+TEST(Scan, TellsTokenAndLineDelimitersApart) {
+    std::string_view tab = "a\tb";
+    EXPECT_EQ(Scan::FindTokenEnd(tab.data(), tab.data() + 3), tab.data() + 1);
+    EXPECT_EQ(Scan::FindLineEnd(tab.data(), tab.data() + 3), tab.data() + 3);
+
+    std::string_view del = "ab\x7f";
+    EXPECT_EQ(Scan::FindTokenEnd(del.data(), del.data() + 3), del.data() + 2);
+    EXPECT_EQ(Scan::FindLineEnd(del.data(), del.data() + 3), del.data() + 2);
+}
@@ -0,0 +1,172 @@
+#include <string>
+#include <string_view>
+
+#include "Test.hpp"
+#include "core/Router.hpp"
+
+using namespace DinoScale;
+
+namespace {
+/* a route told apart from the others by its file path */
+Route route(std::string name) {
+    return Route{"", std::move(name), nullptr, nullptr};
+}
+
+/* a request parsed from its request line, with the bytes it points into */
+struct Request {
+    std::string raw;
+    HTTPRequest request;
+
+    Request(std::string_view method, std::string_view target)
+        : raw(std::string(method) + " " + std::string(target) +
+              " HTTP/1.1\r\nHost: test\r\n\r\n") {
+        HTTPRequestParser parser;
+        parser.Parse(raw, request);
+    }
+};
+
+/* the name of the route `router` picks, empty for none */
+std::string matched(const Router& router, Request& request) {
+    const Route* found = router.Match(request.request);
+    return found == nullptr ? "" : found->filePath;
+}
+
+std::string matched(const Router& router, std::string_view method,
+                    std::string_view path) {
+    Request request(method, path);
+    return matched(router, request);
+}
+}  // namespace
+
+TEST(Router, MatchesStaticPaths) {
+    Router router;
+    // edges are split where these diverge
+    for (const char* pattern :
+         {"/", "/users", "/users/list", "/api/v1/users", "/api/v2/users",
+          "/apix"}) {
+        ASSERT_TRUE(router.Add(HTTPMethod::GET, pattern, route(pattern)));
+    }
+    router.Freeze();
+
+    for (const char* path :
+         {"/", "/users", "/users/list", "/api/v1/users", "/api/v2/users",
+          "/apix"}) {
+        Testing::Context context(path);
+        EXPECT_EQ(matched(router, "GET", path), path);
+    }
+    EXPECT_EQ(matched(router, "GET", "/user"), "");
+    EXPECT_EQ(matched(router, "GET", "/users/"), "");
+    EXPECT_EQ(matched(router, "GET", "/api/v3/users"), "");
+    EXPECT_EQ(matched(router, "GET", "/api"), "");
+    EXPECT_EQ(router.RouteCount(), 6u);
+    EXPECT_EQ(router.RouteAt(2).pattern, "/users/list");
+    EXPECT_EQ(router.RouteAt(2).index, 2u);
+}
+
+TEST(Router, CapturesParamsAndWildcards) {
+    Router router;
+    router.Add(HTTPMethod::GET, "/users/:id/posts/:post", route("post"));
+    router.Add(HTTPMethod::GET, "/files/*rest", route("file"));
+    router.Freeze();
+
+    Request post("GET", "/users/42/posts/7?full=1");
+    EXPECT_EQ(matched(router, post), "post");
+    EXPECT_EQ(post.request.Params().size(), 2u);
+    EXPECT_EQ(post.request.Param("id"), "42");
+    EXPECT_EQ(post.request.Param("post"), "7");
+
+    Request file("GET", "/files/css/site.css");
+    EXPECT_EQ(matched(router, file), "file");
+    EXPECT_EQ(file.request.Param("rest"), "css/site.css");
+
+    // a parameter is one non-empty segment
+    EXPECT_EQ(matched(router, "GET", "/users//posts/7"), "");
+    EXPECT_EQ(matched(router, "GET", "/users/42/posts/7/8"), "");
+    EXPECT_EQ(matched(router, "GET", "/files"), "");
+}
+
+TEST(Router, PrefersStaticOverParamOverWildcard) {
+    Router router;
+    router.Add(HTTPMethod::GET, "/users/*rest", route("wildcard"));
+    router.Add(HTTPMethod::GET, "/users/:id", route("param"));
+    router.Add(HTTPMethod::GET, "/users/me", route("static"));
+    router.Freeze();
+
+    EXPECT_EQ(matched(router, "GET", "/users/me"), "static");
+    EXPECT_EQ(matched(router, "GET", "/users/mel"), "param");
+    EXPECT_EQ(matched(router, "GET", "/users/42"), "param");
+    EXPECT_EQ(matched(router, "GET", "/users/me/photos"), "wildcard");
+}
+
+TEST(Router, BacktracksOutOfBranchesThatFail) {
+    Router router;
+    router.Add(HTTPMethod::GET, "/a/b/d", route("static"));
+    router.Add(HTTPMethod::GET, "/a/:x/c", route("param"));
+    router.Add(HTTPMethod::GET, "/a/*rest", route("wildcard"));
+    router.Freeze();
+
+    // the static branch matches `b` but not what follows
+    Request param("GET", "/a/b/c");
+    EXPECT_EQ(matched(router, param), "param");
+    EXPECT_EQ(param.request.Param("x"), "b");
+
+    // and so does the parameter, whose capture is dropped again
+    Request wildcard("GET", "/a/b/e");
+    EXPECT_EQ(matched(router, wildcard), "wildcard");
+    ASSERT_EQ(wildcard.request.Params().size(), 1u);
+    EXPECT_EQ(wildcard.request.Param("rest"), "b/e");
+    EXPECT_EQ(wildcard.request.Param("x"), "");
+
+    EXPECT_EQ(matched(router, "GET", "/a/b/d"), "static");
+}
+
+TEST(Router, RejectsInvalidPatterns) {
+    Router router;
+    EXPECT_FALSE(router.Add(HTTPMethod::GET, "", route("")));
+    EXPECT_FALSE(router.Add(HTTPMethod::GET, "users", route("")));
+    EXPECT_FALSE(router.Add(HTTPMethod::GET, "/users/:", route("")));
+    EXPECT_FALSE(router.Add(HTTPMethod::GET, "/files/*/x", route("")));
+    EXPECT_FALSE(router.Add(HTTPMethod::GET, "/files/*rest/x", route("")));
+
+    EXPECT_TRUE(router.Add(HTTPMethod::GET, "/users/:id", route("")));
+    EXPECT_FALSE(router.Add(HTTPMethod::GET, "/users/:id", route("")));
+    // captures at the same place share their name
+    EXPECT_FALSE(router.Add(HTTPMethod::GET, "/users/:name/x", route("")));
+    EXPECT_TRUE(router.Add(HTTPMethod::GET, "/users/:id/x", route("")));
+    // the same pattern for another method is a route of its own
+    EXPECT_TRUE(router.Add(HTTPMethod::PUT, "/users/:id", route("")));
+
+    router.Freeze();
+    EXPECT_TRUE(router.IsFrozen());
+    EXPECT_FALSE(router.Add(HTTPMethod::GET, "/late", route("")));
+    EXPECT_EQ(router.RouteCount(), 3u);
+}
+
+TEST(Router, FallsBackFromHeadToGet) {
+    Router router;
+    router.Add(HTTPMethod::GET, "/page/:name", route("get"));
+    router.Add(HTTPMethod::GET, "/own", route("get"));
+    router.Add(HTTPMethod::HEAD, "/own", route("head"));
+    router.Freeze();
+
+    Request head("HEAD", "/page/index");
+    EXPECT_EQ(matched(router, head), "get");
+    EXPECT_EQ(head.request.Param("name"), "index");
+    EXPECT_EQ(matched(router, "HEAD", "/own"), "head");
+    EXPECT_EQ(matched(router, "POST", "/own"), "");
+    EXPECT_EQ(matched(router, "HEAD", "/other"), "");
+}
+
+TEST(Router, ListsAllowedMethods) {
+    Router router;
+    router.Add(HTTPMethod::GET, "/items/:id", route(""));
+    router.Add(HTTPMethod::DELETE, "/items/:id", route(""));
+    router.Add(HTTPMethod::POST, "/items", route(""));
+    router.Add(HTTPMethod::PATCH, "/items/*rest", route(""));
+    router.Freeze();
+
+    EXPECT_EQ(router.AllowedMethods("/items/3"), "GET, HEAD, DELETE, PATCH");
+    EXPECT_EQ(router.AllowedMethods("/items"), "POST");
+    EXPECT_EQ(router.AllowedMethods("/items/3/tags"), "PATCH");
+    EXPECT_EQ(router.AllowedMethods("/nothing"), "");
+}
@@ -0,0 +1,1252 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+
+#include "Test.hpp"
+#include "TestServer.hpp"
+
+using namespace DinoScale;
+using namespace DinoScale::Testing;
+
+namespace {
+void addRoutes(DinoScale::DinoScale& server) {
+    server.createRoute(HTTPMethod::GET, "/hello",
+                       [](const HTTPRequest&, HTTPResponse& response) {
+                           response.Send("hello");
+                       });
+    server.createRoute(
+        HTTPMethod::GET, "/echo/:text",
+        [](const HTTPRequest& request, HTTPResponse& response) {
+            response.Send(std::string(request.Param("text")));
+        });
+    server.createRoute(
+        HTTPMethod::POST, "/upload",
+        [](const HTTPRequest& request, HTTPResponse& response) {
+            response.Send(std::to_string(request.Body().Size()));
+        });
+}
+
+/* an HTTP/2 frame as a client sends it */
+std::string frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream,
+                  std::string_view payload = {}) {
+    std::string out;
+    out.push_back(static_cast<char>(payload.size() >> 16));
+    out.push_back(static_cast<char>(payload.size() >> 8));
+    out.push_back(static_cast<char>(payload.size()));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>(stream >> shift));
+    }
+    return out.append(payload);
+}
+
+struct Frame {
+    int           type = -1;  // -1 when the connection ended before it
+    std::uint8_t  flags = 0;
+    std::uint32_t stream = 0;
+    std::string   payload;
+
+    std::uint32_t Word(std::size_t offset) const {
+        auto bytes = reinterpret_cast<const unsigned char*>(payload.data());
+        return std::uint32_t(bytes[offset]) << 24 |
+               std::uint32_t(bytes[offset + 1]) << 16 |
+               std::uint32_t(bytes[offset + 2]) << 8 | bytes[offset + 3];
+    }
+};
+
+Frame readFrame(Client& client) {
+    Frame       read;
+    std::string header = client.Take(9);
+    if (header.size() < 9) {
+        return read;
+    }
+    auto bytes = reinterpret_cast<const unsigned char*>(header.data());
+    std::size_t length = bytes[0] << 16 | bytes[1] << 8 | bytes[2];
+    read.payload = client.Take(length);
+    if (read.payload.size() < length) {
+        return read;
+    }
+    read.type = bytes[3];
+    read.flags = bytes[4];
+    read.stream = (std::uint32_t(bytes[5]) << 24 | bytes[6] << 16 |
+                   bytes[7] << 8 | bytes[8]) &
+                  0x7fffffff;
+    return read;
+}
+
+/* the client preface followed by empty SETTINGS */
+std::string h2cPreface() {
+    return std::string(HTTP2Preface) + frame(0x4, 0, 0);
+}
+
+/* the header block of a request, compressed with the client's `encoder` */
+std::string requestBlock(
+    HPACKEncoder& encoder, std::string_view method, std::string_view path,
+    std::initializer_list<std::pair<std::string_view, std::string_view>>
+        fields = {}) {
+    std::string block;
+    encoder.Begin(block);
+    auto indexing = HPACKEncoder::Indexing::Incremental;
+    encoder.Encode(block, ":method", method, indexing);
+    encoder.Encode(block, ":scheme", "http", indexing);
+    encoder.Encode(block, ":path", path, indexing);
+    encoder.Encode(block, ":authority", "test", indexing);
+    for (auto [name, value] : fields) {
+        encoder.Encode(block, name, value, indexing);
+    }
+    return block;
+}
+
+/* what arrived for one HTTP/2 stream */
+struct StreamResponse {
+    int         status = 0;
+    std::string body;
+    bool        ended = false;  // END_STREAM was received
+    int         reset = -1;     // error code of RST_STREAM, if one came
+};
+
+/* reads frames until `count` streams ended or were reset, or until the
+ * connection ended or was sent GOAWAY */
+std::map<std::uint32_t, StreamResponse> readStreams(Client&       client,
+                                                    HPACKDecoder& decoder,
+                                                    std::size_t   count) {
+    std::map<std::uint32_t, StreamResponse> streams;
+    std::string                             block;
+    std::size_t                             done = 0;
+    while (done < count) {
+        Frame read = readFrame(client);
+        if (read.type < 0 || read.type == 0x7) {
+            break;
+        }
+        if (read.stream == 0) {
+            continue;
+        }
+        StreamResponse& response = streams[read.stream];
+        if (read.type == 0x1 || read.type == 0x9) {
+            // the server neither pads nor prioritizes its header blocks
+            block += read.payload;
+            if (read.flags & 0x4) {
+                decoder.Decode(block, [&](std::string_view name,
+                                          std::string_view value) {
+                    if (name == ":status") {
+                        response.status = std::stoi(std::string(value));
+                    }
+                });
+                block.clear();
+            }
+        } else if (read.type == 0x0) {
+            response.body += read.payload;
+        } else if (read.type == 0x3) {
+            response.reset = static_cast<int>(read.Word(0));
+            done++;
+        }
+        if ((read.type == 0x0 || read.type == 0x1) && (read.flags & 0x1)) {
+            response.ended = true;
+            done++;
+        }
+    }
+    return streams;
+}
+
+/* a WINDOW_UPDATE or RST_STREAM payload */
+std::string word(std::uint32_t value) {
+    std::string out;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>(value >> shift));
+    }
+    return out;
+}
+
+/* one setting of a SETTINGS payload */
+std::string setting(std::uint16_t id, std::uint32_t value) {
+    std::string out;
+    out.push_back(static_cast<char>(id >> 8));
+    out.push_back(static_cast<char>(id));
+    return out + word(value);
+}
+
+/* a WebSocket frame as a client sends it, masked with a fixed key */
+std::string webSocketFrame(std::uint8_t first, std::string_view payload) {
+    static constexpr unsigned char key[4] = {0x37, 0xfa, 0x21, 0x3d};
+    std::string out(1, static_cast<char>(first));
+    if (payload.size() < 126) {
+        out.push_back(static_cast<char>(0x80 | payload.size()));
+    } else {
+        out.push_back(static_cast<char>(0x80 | 126));
+        out.push_back(static_cast<char>(payload.size() >> 8));
+        out.push_back(static_cast<char>(payload.size()));
+    }
+    out.append(reinterpret_cast<const char*>(key), 4);
+    for (std::size_t i = 0; i < payload.size(); i++) {
+        out.push_back(static_cast<char>(payload[i] ^ key[i % 4]));
+    }
+    return out;
+}
+
+/* a frame as the server sends it, unmasked */
+struct WebSocketFrame {
+    int         first = -1;  // -1 when the connection ended before it
+    std::string payload;
+
+    /* the code of a close frame */
+    int CloseCode() const {
+        if (payload.size() < 2) {
+            return -1;
+        }
+        return static_cast<unsigned char>(payload[0]) << 8 |
+               static_cast<unsigned char>(payload[1]);
+    }
+};
+
+WebSocketFrame readWebSocketFrame(Client& client) {
+    WebSocketFrame read;
+    std::string    header = client.Take(2);
+    if (header.size() < 2) {
+        return read;
+    }
+    std::size_t length = static_cast<unsigned char>(header[1]);
+    if (length == 126) {
+        std::string extended = client.Take(2);
+        if (extended.size() < 2) {
+            return read;
+        }
+        length = static_cast<unsigned char>(extended[0]) << 8 |
+                 static_cast<unsigned char>(extended[1]);
+    }
+    read.payload = client.Take(length);
+    if (read.payload.size() == length) {
+        read.first = static_cast<unsigned char>(header[0]);
+    }
+    return read;
+}
+
+/* a close frame payload carrying `code` */
+std::string closePayload(std::uint16_t code, std::string_view reason = {}) {
+    std::string out;
+    out.push_back(static_cast<char>(code >> 8));
+    out.push_back(static_cast<char>(code));
+    return out.append(reason);
+}
+
+/* the opening handshake of a WebSocket on `path` */
+std::string webSocketUpgrade(std::string_view path) {
+    return "GET " + std::string(path) +
+           " HTTP/1.1\r\nHost: test\r\nUpgrade: websocket\r\n"
+           "Connection: Upgrade\r\n"
+           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+           "Sec-WebSocket-Version: 13\r\n\r\n";
+}
+
+void addWebSocket(DinoScale::DinoScale& server) {
+    addRoutes(server);
+    WebSocketHandlers handlers;
+    handlers.onMessage = [](WebSocket& socket, std::string_view message,
+                            WebSocketOpcode opcode) {
+        socket.Send(message, opcode);
+    };
+    server.createWebSocket("/ws", std::move(handlers));
+}
+
+/* a text file of 1000 distinct-looking bytes, removed again with this */
+class TempFile {
+   private:
+    std::string path = "/tmp/dinoscale_test_XXXXXX.txt";
+
+   public:
+    std::string content;
+
+    TempFile() {
+        for (int i = 0; i < 1000; i++) {
+            content.push_back(static_cast<char>('a' + i * 7 % 26));
+        }
+        int fd = mkstemps(path.data(), 4);
+        if (fd >= 0) {
+            write(fd, content.data(), content.size());
+            close(fd);
+        }
+    }
+
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    ~TempFile() { unlink(path.c_str()); }
+
+    const std::string& Path() const { return path; }
+};
+
+/* a GET of `path` with `fields`, each ending in CRLF */
+std::string get(std::string_view path, std::string_view fields = {}) {
+    return "GET " + std::string(path) + " HTTP/1.1\r\nHost: test\r\n" +
+           std::string(fields) + "\r\n";
+}
+
+/* adds `/cached`, cached for `ttl` and taking 200 ms to answer with the
+ * number of times it ran, and `/block`, holding a handler thread for
+ * 400 ms */
+void addCachedRoutes(DinoScale::DinoScale& server, std::atomic<int>& runs,
+                     std::chrono::milliseconds ttl) {
+    ResponseCachePolicy policy;
+    policy.ttl = ttl;
+    server.createRoute(
+        HTTPMethod::GET, "/cached",
+        [&runs](const HTTPRequest&, HTTPResponse& response) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            response.Send("run " + std::to_string(++runs));
+        },
+        std::move(policy));
+    server.createRoute(HTTPMethod::GET, "/block",
+                       [](const HTTPRequest&, HTTPResponse& response) {
+                           std::this_thread::sleep_for(
+                               std::chrono::milliseconds(400));
+                           response.Send("done");
+                       });
+}
+
+/* runs `test` with a single reactor of either backend, io_uring falls back
+ * to epoll where the kernel does not offer it */
+template <typename Test>
+void forEachBackend(const Test& test) {
+    for (IOBackend backend : {IOBackend::Epoll, IOBackend::IOUring}) {
+        Context       context(backend == IOBackend::Epoll ? "epoll"
+                                                          : "io_uring");
+        ServerOptions options;
+        options.workerCount = 1;
+        options.ioBackend = backend;
+        test(options);
+    }
+}
+}  // namespace
+
+TEST(Server, AnswersHandlerRoute) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        client.Send("GET /hello HTTP/1.1\r\nHost: test\r\n\r\n");
+        Response response = client.Read();
+        EXPECT_EQ(response.status, 200);
+        EXPECT_EQ(response.body, "hello");
+        EXPECT_EQ(response.Header("Connection"), "keep-alive");
+    });
+}
+
+TEST(Server, AnswersPipelinedRequestsInOrder) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        std::string requests;
+        for (int i = 0; i < 20; i++) {
+            requests += "GET /echo/" + std::to_string(i) +
+                        " HTTP/1.1\r\nHost: test\r\n\r\n";
+        }
+        client.Send(requests);
+        for (int i = 0; i < 20; i++) {
+            Response response = client.Read();
+            ASSERT_EQ(response.status, 200);
+            EXPECT_EQ(response.body, std::to_string(i));
+        }
+    });
+}
+
+TEST(Server, RefusesMethodWithoutRoute) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        client.Send("DELETE /hello HTTP/1.1\r\nHost: test\r\n\r\n");
+        Response response = client.Read();
+        EXPECT_EQ(response.status, 405);
+        EXPECT_EQ(response.Header("Allow"), "GET, HEAD");
+    });
+}
+
+TEST(Server, ClosesWhenAsked) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        client.Send(
+            "GET /hello HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n");
+        EXPECT_EQ(client.Read().status, 200);
+        EXPECT_TRUE(client.WaitForClose());
+    });
+}
+
+TEST(Server, SendsNoContentWhereStatusHasNone) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, [](DinoScale::DinoScale& server) {
+            server.createRoute(
+                HTTPMethod::GET, "/status/:code",
+                [](const HTTPRequest& request, HTTPResponse& response) {
+                    int code = std::stoi(std::string(request.Param("code")));
+                    response.SetStatus(static_cast<HTTPStatusCode>(code));
+                    response.Send("body");
+                });
+        });
+        Client client(server.Port());
+
+        // a body sent along would be read as the next response
+        client.Send(get("/status/204") + get("/status/304") +
+                    get("/status/200"));
+        for (int status : {204, 304}) {
+            Context  context(std::to_string(status));
+            Response response = client.Read();
+            EXPECT_EQ(response.status, status);
+            EXPECT_EQ(response.head.find("Content-Length"), std::string::npos);
+            EXPECT_EQ(response.head.find("Content-Type"), std::string::npos);
+        }
+        Response response = client.Read();
+        EXPECT_EQ(response.status, 200);
+        EXPECT_EQ(response.Header("Content-Length"), "4");
+        EXPECT_EQ(response.body, "body");
+    });
+}
+
+TEST(Server, RejectsMalformedRequest) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        client.Send("GET /hello HTTP/1.1\r\nBroken header\r\n\r\n");
+        EXPECT_EQ(client.Read().status, 400);
+        EXPECT_TRUE(client.WaitForClose());
+    });
+}
+
+TEST(Server, ReceivesChunkedBody) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        client.Send(
+            "POST /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "5;ext=1\r\nhello\r\n0\r\nX-Checksum: 1\r\n\r\n");
+        Response response = client.Read();
+        EXPECT_EQ(response.status, 200);
+        EXPECT_EQ(response.body, "5");
+    });
+}
+
+TEST(Server, RejectsConflictingContentLengths) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        // the rest of the longer body must not pass for a request
+        std::string smuggled = "GET /echo/smuggled HTTP/1.1\r\n\r\n";
+        client.Send("POST /upload HTTP/1.1\r\nContent-Length: 5\r\n"
+                    "Content-Length: " +
+                    std::to_string(5 + smuggled.size()) + "\r\n\r\nhello" +
+                    smuggled);
+        EXPECT_EQ(client.Read().status, 400);
+        EXPECT_EQ(client.Read().status, 0);
+        EXPECT_TRUE(client.WaitForClose());
+    });
+}
+
+TEST(Server, RejectsChunkedBeforeOtherCoding) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        client.Send(
+            "POST /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+            "Transfer-Encoding: identity\r\n\r\n"
+            "5\r\nhello\r\n0\r\n\r\n");
+        EXPECT_EQ(client.Read().status, 400);
+        EXPECT_TRUE(client.WaitForClose());
+    });
+}
+
+TEST(Server, RejectsOversizedTrailer) {
+    forEachBackend([](ServerOptions options) {
+        options.bodyLimits.maxFieldSize = 64;
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        client.Send(
+            "POST /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "0\r\nX-Padding: " +
+            std::string(100, 'x') + "\r\n\r\n");
+        EXPECT_EQ(client.Read().status, 431);
+        EXPECT_TRUE(client.WaitForClose());
+    });
+}
+
+TEST(Server, ReadsOthersWhileInputIsPaused) {
+    forEachBackend([](const ServerOptions& options) {
+        std::atomic<bool> slept = false;
+        RunningServer     server(options, [&](DinoScale::DinoScale& server) {
+            addRoutes(server);
+            server.createRoute(
+                HTTPMethod::GET, "/sleep",
+                [&](HTTPRequest& request) -> Task<HTTPResponse> {
+                    co_await request.IO().Sleep(std::chrono::milliseconds(500));
+                    slept = true;
+                    HTTPResponse response;
+                    response.Send("slept");
+                    co_return response;
+                });
+        });
+
+        // sends far more than the receive buffers of io_uring hold while the
+        // handler sleeps, the server must leave it in the socket
+        Client      flooding(server.Port());
+        std::string requests = "GET /sleep HTTP/1.1\r\n\r\n";
+        while (requests.size() < 8 * 1024 * 1024) {
+            requests += "GET /hello HTTP/1.1\r\n\r\n";
+        }
+        std::thread sender([&] { flooding.Send(requests); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        Client other(server.Port());
+        other.Send("GET /hello HTTP/1.1\r\n\r\n");
+        EXPECT_EQ(other.Read().status, 200);
+        EXPECT_FALSE(slept);
+
+        shutdown(flooding.Fd(), SHUT_RDWR);  // ends the blocked send
+        sender.join();
+    });
+}
+
+TEST(Server, ServesHTTP2WithPriorKnowledge) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+        client.Send(h2cPreface());
+
+        // the server's SETTINGS and connection window come first, then the
+        // acknowledgement of the client's SETTINGS
+        Frame settings = readFrame(client);
+        ASSERT_EQ(settings.type, 0x4);
+        EXPECT_EQ(settings.flags, 0);
+        EXPECT_EQ(settings.payload.substr(0, 6), setting(0x3, 100));
+        Frame window = readFrame(client);
+        ASSERT_EQ(window.type, 0x8);
+        EXPECT_EQ(window.stream, 0u);
+        EXPECT_EQ(window.Word(0), 1024u * 1024 - 65535);
+        Frame ack = readFrame(client);
+        EXPECT_EQ(ack.type, 0x4);
+        EXPECT_EQ(ack.flags, 0x1);
+
+        HPACKEncoder encoder;
+        HPACKDecoder decoder;
+        // blocks are compressed in the order they are sent
+        std::string requests =
+            frame(0x1, 0x5, 1, requestBlock(encoder, "GET", "/hello"));
+        requests +=
+            frame(0x1, 0x5, 3, requestBlock(encoder, "GET", "/echo/two"));
+        client.Send(requests);
+        auto streams = readStreams(client, decoder, 2);
+        EXPECT_EQ(streams[1].status, 200);
+        EXPECT_EQ(streams[1].body, "hello");
+        EXPECT_EQ(streams[3].status, 200);
+        EXPECT_EQ(streams[3].body, "two");
+    });
+}
+
+TEST(Server, JoinsHeaderBlockContinuations) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+        HPACKEncoder  encoder;
+        HPACKDecoder  decoder;
+
+        std::string block = requestBlock(encoder, "GET", "/echo/continued");
+        client.Send(h2cPreface() + frame(0x1, 0x1, 1, block.substr(0, 3)) +
+                    frame(0x9, 0, 1, block.substr(3, 4)) +
+                    frame(0x9, 0x4, 1, block.substr(7)));
+        auto streams = readStreams(client, decoder, 1);
+        EXPECT_EQ(streams[1].status, 200);
+        EXPECT_EQ(streams[1].body, "continued");
+
+        // nothing else may come between the fragments of a block
+        block = requestBlock(encoder, "GET", "/hello");
+        client.Send(frame(0x1, 0x1, 3, block.substr(0, 3)) +
+                    frame(0x6, 0, 0, "12345678") +
+                    frame(0x9, 0x4, 3, block.substr(3)));
+        Frame read;
+        do {
+            read = readFrame(client);
+        } while (read.type >= 0 && read.type != 0x7);
+        ASSERT_EQ(read.type, 0x7);
+        EXPECT_EQ(read.Word(4), 0x1u);  // PROTOCOL_ERROR
+        EXPECT_TRUE(client.WaitForClose());
+    });
+}
+
+TEST(Server, SendsDataWithinFlowControlWindow) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+        HPACKEncoder  encoder;
+
+        // streams may take 4 bytes until the client grows their window
+        client.Send(std::string(HTTP2Preface) +
+                    frame(0x4, 0, 0, setting(0x4, 4)) +
+                    frame(0x1, 0x5, 1,
+                          requestBlock(encoder, "GET", "/echo/abcdefghij")));
+        Frame read;
+        do {
+            read = readFrame(client);
+        } while (read.type >= 0 && read.type != 0x0);
+        ASSERT_EQ(read.type, 0x0);
+        EXPECT_EQ(read.payload, "abcd");
+        EXPECT_EQ(read.flags, 0);
+
+        // the PING is answered, while no more DATA is sent
+        client.Send(frame(0x6, 0, 0, "12345678"));
+        do {
+            read = readFrame(client);
+            EXPECT_NE(read.type, 0x0);
+        } while (read.type >= 0 && read.type != 0x6);
+        ASSERT_EQ(read.type, 0x6);
+
+        client.Send(frame(0x8, 0, 1, word(100)));
+        read = readFrame(client);
+        ASSERT_EQ(read.type, 0x0);
+        EXPECT_EQ(read.payload, "efghij");
+        EXPECT_EQ(read.flags, 0x1);
+    });
+}
+
+TEST(Server, ReplenishesRequestBodyWindow) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+        HPACKEncoder  encoder;
+        HPACKDecoder  decoder;
+
+        // half of the stream window of 256 KiB is used up after 8 frames
+        std::string upload =
+            h2cPreface() +
+            frame(0x1, 0x4, 1, requestBlock(encoder, "POST", "/upload"));
+        for (int i = 0; i < 9; i++) {
+            upload += frame(0x0, 0, 1, std::string(16384, 'u'));
+        }
+        client.Send(upload);
+        Frame read;
+        do {
+            read = readFrame(client);
+        } while (read.type >= 0 && !(read.type == 0x8 && read.stream == 1));
+        ASSERT_EQ(read.type, 0x8);
+        EXPECT_EQ(read.Word(0), 8u * 16384);
+
+        client.Send(frame(0x0, 0x1, 1));
+        auto streams = readStreams(client, decoder, 1);
+        EXPECT_EQ(streams[1].status, 200);
+        EXPECT_EQ(streams[1].body, std::to_string(9 * 16384));
+    });
+}
+
+TEST(Server, ResetsHTTP2Streams) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+        HPACKEncoder  encoder;
+        HPACKDecoder  decoder;
+
+        // a stream the client cancels is dropped with the rest of its body,
+        // and one whose body disagrees with its length is reset
+        std::string frames = h2cPreface();
+        frames += frame(0x1, 0x4, 1, requestBlock(encoder, "POST", "/upload"));
+        frames += frame(0x3, 0, 1, word(0x8)) + frame(0x0, 0x1, 1, "late");
+        frames += frame(0x1, 0x4, 3,
+                        requestBlock(encoder, "POST", "/upload",
+                                     {{"content-length", "5"}}));
+        frames += frame(0x0, 0x1, 3, "abc");
+        frames += frame(0x1, 0x4, 5,
+                        requestBlock(encoder, "POST", "/upload",
+                                     {{"content-length", "5"},
+                                      {"content-length", "6"}}));
+        frames += frame(0x1, 0x5, 7, requestBlock(encoder, "GET", "/hello"));
+        client.Send(frames);
+        auto streams = readStreams(client, decoder, 3);
+        EXPECT_EQ(streams.count(1), 0u);
+        EXPECT_EQ(streams[3].reset, 0x1);  // PROTOCOL_ERROR
+        EXPECT_EQ(streams[5].reset, 0x1);
+        EXPECT_EQ(streams[7].status, 200);
+        EXPECT_EQ(streams[7].body, "hello");
+    });
+}
+
+TEST(Server, AnswersConditionalFileRequests) {
+    TempFile file;
+    forEachBackend([&](const ServerOptions& options) {
+        RunningServer server(options, [&](DinoScale::DinoScale& server) {
+            server.createRoute(HTTPMethod::GET, "/file", file.Path());
+        });
+        Client client(server.Port());
+
+        client.Send(get("/file"));
+        Response full = client.Read();
+        ASSERT_EQ(full.status, 200);
+        EXPECT_EQ(full.body, file.content);
+        std::string etag(full.Header("ETag"));
+        std::string lastModified(full.Header("Last-Modified"));
+        ASSERT_NE(etag, "");
+
+        client.Send(get("/file", "If-None-Match: \"x\", " + etag + "\r\n"));
+        Response current = client.Read();
+        EXPECT_EQ(current.status, 304);
+        EXPECT_EQ(current.body, "");
+        EXPECT_EQ(current.Header("ETag"), etag);
+
+        client.Send(
+            get("/file", "If-Modified-Since: " + lastModified + "\r\n"));
+        EXPECT_EQ(client.Read().status, 304);
+
+        // If-None-Match decides alone when both are sent
+        client.Send(get("/file", "If-None-Match: \"x\"\r\nIf-Modified-Since: " +
+                                     lastModified + "\r\n"));
+        EXPECT_EQ(client.Read().status, 200);
+    });
+}
+
+TEST(Server, ServesByteRanges) {
+    TempFile file;
+    forEachBackend([&](const ServerOptions& options) {
+        RunningServer server(options, [&](DinoScale::DinoScale& server) {
+            server.createRoute(HTTPMethod::GET, "/file", file.Path());
+        });
+        Client client(server.Port());
+
+        client.Send(get("/file", "Range: bytes=10-19\r\n"));
+        Response part = client.Read();
+        EXPECT_EQ(part.status, 206);
+        EXPECT_EQ(part.Header("Content-Range"), "bytes 10-19/1000");
+        EXPECT_EQ(part.body, file.content.substr(10, 10));
+
+        client.Send(get("/file", "Range: bytes=-5\r\n"));
+        part = client.Read();
+        EXPECT_EQ(part.status, 206);
+        EXPECT_EQ(part.Header("Content-Range"), "bytes 995-999/1000");
+        EXPECT_EQ(part.body, file.content.substr(995));
+
+        client.Send(get("/file", "Range: bytes=2000-\r\n"));
+        Response beyond = client.Read();
+        EXPECT_EQ(beyond.status, 416);
+        EXPECT_EQ(beyond.Header("Content-Range"), "bytes */1000");
+        EXPECT_EQ(beyond.body, "");
+    });
+}
+
+TEST(Server, ServesSeveralRangesAsMultipart) {
+    TempFile file;
+    forEachBackend([&](const ServerOptions& options) {
+        RunningServer server(options, [&](DinoScale::DinoScale& server) {
+            server.createRoute(HTTPMethod::GET, "/file", file.Path());
+        });
+        Client client(server.Port());
+        client.Send(get("/file"));
+        std::string type(client.Read().Header("Content-Type"));
+
+        client.Send(get("/file", "Range: bytes=0-1, 500-502\r\n"));
+        Response parts = client.Read();
+        ASSERT_EQ(parts.status, 206);
+        std::string_view contentType = parts.Header("Content-Type");
+        std::string_view prefix = "multipart/byteranges; boundary=";
+        ASSERT_EQ(contentType.substr(0, prefix.size()), prefix);
+        std::string boundary(contentType.substr(prefix.size()));
+
+        std::string expected;
+        for (auto [first, last] : {std::pair(0, 1), std::pair(500, 502)}) {
+            expected += "\r\n--" + boundary + "\r\nContent-Type: " + type +
+                        "\r\nContent-Range: bytes " + std::to_string(first) +
+                        "-" + std::to_string(last) + "/1000\r\n\r\n" +
+                        file.content.substr(first, last - first + 1);
+        }
+        expected += "\r\n--" + boundary + "--\r\n";
+        EXPECT_EQ(parts.body, expected);
+    });
+}
+
+TEST(Server, AppliesRangesOnlyWhileIfRangeMatches) {
+    TempFile file;
+    forEachBackend([&](ServerOptions options) {
+        options.maxByteRanges = 2;
+        RunningServer server(options, [&](DinoScale::DinoScale& server) {
+            server.createRoute(HTTPMethod::GET, "/file", file.Path());
+        });
+        Client client(server.Port());
+        client.Send(get("/file"));
+        Response    full = client.Read();
+        std::string etag(full.Header("ETag"));
+        std::string lastModified(full.Header("Last-Modified"));
+
+        std::string range = "Range: bytes=0-9\r\n";
+        client.Send(get("/file", range + "If-Range: " + etag + "\r\n"));
+        EXPECT_EQ(client.Read().status, 206);
+        client.Send(get("/file", range + "If-Range: " + lastModified + "\r\n"));
+        EXPECT_EQ(client.Read().status, 206);
+
+        // a stale validator gets the whole file
+        client.Send(get("/file", range + "If-Range: \"stale\"\r\n"));
+        Response stale = client.Read();
+        EXPECT_EQ(stale.status, 200);
+        EXPECT_EQ(stale.body, file.content);
+
+        // so do more ranges than `maxByteRanges`
+        client.Send(get("/file", "Range: bytes=0-0,2-2,4-4\r\n"));
+        Response many = client.Read();
+        EXPECT_EQ(many.status, 200);
+        EXPECT_EQ(many.body, file.content);
+        client.Send(get("/file", "Range: bytes=0-0,2-2\r\n"));
+        EXPECT_EQ(client.Read().status, 206);
+    });
+}
+
+TEST(Server, CoalescesRequestsForCachedResponse) {
+    forEachBackend([](ServerOptions options) {
+        options.handlerThreads = 2;
+        std::atomic<int> runs = 0;
+        RunningServer    server(options, [&](DinoScale::DinoScale& server) {
+            addCachedRoutes(server, runs, std::chrono::milliseconds(500));
+        });
+
+        // all of them arrive while the first is being produced
+        std::vector<std::unique_ptr<Client>> clients;
+        for (int i = 0; i < 8; i++) {
+            clients.push_back(std::make_unique<Client>(server.Port()));
+            clients.back()->Send(get("/cached"));
+        }
+        for (auto& client : clients) {
+            Response response = client->Read();
+            EXPECT_EQ(response.status, 200);
+            EXPECT_EQ(response.body, "run 1");
+        }
+        EXPECT_EQ(runs.load(), 1);
+
+        // served from the cache until the ttl passed
+        clients[0]->Send(get("/cached"));
+        EXPECT_EQ(clients[0]->Read().body, "run 1");
+        std::this_thread::sleep_for(std::chrono::milliseconds(600));
+        clients[0]->Send(get("/cached"));
+        EXPECT_EQ(clients[0]->Read().body, "run 2");
+        EXPECT_EQ(runs.load(), 2);
+    });
+}
+
+TEST(Server, ShedsWaitersWithTheRequestTheyWaitFor) {
+    forEachBackend([](ServerOptions options) {
+        options.handlerThreads = 1;
+        options.sheddingTarget = std::chrono::milliseconds(10);
+        options.sheddingInterval = std::chrono::milliseconds(50);
+        std::atomic<int> runs = 0;
+        RunningServer    server(options, [&](DinoScale::DinoScale& server) {
+            addCachedRoutes(server, runs, std::chrono::seconds(60));
+        });
+
+        // the handler thread is busy while the cached response is asked
+        // for, so the request producing it waits in the queue for too long
+        Client blocker(server.Port());
+        blocker.Send(get("/block"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::vector<std::unique_ptr<Client>> clients;
+        for (int i = 0; i < 4; i++) {
+            clients.push_back(std::make_unique<Client>(server.Port()));
+            clients.back()->Send(get("/cached"));
+        }
+        for (auto& client : clients) {
+            Response response = client->Read();
+            EXPECT_EQ(response.status, 503);
+            EXPECT_EQ(response.Header("Retry-After"), "1");
+        }
+        EXPECT_EQ(blocker.Read().body, "done");
+        EXPECT_EQ(runs.load(), 0);
+
+        // nothing was cached, the next request runs the handler
+        clients[0]->Send(get("/cached"));
+        Response response = clients[0]->Read();
+        EXPECT_EQ(response.status, 200);
+        EXPECT_EQ(response.body, "run 1");
+    });
+}
+
+TEST(Server, SkipsEventsOfConnectionClosedEarlierInBatch) {
+    forEachBackend([](ServerOptions options) {
+        options.handlerThreads = 1;
+        std::atomic<bool> finish = false;
+        RunningServer     server(options, [&](DinoScale::DinoScale& server) {
+            addRoutes(server);
+            server.createRoute(
+                HTTPMethod::GET, "/wait",
+                [&](const HTTPRequest&, HTTPResponse& response) {
+                    while (!finish) {
+                        std::this_thread::sleep_for(
+                            std::chrono::milliseconds(1));
+                    }
+                    response.Send("done");
+                });
+            // runs on the reactor thread, holding it up
+            WebSocketHandlers handlers;
+            handlers.onMessage = [](WebSocket&, std::string_view,
+                                    WebSocketOpcode) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            };
+            server.createWebSocket("/stall", std::move(handlers));
+        });
+
+        Client stalling(server.Port());
+        stalling.Send(webSocketUpgrade("/stall"));
+        ASSERT_EQ(stalling.Read().status, 101);
+        Client closing(server.Port());
+        closing.Send(get("/wait", "Connection: close\r\n"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        // the handler finishes and one more byte arrives while the reactor
+        // is held up, so it learns of both at once and closes the
+        // connection before it gets to the byte
+        stalling.Send(webSocketFrame(0x81, "stall"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        finish = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        closing.Send("x");
+        EXPECT_EQ(closing.Read().body, "done");
+        EXPECT_TRUE(closing.WaitForClose());
+
+        // the connection was recycled once, so these get one each
+        Client first(server.Port());
+        Client second(server.Port());
+        first.Send(get("/echo/first"));
+        second.Send(get("/echo/second"));
+        EXPECT_EQ(first.Read().body, "first");
+        EXPECT_EQ(second.Read().body, "second");
+    });
+}
+
+TEST(Server, SendsGoAwayOnPingFlood) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        // more PINGs than are answered without the client reading any
+        std::string flood = h2cPreface();
+        for (int i = 0; i < 1200; i++) {
+            flood += frame(0x6, 0, 0, "12345678");
+        }
+        client.Send(flood);
+
+        Frame read;
+        int   acks = 0;
+        do {
+            read = readFrame(client);
+            acks += read.type == 0x6;
+        } while (read.type >= 0 && read.type != 0x7);
+        ASSERT_EQ(read.type, 0x7);
+        EXPECT_EQ(read.Word(4), 0xbu);  // ENHANCE_YOUR_CALM
+        EXPECT_LE(acks, 1000);
+        EXPECT_TRUE(client.WaitForClose());
+    });
+}
+
+TEST(Server, AnswersWebSocketHandshake) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addWebSocket);
+        {
+            Client client(server.Port());
+            client.Send(webSocketUpgrade("/ws"));
+            Response response = client.Read();
+            EXPECT_EQ(response.status, 101);
+            EXPECT_EQ(response.Header("Sec-WebSocket-Accept"),
+                      "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+            EXPECT_EQ(response.Header("Upgrade"), "websocket");
+        }
+        {
+            // no upgrade, or one of another version
+            Client client(server.Port());
+            client.Send("GET /ws HTTP/1.1\r\nHost: test\r\n\r\n");
+            Response response = client.Read();
+            EXPECT_EQ(response.status, 426);
+            EXPECT_EQ(response.Header("Sec-WebSocket-Version"), "13");
+            std::string upgrade = webSocketUpgrade("/ws");
+            upgrade.replace(upgrade.find("Version: 13"), 11, "Version: 8");
+            client.Send(upgrade);
+            EXPECT_EQ(client.Read().status, 426);
+        }
+        {
+            Client      client(server.Port());
+            std::string upgrade = webSocketUpgrade("/ws");
+            upgrade.replace(upgrade.find("dGhl"), 4, "dGh");
+            client.Send(upgrade);
+            EXPECT_EQ(client.Read().status, 400);
+        }
+    });
+}
+
+TEST(Server, AnswersUpgradeToPlainRouteOverHTTP) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addWebSocket);
+        Client        client(server.Port());
+
+        // only routes created with WebSocket handlers switch protocols
+        client.Send(webSocketUpgrade("/hello"));
+        Response response = client.Read();
+        EXPECT_EQ(response.status, 200);
+        EXPECT_EQ(response.body, "hello");
+    });
+}
+
+TEST(Server, ReassemblesWebSocketMessages) {
+    forEachBackend([](const ServerOptions& options) {
+        RunningServer server(options, addWebSocket);
+        Client        client(server.Port());
+        client.Send(webSocketUpgrade("/ws"));
+        ASSERT_EQ(client.Read().status, 101);
+
+        // a frame trickling in over several reads
+        std::string echo = webSocketFrame(0x82, std::string(300, 'b'));
+        for (std::size_t at = 0; at < echo.size(); at += 7) {
+            client.Send(echo.substr(at, 7));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        WebSocketFrame read = readWebSocketFrame(client);
+        EXPECT_EQ(read.first, 0x82);
+        EXPECT_EQ(read.payload, std::string(300, 'b'));
+
+        // fragments with a ping between them, answered right away
+        client.Send(webSocketFrame(0x01, "frag") + webSocketFrame(0x89, "p") +
+                    webSocketFrame(0x00, "men") + webSocketFrame(0x80, "ts"));
+        read = readWebSocketFrame(client);
+        EXPECT_EQ(read.first, 0x8a);
+        EXPECT_EQ(read.payload, "p");
+        read = readWebSocketFrame(client);
+        EXPECT_EQ(read.first, 0x81);
+        EXPECT_EQ(read.payload, "fragments");
+
+        // a continuation without a message to continue
+        client.Send(webSocketFrame(0x80, "stray"));
+        read = readWebSocketFrame(client);
+        EXPECT_EQ(read.first, 0x88);
+        EXPECT_EQ(read.CloseCode(), 1002);
+        EXPECT_TRUE(client.WaitForClose());
+    });
+}
+
+TEST(Server, ValidatesWebSocketCloseCodes) {
+    struct Case {
+        std::string payload;
+        int         answer;
+    };
+    const Case cases[] = {
+        {closePayload(1000, "bye"), 1000},
+        {closePayload(4001), 4001},  // private use
+        {"", 1000},                  // no code is answered as normal
+        {closePayload(1005), 1002},  // never sent on the wire
+        {closePayload(2000), 1002},  // unassigned
+        {"\x03", 1002},              // half a code
+        {closePayload(1000, "\xc3\x28"), 1007},
+    };
+    forEachBackend([&](const ServerOptions& options) {
+        RunningServer server(options, addWebSocket);
+        for (const Case& test : cases) {
+            Context context("close code " + std::to_string(test.answer));
+            Client  client(server.Port());
+            client.Send(webSocketUpgrade("/ws"));
+            ASSERT_EQ(client.Read().status, 101);
+
+            client.Send(webSocketFrame(0x88, test.payload));
+            WebSocketFrame read = readWebSocketFrame(client);
+            EXPECT_EQ(read.first, 0x88);
+            EXPECT_EQ(read.CloseCode(), test.answer);
+            EXPECT_TRUE(client.WaitForClose());
+        }
+    });
+}
+
+TEST(Server, BroadcastsToWebSocketGroup) {
+    forEachBackend([](const ServerOptions& options) {
+        WebSocketGroup group;  // outlives the server
+        RunningServer  server(options, [&](DinoScale::DinoScale& server) {
+            WebSocketHandlers handlers;
+            handlers.onOpen = [&](WebSocket& socket, const HTTPRequest&) {
+                group.Join(socket);
+                socket.Send("joined");
+            };
+            handlers.onMessage = [&](WebSocket& socket, std::string_view,
+                                     WebSocketOpcode) { group.Leave(socket); };
+            server.createWebSocket("/room", std::move(handlers));
+        });
+
+        Client first(server.Port());
+        Client second(server.Port());
+        Client third(server.Port());
+        for (Client* client : {&first, &second, &third}) {
+            client->Send(webSocketUpgrade("/room"));
+            ASSERT_EQ(client->Read().status, 101);
+            ASSERT_EQ(readWebSocketFrame(*client).payload, "joined");
+        }
+        EXPECT_EQ(group.Size(), 3u);
+
+        group.Broadcast("all");
+        for (Client* client : {&first, &second, &third}) {
+            WebSocketFrame read = readWebSocketFrame(*client);
+            EXPECT_EQ(read.first, 0x81);
+            EXPECT_EQ(read.payload, "all");
+        }
+
+        // one leaves by asking, one by closing
+        first.Send(webSocketFrame(0x81, "leave"));
+        third.Close();
+        for (int wait = 0; wait < 500 && group.Size() > 1; wait++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ASSERT_EQ(group.Size(), 1u);
+        group.Broadcast("rest", WebSocketOpcode::Binary);
+        WebSocketFrame read = readWebSocketFrame(second);
+        EXPECT_EQ(read.first, 0x82);
+        EXPECT_EQ(read.payload, "rest");
+
+        // a ping is answered, so nothing of the broadcast was queued before
+        first.Send(webSocketFrame(0x89, "after"));
+        read = readWebSocketFrame(first);
+        EXPECT_EQ(read.first, 0x8a);
+        EXPECT_EQ(read.payload, "after");
+    });
+}
+
+TEST(Server, BroadcastsToMemberClosingInSameBatch) {
+    forEachBackend([](const ServerOptions& options) {
+        WebSocketGroup group;  // outlives the server
+        RunningServer  server(options, [&](DinoScale::DinoScale& server) {
+            addRoutes(server);
+            WebSocketHandlers room;
+            room.onOpen = [&](WebSocket& socket, const HTTPRequest&) {
+                group.Join(socket);
+            };
+            server.createWebSocket("/room", std::move(room));
+            // runs on the reactor thread, holding it up
+            WebSocketHandlers stall;
+            stall.onMessage = [](WebSocket&, std::string_view,
+                                 WebSocketOpcode) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            };
+            server.createWebSocket("/stall", std::move(stall));
+        });
+
+        Client stalling(server.Port());
+        stalling.Send(webSocketUpgrade("/stall"));
+        ASSERT_EQ(stalling.Read().status, 101);
+        Client member(server.Port());
+        member.Send(webSocketUpgrade("/room"));
+        ASSERT_EQ(member.Read().status, 101);
+        for (int wait = 0; wait < 500 && group.Size() < 1; wait++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ASSERT_EQ(group.Size(), 1u);
+
+        // serving the broadcast finds the member closed and releases it,
+        // before the reactor gets to the event of the close
+        stalling.Send(webSocketFrame(0x81, "stall"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        group.Broadcast("all");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        member.Close();
+        for (int wait = 0; wait < 500 && group.Size() > 0; wait++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        EXPECT_EQ(group.Size(), 0u);
+
+        // the connection was recycled once, so these get one each
+        Client first(server.Port());
+        Client second(server.Port());
+        first.Send(get("/echo/first"));
+        second.Send(get("/echo/second"));
+        EXPECT_EQ(first.Read().body, "first");
+        EXPECT_EQ(second.Read().body, "second");
+    });
+}
+
+TEST(Server, StopsReadingPingsWhilePongsQueue) {
+    forEachBackend([](ServerOptions options) {
+        options.webSocketMaxQueuedBytes = 4096;
+        RunningServer server(options, addWebSocket);
+        Client        client(server.Port());
+        client.Send(webSocketUpgrade("/ws"));
+        ASSERT_EQ(client.Read().status, 101);
+
+        // pings are sent until the server stops taking them, which it must
+        // long before all of them are answered in its memory
+        std::string pings;
+        while (pings.size() < 1024 * 1024) {
+            pings += webSocketFrame(0x89, std::string(125, 'p'));
+        }
+        fcntl(client.Fd(), F_SETFL, O_NONBLOCK);
+        std::size_t sent = 0;
+        for (int stalls = 0; stalls < 5 && sent < 128u * 1024 * 1024;) {
+            std::size_t offset = sent % pings.size();
+            ssize_t     count = send(client.Fd(), pings.data() + offset,
+                                     pings.size() - offset, MSG_NOSIGNAL);
+            if (count > 0) {
+                sent += count;
+                stalls = 0;
+            } else {
+                stalls++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+        EXPECT_LT(sent, 128u * 1024 * 1024);
+    });
+}
+
+TEST(Server, DropsClientTricklingRequestHead) {
+    forEachBackend([](ServerOptions options) {
+        options.headerTimeout = std::chrono::seconds(1);
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        // a header line every 100 ms does not extend the timeout
+        auto start = std::chrono::steady_clock::now();
+        client.Send("GET /hello HTTP/1.1\r\nHost: test\r\n");
+        pollfd answer{client.Fd(), POLLIN, 0};
+        for (int line = 0; line < 50 && poll(&answer, 1, 100) == 0; line++) {
+            client.Send("X-Slow: " + std::to_string(line) + "\r\n");
+        }
+        EXPECT_TRUE(client.WaitForClose());
+        EXPECT_LT(std::chrono::steady_clock::now() - start,
+                  std::chrono::seconds(3));
+    });
+}
+
+TEST(Server, ClosesIdleKeepAliveConnection) {
+    forEachBackend([](ServerOptions options) {
+        options.keepAliveTimeout = std::chrono::seconds(1);
+        RunningServer server(options, addRoutes);
+        Client        client(server.Port());
+
+        client.Send("GET /hello HTTP/1.1\r\nHost: test\r\n\r\n");
+        ASSERT_EQ(client.Read().status, 200);
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_TRUE(client.WaitForClose());
+        auto idle = std::chrono::steady_clock::now() - start;
+        EXPECT_GE(idle, std::chrono::milliseconds(900));
+        EXPECT_LT(idle, std::chrono::seconds(3));
+    });
+}
+
+TEST(Server, StopsWithClientsConnected) {
+    forEachBackend([](const ServerOptions& options) {
+        auto   server = std::make_unique<RunningServer>(options, addRoutes);
+        Client idle(server->Port());
+        Client busy(server->Port());
+        busy.Send("GET /hello HTTP/1.1\r\nHost: test\r\n\r\n");
+        EXPECT_EQ(busy.Read().status, 200);
+
+        server.reset();
+        EXPECT_TRUE(idle.WaitForClose());
+        EXPECT_TRUE(busy.WaitForClose());
+    });
+}
@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "utils/TimerWheel.hpp"
+
+using namespace DinoScale;
+
+namespace {
+struct Timer {
+    TimerNode<Timer> node;
+    std::int64_t     firedAt = -1;  // tick of the last firing
+    int              firings = 0;
+
+    Timer() { node.owner = this; }
+};
+
+using Clock = TimerWheel<Timer>::Clock;
+
+constexpr std::chrono::milliseconds tick{1};
+
+/* a clock of its own: time is counted in ticks from a fixed origin */
+const Clock::time_point origin = Clock::time_point() + std::chrono::hours(1);
+
+Clock::time_point at(std::int64_t ticks) {
+    return origin + tick * ticks;
+}
+
+/* advances `wheel` one tick at a time through `last`, recording firings */
+void advanceThrough(TimerWheel<Timer>& wheel, std::int64_t first,
+                    std::int64_t last) {
+    for (std::int64_t now = first; now <= last; now++) {
+        wheel.Advance(at(now), [now](Timer& timer) {
+            timer.firedAt = now;
+            timer.firings++;
+        });
+    }
+}
+}  // namespace
+
+TEST(TimerWheel, NeverFiresEarly) {
+    TimerWheel<Timer> wheel(tick, origin);
+    Timer             exact;
+    Timer             between;
+    wheel.Schedule(exact.node, at(5));
+    wheel.Schedule(between.node, at(5) + std::chrono::microseconds(300));
+    EXPECT_EQ(wheel.Size(), 2u);
+    EXPECT_TRUE(wheel.ExpiryOf(between.node) == at(6));
+
+    advanceThrough(wheel, 1, 10);
+    EXPECT_EQ(exact.firedAt, 5);
+    EXPECT_EQ(between.firedAt, 6);  // rounded up to the next tick
+    EXPECT_EQ(wheel.Size(), 0u);
+    EXPECT_FALSE(exact.node.IsScheduled());
+
+    // deadlines already past fire on the next tick
+    Timer late;
+    wheel.Schedule(late.node, at(2));
+    advanceThrough(wheel, 11, 11);
+    EXPECT_EQ(late.firedAt, 11);
+}
+
+TEST(TimerWheel, CascadesAtLevelBoundaries) {
+    TimerWheel<Timer> wheel(tick, origin);
+    // scheduled mid-slot, so timers move down levels as the wheel turns
+    advanceThrough(wheel, 1, 50);
+
+    // around the first wrap of each level
+    std::vector<std::int64_t> expiries = {
+        63, 64, 65, 127, 128, 4095, 4096, 4097, 4160, 8191, 8192,
+        262143, 262144, 262200};
+    std::vector<Timer> timers(expiries.size());
+    for (std::size_t i = 0; i < timers.size(); i++) {
+        wheel.Schedule(timers[i].node, at(expiries[i]));
+    }
+    advanceThrough(wheel, 51, 270000);
+    for (std::size_t i = 0; i < timers.size(); i++) {
+        Testing::Context context("expiry " + std::to_string(expiries[i]));
+        EXPECT_EQ(timers[i].firedAt, expiries[i]);
+        EXPECT_EQ(timers[i].firings, 1);
+    }
+}
+
+TEST(TimerWheel, ClampsDeadlinesBeyondRange) {
+    constexpr std::int64_t range = std::int64_t{1} << 24;  // 64^4 ticks
+    TimerWheel<Timer>      wheel(tick, origin);
+    Timer                  far;
+    wheel.Schedule(far.node, at(range * 3));
+    EXPECT_TRUE(wheel.ExpiryOf(far.node) == at(range - 1));
+
+    // a single Advance covering many ticks fires on the way
+    wheel.Advance(at(range - 2), [](Timer& timer) { timer.firings++; });
+    EXPECT_EQ(far.firings, 0);
+    wheel.Advance(at(range - 1), [](Timer& timer) { timer.firings++; });
+    EXPECT_EQ(far.firings, 1);
+}
+
+TEST(TimerWheel, CancelsAndReschedules) {
+    TimerWheel<Timer> wheel(tick, origin);
+    Timer             cancelled;
+    Timer             moved;
+    Timer             repeating;
+    wheel.Schedule(cancelled.node, at(10));
+    wheel.Schedule(moved.node, at(10));
+    wheel.Schedule(moved.node, at(200));
+    wheel.Schedule(repeating.node, at(10));
+    wheel.Cancel(cancelled.node);
+    wheel.Cancel(cancelled.node);  // no-op once unscheduled
+    EXPECT_EQ(wheel.Size(), 2u);
+
+    // a firing callback may schedule its timer again
+    for (std::int64_t now = 1; now <= 300; now++) {
+        wheel.Advance(at(now), [&](Timer& timer) {
+            timer.firedAt = now;
+            timer.firings++;
+            if (&timer == &repeating && timer.firings < 3) {
+                wheel.Schedule(timer.node, at(now + 10));
+            }
+        });
+    }
+    EXPECT_EQ(cancelled.firings, 0);
+    EXPECT_EQ(moved.firedAt, 200);
+    EXPECT_EQ(moved.firings, 1);
+    EXPECT_EQ(repeating.firedAt, 30);
+    EXPECT_EQ(repeating.firings, 3);
+}
+
+TEST(TimerWheel, ReportsTimeUntilWork) {
+    TimerWheel<Timer> wheel(tick, origin);
+    EXPECT_TRUE(wheel.TimeUntilNext(origin) == Clock::duration::max());
+
+    Timer soon;
+    wheel.Schedule(soon.node, at(10));
+    EXPECT_TRUE(wheel.TimeUntilNext(at(0)) == tick * 10);
+    EXPECT_TRUE(wheel.TimeUntilNext(at(4)) == tick * 6);
+    EXPECT_TRUE(wheel.TimeUntilNext(at(12)) == Clock::duration::zero());
+
+    // a timer on a higher level needs work when its slot cascades
+    Timer later;
+    wheel.Cancel(soon.node);
+    wheel.Schedule(later.node, at(1000));
+    EXPECT_TRUE(wheel.TimeUntilNext(at(0)) == tick * 64);
+}
@@ -0,0 +1,109 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "Test.hpp"
+#include "core/Router.hpp"
+#include "core/WebSocketFrame.hpp"
+#include "simd/Mask.hpp"
+
+using namespace DinoScale;
+
+namespace {
+constexpr unsigned char key[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+/* bytes which differ at every position, so a shifted key shows */
+std::string payload(std::size_t length) {
+    std::string bytes;
+    for (std::size_t i = 0; i < length; i++) {
+        bytes.push_back(static_cast<char>(i * 7 + 3));
+    }
+    return bytes;
+}
+
+/* what `Mask::Apply` computes, a byte at a time */
+std::string masked(std::string_view bytes, std::size_t offset) {
+    std::string out(bytes);
+    for (std::size_t i = 0; i < out.size(); i++) {
+        out[i] = static_cast<char>(out[i] ^ key[(offset + i) % 4]);
+    }
+    return out;
+}
+
+std::string frameHeader(WebSocketOpcode opcode, std::size_t length,
+                        bool final = true) {
+    std::string out;
+    AppendWebSocketFrameHeader(out, opcode, length, final);
+    return out;
+}
+}  // namespace
+
+TEST(Mask, MatchesBytewiseMasking) {
+    // every vector width, with every remainder and key position
+    for (std::size_t length = 0; length <= 100; length++) {
+        for (std::size_t offset = 0; offset < 8; offset++) {
+            Testing::Context context("length " + std::to_string(length) +
+                                     " offset " + std::to_string(offset));
+            std::string in = payload(length);
+            std::string out(length, '\0');
+            Mask::Apply(in.data(), out.data(), length, key, offset);
+            ASSERT_EQ(out, masked(in, offset));
+        }
+    }
+}
+
+TEST(Mask, UnmasksInPlace) {
+    std::string bytes = payload(77);
+    std::string expected = masked(bytes, 3);
+    Mask::Apply(bytes.data(), bytes.data(), bytes.size(), key, 3);
+    EXPECT_EQ(bytes, expected);
+}
+
+TEST(Mask, ContinuesAcrossSplitPayloads) {
+    // a payload arriving over reads of odd lengths
+    std::string in = payload(300);
+    std::string out(in.size(), '\0');
+    std::size_t done = 0;
+    for (std::size_t piece : {1u, 3u, 33u, 5u, 17u, 65u, 0u, 131u, 45u}) {
+        Mask::Apply(in.data() + done, out.data() + done, piece, key, done);
+        done += piece;
+    }
+    ASSERT_EQ(done, in.size());
+    EXPECT_EQ(out, masked(in, 0));
+}
+
+TEST(WebSocketFrame, AcceptsKeyOfRFCExample) {
+    // RFC 6455 section 1.3
+    std::string accept;
+    AppendWebSocketAccept(accept, "dGhlIHNhbXBsZSBub25jZQ==");
+    EXPECT_EQ(accept, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(WebSocketFrame, ChecksKeys) {
+    EXPECT_TRUE(IsWebSocketKey("dGhlIHNhbXBsZSBub25jZQ=="));
+    EXPECT_TRUE(IsWebSocketKey("AAAAAAAAAAAAAAAAAAA+/w=="));
+    EXPECT_FALSE(IsWebSocketKey(""));
+    EXPECT_FALSE(IsWebSocketKey("dGhlIHNhbXBsZSBub25jZQ"));     // no padding
+    EXPECT_FALSE(IsWebSocketKey("dGhlIHNhbXBsZSBub25jZQ=a"));   // 17 bytes
+    EXPECT_FALSE(IsWebSocketKey("dGhlIHNhbXBsZSBub25j-Q=="));   // alphabet
+    EXPECT_FALSE(IsWebSocketKey("dGhlIHNhbXBsZSBub25jZQ==="));  // too long
+}
+
+TEST(WebSocketFrame, PicksShortestLengthEncoding) {
+    EXPECT_EQ(frameHeader(WebSocketOpcode::Text, 0),
+              std::string("\x81\x00", 2));
+    EXPECT_EQ(frameHeader(WebSocketOpcode::Binary, 125), "\x82\x7d");
+    EXPECT_EQ(frameHeader(WebSocketOpcode::Text, 126, false),
+              std::string("\x01\x7e\x00\x7e", 4));
+    EXPECT_EQ(frameHeader(WebSocketOpcode::Text, 0xffff), "\x81\x7e\xff\xff");
+    EXPECT_EQ(frameHeader(WebSocketOpcode::Pong, 0x10000),
+              std::string("\x8a\x7f\x00\x00\x00\x00\x00\x01\x00\x00", 10));
+}
+
+TEST(Route, LeavesWebSocketUnsetByDefault) {
+    // routes are built positionally by the server, the handlers of a
+    // WebSocket route are the only thing that upgrades a connection
+    Route route{"/hello", "", nullptr, nullptr};
+    EXPECT_TRUE(route.webSocket == nullptr);
+    EXPECT_TRUE(Route().webSocket == nullptr);
+}
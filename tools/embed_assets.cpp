@@ -0,0 +1,309 @@
+/**
+ * Build time generator of embedded asset bundles.
+ *
+ *     dinoscale_embed <output header> <namespace> <asset directory>
+ *
+ * Writes a header defining `<namespace>::bundle`, an `EmbeddedBundle` of
+ * every regular file below the directory: the bytes as constexpr arrays,
+ * the response header and ETag of each file serialized like the static
+ * file cache does, and a perfect hash table from relative path to asset.
+ * The header checks every lookup with a `static_assert`, so a broken table
+ * fails the build instead of a request. Usually run through the
+ * `dinoscale_embed_assets` CMake function.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "constants/mimes.hpp"
+#include "constants/statuses.hpp"
+#include "core/EmbeddedAssets.hpp"
+#include "utils/HTTPDate.hpp"
+
+namespace {
+namespace fs = std::filesystem;
+
+struct Asset {
+    std::string path;  // relative, with forward slashes
+    std::string body;
+    std::string header;
+    std::size_t fieldsOffset = 0;
+    std::string etag;
+    std::string lastModified;
+    std::time_t modified = 0;
+    std::string contentType;
+};
+
+struct PerfectHash {
+    std::vector<std::uint32_t> displacements;
+    std::vector<std::int32_t>  slots;
+};
+
+bool readAsset(const fs::path& root, const fs::path& file, Asset& asset) {
+    std::ifstream input(file, std::ios::binary);
+    if (!input) {
+        return false;
+    }
+    asset.body.assign(std::istreambuf_iterator<char>(input),
+                      std::istreambuf_iterator<char>());
+    asset.path = file.lexically_relative(root).generic_string();
+    asset.contentType = DinoScale::MimeTypeForPath(asset.path);
+
+    // from the content, so a rebuild without changes keeps client caches
+    char etag[24];
+    std::snprintf(etag, sizeof(etag), "\"%016llx\"",
+                  static_cast<unsigned long long>(
+                      DinoScale::EmbeddedHash(asset.body)));
+    asset.etag = etag;
+
+    asset.modified = std::chrono::system_clock::to_time_t(
+        std::chrono::file_clock::to_sys(fs::last_write_time(file)));
+    char date[32];
+    asset.lastModified.assign(date,
+                              DinoScale::FormatHTTPDate(asset.modified, date));
+
+    asset.header = HTTPStatusLine(HTTPStatusCode::OK);
+    asset.fieldsOffset = asset.header.size();
+    asset.header += "Content-Type: " + asset.contentType +
+                    "\r\nContent-Length: " + std::to_string(asset.body.size()) +
+                    "\r\nETag: " + asset.etag +
+                    "\r\nLast-Modified: " + asset.lastModified +
+                    "\r\nAccept-Ranges: bytes\r\n";
+    return true;
+}
+
+/**
+ * Hash and displace: buckets are placed largest first, each trying
+ * displacements until all its keys land in free slots. The table starts
+ * with one slot per key and grows only if a bucket cannot be placed.
+ */
+bool buildPerfectHash(const std::vector<Asset>& assets, PerfectHash& table) {
+    std::size_t count = assets.size();
+    std::size_t bucketCount = std::max<std::size_t>(1, (count + 3) / 4);
+
+    std::vector<std::uint64_t> hashes;
+    for (const Asset& asset : assets) {
+        hashes.push_back(DinoScale::EmbeddedHash(asset.path));
+    }
+    std::vector<std::vector<std::size_t>> buckets(bucketCount);
+    for (std::size_t i = 0; i < count; i++) {
+        buckets[hashes[i] % bucketCount].push_back(i);
+    }
+    std::vector<std::size_t> order(bucketCount);
+    for (std::size_t i = 0; i < bucketCount; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) {
+                         return buckets[a].size() > buckets[b].size();
+                     });
+
+    for (std::size_t slotCount = std::max<std::size_t>(1, count);
+         slotCount <= 4 * count + 8; slotCount += slotCount / 8 + 1) {
+        table.displacements.assign(bucketCount, 0);
+        table.slots.assign(slotCount, -1);
+        bool placed = true;
+
+        for (std::size_t bucket : order) {
+            const std::vector<std::size_t>& keys = buckets[bucket];
+            if (keys.empty()) {
+                continue;
+            }
+            bool found = false;
+            for (std::uint32_t displacement = 0;
+                 displacement < (1u << 16) && !found; displacement++) {
+                std::vector<std::uint64_t> taken;
+                found = true;
+                for (std::size_t key : keys) {
+                    std::uint64_t slot =
+                        DinoScale::EmbeddedSlot(hashes[key], displacement) %
+                        slotCount;
+                    if (table.slots[slot] >= 0 ||
+                        std::find(taken.begin(), taken.end(), slot) !=
+                            taken.end()) {
+                        found = false;
+                        break;
+                    }
+                    taken.push_back(slot);
+                }
+                if (found) {
+                    table.displacements[bucket] = displacement;
+                    for (std::size_t i = 0; i < keys.size(); i++) {
+                        table.slots[taken[i]] = keys[i];
+                    }
+                }
+            }
+            if (!found) {
+                placed = false;
+                break;
+            }
+        }
+        if (placed) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* `bytes` as adjacent string literals, octal escapes where needed */
+void writeLiteral(std::ostream& out, std::string_view bytes) {
+    out << "\n    \"";
+    std::size_t column = 0;
+    for (unsigned char c : bytes) {
+        if (column >= 72) {
+            out << "\"\n    \"";
+            column = 0;
+        }
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+            column += 2;
+        } else if (c >= 0x20 && c < 0x7f && c != '?') {
+            out << c;
+            column++;
+        } else {
+            char escaped[5];
+            std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+            out << escaped;
+            column += 4;
+        }
+    }
+    out << '"';
+}
+
+void writeHeader(std::ostream& out, const std::string& name,
+                 const fs::path& directory, const std::vector<Asset>& assets,
+                 const PerfectHash& table) {
+    out << "// generated by dinoscale_embed from " << directory.string()
+        << ", do not edit\n"
+        << "#pragma once\n\n"
+        << "#include \"core/EmbeddedAssets.hpp\"\n\n"
+        << "namespace " << name << " {\n";
+    if (assets.empty()) {
+        out << "inline constexpr DinoScale::EmbeddedBundle bundle;\n"
+            << "}  // namespace " << name << "\n";
+        return;
+    }
+
+    out << "namespace detail {\n";
+    for (std::size_t i = 0; i < assets.size(); i++) {
+        out << "// " << assets[i].path << "\n"
+            << "inline constexpr char body" << i << "[] =";
+        writeLiteral(out, assets[i].body);
+        out << ";\ninline constexpr char header" << i << "[] =";
+        writeLiteral(out, assets[i].header);
+        out << ";\n";
+    }
+    out << "}  // namespace detail\n\n"
+        << "inline constexpr DinoScale::EmbeddedAsset assets[] = {\n";
+    for (std::size_t i = 0; i < assets.size(); i++) {
+        const Asset& asset = assets[i];
+        out << "    {\"" << asset.path << "\",\n"
+            << "     {detail::body" << i << ", sizeof(detail::body" << i
+            << ") - 1},\n"
+            << "     {detail::header" << i << ", sizeof(detail::header" << i
+            << ") - 1},\n"
+            << "     " << asset.fieldsOffset << ",\n"
+            << "     \"" << asset.contentType << "\",\n"
+            << "     \"\\\"" << asset.etag.substr(1, asset.etag.size() - 2)
+            << "\\\"\",\n"
+            << "     \"" << asset.lastModified << "\",\n"
+            << "     " << asset.modified << "},\n";
+    }
+    out << "};\n\n"
+        << "inline constexpr std::uint32_t displacements[] = {";
+    for (std::size_t i = 0; i < table.displacements.size(); i++) {
+        out << (i % 12 == 0 ? "\n    " : " ") << table.displacements[i] << ",";
+    }
+    out << "\n};\n\n"
+        << "inline constexpr std::int32_t slots[] = {";
+    for (std::size_t i = 0; i < table.slots.size(); i++) {
+        out << (i % 12 == 0 ? "\n    " : " ") << table.slots[i] << ",";
+    }
+    out << "\n};\n\n"
+        << "inline constexpr DinoScale::EmbeddedBundle bundle(assets, "
+           "displacements,\n"
+        << "                                                  slots);\n\n";
+    for (std::size_t i = 0; i < assets.size(); i++) {
+        out << "static_assert(bundle.Find(\"" << assets[i].path
+            << "\") == &assets[" << i << "]);\n";
+    }
+    out << "}  // namespace " << name << "\n";
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        std::fprintf(stderr,
+                     "usage: %s <output header> <namespace> <directory>\n",
+                     argv[0]);
+        return 2;
+    }
+    fs::path    output = argv[1];
+    std::string name = argv[2];
+    fs::path    directory = argv[3];
+
+    std::error_code error;
+    if (!fs::is_directory(directory, error)) {
+        std::fprintf(stderr, "%s is not a directory\n", argv[3]);
+        return 1;
+    }
+
+    std::vector<Asset> assets;
+    for (const fs::directory_entry& entry :
+         fs::recursive_directory_iterator(directory)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        Asset asset;
+        if (!readAsset(directory, entry.path(), asset)) {
+            std::fprintf(stderr, "cannot read %s\n",
+                         entry.path().string().c_str());
+            return 1;
+        }
+        if (asset.path.find_first_of("\"\\\n") != std::string::npos) {
+            std::fprintf(stderr, "unsupported file name %s\n",
+                         asset.path.c_str());
+            return 1;
+        }
+        assets.push_back(std::move(asset));
+    }
+    // sorted, so the same files always generate the same header
+    std::sort(assets.begin(), assets.end(),
+              [](const Asset& a, const Asset& b) { return a.path < b.path; });
+
+    PerfectHash table;
+    if (!assets.empty() && !buildPerfectHash(assets, table)) {
+        std::fprintf(stderr, "cannot build a perfect hash of %zu paths\n",
+                     assets.size());
+        return 1;
+    }
+
+    // written aside and renamed, a failed run leaves no partial header
+    std::ostringstream header;
+    writeHeader(header, name, directory, assets, table);
+    fs::path temporary = output;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out << header.str();
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", argv[1]);
+            return 1;
+        }
+    }
+    fs::rename(temporary, output, error);
+    if (error) {
+        std::fprintf(stderr, "cannot write %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}